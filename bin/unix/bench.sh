@@ -0,0 +1,94 @@
+#!/bin/bash
+
+set -e
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+BASE_URL="http://localhost:8080"
+ENDPOINT="/api/conversations"
+DURATION=30
+CONNECTIONS=64
+
+# Function to show help
+show_help() {
+    echo "Usage: $0 [OPTIONS]"
+    echo
+    echo "Measure requests per second for a GET endpoint of a running service."
+    echo "Uses wrk if installed, otherwise ab (ApacheBench)."
+    echo
+    echo "Options:"
+    echo "  --help, -h             Show this help message"
+    echo "  --url URL              Base URL of the service (default: $BASE_URL)"
+    echo "  --endpoint PATH        Endpoint to request (default: $ENDPOINT)"
+    echo "  --duration SECONDS     Length of the run (default: $DURATION)"
+    echo "  --connections N        Concurrent keep-alive connections (default: $CONNECTIONS)"
+    echo
+    echo "Examples:"
+    echo "  $0                                      # GET /api/conversations for 30s"
+    echo "  $0 --endpoint /api/conversations/1/messages --connections 128"
+    echo
+    echo "To compare two builds, start each in turn against the same database and"
+    echo "run this script with the same options."
+}
+
+while [[ $# -gt 0 ]]; do
+    case $1 in
+        --help|-h)
+            show_help
+            exit 0
+            ;;
+        --url)
+            BASE_URL="$2"
+            shift 2
+            ;;
+        --endpoint)
+            ENDPOINT="$2"
+            shift 2
+            ;;
+        --duration)
+            DURATION="$2"
+            shift 2
+            ;;
+        --connections)
+            CONNECTIONS="$2"
+            shift 2
+            ;;
+        *)
+            echo -e "${RED}Unknown option: $1${NC}"
+            show_help
+            exit 1
+            ;;
+    esac
+done
+
+URL="$BASE_URL$ENDPOINT"
+
+if ! curl -s -o /dev/null -f "$URL"; then
+    echo -e "${RED}$URL is not responding. Start the service first (./bin/start).${NC}"
+    exit 1
+fi
+
+echo -e "${BLUE}Benchmarking GET $URL for ${DURATION}s with $CONNECTIONS connections${NC}"
+
+if command -v wrk >/dev/null 2>&1; then
+    THREADS=$(( CONNECTIONS < 8 ? CONNECTIONS : 8 ))
+    OUTPUT=$(wrk -t"$THREADS" -c"$CONNECTIONS" -d"${DURATION}s" --latency "$URL")
+    echo "$OUTPUT"
+    RPS=$(echo "$OUTPUT" | awk '/Requests\/sec/ {print $2}')
+elif command -v ab >/dev/null 2>&1; then
+    OUTPUT=$(ab -k -q -c "$CONNECTIONS" -t "$DURATION" -n 10000000 "$URL")
+    echo "$OUTPUT"
+    RPS=$(echo "$OUTPUT" | awk '/Requests per second/ {print $4}')
+else
+    echo -e "${RED}Neither wrk nor ab is installed.${NC}"
+    echo -e "${YELLOW}Install wrk (brew install wrk / apt-get install wrk) or ab (apache2-utils).${NC}"
+    exit 1
+fi
+
+echo
+echo -e "${GREEN}GET $ENDPOINT: $RPS req/s${NC}"
@@ -95,6 +95,15 @@ if check_command "pkg-config"; then
             echo -e "   Or: ${YELLOW}sudo apt-get install libpq-dev${NC} (Ubuntu/Debian)"
         fi
     fi
+    
+    # Check zlib
+    if pkg-config --exists zlib; then
+        local version=$(pkg-config --modversion zlib)
+        echo -e "${GREEN}✅ zlib${NC} - Version: ${YELLOW}$version${NC}"
+    else
+        echo -e "${RED}❌ zlib${NC} - Not found"
+        echo -e "   Install with: ${YELLOW}sudo apt-get install zlib1g-dev${NC} (Ubuntu/Debian)"
+    fi
 else
     echo -e "${YELLOW}⚠️  pkg-config${NC} - Not found (needed to check libraries)"
     echo -e "${YELLOW}⚠️  Cannot check cpp-httplib and PostgreSQL${NC}"
@@ -111,12 +120,12 @@ echo
 echo "📖 Installation Instructions:"
 echo
 echo "macOS:"
-echo "  brew install docker cmake cpp-httplib postgresql"
+echo "  brew install docker cmake cpp-httplib postgresql zstd"
 echo "  # Or install Docker Desktop from https://docker.com"
 echo
 echo "Ubuntu/Debian:"
 echo "  sudo apt-get update"
-echo "  sudo apt-get install docker.io docker-compose cmake g++ libcpp-httplib-dev libpq-dev"
+echo "  sudo apt-get install docker.io docker-compose cmake g++ libcpp-httplib-dev libpq-dev zlib1g-dev libzstd-dev"
 echo
 echo "RHEL/CentOS:"
 echo "  sudo yum install docker cmake gcc-c++ postgresql-devel"
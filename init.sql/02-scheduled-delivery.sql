@@ -0,0 +1,10 @@
+-- Scheduled delivery recovery
+-- Unsent scheduled and rate-deferred messages record when they are due and
+-- which server node holds them in memory, so a restarted node can reload them
+
+ALTER TABLE messages ADD COLUMN IF NOT EXISTS scheduled_time TIMESTAMP WITH TIME ZONE;
+ALTER TABLE messages ADD COLUMN IF NOT EXISTS scheduled_node INTEGER;
+
+-- Only the small set of pending deliveries is indexed
+CREATE INDEX IF NOT EXISTS idx_messages_pending_delivery ON messages(scheduled_node, scheduled_time)
+    WHERE sent_time IS NULL AND scheduled_time IS NOT NULL;
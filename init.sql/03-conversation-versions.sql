@@ -0,0 +1,44 @@
+-- Conversation versions for conditional GET
+-- Every insert or update of a message bumps its conversation's version (and,
+-- through the existing trigger, updated_at), so clients can revalidate a
+-- conversation with a primary key lookup instead of re-reading its messages
+
+ALTER TABLE conversations ADD COLUMN IF NOT EXISTS version BIGINT NOT NULL DEFAULT 0;
+
+CREATE OR REPLACE FUNCTION bump_conversation_version()
+RETURNS TRIGGER AS $$
+BEGIN
+    UPDATE conversations SET version = version + 1 WHERE id = NEW.conversation_id;
+    RETURN NULL;
+END;
+$$ language 'plpgsql';
+
+DROP TRIGGER IF EXISTS bump_conversation_version ON messages;
+CREATE TRIGGER bump_conversation_version
+    AFTER INSERT OR UPDATE ON messages
+    FOR EACH ROW
+    EXECUTE FUNCTION bump_conversation_version();
+
+-- The conversations list has a version of its own: a sequence advanced by
+-- every statement that changes conversations, including the version updates
+-- above. nextval takes no row lock and leaves no dead tuple, so concurrent
+-- writers do not serialize on it. A sequence is not transactional, so readers
+-- combine it with max(updated_at), which only moves once the write commits,
+-- and a list read while a write was in flight is revalidated after it lands.
+DROP TABLE IF EXISTS conversation_list_version;
+CREATE SEQUENCE IF NOT EXISTS conversation_list_version;
+CREATE INDEX IF NOT EXISTS idx_conversations_updated_at ON conversations(updated_at);
+
+CREATE OR REPLACE FUNCTION bump_conversation_list_version()
+RETURNS TRIGGER AS $$
+BEGIN
+    PERFORM nextval('conversation_list_version');
+    RETURN NULL;
+END;
+$$ language 'plpgsql';
+
+DROP TRIGGER IF EXISTS bump_conversation_list_version ON conversations;
+CREATE TRIGGER bump_conversation_list_version
+    AFTER INSERT OR UPDATE OR DELETE ON conversations
+    FOR EACH STATEMENT
+    EXECUTE FUNCTION bump_conversation_list_version();
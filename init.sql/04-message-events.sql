@@ -0,0 +1,24 @@
+-- Message events for event stream subscribers
+-- Every new message is announced on the message_events channel. The payload
+-- carries ids and addresses only, well under the 8000 byte NOTIFY limit;
+-- listeners load the message itself when someone is subscribed to it.
+-- Notifications are sent when the inserting transaction commits.
+
+CREATE OR REPLACE FUNCTION notify_message_event()
+RETURNS TRIGGER AS $$
+BEGIN
+    PERFORM pg_notify('message_events', json_build_object(
+        'id', NEW.id,
+        'conversation_id', NEW.conversation_id,
+        'from_address', NEW.from_address,
+        'to_address', NEW.to_address
+    )::text);
+    RETURN NULL;
+END;
+$$ language 'plpgsql';
+
+DROP TRIGGER IF EXISTS notify_message_event ON messages;
+CREATE TRIGGER notify_message_event
+    AFTER INSERT ON messages
+    FOR EACH ROW
+    EXECUTE FUNCTION notify_message_event();
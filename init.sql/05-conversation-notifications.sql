@@ -0,0 +1,18 @@
+-- Cross-instance cache invalidation
+-- Each bump of a conversation's version is announced on conversation_changes
+-- with the new tag ("<conversation id>.<version>", the value behind the
+-- conversation's ETag), so every server process can drop cached pages that
+-- another process's write made stale. Notifications are sent when the
+-- writing transaction commits.
+
+CREATE OR REPLACE FUNCTION bump_conversation_version()
+RETURNS TRIGGER AS $$
+DECLARE
+    new_version BIGINT;
+BEGIN
+    UPDATE conversations SET version = version + 1 WHERE id = NEW.conversation_id
+    RETURNING version INTO new_version;
+    PERFORM pg_notify('conversation_changes', NEW.conversation_id || '.' || new_version);
+    RETURN NULL;
+END;
+$$ language 'plpgsql';
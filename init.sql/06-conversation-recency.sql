@@ -0,0 +1,42 @@
+-- Per-participant inboxes ordered by latest activity
+-- last_message_at is the newest message timestamp in the conversation (its
+-- creation time until the first message) and is kept current by the
+-- version trigger. Each participant column has an index on
+-- (participant, last_message_at DESC, id DESC) that includes the other
+-- listed columns, so one user's inbox page is an index-only range scan per
+-- side of the conversation.
+
+ALTER TABLE conversations ADD COLUMN IF NOT EXISTS last_message_at TIMESTAMP WITH TIME ZONE;
+
+UPDATE conversations c
+SET last_message_at = COALESCE((SELECT max(m.timestamp) FROM messages m WHERE m.conversation_id = c.id), c.created_at)
+WHERE last_message_at IS NULL;
+
+ALTER TABLE conversations ALTER COLUMN last_message_at SET DEFAULT CURRENT_TIMESTAMP;
+ALTER TABLE conversations ALTER COLUMN last_message_at SET NOT NULL;
+
+CREATE OR REPLACE FUNCTION bump_conversation_version()
+RETURNS TRIGGER AS $$
+DECLARE
+    new_version BIGINT;
+BEGIN
+    IF TG_OP = 'INSERT' THEN
+        UPDATE conversations
+        SET version = version + 1, last_message_at = GREATEST(last_message_at, NEW.timestamp)
+        WHERE id = NEW.conversation_id
+        RETURNING version INTO new_version;
+    ELSE
+        UPDATE conversations SET version = version + 1 WHERE id = NEW.conversation_id
+        RETURNING version INTO new_version;
+    END IF;
+    PERFORM pg_notify('conversation_changes', NEW.conversation_id || '.' || new_version);
+    RETURN NULL;
+END;
+$$ language 'plpgsql';
+
+CREATE INDEX IF NOT EXISTS idx_conversations_from_recency
+    ON conversations (participant_from, last_message_at DESC, id DESC)
+    INCLUDE (participant_to, created_at, updated_at);
+CREATE INDEX IF NOT EXISTS idx_conversations_to_recency
+    ON conversations (participant_to, last_message_at DESC, id DESC)
+    INCLUDE (participant_from, created_at, updated_at);
@@ -0,0 +1,87 @@
+-- Conversation summaries for inbox listings
+-- Each conversation carries its message count and the id, start of the body
+-- and timestamp of its newest message, so a listing page shows them without
+-- reading messages. The version trigger maintains them in the same
+-- statement, and so the same transaction, as the insert; deleting messages
+-- recomputes them from what is left.
+
+ALTER TABLE conversations ADD COLUMN IF NOT EXISTS last_message_id INTEGER;
+ALTER TABLE conversations ADD COLUMN IF NOT EXISTS last_message_preview TEXT;
+ALTER TABLE conversations ADD COLUMN IF NOT EXISTS message_count INTEGER NOT NULL DEFAULT 0;
+
+CREATE OR REPLACE FUNCTION refresh_conversation_summary(target_id INTEGER)
+RETURNS VOID AS $$
+DECLARE
+    latest RECORD;
+BEGIN
+    -- All nulls when the conversation has no messages left
+    SELECT id, body, timestamp INTO latest FROM messages
+    WHERE conversation_id = target_id
+    ORDER BY timestamp DESC, id DESC
+    LIMIT 1;
+
+    UPDATE conversations
+    SET message_count = (SELECT count(*) FROM messages WHERE conversation_id = target_id),
+        last_message_id = latest.id,
+        last_message_preview = left(latest.body, 100),
+        last_message_at = COALESCE(latest.timestamp, created_at)
+    WHERE id = target_id;
+END;
+$$ language 'plpgsql';
+
+SELECT refresh_conversation_summary(id) FROM conversations WHERE last_message_id IS NULL;
+
+CREATE OR REPLACE FUNCTION bump_conversation_version()
+RETURNS TRIGGER AS $$
+DECLARE
+    new_version BIGINT;
+BEGIN
+    IF TG_OP = 'INSERT' THEN
+        -- Messages can arrive out of order; only a newer one replaces the summary
+        UPDATE conversations
+        SET version = version + 1,
+            message_count = message_count + 1,
+            last_message_id = CASE WHEN last_message_id IS NULL OR NEW.timestamp >= last_message_at
+                                   THEN NEW.id ELSE last_message_id END,
+            last_message_preview = CASE WHEN last_message_id IS NULL OR NEW.timestamp >= last_message_at
+                                        THEN left(NEW.body, 100) ELSE last_message_preview END,
+            last_message_at = GREATEST(last_message_at, NEW.timestamp)
+        WHERE id = NEW.conversation_id
+        RETURNING version INTO new_version;
+    ELSIF TG_OP = 'UPDATE' THEN
+        UPDATE conversations
+        SET version = version + 1,
+            last_message_preview = CASE WHEN last_message_id = NEW.id
+                                        THEN left(NEW.body, 100) ELSE last_message_preview END
+        WHERE id = NEW.conversation_id
+        RETURNING version INTO new_version;
+    ELSE
+        -- Nothing to update when the delete cascades from the conversation itself
+        PERFORM refresh_conversation_summary(OLD.conversation_id);
+        UPDATE conversations SET version = version + 1 WHERE id = OLD.conversation_id
+        RETURNING version INTO new_version;
+        IF FOUND THEN
+            PERFORM pg_notify('conversation_changes', OLD.conversation_id || '.' || new_version);
+        END IF;
+        RETURN NULL;
+    END IF;
+    PERFORM pg_notify('conversation_changes', NEW.conversation_id || '.' || new_version);
+    RETURN NULL;
+END;
+$$ language 'plpgsql';
+
+DROP TRIGGER IF EXISTS bump_conversation_version ON messages;
+CREATE TRIGGER bump_conversation_version
+    AFTER INSERT OR UPDATE OR DELETE ON messages
+    FOR EACH ROW
+    EXECUTE FUNCTION bump_conversation_version();
+
+-- Participant listings return the summaries too, so the recency indexes cover them
+DROP INDEX IF EXISTS idx_conversations_from_recency;
+DROP INDEX IF EXISTS idx_conversations_to_recency;
+CREATE INDEX idx_conversations_from_recency
+    ON conversations (participant_from, last_message_at DESC, id DESC)
+    INCLUDE (participant_to, created_at, updated_at, message_count, last_message_id, last_message_preview);
+CREATE INDEX idx_conversations_to_recency
+    ON conversations (participant_to, last_message_at DESC, id DESC)
+    INCLUDE (participant_from, created_at, updated_at, message_count, last_message_id, last_message_preview);
@@ -0,0 +1,203 @@
+-- Monthly partitions of messages
+-- messages is range partitioned on timestamp, one partition per UTC month
+-- named messages_pYYYY_MM, so inserts only touch the current month's
+-- indexes and old history is removed by dropping whole partitions instead
+-- of deleting rows. Timestamps outside every month land in messages_default
+-- and move to their month when it is created; rows there older than the
+-- retention cutoff are deleted when partitions expire.
+--
+-- The server calls ensure_message_partitions() at startup and hourly to keep
+-- the coming months created, and expire_message_partitions() when
+-- message_retention_months is set. Both serialize on an advisory lock, so
+-- any number of processes can run them. The primary key becomes
+-- (id, timestamp), because unique indexes must include the partition key,
+-- so single-message lookups also match on timestamp to touch one partition;
+-- message_events notifications carry it for that reason.
+--
+-- The low-cardinality message_type and direction indexes are not recreated,
+-- and the conversation_id and timestamp indexes are replaced by one on
+-- (conversation_id, timestamp), which also orders a conversation's messages.
+
+-- Creates the partition for the UTC month starting at month_start; false if it exists
+CREATE OR REPLACE FUNCTION create_message_partition(month_start TIMESTAMP)
+RETURNS BOOLEAN AS $$
+DECLARE
+    partition_name TEXT := 'messages_p' || to_char(month_start, 'YYYY_MM');
+    range_start TIMESTAMPTZ := month_start AT TIME ZONE 'UTC';
+    range_end TIMESTAMPTZ := (month_start + interval '1 month') AT TIME ZONE 'UTC';
+BEGIN
+    IF to_regclass(partition_name) IS NOT NULL THEN
+        RETURN FALSE;
+    END IF;
+
+    IF NOT EXISTS (SELECT 1 FROM messages_default WHERE timestamp >= range_start AND timestamp < range_end) THEN
+        EXECUTE format('CREATE TABLE %I PARTITION OF messages FOR VALUES FROM (%L) TO (%L)',
+                       partition_name, range_start, range_end);
+        RETURN TRUE;
+    END IF;
+
+    -- Early rows move out of the default partition. Copying into a table
+    -- that is attached afterwards, and deleting while the default partition
+    -- is detached, keeps the message triggers from counting them twice.
+    ALTER TABLE messages DETACH PARTITION messages_default;
+    EXECUTE format('CREATE TABLE %I (LIKE messages INCLUDING DEFAULTS INCLUDING CONSTRAINTS)', partition_name);
+    EXECUTE format('INSERT INTO %I SELECT * FROM messages_default WHERE timestamp >= %L AND timestamp < %L',
+                   partition_name, range_start, range_end);
+    DELETE FROM messages_default WHERE timestamp >= range_start AND timestamp < range_end;
+    EXECUTE format('ALTER TABLE messages ATTACH PARTITION %I FOR VALUES FROM (%L) TO (%L)',
+                   partition_name, range_start, range_end);
+    ALTER TABLE messages ATTACH PARTITION messages_default DEFAULT;
+    RETURN TRUE;
+END;
+$$ language 'plpgsql';
+
+-- Creates the partitions for this month and the next months_ahead; returns how many were new
+CREATE OR REPLACE FUNCTION ensure_message_partitions(months_ahead INTEGER)
+RETURNS INTEGER AS $$
+DECLARE
+    this_month TIMESTAMP := date_trunc('month', now() AT TIME ZONE 'UTC');
+    created INTEGER := 0;
+BEGIN
+    PERFORM pg_advisory_xact_lock(hashtext('message_partitions'));
+    FOR i IN 0..months_ahead LOOP
+        IF create_message_partition(this_month + make_interval(months => i)) THEN
+            created := created + 1;
+        END IF;
+    END LOOP;
+    RETURN created;
+END;
+$$ language 'plpgsql';
+
+-- Detaches, and unless keep_detached drops, partitions whose whole month is
+-- older than retention_months before the current one; returns how many.
+-- Rows of the default partition older than the cutoff are deleted, after
+-- being copied to messages_default_before_YYYY_MM when keep_detached.
+-- Summaries and versions of the conversations that lost messages are
+-- refreshed, and the changes announced like any other write.
+CREATE OR REPLACE FUNCTION expire_message_partitions(retention_months INTEGER, keep_detached BOOLEAN DEFAULT FALSE)
+RETURNS INTEGER AS $$
+DECLARE
+    cutoff TIMESTAMP := date_trunc('month', now() AT TIME ZONE 'UTC') - make_interval(months => retention_months);
+    expired_partition TEXT;
+    affected INTEGER[];
+    conversation INTEGER;
+    new_version BIGINT;
+    expired INTEGER := 0;
+BEGIN
+    PERFORM pg_advisory_xact_lock(hashtext('message_partitions'));
+    FOR expired_partition IN
+        SELECT c.relname FROM pg_inherits i JOIN pg_class c ON c.oid = i.inhrelid
+        WHERE i.inhparent = 'messages'::regclass
+          AND c.relname ~ '^messages_p[0-9]{4}_[0-9]{2}$'
+          AND to_timestamp(substring(c.relname FROM 11), 'YYYY_MM')::timestamp + interval '1 month' <= cutoff
+        ORDER BY c.relname
+    LOOP
+        EXECUTE format('SELECT array_agg(DISTINCT conversation_id) FROM %I', expired_partition) INTO affected;
+        EXECUTE format('ALTER TABLE messages DETACH PARTITION %I', expired_partition);
+        IF NOT keep_detached THEN
+            EXECUTE format('DROP TABLE %I', expired_partition);
+        END IF;
+
+        FOREACH conversation IN ARRAY COALESCE(affected, '{}') LOOP
+            PERFORM refresh_conversation_summary(conversation);
+            UPDATE conversations SET version = version + 1 WHERE id = conversation
+            RETURNING version INTO new_version;
+            IF FOUND THEN
+                PERFORM pg_notify('conversation_changes', conversation || '.' || new_version);
+            END IF;
+        END LOOP;
+        expired := expired + 1;
+    END LOOP;
+
+    -- Deleting row by row fires the message triggers, which refresh the summaries
+    IF keep_detached THEN
+        EXECUTE format('CREATE TABLE IF NOT EXISTS %I (LIKE messages INCLUDING DEFAULTS INCLUDING CONSTRAINTS)',
+                       'messages_default_before_' || to_char(cutoff, 'YYYY_MM'));
+        EXECUTE format('INSERT INTO %I SELECT * FROM messages_default WHERE timestamp < %L',
+                       'messages_default_before_' || to_char(cutoff, 'YYYY_MM'), cutoff AT TIME ZONE 'UTC');
+    END IF;
+    DELETE FROM messages_default WHERE timestamp < cutoff AT TIME ZONE 'UTC';
+    RETURN expired;
+END;
+$$ language 'plpgsql';
+
+-- One-time conversion of the unpartitioned table
+DO $$
+BEGIN
+    IF EXISTS (SELECT 1 FROM pg_partitioned_table WHERE partrelid = 'messages'::regclass) THEN
+        RETURN;
+    END IF;
+
+    ALTER TABLE messages RENAME TO messages_unpartitioned;
+    ALTER TABLE messages_unpartitioned RENAME CONSTRAINT messages_pkey TO messages_unpartitioned_pkey;
+    ALTER SEQUENCE messages_id_seq OWNED BY NONE;
+
+    CREATE TABLE messages (
+        id INTEGER NOT NULL DEFAULT nextval('messages_id_seq'),
+        conversation_id INTEGER REFERENCES conversations(id) ON DELETE CASCADE,
+        from_address VARCHAR(255) NOT NULL,
+        to_address VARCHAR(255) NOT NULL,
+        message_type VARCHAR(10) NOT NULL CHECK (message_type IN ('sms', 'mms', 'email')),
+        body TEXT NOT NULL,
+        attachments JSONB DEFAULT '[]'::jsonb,
+        messaging_provider_id VARCHAR(255),
+        timestamp TIMESTAMP WITH TIME ZONE NOT NULL,
+        sent_time TIMESTAMP WITH TIME ZONE DEFAULT CURRENT_TIMESTAMP,
+        created_at TIMESTAMP WITH TIME ZONE DEFAULT CURRENT_TIMESTAMP,
+        direction VARCHAR(10) NOT NULL CHECK (direction IN ('inbound', 'outbound')),
+        scheduled_time TIMESTAMP WITH TIME ZONE,
+        scheduled_node INTEGER,
+        PRIMARY KEY (id, timestamp)
+    ) PARTITION BY RANGE (timestamp);
+    CREATE TABLE messages_default PARTITION OF messages DEFAULT;
+
+    PERFORM create_message_partition(month_start)
+    FROM (SELECT DISTINCT date_trunc('month', timestamp AT TIME ZONE 'UTC') AS month_start FROM messages_unpartitioned) months;
+
+    -- Copied before the message triggers exist, so summaries and versions stay as they are
+    INSERT INTO messages (id, conversation_id, from_address, to_address, message_type, body, attachments,
+                          messaging_provider_id, timestamp, sent_time, created_at, direction,
+                          scheduled_time, scheduled_node)
+    SELECT id, conversation_id, from_address, to_address, message_type, body, attachments,
+           messaging_provider_id, timestamp, sent_time, created_at, direction,
+           scheduled_time, scheduled_node
+    FROM messages_unpartitioned;
+
+    -- Takes the old table's indexes and triggers with it
+    DROP TABLE messages_unpartitioned;
+    ALTER SEQUENCE messages_id_seq OWNED BY messages.id;
+END;
+$$;
+
+CREATE INDEX IF NOT EXISTS idx_messages_conversation_timestamp ON messages(conversation_id, timestamp);
+CREATE INDEX IF NOT EXISTS idx_messages_pending_delivery ON messages(scheduled_node, scheduled_time)
+    WHERE sent_time IS NULL AND scheduled_time IS NOT NULL;
+
+DROP TRIGGER IF EXISTS bump_conversation_version ON messages;
+CREATE TRIGGER bump_conversation_version
+    AFTER INSERT OR UPDATE OR DELETE ON messages
+    FOR EACH ROW
+    EXECUTE FUNCTION bump_conversation_version();
+
+-- The timestamp lets listeners load the message from its own partition
+CREATE OR REPLACE FUNCTION notify_message_event()
+RETURNS TRIGGER AS $$
+BEGIN
+    PERFORM pg_notify('message_events', json_build_object(
+        'id', NEW.id,
+        'timestamp', NEW.timestamp,
+        'conversation_id', NEW.conversation_id,
+        'from_address', NEW.from_address,
+        'to_address', NEW.to_address
+    )::text);
+    RETURN NULL;
+END;
+$$ language 'plpgsql';
+
+DROP TRIGGER IF EXISTS notify_message_event ON messages;
+CREATE TRIGGER notify_message_event
+    AFTER INSERT ON messages
+    FOR EACH ROW
+    EXECUTE FUNCTION notify_message_event();
+
+SELECT ensure_message_partitions(3);
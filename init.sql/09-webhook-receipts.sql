@@ -0,0 +1,25 @@
+-- Inbound webhook receipts
+-- One row per provider message id received by a webhook, inserted in the
+-- same statement as the message, so a redelivered webhook conflicts on the
+-- primary key and stores nothing. source separates the id spaces of the
+-- SMS/MMS provider (messaging_provider_id) and the email provider
+-- (xillio_id). Receipts older than 30 days are pruned by the server;
+-- providers stop redelivering long before that.
+
+CREATE TABLE IF NOT EXISTS webhook_receipts (
+    source VARCHAR(10) NOT NULL,
+    provider_message_id VARCHAR(255) NOT NULL,
+    received_at TIMESTAMP WITH TIME ZONE NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (source, provider_message_id)
+);
+
+CREATE INDEX IF NOT EXISTS idx_webhook_receipts_received_at ON webhook_receipts(received_at);
+
+-- Messages received before receipts existed
+INSERT INTO webhook_receipts (source, provider_message_id, received_at)
+SELECT CASE WHEN message_type = 'email' THEN 'email' ELSE 'sms' END, messaging_provider_id, min(created_at)
+FROM messages
+WHERE direction = 'inbound' AND messaging_provider_id IS NOT NULL
+  AND created_at > CURRENT_TIMESTAMP - interval '30 days'
+GROUP BY 1, 2
+ON CONFLICT DO NOTHING;
@@ -0,0 +1,19 @@
+-- Idempotency keys for outbound sends
+-- A request with an Idempotency-Key header claims its key here before
+-- sending and stores its response afterwards, so a retry that reaches
+-- another process or arrives after a restart replays the response instead
+-- of sending again. Rows without a response are in flight; a claim older
+-- than five minutes is taken to belong to a process that died and may be taken
+-- over. Keys are pruned by the server after 24 hours.
+
+CREATE TABLE IF NOT EXISTS idempotency_keys (
+    idempotency_key VARCHAR(512) PRIMARY KEY,
+    fingerprint VARCHAR(64) NOT NULL,
+    status_code INTEGER,
+    response_body TEXT,
+    content_type VARCHAR(255),
+    created_at TIMESTAMP WITH TIME ZONE NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    completed_at TIMESTAMP WITH TIME ZONE
+);
+
+CREATE INDEX IF NOT EXISTS idx_idempotency_keys_created_at ON idempotency_keys(created_at);
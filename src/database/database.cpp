@@ -1,21 +1,129 @@
 #include "database.h"
-#include <iostream>
+#include "../utils/json_parser.h"
+#include "../utils/logger.h"
+#include "../utils/message_event_hub.h"
+#include "../utils/message_page_cache.h"
+#include "../utils/metrics.h"
+#include "../utils/tracing.h"
+#include <cerrno>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
+#include <poll.h>
+
+namespace {
+
+// libpq error messages end with a newline
+std::string errorMessage(PGconn* connection) {
+    std::string message = PQerrorMessage(connection);
+    while (!message.empty() && (message.back() == '\n' || message.back() == ' ')) {
+        message.pop_back();
+    }
+    return message;
+}
+
+messaging_service::Histogram& statementLatency(const char* statement) {
+    return messaging_service::MetricsRegistry::instance().histogram(
+        "db_statement_duration_seconds", "Time spent executing database statements", {{"statement", statement}});
+}
+
+// Runs a libpq call, records how long it took and traces it as a stage of the request
+template<typename Exec>
+PGresult* timed(const char* span, messaging_service::Histogram& latency, Exec exec) {
+    messaging_service::Span stage(span);
+    auto start = std::chrono::steady_clock::now();
+    PGresult* result = exec();
+    latency.observe(std::chrono::steady_clock::now() - start);
+    return result;
+}
+
+// Columns read by appendConversationJson, in order
+const char* const kConversationColumns = "id, participant_from, participant_to, created_at, updated_at, last_message_at, "
+                                         "message_count, last_message_id, last_message_preview";
+const int kConversationColumnCount = 9;
+
+// Appends one conversation row selected with kConversationColumns as a JSON object
+void appendConversationJson(std::string& json_response, PGresult* result, int row) {
+    std::string id = PQgetvalue(result, row, 0);
+    std::string participant_from = PQgetvalue(result, row, 1);
+    std::string participant_to = PQgetvalue(result, row, 2);
+    std::string created_at = PQgetvalue(result, row, 3);
+    std::string updated_at = PQgetvalue(result, row, 4);
+    std::string last_message_at = PQgetvalue(result, row, 5);
+    std::string message_count = PQgetvalue(result, row, 6);
+    
+    json_response += "{";
+    json_response += "\"id\":" + id + ",";
+    json_response += "\"participant_from\":\"" + participant_from + "\",";
+    json_response += "\"participant_to\":\"" + participant_to + "\",";
+    json_response += "\"created_at\":\"" + created_at + "\",";
+    json_response += "\"updated_at\":\"" + updated_at + "\",";
+    json_response += "\"last_message_at\":\"" + last_message_at + "\",";
+    json_response += "\"message_count\":" + message_count + ",";
+    if (PQgetisnull(result, row, 7)) {
+        json_response += "\"last_message_id\":null,\"last_message_preview\":null";
+    } else {
+        json_response += "\"last_message_id\":" + std::string(PQgetvalue(result, row, 7)) + ",";
+        json_response += "\"last_message_preview\":\"" + JsonParser::escape(PQgetvalue(result, row, 8)) + "\"";
+    }
+    json_response += "}";
+}
+
+// Columns read by appendMessageJson, in order
+const char* const kMessageColumns = R"(id, conversation_id, from_address, to_address, message_type, body, 
+               attachments, messaging_provider_id, timestamp, sent_time, created_at, direction)";
+
+// Appends one message row selected with kMessageColumns as a JSON object
+void appendMessageJson(std::string& json_response, PGresult* result, int row) {
+    std::string id = PQgetvalue(result, row, 0);
+    std::string conversation_id_db = PQgetvalue(result, row, 1);
+    std::string from_address = PQgetvalue(result, row, 2);
+    std::string to_address = PQgetvalue(result, row, 3);
+    std::string message_type = PQgetvalue(result, row, 4);
+    std::string body = PQgetvalue(result, row, 5);
+    std::string attachments = PQgetvalue(result, row, 6);
+    std::string messaging_provider_id = PQgetvalue(result, row, 7);
+    std::string timestamp = PQgetvalue(result, row, 8);
+    std::string sent_time = PQgetvalue(result, row, 9);
+    std::string created_at = PQgetvalue(result, row, 10);
+    std::string direction = PQgetvalue(result, row, 11);
+    
+    json_response += "{";
+    json_response += "\"id\":" + id + ",";
+    json_response += "\"conversation_id\":" + conversation_id_db + ",";
+    json_response += "\"from_address\":\"" + from_address + "\",";
+    json_response += "\"to_address\":\"" + to_address + "\",";
+    json_response += "\"message_type\":\"" + message_type + "\",";
+    json_response += "\"body\":\"" + body + "\",";
+    json_response += "\"attachments\":" + attachments + ",";
+    json_response += "\"messaging_provider_id\":\"" + messaging_provider_id + "\",";
+    json_response += "\"timestamp\":\"" + timestamp + "\",";
+    json_response += "\"sent_time\":\"" + sent_time + "\",";
+    json_response += "\"created_at\":\"" + created_at + "\",";
+    json_response += "\"direction\":\"" + direction + "\"";
+    json_response += "}";
+}
+
+} // namespace
 
 Database::Database() : connection_(nullptr, PQfinish) {
     connection_string_ = buildConnectionString();
 }
 
 bool Database::connect() {
+    static auto& connectLatency = messaging_service::MetricsRegistry::instance().histogram(
+        "db_connect_duration_seconds", "Time spent opening database connections");
+    messaging_service::Span stage("db.connect");
+    auto start = std::chrono::steady_clock::now();
     connection_ = std::unique_ptr<PGconn, decltype(&PQfinish)>(PQconnectdb(connection_string_.c_str()), PQfinish);
+    connectLatency.observe(std::chrono::steady_clock::now() - start);
     
     if (PQstatus(connection_.get()) != CONNECTION_OK) {
-        std::cerr << "Database connection failed: " << PQerrorMessage(connection_.get()) << std::endl;
+        LOG_ERROR("database", "Database connection failed", {{"error", errorMessage(connection_.get())}});
         return false;
     }
     
-    std::cout << "Database connected successfully" << std::endl;
+    LOG_DEBUG("database", "Database connected successfully");
     return true;
 }
 
@@ -25,7 +133,7 @@ bool Database::isConnected() const {
 
 int Database::findOrCreateConversation(const std::string& participant_from, const std::string& participant_to) {
     if (!isConnected()) {
-        std::cerr << "Database not connected" << std::endl;
+        LOG_ERROR("database", "Database not connected");
         return -1;
     }
     
@@ -35,7 +143,8 @@ int Database::findOrCreateConversation(const std::string& participant_from, cons
     int param_lengths[] = {static_cast<int>(participant_from.length()), static_cast<int>(participant_to.length())};
     int param_formats[] = {0, 0}; // text format
     
-    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(PQexecParams(connection_.get(), select_query.c_str(), 2, nullptr, param_values, param_lengths, param_formats, 0), PQclear);
+    static auto& selectConversationLatency = statementLatency("select_conversation");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.select_conversation", selectConversationLatency, [&] { return PQexecParams(connection_.get(), select_query.c_str(), 2, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
     
     if (PQresultStatus(result.get()) == PGRES_TUPLES_OK && PQntuples(result.get()) > 0) {
         return std::atoi(PQgetvalue(result.get(), 0, 0));
@@ -44,28 +153,30 @@ int Database::findOrCreateConversation(const std::string& participant_from, cons
     // If not found, create new conversation
     std::string insert_query = "INSERT INTO conversations (participant_from, participant_to) VALUES ($1, $2) RETURNING id";
     
-    result = std::unique_ptr<PGresult, decltype(&PQclear)>(PQexecParams(connection_.get(), insert_query.c_str(), 2, nullptr, param_values, param_lengths, param_formats, 0), PQclear);
+    static auto& insertConversationLatency = statementLatency("insert_conversation");
+    result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.insert_conversation", insertConversationLatency, [&] { return PQexecParams(connection_.get(), insert_query.c_str(), 2, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
     
     if (PQresultStatus(result.get()) == PGRES_TUPLES_OK && PQntuples(result.get()) > 0) {
         return std::atoi(PQgetvalue(result.get(), 0, 0));
     }
     
-    std::cerr << "Failed to find or create conversation: " << PQerrorMessage(connection_.get()) << std::endl;
+    LOG_ERROR("database", "Failed to find or create conversation", {{"error", errorMessage(connection_.get())}});
     return -1;
 }
 
 std::string Database::getAllConversations() {
     if (!isConnected()) {
-        std::cerr << "Database not connected" << std::endl;
+        LOG_ERROR("database", "Database not connected");
         return "{\"conversations\": [], \"error\": \"Database not connected\"}";
     }
     
-    std::string select_query = "SELECT id, participant_from, participant_to, created_at, updated_at FROM conversations ORDER BY created_at DESC";
+    std::string select_query = std::string("SELECT ") + kConversationColumns + " FROM conversations ORDER BY created_at DESC";
     
-    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(PQexec(connection_.get(), select_query.c_str()), PQclear);
+    static auto& listConversationsLatency = statementLatency("list_conversations");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.list_conversations", listConversationsLatency, [&] { return PQexec(connection_.get(), select_query.c_str()); }), PQclear);
     
     if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
-        std::cerr << "Failed to query conversations: " << PQerrorMessage(connection_.get()) << std::endl;
+        LOG_ERROR("database", "Failed to query conversations", {{"error", errorMessage(connection_.get())}});
         return "{\"conversations\": [], \"error\": \"Database query failed\"}";
     }
     
@@ -77,28 +188,94 @@ std::string Database::getAllConversations() {
             json_response += ",";
         }
         
-        std::string id = PQgetvalue(result.get(), i, 0);
-        std::string participant_from = PQgetvalue(result.get(), i, 1);
-        std::string participant_to = PQgetvalue(result.get(), i, 2);
-        std::string created_at = PQgetvalue(result.get(), i, 3);
-        std::string updated_at = PQgetvalue(result.get(), i, 4);
-        
-        json_response += "{";
-        json_response += "\"id\":" + id + ",";
-        json_response += "\"participant_from\":\"" + participant_from + "\",";
-        json_response += "\"participant_to\":\"" + participant_to + "\",";
-        json_response += "\"created_at\":\"" + created_at + "\",";
-        json_response += "\"updated_at\":\"" + updated_at + "\"";
-        json_response += "}";
+        appendConversationJson(json_response, result.get(), i);
     }
     
     json_response += "]}";
     return json_response;
 }
 
+std::string Database::getConversationsForParticipant(const std::string& participant, int limit,
+                                                     long long before_micros, int before_id, bool* succeeded) {
+    if (succeeded) {
+        *succeeded = false;
+    }
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return "{\"conversations\": [], \"error\": \"Database not connected\"}";
+    }
+    
+    // One ordered range scan per side of the conversation, merged; see init.sql/06-conversation-recency.sql.
+    // The second side skips conversations with oneself, which the first already returned
+    std::string side = std::string("SELECT ") + kConversationColumns + R"(,
+               (EXTRACT(EPOCH FROM last_message_at) * 1000000)::bigint AS recency
+        FROM conversations
+        WHERE %s = $1
+          AND ($3::bigint IS NULL OR (last_message_at, id) < ('epoch'::timestamptz + $3::bigint * interval '1 microsecond', $4::integer))
+          %s
+        ORDER BY last_message_at DESC, id DESC
+        LIMIT $2)";
+    auto sideQuery = [&side](const char* column, const char* extra) {
+        std::string query = side;
+        query.replace(query.find("%s"), 2, column);
+        query.replace(query.find("%s"), 2, extra);
+        return query;
+    };
+    std::string select_query = "SELECT * FROM ((" + sideQuery("participant_from", "") + ") UNION ALL (" +
+                               sideQuery("participant_to", "AND participant_from <> $1") +
+                               ")) inbox ORDER BY last_message_at DESC, id DESC LIMIT $2";
+    
+    std::string limit_str = std::to_string(limit);
+    std::string before_micros_str = std::to_string(before_micros);
+    std::string before_id_str = std::to_string(before_id);
+    bool has_cursor = before_id > 0;
+    const char* param_values[] = {
+        participant.c_str(),
+        limit_str.c_str(),
+        has_cursor ? before_micros_str.c_str() : nullptr,
+        has_cursor ? before_id_str.c_str() : nullptr
+    };
+    int param_lengths[] = {
+        static_cast<int>(participant.length()),
+        static_cast<int>(limit_str.length()),
+        static_cast<int>(before_micros_str.length()),
+        static_cast<int>(before_id_str.length())
+    };
+    int param_formats[] = {0, 0, 0, 0}; // all text format
+    
+    static auto& participantConversationsLatency = statementLatency("list_participant_conversations");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.list_participant_conversations", participantConversationsLatency, [&] { return PQexecParams(connection_.get(), select_query.c_str(), 4, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
+        LOG_ERROR("database", "Failed to query participant conversations", {{"error", errorMessage(connection_.get())}});
+        return "{\"conversations\": [], \"error\": \"Database query failed\"}";
+    }
+    
+    int num_rows = PQntuples(result.get());
+    std::string json_response = "{\"conversations\": [";
+    for (int i = 0; i < num_rows; ++i) {
+        if (i > 0) {
+            json_response += ",";
+        }
+        appendConversationJson(json_response, result.get(), i);
+    }
+    json_response += "]";
+    
+    // A full page may have more after it; the cursor is the last row's position in the ordering
+    if (num_rows > 0 && num_rows == limit) {
+        json_response += ",\"next_before\":\"" + std::string(PQgetvalue(result.get(), num_rows - 1, kConversationColumnCount)) + ":" +
+                         PQgetvalue(result.get(), num_rows - 1, 0) + "\"";
+    }
+    json_response += "}";
+    if (succeeded) {
+        *succeeded = true;
+    }
+    return json_response;
+}
+
 bool Database::conversationExists(int conversation_id) {
     if (!isConnected()) {
-        std::cerr << "Database not connected" << std::endl;
+        LOG_ERROR("database", "Database not connected");
         return false;
     }
     
@@ -108,7 +285,8 @@ bool Database::conversationExists(int conversation_id) {
     int param_lengths[] = {static_cast<int>(conversation_id_str.length())};
     int param_formats[] = {0}; // text format
     
-    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(PQexecParams(connection_.get(), select_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0), PQclear);
+    static auto& conversationExistsLatency = statementLatency("conversation_exists");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.conversation_exists", conversationExistsLatency, [&] { return PQexecParams(connection_.get(), select_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
     
     if (PQresultStatus(result.get()) == PGRES_TUPLES_OK && PQntuples(result.get()) > 0) {
         return true;
@@ -117,15 +295,114 @@ bool Database::conversationExists(int conversation_id) {
     return false;
 }
 
-std::string Database::getMessagesForConversation(int conversation_id) {
+bool Database::getConversationVersion(int conversation_id, ResourceVersion& version) {
+    version = ResourceVersion();
     if (!isConnected()) {
-        std::cerr << "Database not connected" << std::endl;
-        return "{\"messages\": [], \"error\": \"Database not connected\"}";
+        LOG_ERROR("database", "Database not connected");
+        return false;
+    }
+    
+    // version is bumped by a trigger on messages, see init.sql/03-conversation-versions.sql
+    std::string select_query = R"(
+        SELECT version, to_char(updated_at AT TIME ZONE 'UTC', 'Dy, DD Mon YYYY HH24:MI:SS "GMT"')
+        FROM conversations
+        WHERE id = $1
+    )";
+    std::string conversation_id_str = std::to_string(conversation_id);
+    const char* param_values[] = {conversation_id_str.c_str()};
+    int param_lengths[] = {static_cast<int>(conversation_id_str.length())};
+    int param_formats[] = {0}; // text format
+    
+    static auto& conversationVersionLatency = statementLatency("conversation_version");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.conversation_version", conversationVersionLatency, [&] { return PQexecParams(connection_.get(), select_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
+        LOG_ERROR("database", "Failed to query conversation version", {{"error", errorMessage(connection_.get())}});
+        return false;
+    }
+    if (PQntuples(result.get()) > 0) {
+        version.exists = true;
+        version.tag = conversation_id_str + "." + PQgetvalue(result.get(), 0, 0);
+        version.last_modified = PQgetvalue(result.get(), 0, 1);
+    }
+    return true;
+}
+
+bool Database::getConversationTags(const std::vector<int>& conversation_ids, std::vector<std::pair<int, std::string>>& tags) {
+    tags.clear();
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return false;
+    }
+    
+    std::string select_query = "SELECT id, version FROM conversations WHERE id = ANY($1::integer[])";
+    std::string ids_array = "{";
+    for (size_t i = 0; i < conversation_ids.size(); ++i) {
+        if (i > 0) {
+            ids_array += ",";
+        }
+        ids_array += std::to_string(conversation_ids[i]);
+    }
+    ids_array += "}";
+    const char* param_values[] = {ids_array.c_str()};
+    int param_lengths[] = {static_cast<int>(ids_array.length())};
+    int param_formats[] = {0}; // text format
+    
+    static auto& conversationTagsLatency = statementLatency("conversation_tags");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.conversation_tags", conversationTagsLatency, [&] { return PQexecParams(connection_.get(), select_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
+        LOG_ERROR("database", "Failed to query conversation tags", {{"error", errorMessage(connection_.get())}});
+        return false;
+    }
+    int rows = PQntuples(result.get());
+    tags.reserve(rows);
+    for (int i = 0; i < rows; ++i) {
+        std::string id = PQgetvalue(result.get(), i, 0);
+        tags.emplace_back(std::atoi(id.c_str()), id + "." + PQgetvalue(result.get(), i, 1));
+    }
+    return true;
+}
+
+bool Database::getConversationListVersion(ResourceVersion& version) {
+    version = ResourceVersion();
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return false;
     }
     
+    // The sequence moves with every statement that changes conversations; the newest
+    // updated_at, read from its index, only moves once that write has committed
     std::string select_query = R"(
-        SELECT id, conversation_id, from_address, to_address, message_type, body, 
-               attachments, messaging_provider_id, timestamp, sent_time, created_at, direction
+        SELECT (SELECT last_value FROM conversation_list_version),
+               COALESCE((EXTRACT(EPOCH FROM max(updated_at)) * 1000000)::bigint, 0),
+               COALESCE(to_char(max(updated_at) AT TIME ZONE 'UTC', 'Dy, DD Mon YYYY HH24:MI:SS "GMT"'), '')
+        FROM conversations
+    )";
+    
+    static auto& conversationListVersionLatency = statementLatency("conversation_list_version");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.conversation_list_version", conversationListVersionLatency, [&] { return PQexec(connection_.get(), select_query.c_str()); }), PQclear);
+    
+    if (PQresultStatus(result.get()) != PGRES_TUPLES_OK || PQntuples(result.get()) == 0) {
+        LOG_ERROR("database", "Failed to query conversation list version", {{"error", errorMessage(connection_.get())}});
+        return false;
+    }
+    version.exists = true;
+    version.tag = std::string("list.") + PQgetvalue(result.get(), 0, 0) + "." + PQgetvalue(result.get(), 0, 1);
+    version.last_modified = PQgetvalue(result.get(), 0, 2);
+    return true;
+}
+
+std::string Database::getMessagesForConversation(int conversation_id, bool* succeeded) {
+    if (succeeded) {
+        *succeeded = false;
+    }
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return "{\"messages\": [], \"error\": \"Database not connected\"}";
+    }
+    
+    std::string select_query = std::string("SELECT ") + kMessageColumns + R"(
         FROM messages 
         WHERE conversation_id = $1 
         ORDER BY timestamp ASC
@@ -136,10 +413,11 @@ std::string Database::getMessagesForConversation(int conversation_id) {
     int param_lengths[] = {static_cast<int>(conversation_id_str.length())};
     int param_formats[] = {0}; // text format
     
-    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(PQexecParams(connection_.get(), select_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0), PQclear);
+    static auto& listMessagesLatency = statementLatency("list_messages");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.list_messages", listMessagesLatency, [&] { return PQexecParams(connection_.get(), select_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
     
     if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
-        std::cerr << "Failed to query messages: " << PQerrorMessage(connection_.get()) << std::endl;
+        LOG_ERROR("database", "Failed to query messages", {{"error", errorMessage(connection_.get())}});
         return "{\"messages\": [], \"error\": \"Database query failed\"}";
     }
     
@@ -151,39 +429,105 @@ std::string Database::getMessagesForConversation(int conversation_id) {
             json_response += ",";
         }
         
-        std::string id = PQgetvalue(result.get(), i, 0);
-        std::string conversation_id_db = PQgetvalue(result.get(), i, 1);
-        std::string from_address = PQgetvalue(result.get(), i, 2);
-        std::string to_address = PQgetvalue(result.get(), i, 3);
-        std::string message_type = PQgetvalue(result.get(), i, 4);
-        std::string body = PQgetvalue(result.get(), i, 5);
-        std::string attachments = PQgetvalue(result.get(), i, 6);
-        std::string messaging_provider_id = PQgetvalue(result.get(), i, 7);
-        std::string timestamp = PQgetvalue(result.get(), i, 8);
-        std::string sent_time = PQgetvalue(result.get(), i, 9);
-        std::string created_at = PQgetvalue(result.get(), i, 10);
-        std::string direction = PQgetvalue(result.get(), i, 11);
-        
-        json_response += "{";
-        json_response += "\"id\":" + id + ",";
-        json_response += "\"conversation_id\":" + conversation_id_db + ",";
-        json_response += "\"from_address\":\"" + from_address + "\",";
-        json_response += "\"to_address\":\"" + to_address + "\",";
-        json_response += "\"message_type\":\"" + message_type + "\",";
-        json_response += "\"body\":\"" + body + "\",";
-        json_response += "\"attachments\":" + attachments + ",";
-        json_response += "\"messaging_provider_id\":\"" + messaging_provider_id + "\",";
-        json_response += "\"timestamp\":\"" + timestamp + "\",";
-        json_response += "\"sent_time\":\"" + sent_time + "\",";
-        json_response += "\"created_at\":\"" + created_at + "\",";
-        json_response += "\"direction\":\"" + direction + "\"";
-        json_response += "}";
+        appendMessageJson(json_response, result.get(), i);
     }
     
     json_response += "]}";
+    if (succeeded) {
+        *succeeded = true;
+    }
     return json_response;
 }
 
+bool Database::getMessageEvent(int message_id, const std::string& timestamp, messaging_service::MessageEvent& event) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return false;
+    }
+    
+    // The timestamp is the partition key, so only the message's own month is read
+    std::string select_query = std::string("SELECT ") + kMessageColumns + " FROM messages WHERE id = $1 AND timestamp = $2::timestamptz";
+    std::string message_id_str = std::to_string(message_id);
+    const char* param_values[] = {message_id_str.c_str(), timestamp.c_str()};
+    int param_lengths[] = {static_cast<int>(message_id_str.length()), static_cast<int>(timestamp.length())};
+    int param_formats[] = {0, 0}; // text format
+    
+    static auto& getMessageLatency = statementLatency("get_message");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.get_message", getMessageLatency, [&] { return PQexecParams(connection_.get(), select_query.c_str(), 2, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
+        LOG_ERROR("database", "Failed to query message", {{"error", errorMessage(connection_.get())}});
+        return false;
+    }
+    if (PQntuples(result.get()) == 0) {
+        return false;
+    }
+    event.messageId = message_id;
+    event.conversationId = std::atoi(PQgetvalue(result.get(), 0, 1));
+    event.fromAddress = PQgetvalue(result.get(), 0, 2);
+    event.toAddress = PQgetvalue(result.get(), 0, 3);
+    event.json.clear();
+    appendMessageJson(event.json, result.get(), 0);
+    return true;
+}
+
+bool Database::listen(const std::string& channel) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return false;
+    }
+    
+    // Channel names are identifiers, which cannot be bound as parameters
+    char* escaped = PQescapeIdentifier(connection_.get(), channel.c_str(), channel.length());
+    if (!escaped) {
+        LOG_ERROR("database", "Failed to escape channel name", {{"error", errorMessage(connection_.get())}});
+        return false;
+    }
+    std::string listen_query = std::string("LISTEN ") + escaped;
+    PQfreemem(escaped);
+    
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(PQexec(connection_.get(), listen_query.c_str()), PQclear);
+    if (PQresultStatus(result.get()) != PGRES_COMMAND_OK) {
+        LOG_ERROR("database", "Failed to listen for notifications", {{"channel", channel}, {"error", errorMessage(connection_.get())}});
+        return false;
+    }
+    return true;
+}
+
+bool Database::waitForNotifications(std::chrono::milliseconds timeout, std::vector<DatabaseNotification>& notifications) {
+    if (!isConnected()) {
+        return false;
+    }
+    
+    auto collect = [&] {
+        while (PGnotify* notification = PQnotifies(connection_.get())) {
+            notifications.push_back({notification->relname, notification->extra});
+            PQfreemem(notification);
+        }
+    };
+    
+    // Notifications can arrive alongside the result of an earlier query
+    size_t before = notifications.size();
+    collect();
+    if (notifications.size() == before) {
+        pollfd descriptor = {PQsocket(connection_.get()), POLLIN, 0};
+        if (descriptor.fd < 0) {
+            return false;
+        }
+        int ready = poll(&descriptor, 1, static_cast<int>(timeout.count()));
+        if (ready < 0 && errno != EINTR) {
+            LOG_ERROR("database", "Failed to wait for notifications", {{"error", std::strerror(errno)}});
+            return false;
+        }
+        if (ready > 0 && !PQconsumeInput(connection_.get())) {
+            LOG_ERROR("database", "Lost notification connection", {{"error", errorMessage(connection_.get())}});
+            return false;
+        }
+        collect();
+    }
+    return PQstatus(connection_.get()) == CONNECTION_OK;
+}
+
 int Database::insertMessage(int conversation_id, 
                            const std::string& from_address,
                            const std::string& to_address,
@@ -193,19 +537,23 @@ int Database::insertMessage(int conversation_id,
                            const std::string& messaging_provider_id,
                            const std::string& timestamp,
                            const std::string& direction,
-                           const std::string& sent_time) {
+                           const std::string& sent_time,
+                           long long scheduled_time_ms,
+                           int scheduled_node) {
     if (!isConnected()) {
-        std::cerr << "Database not connected" << std::endl;
+        LOG_ERROR("database", "Database not connected");
         return -1;
     }
     
     std::string insert_query = R"(
-        INSERT INTO messages (conversation_id, from_address, to_address, message_type, body, attachments, messaging_provider_id, timestamp, direction, sent_time)
-        VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9, $10)
+        INSERT INTO messages (conversation_id, from_address, to_address, message_type, body, attachments, messaging_provider_id, timestamp, direction, sent_time, scheduled_time, scheduled_node)
+        VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9, $10, to_timestamp($11::bigint / 1000.0), $12::integer)
         RETURNING id
     )";
     
     std::string conversation_id_str = std::to_string(conversation_id);
+    std::string scheduled_time_str = std::to_string(scheduled_time_ms);
+    std::string scheduled_node_str = std::to_string(scheduled_node);
     const char* param_values[] = {
         conversation_id_str.c_str(),
         from_address.c_str(),
@@ -216,7 +564,9 @@ int Database::insertMessage(int conversation_id,
         messaging_provider_id.c_str(),
         timestamp.c_str(),
         direction.c_str(),
-        sent_time.empty() ? nullptr : sent_time.c_str() // Use nullptr for empty string to represent NULL
+        sent_time.empty() ? nullptr : sent_time.c_str(), // Use nullptr for empty string to represent NULL
+        scheduled_time_ms > 0 ? scheduled_time_str.c_str() : nullptr,
+        scheduled_node >= 0 ? scheduled_node_str.c_str() : nullptr
     };
     
     int param_lengths[] = {
@@ -229,54 +579,415 @@ int Database::insertMessage(int conversation_id,
         static_cast<int>(messaging_provider_id.length()),
         static_cast<int>(timestamp.length()),
         static_cast<int>(direction.length()),
-        sent_time.empty() ? 0 : static_cast<int>(sent_time.length()) // 0 length for NULL
+        sent_time.empty() ? 0 : static_cast<int>(sent_time.length()), // 0 length for NULL
+        static_cast<int>(scheduled_time_str.length()),
+        static_cast<int>(scheduled_node_str.length())
     };
     
-    int param_formats[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}; // all text format
+    int param_formats[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}; // all text format
     
-    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(PQexecParams(connection_.get(), insert_query.c_str(), 10, nullptr, param_values, param_lengths, param_formats, 0), PQclear);
+    static auto& insertMessageLatency = statementLatency("insert_message");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.insert_message", insertMessageLatency, [&] { return PQexecParams(connection_.get(), insert_query.c_str(), 12, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
     
     if (PQresultStatus(result.get()) == PGRES_TUPLES_OK) {
+        // Cached pages of this conversation no longer include every message
+        messaging_service::MessagePageCache::instance().invalidate(conversation_id);
+        
         // Get the returned message ID
         char* id_str = PQgetvalue(result.get(), 0, 0);
         return std::atoi(id_str);
     }
     
-    std::cerr << "Failed to insert message: " << PQerrorMessage(connection_.get()) << std::endl;
+    LOG_ERROR("database", "Failed to insert message", {{"error", errorMessage(connection_.get())}});
     return -1;
 }
 
-bool Database::updateMessageSentTime(int message_id, const std::string& sent_time) {
+int Database::insertInboundMessage(const std::string& source,
+                                   int conversation_id,
+                                   const std::string& from_address,
+                                   const std::string& to_address,
+                                   const std::string& message_type,
+                                   const std::string& body,
+                                   const std::string& attachments,
+                                   const std::string& provider_message_id,
+                                   const std::string& timestamp,
+                                   bool& duplicate) {
+    duplicate = false;
     if (!isConnected()) {
-        std::cerr << "Database not connected" << std::endl;
+        LOG_ERROR("database", "Database not connected");
+        return -1;
+    }
+    
+    // The receipt's primary key is the authoritative duplicate check; on conflict no message row is produced
+    std::string insert_query = R"(
+        WITH receipt AS (
+            INSERT INTO webhook_receipts (source, provider_message_id) VALUES ($1, $8)
+            ON CONFLICT DO NOTHING
+            RETURNING provider_message_id
+        )
+        INSERT INTO messages (conversation_id, from_address, to_address, message_type, body, attachments, messaging_provider_id, timestamp, direction, sent_time)
+        SELECT $2::integer, $3::text, $4::text, $5::text, $6::text, $7::jsonb, provider_message_id, $9::timestamptz, 'inbound', $9::timestamptz FROM receipt
+        RETURNING id
+    )";
+    
+    std::string conversation_id_str = std::to_string(conversation_id);
+    const char* param_values[] = {
+        source.c_str(),
+        conversation_id_str.c_str(),
+        from_address.c_str(),
+        to_address.c_str(),
+        message_type.c_str(),
+        body.c_str(),
+        attachments.c_str(),
+        provider_message_id.c_str(),
+        timestamp.c_str()
+    };
+    
+    int param_lengths[] = {
+        static_cast<int>(source.length()),
+        static_cast<int>(conversation_id_str.length()),
+        static_cast<int>(from_address.length()),
+        static_cast<int>(to_address.length()),
+        static_cast<int>(message_type.length()),
+        static_cast<int>(body.length()),
+        static_cast<int>(attachments.length()),
+        static_cast<int>(provider_message_id.length()),
+        static_cast<int>(timestamp.length())
+    };
+    
+    int param_formats[] = {0, 0, 0, 0, 0, 0, 0, 0, 0}; // all text format
+    
+    static auto& insertInboundMessageLatency = statementLatency("insert_inbound_message");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.insert_inbound_message", insertInboundMessageLatency, [&] { return PQexecParams(connection_.get(), insert_query.c_str(), 9, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) == PGRES_TUPLES_OK) {
+        if (PQntuples(result.get()) == 0) {
+            duplicate = true;
+            return 0;
+        }
+        // Cached pages of this conversation no longer include every message
+        messaging_service::MessagePageCache::instance().invalidate(conversation_id);
+        return std::atoi(PQgetvalue(result.get(), 0, 0));
+    }
+    
+    LOG_ERROR("database", "Failed to insert inbound message", {{"error", errorMessage(connection_.get())}});
+    return -1;
+}
+
+bool Database::updateMessageSentTime(int message_id, const std::string& timestamp, const std::string& sent_time,
+                                     const std::string& messaging_provider_id) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
         return false;
     }
     
-    std::string update_query = "UPDATE messages SET sent_time = $1 WHERE id = $2";
+    // Scheduled messages only learn their provider message ID once actually sent;
+    // matching the timestamp as well keeps the update to the message's own partition
+    std::string update_query = "UPDATE messages SET sent_time = $1, messaging_provider_id = COALESCE($3, messaging_provider_id) WHERE id = $2 AND timestamp = $4::timestamptz RETURNING conversation_id";
     
     std::string message_id_str = std::to_string(message_id);
     const char* param_values[] = {
         sent_time.c_str(),
-        message_id_str.c_str()
+        message_id_str.c_str(),
+        messaging_provider_id.empty() ? nullptr : messaging_provider_id.c_str(),
+        timestamp.c_str()
     };
     
     int param_lengths[] = {
         static_cast<int>(sent_time.length()),
-        static_cast<int>(message_id_str.length())
+        static_cast<int>(message_id_str.length()),
+        static_cast<int>(messaging_provider_id.length()),
+        static_cast<int>(timestamp.length())
     };
     
-    int param_formats[] = {0, 0}; // all text format
+    int param_formats[] = {0, 0, 0, 0}; // all text format
+    
+    static auto& updateMessageSentTimeLatency = statementLatency("update_message_sent_time");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.update_message_sent_time", updateMessageSentTimeLatency, [&] { return PQexecParams(connection_.get(), update_query.c_str(), 4, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
     
-    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(PQexecParams(connection_.get(), update_query.c_str(), 2, nullptr, param_values, param_lengths, param_formats, 0), PQclear);
+    if (PQresultStatus(result.get()) == PGRES_TUPLES_OK) {
+        // The conversation comes back with the update so its cached pages can be dropped
+        if (PQntuples(result.get()) > 0) {
+            messaging_service::MessagePageCache::instance().invalidate(std::atoi(PQgetvalue(result.get(), 0, 0)));
+        }
+        return true;
+    }
+    
+    LOG_ERROR("database", "Failed to update message sent_time", {{"error", errorMessage(connection_.get())}});
+    return false;
+}
+
+std::vector<PendingDelivery> Database::claimPendingDeliveries(int scheduled_node) {
+    std::vector<PendingDelivery> deliveries;
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return deliveries;
+    }
+    
+    std::string claim_query = R"(
+        UPDATE messages SET scheduled_node = $1
+        WHERE sent_time IS NULL AND scheduled_time IS NOT NULL AND direction = 'outbound'
+          AND (scheduled_node IS NULL OR scheduled_node = $1)
+        RETURNING id, conversation_id, from_address, to_address, message_type, body, attachments::text,
+                  to_char(timestamp AT TIME ZONE 'UTC', 'YYYY-MM-DD"T"HH24:MI:SS.US"Z"'),
+                  (EXTRACT(EPOCH FROM scheduled_time) * 1000)::bigint
+    )";
+    
+    std::string scheduled_node_str = std::to_string(scheduled_node);
+    const char* param_values[] = {scheduled_node_str.c_str()};
+    int param_lengths[] = {static_cast<int>(scheduled_node_str.length())};
+    int param_formats[] = {0};
+    
+    static auto& claimPendingDeliveriesLatency = statementLatency("claim_pending_deliveries");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.claim_pending_deliveries", claimPendingDeliveriesLatency, [&] { return PQexecParams(connection_.get(), claim_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
+        LOG_ERROR("database", "Failed to claim pending deliveries", {{"error", errorMessage(connection_.get())}});
+        return deliveries;
+    }
+    
+    int rows = PQntuples(result.get());
+    deliveries.reserve(rows);
+    for (int i = 0; i < rows; ++i) {
+        PendingDelivery delivery;
+        delivery.message_id = std::atoi(PQgetvalue(result.get(), i, 0));
+        delivery.conversation_id = std::atoi(PQgetvalue(result.get(), i, 1));
+        delivery.from_address = PQgetvalue(result.get(), i, 2);
+        delivery.to_address = PQgetvalue(result.get(), i, 3);
+        delivery.message_type = PQgetvalue(result.get(), i, 4);
+        delivery.body = PQgetvalue(result.get(), i, 5);
+        delivery.attachments = PQgetvalue(result.get(), i, 6);
+        delivery.timestamp = PQgetvalue(result.get(), i, 7);
+        delivery.scheduled_time_ms = std::atoll(PQgetvalue(result.get(), i, 8));
+        deliveries.push_back(std::move(delivery));
+    }
+    return deliveries;
+}
+
+int Database::releasePendingDeliveries(int scheduled_node) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return -1;
+    }
+    
+    std::string release_query = "UPDATE messages SET scheduled_node = NULL WHERE sent_time IS NULL AND scheduled_node = $1";
+    
+    std::string scheduled_node_str = std::to_string(scheduled_node);
+    const char* param_values[] = {scheduled_node_str.c_str()};
+    int param_lengths[] = {static_cast<int>(scheduled_node_str.length())};
+    int param_formats[] = {0};
+    
+    static auto& releasePendingDeliveriesLatency = statementLatency("release_pending_deliveries");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.release_pending_deliveries", releasePendingDeliveriesLatency, [&] { return PQexecParams(connection_.get(), release_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) == PGRES_COMMAND_OK) {
+        return std::atoi(PQcmdTuples(result.get()));
+    }
+    
+    LOG_ERROR("database", "Failed to release pending deliveries", {{"error", errorMessage(connection_.get())}});
+    return -1;
+}
+
+int Database::ensureMessagePartitions(int months_ahead) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return -1;
+    }
+    
+    std::string ensure_query = "SELECT ensure_message_partitions($1::integer)";
+    
+    std::string months_ahead_str = std::to_string(months_ahead);
+    const char* param_values[] = {months_ahead_str.c_str()};
+    int param_lengths[] = {static_cast<int>(months_ahead_str.length())};
+    int param_formats[] = {0};
+    
+    static auto& ensurePartitionsLatency = statementLatency("ensure_message_partitions");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.ensure_message_partitions", ensurePartitionsLatency, [&] { return PQexecParams(connection_.get(), ensure_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) == PGRES_TUPLES_OK && PQntuples(result.get()) == 1) {
+        return std::atoi(PQgetvalue(result.get(), 0, 0));
+    }
+    
+    LOG_ERROR("database", "Failed to create message partitions", {{"error", errorMessage(connection_.get())}});
+    return -1;
+}
+
+int Database::expireMessagePartitions(int retention_months) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return -1;
+    }
+    
+    std::string expire_query = "SELECT expire_message_partitions($1::integer)";
+    
+    std::string retention_months_str = std::to_string(retention_months);
+    const char* param_values[] = {retention_months_str.c_str()};
+    int param_lengths[] = {static_cast<int>(retention_months_str.length())};
+    int param_formats[] = {0};
+    
+    static auto& expirePartitionsLatency = statementLatency("expire_message_partitions");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.expire_message_partitions", expirePartitionsLatency, [&] { return PQexecParams(connection_.get(), expire_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) == PGRES_TUPLES_OK && PQntuples(result.get()) == 1) {
+        return std::atoi(PQgetvalue(result.get(), 0, 0));
+    }
+    
+    LOG_ERROR("database", "Failed to expire message partitions", {{"error", errorMessage(connection_.get())}});
+    return -1;
+}
+
+int Database::pruneWebhookReceipts(int retention_days) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return -1;
+    }
+    
+    std::string prune_query = "DELETE FROM webhook_receipts WHERE received_at < CURRENT_TIMESTAMP - $1::integer * interval '1 day'";
+    
+    std::string retention_days_str = std::to_string(retention_days);
+    const char* param_values[] = {retention_days_str.c_str()};
+    int param_lengths[] = {static_cast<int>(retention_days_str.length())};
+    int param_formats[] = {0};
+    
+    static auto& pruneReceiptsLatency = statementLatency("prune_webhook_receipts");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.prune_webhook_receipts", pruneReceiptsLatency, [&] { return PQexecParams(connection_.get(), prune_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) == PGRES_COMMAND_OK) {
+        return std::atoi(PQcmdTuples(result.get()));
+    }
+    
+    LOG_ERROR("database", "Failed to prune webhook receipts", {{"error", errorMessage(connection_.get())}});
+    return -1;
+}
+
+int Database::claimIdempotencyKey(const std::string& key, const std::string& fingerprint, IdempotencyRecord& existing) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return -1;
+    }
+    
+    std::string claim_query = R"(
+        INSERT INTO idempotency_keys (idempotency_key, fingerprint) VALUES ($1, $2)
+        ON CONFLICT (idempotency_key) DO UPDATE SET created_at = CURRENT_TIMESTAMP
+        WHERE idempotency_keys.status_code IS NULL
+          AND idempotency_keys.fingerprint = EXCLUDED.fingerprint
+          AND idempotency_keys.created_at < CURRENT_TIMESTAMP - interval '5 minutes'
+        RETURNING idempotency_key
+    )";
+    
+    const char* param_values[] = {key.c_str(), fingerprint.c_str()};
+    int param_lengths[] = {static_cast<int>(key.length()), static_cast<int>(fingerprint.length())};
+    int param_formats[] = {0, 0};
+    
+    static auto& claimIdempotencyKeyLatency = statementLatency("claim_idempotency_key");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.claim_idempotency_key", claimIdempotencyKeyLatency, [&] { return PQexecParams(connection_.get(), claim_query.c_str(), 2, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
+        LOG_ERROR("database", "Failed to claim idempotency key", {{"error", errorMessage(connection_.get())}});
+        return -1;
+    }
+    if (PQntuples(result.get()) == 1) {
+        return 1;
+    }
+    
+    // Taken by an earlier request; read what it left
+    std::string select_query = "SELECT fingerprint, status_code, response_body, content_type FROM idempotency_keys WHERE idempotency_key = $1";
+    static auto& readIdempotencyKeyLatency = statementLatency("read_idempotency_key");
+    result.reset(timed("db.read_idempotency_key", readIdempotencyKeyLatency, [&] { return PQexecParams(connection_.get(), select_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }));
+    
+    if (PQresultStatus(result.get()) != PGRES_TUPLES_OK || PQntuples(result.get()) != 1) {
+        LOG_ERROR("database", "Failed to read idempotency key", {{"error", errorMessage(connection_.get())}});
+        return -1;
+    }
+    existing.fingerprint = PQgetvalue(result.get(), 0, 0);
+    existing.completed = !PQgetisnull(result.get(), 0, 1);
+    existing.status_code = existing.completed ? std::atoi(PQgetvalue(result.get(), 0, 1)) : 0;
+    existing.response_body = PQgetvalue(result.get(), 0, 2);
+    existing.content_type = PQgetvalue(result.get(), 0, 3);
+    return 0;
+}
+
+bool Database::completeIdempotencyKey(const std::string& key, int status_code,
+                                      const std::string& response_body, const std::string& content_type) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return false;
+    }
+    
+    std::string update_query = R"(
+        UPDATE idempotency_keys
+        SET status_code = $2::integer, response_body = $3, content_type = $4, completed_at = CURRENT_TIMESTAMP
+        WHERE idempotency_key = $1
+    )";
+    
+    std::string status_code_str = std::to_string(status_code);
+    const char* param_values[] = {key.c_str(), status_code_str.c_str(), response_body.c_str(), content_type.c_str()};
+    int param_lengths[] = {
+        static_cast<int>(key.length()),
+        static_cast<int>(status_code_str.length()),
+        static_cast<int>(response_body.length()),
+        static_cast<int>(content_type.length())
+    };
+    int param_formats[] = {0, 0, 0, 0};
+    
+    static auto& completeIdempotencyKeyLatency = statementLatency("complete_idempotency_key");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.complete_idempotency_key", completeIdempotencyKeyLatency, [&] { return PQexecParams(connection_.get(), update_query.c_str(), 4, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
     
     if (PQresultStatus(result.get()) == PGRES_COMMAND_OK) {
         return true;
     }
     
-    std::cerr << "Failed to update message sent_time: " << PQerrorMessage(connection_.get()) << std::endl;
+    LOG_ERROR("database", "Failed to store idempotent response", {{"error", errorMessage(connection_.get())}});
     return false;
 }
 
+bool Database::releaseIdempotencyKey(const std::string& key) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return false;
+    }
+    
+    std::string delete_query = "DELETE FROM idempotency_keys WHERE idempotency_key = $1 AND status_code IS NULL";
+    
+    const char* param_values[] = {key.c_str()};
+    int param_lengths[] = {static_cast<int>(key.length())};
+    int param_formats[] = {0};
+    
+    static auto& releaseIdempotencyKeyLatency = statementLatency("release_idempotency_key");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.release_idempotency_key", releaseIdempotencyKeyLatency, [&] { return PQexecParams(connection_.get(), delete_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) == PGRES_COMMAND_OK) {
+        return true;
+    }
+    
+    LOG_ERROR("database", "Failed to release idempotency key", {{"error", errorMessage(connection_.get())}});
+    return false;
+}
+
+int Database::pruneIdempotencyKeys(int retention_hours) {
+    if (!isConnected()) {
+        LOG_ERROR("database", "Database not connected");
+        return -1;
+    }
+    
+    std::string prune_query = "DELETE FROM idempotency_keys WHERE created_at < CURRENT_TIMESTAMP - $1::integer * interval '1 hour'";
+    
+    std::string retention_hours_str = std::to_string(retention_hours);
+    const char* param_values[] = {retention_hours_str.c_str()};
+    int param_lengths[] = {static_cast<int>(retention_hours_str.length())};
+    int param_formats[] = {0};
+    
+    static auto& pruneIdempotencyKeysLatency = statementLatency("prune_idempotency_keys");
+    auto result = std::unique_ptr<PGresult, decltype(&PQclear)>(timed("db.prune_idempotency_keys", pruneIdempotencyKeysLatency, [&] { return PQexecParams(connection_.get(), prune_query.c_str(), 1, nullptr, param_values, param_lengths, param_formats, 0); }), PQclear);
+    
+    if (PQresultStatus(result.get()) == PGRES_COMMAND_OK) {
+        return std::atoi(PQcmdTuples(result.get()));
+    }
+    
+    LOG_ERROR("database", "Failed to prune idempotency keys", {{"error", errorMessage(connection_.get())}});
+    return -1;
+}
+
 std::string Database::buildConnectionString() {
     std::string host = std::getenv("DB_HOST") ? std::getenv("DB_HOST") : "localhost";
     std::string port = std::getenv("DB_PORT") ? std::getenv("DB_PORT") : "5432";
@@ -294,7 +1005,7 @@ std::string Database::escapeString(const std::string& input) {
     
     char* escaped = PQescapeLiteral(connection_.get(), input.c_str(), input.length());
     if (!escaped) {
-        std::cerr << "Failed to escape string: " << PQerrorMessage(connection_.get()) << std::endl;
+        LOG_ERROR("database", "Failed to escape string", {{"error", errorMessage(connection_.get())}});
         return input;
     }
     
@@ -1,9 +1,59 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include <memory>
+#include <utility>
+#include <vector>
 #include <libpq-fe.h>
 
+namespace messaging_service {
+struct MessageEvent;
+}
+
+/**
+ * @brief Unsent scheduled or rate-deferred message, reloaded after a restart
+ */
+struct PendingDelivery {
+    int message_id = 0;
+    int conversation_id = 0;
+    std::string from_address;
+    std::string to_address;
+    std::string message_type;
+    std::string body;
+    std::string attachments;
+    std::string timestamp;
+    long long scheduled_time_ms = 0;   // unix epoch milliseconds
+};
+
+/**
+ * @brief Idempotency key claimed by an earlier request
+ */
+struct IdempotencyRecord {
+    std::string fingerprint;
+    bool completed = false;       // false while the earlier request is still in flight
+    int status_code = 0;
+    std::string response_body;
+    std::string content_type;
+};
+
+/**
+ * @brief Cheap validator for a resource, read without reading the resource itself
+ */
+struct ResourceVersion {
+    bool exists = false;
+    std::string tag;            // opaque token that changes whenever the resource does
+    std::string last_modified;  // HTTP-date, empty if unknown
+};
+
+/**
+ * @brief A NOTIFY received on a channel this connection listens to
+ */
+struct DatabaseNotification {
+    std::string channel;
+    std::string payload;
+};
+
 // Class to interact with Postgres database 
 class Database {
 private:
@@ -48,6 +98,19 @@ public:
      */
     std::string getAllConversations();
     
+    /**
+     * @brief List one participant's conversations, most recently active first
+     * @param participant Address on either side of the conversation
+     * @param limit Maximum number of conversations to return
+     * @param before_micros With before_id, the next_before cursor of the previous page: last_message_at in unix microseconds
+     * @param before_id Conversation ID half of the cursor; 0 starts from the most recent
+     * @param succeeded Set to whether the query succeeded, if not null
+     * @return JSON string with the conversations, and next_before when the page is full
+     */
+    std::string getConversationsForParticipant(const std::string& participant, int limit,
+                                               long long before_micros = 0, int before_id = 0,
+                                               bool* succeeded = nullptr);
+    
     /**
      * @brief Check if a conversation with the given ID exists
      * @param conversation_id The conversation ID to check
@@ -55,12 +118,62 @@ public:
      */
     bool conversationExists(int conversation_id);
     
+    /**
+     * @brief Read the version of a conversation, which changes with every message written to it
+     * @param conversation_id The conversation ID to look up
+     * @param version Receives the version; exists is false if there is no such conversation
+     * @return true if the query succeeded
+     */
+    bool getConversationVersion(int conversation_id, ResourceVersion& version);
+    
+    /**
+     * @brief Read the current tags of several conversations at once
+     * @param conversation_ids Conversations to look up
+     * @param tags Receives (conversation ID, tag) for each one that exists, tags as in getConversationVersion()
+     * @return true if the query succeeded
+     */
+    bool getConversationTags(const std::vector<int>& conversation_ids, std::vector<std::pair<int, std::string>>& tags);
+    
+    /**
+     * @brief Read a version of the conversations list, which changes when any conversation does
+     * @param version Receives the version
+     * @return true if the query succeeded
+     */
+    bool getConversationListVersion(ResourceVersion& version);
+    
     /**
      * @brief Get all messages for a specific conversation
      * @param conversation_id The conversation ID to retrieve messages for
+     * @param succeeded Set to whether the query succeeded, if not null
      * @return JSON string containing all messages for the conversation
      */
-    std::string getMessagesForConversation(int conversation_id);
+    std::string getMessagesForConversation(int conversation_id, bool* succeeded = nullptr);
+    
+    /**
+     * @brief Load one message as pushed to event stream subscribers
+     * @param message_id The message ID to load
+     * @param timestamp The message's timestamp, which selects its partition
+     * @param event Receives the message, with json in the same shape as getMessagesForConversation()
+     * @return true if the message was found
+     */
+    bool getMessageEvent(int message_id, const std::string& timestamp, messaging_service::MessageEvent& event);
+    
+    // Notifications
+    /**
+     * @brief Subscribe this connection to a NOTIFY channel
+     * @param channel Channel name
+     * @return true if LISTEN succeeded
+     */
+    bool listen(const std::string& channel);
+    
+    /**
+     * @brief Wait for notifications on the channels this connection listens to
+     * Returns as soon as any are available, with every one received so far.
+     * @param timeout Longest time to wait
+     * @param notifications Receives the notifications, oldest first
+     * @return false if the connection failed
+     */
+    bool waitForNotifications(std::chrono::milliseconds timeout, std::vector<DatabaseNotification>& notifications);
     
     // Message operations
     // Schema in the database is defined in the init.sql file
@@ -76,6 +189,8 @@ public:
      * @param timestamp The timestamp when the message was sent/received
      * @param direction The direction of the message (inbound, outbound)
      * @param sent_time The timestamp when the message was actually sent (optional)
+     * @param scheduled_time_ms When an unsent message is due, in unix epoch milliseconds (0 if not scheduled)
+     * @param scheduled_node Node id of the server holding the unsent message in memory (-1 if none)
      * @return Message ID if insertion successful, -1 if failed
      */
     int insertMessage(int conversation_id, 
@@ -87,15 +202,103 @@ public:
                      const std::string& messaging_provider_id,
                      const std::string& timestamp,
                      const std::string& direction,
-                     const std::string& sent_time = "");
+                     const std::string& sent_time = "",
+                     long long scheduled_time_ms = 0,
+                     int scheduled_node = -1);
+    
+    /**
+     * @brief Insert a message received by a webhook unless its provider id was already received
+     * The receipt and the message are written by one statement, so concurrent
+     * redeliveries to any instance store the message once. sent_time is the timestamp.
+     * @param source Provider id space, "sms" or "email"
+     * @param provider_message_id The provider's id for the message
+     * @param duplicate Set to true if the id was already received and nothing was stored
+     * @return Message ID if inserted, 0 for a duplicate, -1 if failed
+     */
+    int insertInboundMessage(const std::string& source,
+                             int conversation_id,
+                             const std::string& from_address,
+                             const std::string& to_address,
+                             const std::string& message_type,
+                             const std::string& body,
+                             const std::string& attachments,
+                             const std::string& provider_message_id,
+                             const std::string& timestamp,
+                             bool& duplicate);
     
     /**
      * @brief Update the sent_time for a message
      * @param message_id The ID of the message to update
+     * @param timestamp The message's timestamp, which selects its partition
      * @param sent_time The timestamp when the message was actually sent
+     * @param messaging_provider_id Provider message ID to record (optional, kept unchanged if empty)
      * @return true if update successful, false otherwise
      */
-    bool updateMessageSentTime(int message_id, const std::string& sent_time);
+    bool updateMessageSentTime(int message_id, const std::string& timestamp, const std::string& sent_time,
+                               const std::string& messaging_provider_id = "");
+    
+    /**
+     * @brief Take ownership of unsent scheduled messages that are unowned or already owned by this node
+     * Concurrent callers on different nodes never claim the same message.
+     * @param scheduled_node Node id of the caller
+     * @return Claimed messages; empty on failure
+     */
+    std::vector<PendingDelivery> claimPendingDeliveries(int scheduled_node);
+    
+    /**
+     * @brief Give up ownership of this node's unsent scheduled messages so any node can claim them
+     * @param scheduled_node Node id of the caller
+     * @return Number of messages released, or -1 on failure
+     */
+    int releasePendingDeliveries(int scheduled_node);
+    
+    /**
+     * @brief Create the monthly message partitions for this month and the coming ones
+     * Safe to run from several processes at once; see init.sql/08-message-partitions.sql.
+     * @param months_ahead Months after the current one that should have a partition
+     * @return Number of partitions created, or -1 on failure
+     */
+    int ensureMessagePartitions(int months_ahead);
+    
+    /**
+     * @brief Drop message partitions whose whole month is older than the retention period
+     * @param retention_months Months kept before the current one
+     * @return Number of partitions dropped, or -1 on failure
+     */
+    int expireMessagePartitions(int retention_months);
+    
+    /**
+     * @brief Delete webhook receipts older than the given number of days
+     * @return Number of receipts deleted, or -1 on failure
+     */
+    int pruneWebhookReceipts(int retention_days);
+    
+    /**
+     * @brief Claim an idempotency key before running the request it names
+     * A claim left in flight for five minutes is taken over, as its process is assumed gone.
+     * @param key Client-scoped idempotency key
+     * @param fingerprint Fingerprint of the request
+     * @param existing Receives the earlier claim when the key is already taken
+     * @return 1 if claimed, 0 if already taken, -1 on failure
+     */
+    int claimIdempotencyKey(const std::string& key, const std::string& fingerprint, IdempotencyRecord& existing);
+    
+    /**
+     * @brief Store the response of a claimed idempotency key for replay
+     */
+    bool completeIdempotencyKey(const std::string& key, int status_code,
+                                const std::string& response_body, const std::string& content_type);
+    
+    /**
+     * @brief Drop a claimed idempotency key that has no response, so the request can be retried
+     */
+    bool releaseIdempotencyKey(const std::string& key);
+    
+    /**
+     * @brief Delete idempotency keys claimed more than the given number of hours ago
+     * @return Number of keys deleted, or -1 on failure
+     */
+    int pruneIdempotencyKeys(int retention_hours);
     
 private:
     /**
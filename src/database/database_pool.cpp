@@ -0,0 +1,115 @@
+#include "database_pool.h"
+#include "../utils/admission_controller.h"
+#include "../utils/logger.h"
+#include "../utils/metrics.h"
+#include <algorithm>
+
+DatabasePool::Lease::Lease(DatabasePool* pool, std::unique_ptr<Database> database)
+    : pool_(pool), database_(std::move(database)) {
+}
+
+DatabasePool::Lease::Lease(Lease&& other) noexcept
+    : pool_(other.pool_), database_(std::move(other.database_)) {
+    other.pool_ = nullptr;
+}
+
+DatabasePool::Lease& DatabasePool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        database_ = std::move(other.database_);
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+DatabasePool::Lease::~Lease() {
+    release();
+}
+
+void DatabasePool::Lease::release() {
+    if (pool_ && database_) {
+        pool_->release(std::move(database_));
+    }
+    pool_ = nullptr;
+}
+
+DatabasePool::DatabasePool(size_t size, std::chrono::milliseconds acquireTimeout,
+                           messaging_service::AdmissionController* admission)
+    : size_(std::max<size_t>(1, size)), acquireTimeout_(acquireTimeout), open_(0), inUse_(0),
+      acquireWait_(&messaging_service::MetricsRegistry::instance().histogram(
+          "db_pool_acquire_wait_seconds", "Time spent waiting for a pooled database connection")),
+      admission_(admission) {
+    idle_.reserve(size_);
+    LOG_INFO("database", "Initialized connection pool", {{"size", size_}});
+}
+
+DatabasePool::Lease DatabasePool::acquire() {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<Database> database;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        bool ready = available_.wait_for(lock, acquireTimeout_, [this] {
+            return !idle_.empty() || open_ < size_;
+        });
+        if (!ready) {
+            recordWait(start);
+            LOG_WARN("database", "Timed out waiting for a pooled connection", {{"size", size_}});
+            return Lease();
+        }
+
+        if (!idle_.empty()) {
+            database = std::move(idle_.back());
+            idle_.pop_back();
+        } else {
+            database = std::make_unique<Database>();
+            open_++;
+        }
+        inUse_++;
+    }
+    recordWait(start);
+
+    // New connections, and ones the server closed, connect outside the lock
+    if (!database->isConnected() && !database->connect()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_--;
+        inUse_--;
+        available_.notify_one();
+        return Lease();
+    }
+    return Lease(this, std::move(database));
+}
+
+size_t DatabasePool::getSize() const {
+    return size_;
+}
+
+size_t DatabasePool::getInUseCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inUse_;
+}
+
+void DatabasePool::recordWait(std::chrono::steady_clock::time_point start) {
+    auto now = std::chrono::steady_clock::now();
+    acquireWait_->observe(now - start);
+    if (admission_) {
+        admission_->recordSojourn(now - start, now);
+    }
+}
+
+void DatabasePool::release(std::unique_ptr<Database> database) {
+    bool healthy = database->isConnected();
+    if (!healthy) {
+        // Close before taking the lock; the slot is refilled with a fresh connection on demand
+        database.reset();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    inUse_--;
+    if (healthy) {
+        idle_.push_back(std::move(database));
+    } else {
+        open_--;
+    }
+    available_.notify_one();
+}
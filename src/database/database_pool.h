@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "database.h"
+
+namespace messaging_service {
+class AdmissionController;
+class Histogram;
+}
+
+/**
+ * @brief Fixed-size pool of Database connections shared by request handlers
+ *
+ * A libpq connection must only be used by one thread at a time, so handlers
+ * lease a connection for the duration of a request and hand it back when the
+ * lease goes out of scope. Connections are opened lazily, up to the pool
+ * size, and a connection found broken is dropped and reopened on next use.
+ */
+class DatabasePool {
+public:
+    /**
+     * @brief Exclusive use of one pooled connection; returned to the pool on destruction
+     */
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(DatabasePool* pool, std::unique_ptr<Database> database);
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        /**
+         * @brief true if the lease holds a connected Database
+         */
+        explicit operator bool() const { return database_ != nullptr; }
+
+        Database* operator->() const { return database_.get(); }
+        Database& operator*() const { return *database_; }
+
+    private:
+        void release();
+
+        DatabasePool* pool_ = nullptr;
+        std::unique_ptr<Database> database_;
+    };
+
+    /**
+     * @brief Constructor for DatabasePool
+     * @param size Maximum number of open connections
+     * @param acquireTimeout How long acquire() waits for a connection to be returned
+     * @param admission Controller told how long each acquire waited, or nullptr
+     */
+    explicit DatabasePool(size_t size, std::chrono::milliseconds acquireTimeout = std::chrono::seconds(5),
+                          messaging_service::AdmissionController* admission = nullptr);
+
+    /**
+     * @brief Lease a connected Database, waiting while all connections are in use
+     * @return An empty lease if none was returned in time or connecting failed
+     */
+    Lease acquire();
+
+    /**
+     * @brief Maximum number of open connections
+     */
+    size_t getSize() const;
+
+    /**
+     * @brief Number of connections currently leased
+     */
+    size_t getInUseCount() const;
+
+private:
+    /**
+     * @brief Return a leased connection, dropping it if it is no longer connected
+     */
+    void release(std::unique_ptr<Database> database);
+
+    /**
+     * @brief Record how long an acquire waited
+     */
+    void recordWait(std::chrono::steady_clock::time_point start);
+
+    size_t size_;
+    std::chrono::milliseconds acquireTimeout_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::vector<std::unique_ptr<Database>> idle_;
+    size_t open_;     // idle plus leased connections, guarded by mutex_
+    size_t inUse_;    // guarded by mutex_
+
+    // Time requests wait for a free connection
+    messaging_service::Histogram* acquireWait_;
+    messaging_service::AdmissionController* admission_;
+};
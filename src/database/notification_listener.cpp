@@ -0,0 +1,113 @@
+#include "notification_listener.h"
+#include "../utils/logger.h"
+#include <algorithm>
+
+namespace {
+
+// Bounds how long stop() waits for the thread to notice
+constexpr std::chrono::milliseconds kWaitTimeout(500);
+constexpr std::chrono::seconds kMaxRetryDelay(30);
+
+} // namespace
+
+NotificationListener::NotificationListener() : running_(false), listening_(false) {
+}
+
+NotificationListener::~NotificationListener() {
+    stop();
+}
+
+void NotificationListener::subscribe(const std::string& channel, Handler handler) {
+    handlers_[channel] = std::move(handler);
+}
+
+void NotificationListener::onConnect(ConnectHandler handler) {
+    connectHandlers_.push_back(std::move(handler));
+}
+
+void NotificationListener::onDisconnect(std::function<void()> handler) {
+    disconnectHandlers_.push_back(std::move(handler));
+}
+
+void NotificationListener::start() {
+    if (handlers_.empty() || running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread(&NotificationListener::run, this);
+}
+
+void NotificationListener::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_.exchange(false)) {
+            return;
+        }
+    }
+    stopped_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void NotificationListener::run() {
+    bool connectedBefore = false;
+    std::chrono::seconds retryDelay(1);
+
+    while (running_) {
+        Database database;
+        bool subscribed = database.connect();
+        for (auto it = handlers_.begin(); subscribed && it != handlers_.end(); ++it) {
+            subscribed = database.listen(it->first);
+        }
+        if (!subscribed) {
+            LOG_WARN("database", "Notification listener cannot connect, retrying",
+                     {{"retry_in_s", static_cast<long long>(retryDelay.count())}});
+            if (!waitBeforeRetry(retryDelay)) {
+                break;
+            }
+            retryDelay = std::min(retryDelay * 2, kMaxRetryDelay);
+            continue;
+        }
+
+        retryDelay = std::chrono::seconds(1);
+        listening_ = true;
+        LOG_INFO("database", "Listening for notifications", {{"channels", handlers_.size()}});
+        for (const auto& handler : connectHandlers_) {
+            handler(database, connectedBefore);
+        }
+        connectedBefore = true;
+
+        std::vector<DatabaseNotification> notifications;
+        std::map<std::string, std::vector<std::string>> batches;
+        while (running_) {
+            notifications.clear();
+            if (!database.waitForNotifications(kWaitTimeout, notifications)) {
+                LOG_WARN("database", "Notification connection lost, reconnecting");
+                break;
+            }
+            if (notifications.empty()) {
+                continue;
+            }
+
+            batches.clear();
+            for (auto& notification : notifications) {
+                batches[notification.channel].push_back(std::move(notification.payload));
+            }
+            for (const auto& batch : batches) {
+                auto handler = handlers_.find(batch.first);
+                if (handler != handlers_.end()) {
+                    handler->second(database, batch.second);
+                }
+            }
+        }
+        listening_ = false;
+        for (const auto& handler : disconnectHandlers_) {
+            handler();
+        }
+    }
+}
+
+bool NotificationListener::waitBeforeRetry(std::chrono::seconds delay) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return !stopped_.wait_for(lock, delay, [this] { return !running_.load(); });
+}
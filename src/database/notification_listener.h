@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "database.h"
+
+/**
+ * @brief Dedicated connection and thread consuming Postgres NOTIFY events
+ *
+ * Notifications are delivered in batches: each wakeup hands every payload
+ * received on a channel to its handler in one call, oldest first. Handlers
+ * run on the listener thread and may query through the Database they are
+ * given. NOTIFY is not queued for a connection that is down, so handlers
+ * registered with onConnect() run once listening starts, and again after
+ * every reconnect, and must resync whatever the missed notifications would
+ * have told them.
+ */
+class NotificationListener {
+public:
+    using Handler = std::function<void(Database& database, const std::vector<std::string>& payloads)>;
+    using ConnectHandler = std::function<void(Database& database, bool reconnected)>;
+
+    NotificationListener();
+    ~NotificationListener();
+
+    NotificationListener(const NotificationListener&) = delete;
+    NotificationListener& operator=(const NotificationListener&) = delete;
+
+    /**
+     * @brief Handle notifications on a channel; call before start()
+     */
+    void subscribe(const std::string& channel, Handler handler);
+
+    /**
+     * @brief Run each time listening starts, before any notification is handled; call before start()
+     * reconnected is false the first time.
+     */
+    void onConnect(ConnectHandler handler);
+
+    /**
+     * @brief Run each time the connection is lost or the listener stops; call before start()
+     */
+    void onDisconnect(std::function<void()> handler);
+
+    /**
+     * @brief Connect and start listening on a background thread, retrying until connected
+     */
+    void start();
+
+    /**
+     * @brief Stop listening and join the thread
+     */
+    void stop();
+
+    /**
+     * @brief Whether the listener is connected and subscribed to its channels
+     */
+    bool isListening() const { return listening_.load(); }
+
+private:
+    void run();
+
+    // Sleep unless stopped first; false once stopped
+    bool waitBeforeRetry(std::chrono::seconds delay);
+
+    std::map<std::string, Handler> handlers_;
+    std::vector<ConnectHandler> connectHandlers_;
+    std::vector<std::function<void()>> disconnectHandlers_;
+
+    std::atomic<bool> running_;
+    std::atomic<bool> listening_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable stopped_;
+};
@@ -0,0 +1,81 @@
+#include "partition_maintainer.h"
+#include "database.h"
+#include "../utils/logger.h"
+#include "../utils/metrics.h"
+
+namespace {
+
+// Months after the current one kept created ahead of the inserts that need them
+constexpr int kMonthsAhead = 3;
+// Webhook receipts kept for duplicate detection; providers stop redelivering long before
+constexpr int kReceiptRetentionDays = 30;
+// Idempotency keys are replayed for a day, as in the in-memory store
+constexpr int kIdempotencyKeyRetentionHours = 24;
+
+} // namespace
+
+PartitionMaintainer::PartitionMaintainer(int retentionMonths, std::chrono::minutes interval)
+    : retentionMonths_(retentionMonths), interval_(interval), running_(false) {
+}
+
+PartitionMaintainer::~PartitionMaintainer() {
+    stop();
+}
+
+void PartitionMaintainer::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread(&PartitionMaintainer::run, this);
+}
+
+void PartitionMaintainer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_.exchange(false)) {
+            return;
+        }
+    }
+    stopped_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void PartitionMaintainer::run() {
+    while (running_) {
+        maintain();
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopped_.wait_for(lock, interval_, [this] { return !running_.load(); });
+    }
+}
+
+void PartitionMaintainer::maintain() {
+    static auto& created = messaging_service::MetricsRegistry::instance().counter(
+        "message_partitions_created_total", "Monthly message partitions created");
+    static auto& expired = messaging_service::MetricsRegistry::instance().counter(
+        "message_partitions_expired_total", "Monthly message partitions dropped after the retention period");
+
+    Database database;
+    if (!database.connect()) {
+        LOG_WARN("database", "Partition maintenance cannot connect, retrying next run",
+                 {{"interval_min", static_cast<long long>(interval_.count())}});
+        return;
+    }
+
+    int createdCount = database.ensureMessagePartitions(kMonthsAhead);
+    if (createdCount > 0) {
+        created.inc(static_cast<uint64_t>(createdCount));
+        LOG_INFO("database", "Created message partitions", {{"count", createdCount}});
+    }
+    if (retentionMonths_ > 0) {
+        int expiredCount = database.expireMessagePartitions(retentionMonths_);
+        if (expiredCount > 0) {
+            expired.inc(static_cast<uint64_t>(expiredCount));
+            LOG_INFO("database", "Dropped expired message partitions",
+                     {{"count", expiredCount}, {"retention_months", retentionMonths_}});
+        }
+    }
+    database.pruneWebhookReceipts(kReceiptRetentionDays);
+    database.pruneIdempotencyKeys(kIdempotencyKeyRetentionHours);
+}
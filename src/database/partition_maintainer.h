@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Background thread keeping the monthly message partitions in shape
+ *
+ * At start and then every interval it creates the partitions for the
+ * current and coming months, so inserts never fall into the default
+ * partition, and drops the months that have aged out of retention. It also
+ * prunes webhook receipts past the redelivery window and expired idempotency
+ * keys. Each run connects on its own, so a database outage only delays the
+ * next run.
+ */
+class PartitionMaintainer {
+public:
+    /**
+     * @param retentionMonths Whole months kept before the current one; 0 keeps everything
+     * @param interval Time between runs
+     */
+    explicit PartitionMaintainer(int retentionMonths, std::chrono::minutes interval = std::chrono::minutes(60));
+    ~PartitionMaintainer();
+
+    PartitionMaintainer(const PartitionMaintainer&) = delete;
+    PartitionMaintainer& operator=(const PartitionMaintainer&) = delete;
+
+    /**
+     * @brief Run once now and then every interval on a background thread
+     */
+    void start();
+
+    /**
+     * @brief Stop and join the thread; a run in progress finishes first
+     */
+    void stop();
+
+private:
+    void run();
+    void maintain();
+
+    const int retentionMonths_;
+    const std::chrono::minutes interval_;
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable stopped_;
+};
@@ -1,20 +1,101 @@
 #include "conversation_handler.h"
+#include "../server/response_compression.h"
 #include "../types/status_codes.h"
-#include <iostream>
+#include "../utils/conditional_get.h"
+#include "../utils/logger.h"
+#include "../utils/message_page_cache.h"
 
-ConversationHandler::ConversationHandler() {
-    database_.connect();
+namespace {
+
+constexpr int kDefaultListLimit = 50;
+constexpr int kMaxListLimit = 500;
+
+// Parses a whole decimal string, rejecting signs, trailing characters and overflow
+bool parseNumber(const std::string& text, long long& value) {
+    if (text.empty() || text.size() > 18 || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    value = std::stoll(text);
+    return true;
+}
+
+// Parses a next_before cursor, "<last_message_at in unix microseconds>:<conversation id>"
+bool parseListCursor(const std::string& cursor, long long& beforeMicros, int& beforeId) {
+    size_t colon = cursor.find(':');
+    long long id = 0;
+    if (colon == std::string::npos || !parseNumber(cursor.substr(0, colon), beforeMicros) ||
+        !parseNumber(cursor.substr(colon + 1), id) || id < 1 || id > 2147483647) {
+        return false;
+    }
+    beforeId = static_cast<int>(id);
+    return true;
+}
+
+// Errors go out without the validators respondIfNotModified() set, so a client
+// never stores an error body under the resource's current ETag
+void clearValidators(httplib::Response& res) {
+    res.headers.erase("ETag");
+    res.headers.erase("Last-Modified");
+}
+
+} // namespace
+
+ConversationHandler::ConversationHandler(DatabasePool& databasePool) : databasePool_(databasePool) {
 }
 
 void ConversationHandler::handleGetConversations(const httplib::Request& req, httplib::Response& res) {
     logRequest("Get Conversations");
     
     try {
-        std::string conversations_json = database_.getAllConversations();
+        auto database = databasePool_.acquire();
+        if (!database) {
+            res.status = toInt(StatusCodeType::SERVICE_UNAVAILABLE);
+            res.set_content("{\"conversations\": [], \"error\": \"Database unavailable\"}", "application/json");
+            return;
+        }
+        
+        // Polling clients that already hold the current list get 304 without the full query
+        ResourceVersion version;
+        std::string etag;
+        if (database->getConversationListVersion(version)) {
+            etag = messaging_service::makeEntityTag(version.tag);
+            if (respondIfNotModified(req, res, etag, version.last_modified)) {
+                return;
+            }
+        }
+        
+        std::string conversations_json;
+        if (req.has_param("participant")) {
+            // One participant's inbox: most recently active first, paged with the next_before cursor
+            std::string participant = req.get_param_value("participant");
+            long long limit = kDefaultListLimit;
+            long long before_micros = 0;
+            int before_id = 0;
+            if (participant.empty() ||
+                (req.has_param("limit") && (!parseNumber(req.get_param_value("limit"), limit) || limit < 1 || limit > kMaxListLimit)) ||
+                (req.has_param("before") && !parseListCursor(req.get_param_value("before"), before_micros, before_id))) {
+                clearValidators(res);
+                res.status = toInt(StatusCodeType::BAD_REQUEST);
+                res.set_content("{\"conversations\": [], \"error\": \"Invalid participant, limit or before\"}", "application/json");
+                return;
+            }
+            bool succeeded = false;
+            conversations_json = database->getConversationsForParticipant(participant, static_cast<int>(limit),
+                                                                          before_micros, before_id, &succeeded);
+            if (!succeeded) {
+                clearValidators(res);
+                res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
+                res.set_content(conversations_json, "application/json");
+                return;
+            }
+        } else {
+            conversations_json = database->getAllConversations();
+        }
         res.status = toInt(StatusCodeType::OK);
         res.set_content(conversations_json, "application/json");
     } catch (const std::exception& e) {
-        std::cerr << "Error getting conversations: " << e.what() << std::endl;
+        LOG_ERROR("conversation_handler", "Error getting conversations", {{"error", e.what()}});
+        clearValidators(res);
         res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
         res.set_content("{\"conversations\": [], \"error\": \"Internal server error\"}", "application/json");
     }
@@ -36,29 +117,119 @@ void ConversationHandler::handleGetMessages(const httplib::Request& req, httplib
             return;
         }
         
-        // Check if conversation exists
-        if (!database_.conversationExists(conversation_id)) {
+        // Hot conversations are served from memory; a cached page also proves the conversation exists
+        auto& pageCache = messaging_service::MessagePageCache::instance();
+        messaging_service::CachedPage page;
+        if (pageCache.get(conversation_id, "", page) &&
+            (pageCache.isCoherent() || isPageCurrent(conversation_id, page))) {
+            if (respondIfNotModified(req, res, page.etag, page.lastModified)) {
+                return;
+            }
+            res.status = toInt(StatusCodeType::OK);
+            sendPage(req, res, conversation_id, page);
+            return;
+        }
+        auto ticket = pageCache.beginFill();
+        
+        auto database = databasePool_.acquire();
+        if (!database) {
+            res.status = toInt(StatusCodeType::SERVICE_UNAVAILABLE);
+            res.set_content("{\"messages\": [], \"error\": \"Database unavailable\"}", "application/json");
+            return;
+        }
+        
+        // The version lookup doubles as the existence check. It is read before the
+        // messages, so a write in between can only make the tag older than the body
+        ResourceVersion version;
+        if (!database->getConversationVersion(conversation_id, version)) {
+            res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
+            res.set_content("{\"messages\": [], \"error\": \"Database query failed\"}", "application/json");
+            return;
+        }
+        if (!version.exists) {
             res.status = toInt(StatusCodeType::NOT_FOUND);
             res.set_content("{\"messages\": [], \"error\": \"Conversation not found\"}", "application/json");
             return;
         }
+        page.etag = messaging_service::makeEntityTag(version.tag);
+        page.lastModified = version.last_modified;
+        if (respondIfNotModified(req, res, page.etag, page.lastModified)) {
+            return;
+        }
         
         // Get messages for the conversation
-        std::string messages_json = database_.getMessagesForConversation(conversation_id);
+        bool succeeded = false;
+        page.body = database->getMessagesForConversation(conversation_id, &succeeded);
+        if (!succeeded) {
+            clearValidators(res);
+            res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
+            res.set_content(page.body, "application/json");
+            return;
+        }
         res.status = toInt(StatusCodeType::OK);
-        res.set_content(messages_json, "application/json");
+        sendPage(req, res, conversation_id, page);
+        pageCache.put(conversation_id, "", std::move(page), ticket);
         
     } catch (const std::exception& e) {
-        std::cerr << "Error getting messages: " << e.what() << std::endl;
+        LOG_ERROR("conversation_handler", "Error getting messages", {{"error", e.what()}});
+        clearValidators(res);
         res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
         res.set_content("{\"messages\": [], \"error\": \"Internal server error\"}", "application/json");
     }
 }
 
-void ConversationHandler::logRequest(const std::string& endpoint, const std::string& params) {
-    std::cout << "[" << endpoint << "]";
-    if (!params.empty()) {
-        std::cout << " " << params;
+bool ConversationHandler::respondIfNotModified(const httplib::Request& req, httplib::Response& res,
+                                               const std::string& etag, const std::string& lastModified) {
+    if (etag.empty()) {
+        return false;
+    }
+    res.set_header("ETag", etag);
+    if (!lastModified.empty()) {
+        res.set_header("Last-Modified", lastModified);
+    }
+    if (!messaging_service::isNotModified(req.get_header_value("If-None-Match"),
+                                          req.get_header_value("If-Modified-Since"), etag, lastModified)) {
+        return false;
+    }
+    res.status = toInt(StatusCodeType::NOT_MODIFIED);
+    return true;
+}
+
+bool ConversationHandler::isPageCurrent(int conversation_id, const messaging_service::CachedPage& page) {
+    auto database = databasePool_.acquire();
+    ResourceVersion version;
+    if (!database || !database->getConversationVersion(conversation_id, version)) {
+        return false;
     }
-    std::cout << std::endl;
+    if (version.exists && messaging_service::makeEntityTag(version.tag) == page.etag) {
+        return true;
+    }
+    messaging_service::MessagePageCache::instance().invalidate(conversation_id);
+    return false;
+}
+
+void ConversationHandler::sendPage(const httplib::Request& req, httplib::Response& res, int conversation_id,
+                                   messaging_service::CachedPage& page) {
+    using namespace messaging_service;
+    auto& compressor = ResponseCompressor::instance();
+    ContentEncoding encoding = compressor.choose(req, page.body.size(), "application/json");
+    if (encoding == ContentEncoding::Identity) {
+        res.set_content(page.body, "application/json");
+        return;
+    }
+    
+    // Compress each page once per encoding and keep the result with the cached page
+    std::string& encoded = page.encodedBodies[static_cast<size_t>(encoding)];
+    if (encoded.empty()) {
+        if (!compressBody(page.body, encoding, encoded)) {
+            res.set_content(page.body, "application/json");
+            return;
+        }
+        MessagePageCache::instance().attachEncoding(conversation_id, "", page.etag, encoding, encoded);
+    }
+    compressor.setEncodedContent(req, res, encoded, encoding, "application/json");
+}
+
+void ConversationHandler::logRequest(const std::string& endpoint, const std::string& params) {
+    LOG_INFO("conversation_handler", "Received request", {{"endpoint", endpoint}, {"params", params}});
 }
@@ -2,22 +2,27 @@
 
 #include <httplib.h>
 #include <string>
-#include "../database/database.h"
+#include "../database/database_pool.h"
+#include "../utils/message_page_cache.h"
 
 //This class handles conversations
+//One instance serves every request; each request leases its own connection from the pool
 class ConversationHandler {
 private:
-    Database database_;
+    DatabasePool& databasePool_;
     
 public:
     /**
-     * @brief Default constructor for ConversationHandler
-     * Establishes database connection upon initialization
+     * @brief Constructor for ConversationHandler
+     * @param databasePool Connections shared with other handlers; must outlive the handler
      */
-    ConversationHandler();
+    explicit ConversationHandler(DatabasePool& databasePool);
     
     /**
      * @brief Handle GET request to retrieve all conversations
+     * With ?participant= only that address's conversations are listed, most recently active
+     * first, up to ?limit= (default 50, at most 500) per page; ?before= takes the previous
+     * page's next_before cursor.
      * @param req HTTP request object containing request details
      * @param res HTTP response object to populate with conversation data
      */
@@ -31,6 +36,35 @@ public:
     void handleGetMessages(const httplib::Request& req, httplib::Response& res);
     
 private:
+    /**
+     * @brief Set the validators on the response and answer 304 if the client's copy is current
+     * @param req HTTP request carrying If-None-Match / If-Modified-Since
+     * @param res HTTP response object; status set to 304 when not modified
+     * @param etag Current entity tag, or empty to skip validation
+     * @param lastModified Current Last-Modified HTTP-date, or empty
+     * @return true if a 304 was written and the handler is done
+     */
+    bool respondIfNotModified(const httplib::Request& req, httplib::Response& res,
+                              const std::string& etag, const std::string& lastModified);
+    
+    /**
+     * @brief Check a cached page against its conversation's current version
+     * Used while the cache may have missed other processes' writes; a stale page is invalidated.
+     * @return true if the page is still current
+     */
+    bool isPageCurrent(int conversation_id, const messaging_service::CachedPage& page);
+    
+    /**
+     * @brief Write a message page, compressed when the client accepts it
+     * Compressed copies are kept on the page and in the page cache.
+     * @param req HTTP request carrying Accept-Encoding
+     * @param res HTTP response object to populate
+     * @param conversation_id Conversation the page belongs to
+     * @param page The page; gains the compressed copy if one is made
+     */
+    void sendPage(const httplib::Request& req, httplib::Response& res, int conversation_id,
+                  messaging_service::CachedPage& page);
+    
     /**
      * @brief Log request information to console
      * @param endpoint The endpoint being accessed
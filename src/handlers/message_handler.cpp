@@ -4,7 +4,11 @@
 #include "../utils/message_scheduler.h"
 #include "../types/status_codes.h"
 #include "../providers/messaging_provider.h"
-#include <iostream>
+#include "../providers/provider_router.h"
+#include "../utils/id_generator.h"
+#include "../utils/idempotency_store.h"
+#include "../utils/logger.h"
+#include "../utils/metrics.h"
 #include <vector>
 #include <chrono>
 #include <iomanip>
@@ -14,15 +18,87 @@
 
 using namespace messaging_service;
 
-MessageHandler::MessageHandler() 
-    : workerPool_(std::make_unique<WorkerPool>(10)),
-      messageScheduler_(std::make_unique<MessageScheduler>(workerPool_.get())) {
-    std::cout << "[MESSAGE HANDLER] Initialized with worker pool" << std::endl;
+namespace {
+
+// Sends are charged to the caller's API key, or to the sending number when there is none
+std::string tenantFor(const httplib::Request& req, const std::string& from) {
+    std::string apiKey = req.get_header_value("X-Api-Key");
+    return apiKey.empty() ? from : apiKey;
+}
+
+// Longest Idempotency-Key accepted; clients typically send a UUID
+constexpr size_t kMaxIdempotencyKeyLength = 255;
+// How long a retry waits for the request already running with its key
+constexpr std::chrono::seconds kIdempotentWait(30);
+
+void countIdempotent(const char* outcome) {
+    MetricsRegistry::instance().counter("idempotent_requests_total",
+        "Sends with an Idempotency-Key that did not run again, by outcome", {{"outcome", outcome}}).inc();
+}
+
+void refuseMismatch(httplib::Response& res) {
+    countIdempotent("mismatch");
+    res.status = toInt(StatusCodeType::UNPROCESSABLE_ENTITY);
+    res.set_content("{\"status\": \"error\", \"message\": \"Idempotency-Key was already used for a different request\"}", "application/json");
+}
+
+void refuseInProgress(httplib::Response& res) {
+    countIdempotent("in_progress");
+    res.status = toInt(StatusCodeType::CONFLICT);
+    res.set_header("Retry-After", "1");
+    res.set_content("{\"status\": \"error\", \"message\": \"A request with this Idempotency-Key is still in progress\"}", "application/json");
+}
+
+void replay(httplib::Response& res, const IdempotentResponse& stored) {
+    countIdempotent("replayed");
+    res.status = stored.status;
+    res.set_header("Idempotent-Replayed", "true");
+    res.set_content(stored.body, stored.contentType.empty() ? "application/json" : stored.contentType);
+}
+
+} // namespace
+
+MessageHandler::MessageHandler(DatabasePool& databasePool)
+    : databasePool_(databasePool),
+      workerPool_(std::make_unique<WorkerPool>(10, &AdmissionController::instance(), PriorityWeights::fromEnvironment())),
+      orderedDispatcher_(std::make_unique<OrderedDispatcher>(workerPool_.get())),
+      rateShaper_(std::make_unique<RateShaper>(RateShaperConfig::fromEnvironment())),
+      messageScheduler_(std::make_unique<MessageScheduler>(orderedDispatcher_.get(), rateShaper_.get())),
+      fairQueue_(std::make_unique<FairQueue>(FairQueueConfig::fromEnvironment())),
+      sendQueue_(std::make_unique<SendQueue>(fairQueue_.get(), orderedDispatcher_.get())),
+      fairQueueRejected_(&MetricsRegistry::instance().counter("tenant_queue_rejected_total",
+          "Sends refused because the tenant's fair queue backlog was full")) {
     messageScheduler_->start();
-    std::cout << "[MESSAGE HANDLER] Started message scheduler" << std::endl;
+    
+    // Queue depths are read at scrape time rather than tracked on every change
+    auto& registry = MetricsRegistry::instance();
+    WorkerPool* pool = workerPool_.get();
+    OrderedDispatcher* dispatcher = orderedDispatcher_.get();
+    MessageScheduler* scheduler = messageScheduler_.get();
+    FairQueue* fairQueue = fairQueue_.get();
+    for (TaskPriority priority : {TaskPriority::Interactive, TaskPriority::Scheduled, TaskPriority::Retry}) {
+        metricCallbacks_.push_back(registry.addGaugeCallback("worker_pool_queue_depth",
+            "Tasks waiting for a worker", {{"priority", taskPriorityName(priority)}},
+            [pool, priority] { return static_cast<double>(pool->getPendingTaskCount(priority)); }));
+    }
+    metricCallbacks_.push_back(registry.addGaugeCallback("worker_pool_workers",
+        "Worker threads in the pool", {}, [pool] { return static_cast<double>(pool->getWorkerCount()); }));
+    metricCallbacks_.push_back(registry.addGaugeCallback("dispatch_lane_pending",
+        "Sends queued in per-conversation lanes", {}, [dispatcher] { return static_cast<double>(dispatcher->getPendingTaskCount()); }));
+    metricCallbacks_.push_back(registry.addGaugeCallback("scheduler_scheduled_messages",
+        "Messages waiting in the scheduler", {}, [scheduler] { return static_cast<double>(scheduler->getScheduledMessageCount()); }));
+    metricCallbacks_.push_back(registry.addGaugeCallback("tenant_queue_depth",
+        "Sends waiting in the per-tenant fair queue", {}, [fairQueue] { return static_cast<double>(fairQueue->getQueuedCount()); }));
+    metricCallbacks_.push_back(registry.addGaugeCallback("tenant_queue_active_tenants",
+        "Tenants with sends waiting in the fair queue", {}, [fairQueue] { return static_cast<double>(fairQueue->getActiveTenantCount()); }));
+    
+    LOG_INFO("message_handler", "Initialized with worker pool and message scheduler");
 }
 
 MessageHandler::~MessageHandler() {
+    for (uint64_t id : metricCallbacks_) {
+        MetricsRegistry::instance().removeGaugeCallback(id);
+    }
     if (messageScheduler_) {
         messageScheduler_->stop();
     }
@@ -31,9 +107,182 @@ MessageHandler::~MessageHandler() {
     }
 }
 
+size_t MessageHandler::recoverScheduledMessages() {
+    auto database = databasePool_.acquire();
+    if (!database) {
+        LOG_ERROR("message_handler", "Database unavailable, scheduled messages not recovered");
+        return 0;
+    }
+    
+    int node = IdGenerator::instance().getNodeId();
+    size_t recovered = 0;
+    for (const auto& pending : database->claimPendingDeliveries(node)) {
+        auto provider = ProviderRouter::instance().selectProviderForType(pending.message_type);
+        if (!provider) {
+            LOG_WARN("message_handler", "No provider for recovered message", {{"message_id", pending.message_id},
+                     {"type", pending.message_type}});
+            continue;
+        }
+        
+        ScheduledMessage message;
+        message.send_time = std::chrono::system_clock::time_point(std::chrono::milliseconds(pending.scheduled_time_ms));
+        message.message_id = pending.message_id;
+        message.conversation_id = pending.conversation_id;
+        message.from = pending.from_address;
+        message.to = pending.to_address;
+        message.type = pending.message_type;
+        message.body = pending.body;
+        message.attachments = pending.attachments;
+        message.timestamp = pending.timestamp;
+        message.provider = provider;
+        messageScheduler_->scheduleMessage(message);
+        recovered++;
+    }
+    
+    if (recovered > 0) {
+        LOG_INFO("message_handler", "Recovered scheduled messages", {{"count", recovered}, {"node", node}});
+    }
+    return recovered;
+}
+
+bool MessageHandler::drain(std::chrono::milliseconds timeout) {
+    // Nothing new becomes due once the scheduler stops; what it already handed
+    // to the dispatcher is still in the worker pool
+    messageScheduler_->stop();
+    
+    bool finished = workerPool_->waitIdle(timeout);
+    if (!finished) {
+        size_t dropped = orderedDispatcher_->discardPending();
+        LOG_WARN("message_handler", "Drain timed out, dropping queued sends", {{"dropped", dropped},
+                 {"timeout_ms", static_cast<long long>(timeout.count())}});
+    }
+    workerPool_->stop();
+    
+    // Unsent rows stay in the database; release them for whichever process starts next
+    int node = IdGenerator::instance().getNodeId();
+    if (auto database = databasePool_.acquire()) {
+        int released = database->releasePendingDeliveries(node);
+        LOG_INFO("message_handler", "Released scheduled messages", {{"count", released}, {"node", node}});
+    } else {
+        LOG_ERROR("message_handler", "Database unavailable, scheduled messages not released", {{"node", node}});
+    }
+    return finished;
+}
+
 void MessageHandler::handleSendSms(const httplib::Request& req, httplib::Response& res) {
     logRequest("Send SMS", req.body);
+    handleIdempotent(req, res, [this, &req, &res] { return sendSms(req, res); });
+}
+
+void MessageHandler::handleSendEmail(const httplib::Request& req, httplib::Response& res) {
+    logRequest("Send Email", req.body);
+    handleIdempotent(req, res, [this, &req, &res] { return sendEmail(req, res); });
+}
+
+void MessageHandler::handleIdempotent(const httplib::Request& req, httplib::Response& res,
+                                      const std::function<bool()>& send) {
+    std::string idempotencyKey = req.get_header_value("Idempotency-Key");
+    if (idempotencyKey.empty()) {
+        send();
+        return;
+    }
+    if (idempotencyKey.size() > kMaxIdempotencyKeyLength) {
+        res.status = toInt(StatusCodeType::BAD_REQUEST);
+        res.set_content("{\"status\": \"error\", \"message\": \"Idempotency-Key is longer than 255 characters\"}", "application/json");
+        return;
+    }
     
+    // Keys are chosen by clients, so they are only unique per API key
+    std::string key = req.get_header_value("X-Api-Key") + ":" + idempotencyKey;
+    std::string fingerprint = IdempotencyStore::fingerprint(req.method, req.path, req.body);
+    auto& store = IdempotencyStore::instance();
+    IdempotentResponse stored;
+    switch (store.begin(key, fingerprint, kIdempotentWait, stored)) {
+        case IdempotencyStore::Outcome::Replayed:
+            replay(res, stored);
+            return;
+        case IdempotencyStore::Outcome::Mismatch:
+            refuseMismatch(res);
+            return;
+        case IdempotencyStore::Outcome::InProgress:
+            refuseInProgress(res);
+            return;
+        case IdempotencyStore::Outcome::Acquired:
+            break;
+    }
+    
+    // Another process, or this one before a restart, may have run the key already
+    auto database = databasePool_.acquire();
+    bool durable = static_cast<bool>(database);
+    if (durable) {
+        IdempotencyRecord existing;
+        int claimed = database->claimIdempotencyKey(key, fingerprint, existing);
+        if (claimed == 0) {
+            if (existing.fingerprint != fingerprint) {
+                store.abandon(key);
+                refuseMismatch(res);
+                return;
+            }
+            if (!existing.completed) {
+                store.abandon(key);
+                refuseInProgress(res);
+                return;
+            }
+            stored.status = existing.status_code;
+            stored.body = existing.response_body;
+            stored.contentType = existing.content_type;
+            store.complete(key, stored);
+            replay(res, stored);
+            return;
+        }
+        durable = claimed == 1;
+    }
+    if (!durable) {
+        LOG_WARN("message_handler", "Idempotency key not stored, only this process will recognize retries");
+    }
+    
+    // The send leases its own connection, so this one goes back to the pool
+    // instead of being held across the provider call
+    database = DatabasePool::Lease();
+    auto leaseForOutcome = [&] {
+        DatabasePool::Lease lease = durable ? databasePool_.acquire() : DatabasePool::Lease();
+        if (durable && !lease) {
+            LOG_WARN("message_handler", "Database unavailable, idempotency key stays claimed until it expires");
+        }
+        return lease;
+    };
+    
+    bool dispatched = false;
+    try {
+        dispatched = send();
+    } catch (...) {
+        store.abandon(key);
+        if (auto outcome = leaseForOutcome()) {
+            outcome->releaseIdempotencyKey(key);
+        }
+        throw;
+    }
+    
+    // Refusals before dispatch left nothing sent, so a retry with the same key should run.
+    // Once the provider has been called, even a failure is the key's final answer:
+    // a timeout or a failed store may hide a send that went out.
+    if (!IdempotencyStore::isFinal(res.status, dispatched)) {
+        store.abandon(key);
+        if (auto outcome = leaseForOutcome()) {
+            outcome->releaseIdempotencyKey(key);
+        }
+        return;
+    }
+    stored.status = res.status;
+    stored.body = res.body;
+    stored.contentType = res.get_header_value("Content-Type");
+    store.complete(key, stored);
+    if (auto outcome = leaseForOutcome()) {
+        outcome->completeIdempotencyKey(key, stored.status, stored.body, stored.contentType);
+    }
+}
+
+bool MessageHandler::sendSms(const httplib::Request& req, httplib::Response& res) {
     try {
         // Parse JSON request body
         auto json_data = JsonParser::parse(req.body);
@@ -51,28 +300,29 @@ void MessageHandler::handleSendSms(const httplib::Request& req, httplib::Respons
         if (from.empty() || to.empty() || type.empty() || body.empty() || timestamp.empty()) {
             res.status = toInt(StatusCodeType::BAD_REQUEST);
             res.set_content("{\"status\": \"error\", \"message\": \"Missing required fields\"}", "application/json");
-            return;
+            return false;
         }
         
         // Validate message type
         if (type != "sms" && type != "mms") {
             res.status = toInt(StatusCodeType::BAD_REQUEST);
             res.set_content("{\"status\": \"error\", \"message\": \"Invalid message type\"}", "application/json");
-            return;
+            return false;
         }
         
         // Get the appropriate provider based on message type
-        auto provider = MessagingProviderFactory::getProviderForType(type);
+        auto provider = ProviderRouter::instance().selectProviderForType(type);
         if (!provider) {
             res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
             res.set_content("{\"status\": \"error\", \"message\": \"No provider configured for message type: " + type + "\"}", "application/json");
-            return;
+            return false;
         }
         
-        std::cout << "[MESSAGE HANDLER] Using provider: " << provider->getProviderName() << " for message type: " << type << std::endl;
+        LOG_DEBUG("message_handler", "Provider selected", {{"provider", provider->getProviderName()}, {"type", type}});
         
-        // Create message request
+        // Create message request; its idempotency key stays with it through every provider attempt
         MessageRequest messageRequest(from, to, type, body, provider->getProviderName(), timestamp, "outbound");
+        messageRequest.idempotency_key = IdGenerator::instance().nextBase32();
         
         // Parse attachments if provided
         if (attachments != "null" && !attachments.empty()) {
@@ -85,113 +335,16 @@ void MessageHandler::handleSendSms(const httplib::Request& req, httplib::Respons
             }
         }
         
-        // Send message through provider using worker pool
-        std::cout << "[MESSAGE HANDLER] Submitting sendMessage task to worker pool" << std::endl;
-        auto future = workerPool_->submit([provider, messageRequest]() {
-            return provider->sendMessage(messageRequest);
-        });
-        
-        // Wait for the result
-        MessageResponse providerResponse = future.get();
-        
-        // Connect to database
-        Database db;
-        if (!db.connect()) {
-            res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
-            res.set_content("{\"status\": \"error\", \"message\": \"Database connection failed\"}", "application/json");
-            return;
-        }
-        
-        // Find or create conversation
-        int conversation_id = db.findOrCreateConversation(from, to);
-        if (conversation_id == -1) {
-            res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
-            res.set_content("{\"status\": \"error\", \"message\": \"Failed to find or create conversation\"}", "application/json");
-            return;
-        }
-        
-        // Check if this is a scheduled message
-        bool isScheduled = (send_time != "null" && !send_time.empty());
-        
-        if (isScheduled) {
-            // For scheduled messages, store with sent_time=NULL and schedule for later
-            int message_id = db.insertMessage(
-                conversation_id,
-                from,
-                to,
-                type,
-                body,
-                attachments,
-                providerResponse.provider_message_id,
-                timestamp,
-                "outbound",
-                "" // sent_time is NULL for scheduled messages
-            );
-            
-            if (message_id == -1) {
-                res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
-                res.set_content("{\"status\": \"error\", \"message\": \"Failed to store scheduled message\"}", "application/json");
-                return;
-            }
-            
-            // Schedule the message for future sending using the new scheduler
-            messageScheduler_->scheduleMessage(
-                message_id,
-                conversation_id,
-                from,
-                to,
-                type,
-                body,
-                attachments,
-                providerResponse.provider_message_id,
-                timestamp,
-                send_time,
-                provider
-            );
-            
-            res.status = toInt(StatusCodeType::OK);
-            res.set_content("{\"status\": \"success\", \"message\": \"Message scheduled for delivery\", \"conversation_id\": " + std::to_string(conversation_id) + ", \"message_id\": " + std::to_string(message_id) + ", \"scheduled_time\": \"" + send_time + "\"}", "application/json");
-        } else {
-            // For immediate messages, store with sent_time and return provider response
-            std::string currentTime = getCurrentTimestamp();
-            int message_id = db.insertMessage(
-                conversation_id,
-                from,
-                to,
-                type,
-                body,
-                attachments,
-                providerResponse.provider_message_id,
-                timestamp,
-                "outbound",
-                currentTime // sent_time is set to current time for immediate messages
-            );
-            
-            if (message_id == -1) {
-                res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
-                res.set_content("{\"status\": \"error\", \"message\": \"Failed to store message\"}", "application/json");
-                return;
-            }
-            
-            // Return response based on provider result
-            if (providerResponse.success) {
-                res.status = toInt(StatusCodeType::OK);
-                res.set_content("{\"status\": \"success\", \"message\": \"" + providerResponse.message + "\", \"conversation_id\": " + std::to_string(conversation_id) + ", \"message_id\": " + std::to_string(message_id) + ", \"provider_message_id\": \"" + providerResponse.provider_message_id + "\"}", "application/json");
-            } else {
-                res.status = providerResponse.http_status_code;
-                res.set_content("{\"status\": \"error\", \"message\": \"" + providerResponse.message + "\", \"error_code\": \"" + providerResponse.error_code + "\"}", "application/json");
-            }
-        }
+        return processOutboundMessage(messageRequest, provider, attachments, send_time, tenantFor(req, from), res);
         
     } catch (const std::exception& e) {
         res.status = toInt(StatusCodeType::BAD_REQUEST);
         res.set_content("{\"status\": \"error\", \"message\": \"Invalid JSON or processing error\"}", "application/json");
+        return false;
     }
 }
 
-void MessageHandler::handleSendEmail(const httplib::Request& req, httplib::Response& res) {
-    logRequest("Send Email", req.body);
-    
+bool MessageHandler::sendEmail(const httplib::Request& req, httplib::Response& res) {
     try {
         // Parse JSON request body
         auto json_data = JsonParser::parse(req.body);
@@ -211,28 +364,29 @@ void MessageHandler::handleSendEmail(const httplib::Request& req, httplib::Respo
             body.empty() || timestamp.empty()) {
             res.status = toInt(StatusCodeType::BAD_REQUEST);
             res.set_content("{\"status\": \"error\", \"message\": \"Missing required fields\"}", "application/json");
-            return;
+            return false;
         }
         
         // Validate message type
         if (type != "email") {
             res.status = toInt(StatusCodeType::BAD_REQUEST);
             res.set_content("{\"status\": \"error\", \"message\": \"Invalid message type\"}", "application/json");
-            return;
+            return false;
         }
         
         // Get the appropriate provider based on message type
-        auto provider = MessagingProviderFactory::getProviderForType(type);
+        auto provider = ProviderRouter::instance().selectProviderForType(type);
         if (!provider) {
             res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
             res.set_content("{\"status\": \"error\", \"message\": \"No provider configured for message type: " + type + "\"}", "application/json");
-            return;
+            return false;
         }
         
-        std::cout << "[MESSAGE HANDLER] Using provider: " << provider->getProviderName() << " for message type: " << type << std::endl;
+        LOG_DEBUG("message_handler", "Provider selected", {{"provider", provider->getProviderName()}, {"type", type}});
         
-        // Create message request
+        // Create message request; its idempotency key stays with it through every provider attempt
         MessageRequest messageRequest(from, to, type, body, provider->getProviderName(), timestamp, "outbound");
+        messageRequest.idempotency_key = IdGenerator::instance().nextBase32();
         messageRequest.subject = subject;
         
         // Parse attachments if provided
@@ -246,69 +400,198 @@ void MessageHandler::handleSendEmail(const httplib::Request& req, httplib::Respo
             }
         }
         
-        // Send message through provider using worker pool
-        std::cout << "[MESSAGE HANDLER] Submitting sendMessage task to worker pool" << std::endl;
-        auto future = workerPool_->submit([provider, messageRequest]() {
-            return provider->sendMessage(messageRequest);
-        });
+        // For email messages, always send immediately (no scheduling support yet)
+        return processOutboundMessage(messageRequest, provider, attachments, "null", tenantFor(req, from), res);
         
-        // Wait for the result
-        MessageResponse providerResponse = future.get();
+    } catch (const std::exception& e) {
+        res.status = toInt(StatusCodeType::BAD_REQUEST);
+        res.set_content("{\"status\": \"error\", \"message\": \"Invalid JSON or processing error\"}", "application/json");
+        return false;
+    }
+}
+
+bool MessageHandler::processOutboundMessage(const MessageRequest& messageRequest,
+                                            std::shared_ptr<MessagingProvider> provider,
+                                            const std::string& attachments,
+                                            const std::string& send_time,
+                                            const std::string& tenant,
+                                            httplib::Response& res) {
+    // Check if this is a scheduled message
+    bool isScheduled = (send_time != "null" && !send_time.empty());
+    
+    // Lease a database connection
+    auto database = databasePool_.acquire();
+    if (!database) {
+        res.status = toInt(StatusCodeType::SERVICE_UNAVAILABLE);
+        res.set_content("{\"status\": \"error\", \"message\": \"Database unavailable\"}", "application/json");
+        return false;
+    }
+    
+    // Find or create conversation
+    int conversation_id = database->findOrCreateConversation(messageRequest.from, messageRequest.to);
+    if (conversation_id == -1) {
+        res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
+        res.set_content("{\"status\": \"error\", \"message\": \"Failed to find or create conversation\"}", "application/json");
+        return false;
+    }
+    
+    // Immediate sends must fit the sender/recipient/provider rate limits;
+    // anything over the limit is deferred to the scheduler instead of failing.
+    // Scheduled messages are shaped when the scheduler sends them.
+    std::chrono::milliseconds rateDelay(0);
+    if (!isScheduled && !rateShaper_->reserve(messageRequest.from, messageRequest.to, provider->getProviderName(), rateDelay)) {
+        res.status = toInt(StatusCodeType::TOO_MANY_REQUESTS);
+        res.set_header("Retry-After", "60");
+        res.set_content("{\"status\": \"error\", \"message\": \"Rate limit backlog exceeded for this sender or recipient\"}", "application/json");
+        return false;
+    }
+    bool isDeferred = rateDelay.count() > 0;
+    
+    // Send message through provider on the conversation's lane, so two sends
+    // in one conversation reach the provider in the order they arrived here.
+    // Scheduled messages also go out now, and again when the scheduler fires.
+    MessageResponse providerResponse;
+    if (!isDeferred) {
+        LOG_DEBUG("message_handler", "Dispatching send", {{"conversation_id", conversation_id}, {"tenant", tenant}});
         
-        // Connect to database
-        Database db;
-        if (!db.connect()) {
-            res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
-            res.set_content("{\"status\": \"error\", \"message\": \"Database connection failed\"}", "application/json");
-            return;
+        // Wait for the result without holding a pooled connection through the provider call
+        database = DatabasePool::Lease();
+        auto outcome = sendQueue_->send(tenant, static_cast<uint64_t>(conversation_id), [provider, messageRequest]() {
+            return ProviderRouter::instance().dispatch(provider, messageRequest);
+        }, providerResponse);
+        if (outcome != SendQueue::Outcome::Sent) {
+            // Nothing was sent, so the rate slot goes back to the sender
+            if (!isScheduled) {
+                rateShaper_->release(messageRequest.from, messageRequest.to, provider->getProviderName());
+            }
+            res.set_header("Retry-After", "1");
+            if (outcome == SendQueue::Outcome::TenantQueueFull) {
+                fairQueueRejected_->inc();
+                res.status = toInt(StatusCodeType::TOO_MANY_REQUESTS);
+                res.set_content("{\"status\": \"error\", \"message\": \"Too many sends queued for this tenant\"}", "application/json");
+            } else {
+                res.status = toInt(StatusCodeType::SERVICE_UNAVAILABLE);
+                res.set_content("{\"status\": \"error\", \"message\": \"Sending is unavailable, retry later\"}", "application/json");
+            }
+            return false;
         }
-        
-        // Find or create conversation
-        int conversation_id = db.findOrCreateConversation(from, to);
-        if (conversation_id == -1) {
-            res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
-            res.set_content("{\"status\": \"error\", \"message\": \"Failed to find or create conversation\"}", "application/json");
-            return;
+        database = databasePool_.acquire();
+        if (!database) {
+            res.status = toInt(StatusCodeType::SERVICE_UNAVAILABLE);
+            res.set_content("{\"status\": \"error\", \"message\": \"Database unavailable, message sent but not stored\"}", "application/json");
+            return true;
         }
-        
-        // For email messages, always send immediately (no scheduling support yet)
-        std::string currentTime = getCurrentTimestamp();
-        int message_id = db.insertMessage(
+    }
+    
+    if (isScheduled || isDeferred) {
+        // Store with sent_time=NULL; the provider message ID is filled in once it is actually sent.
+        // The due time and owning node let a restarted server pick the message up again.
+        auto dueTime = isScheduled ? MessageScheduler::parseSendTime(send_time)
+                                   : std::chrono::system_clock::now() + rateDelay;
+        long long dueTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(dueTime.time_since_epoch()).count();
+        int message_id = database->insertMessage(
             conversation_id,
-            from,
-            to,
-            type,
-            body,
+            messageRequest.from,
+            messageRequest.to,
+            messageRequest.type,
+            messageRequest.body,
             attachments,
             providerResponse.provider_message_id,
-            timestamp,
+            messageRequest.timestamp,
             "outbound",
-            currentTime // sent_time is set to current time for immediate messages
+            "", // sent_time is NULL for scheduled messages
+            dueTimeMs,
+            IdGenerator::instance().getNodeId()
         );
         
         if (message_id == -1) {
+            if (isDeferred) {
+                rateShaper_->release(messageRequest.from, messageRequest.to, provider->getProviderName());
+            }
             res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
-            res.set_content("{\"status\": \"error\", \"message\": \"Failed to store message\"}", "application/json");
-            return;
+            res.set_content("{\"status\": \"error\", \"message\": \"Failed to store scheduled message\"}", "application/json");
+            // A deferred message has not been sent yet; a scheduled one went out above
+            return isScheduled;
         }
         
-        // Return response based on provider result
-        if (providerResponse.success) {
+        if (isScheduled) {
+            // Schedule the message for future sending using the new scheduler
+            messageScheduler_->scheduleMessage(
+                message_id,
+                conversation_id,
+                messageRequest.from,
+                messageRequest.to,
+                messageRequest.type,
+                messageRequest.body,
+                attachments,
+                providerResponse.provider_message_id,
+                messageRequest.timestamp,
+                send_time,
+                provider
+            );
+            
             res.status = toInt(StatusCodeType::OK);
-            res.set_content("{\"status\": \"success\", \"message\": \"" + providerResponse.message + "\", \"conversation_id\": " + std::to_string(conversation_id) + ", \"message_id\": " + std::to_string(message_id) + ", \"provider_message_id\": \"" + providerResponse.provider_message_id + "\"}", "application/json");
-        } else {
-            res.status = providerResponse.http_status_code;
-            res.set_content("{\"status\": \"error\", \"message\": \"" + providerResponse.message + "\", \"error_code\": \"" + providerResponse.error_code + "\"}", "application/json");
+            res.set_content("{\"status\": \"success\", \"message\": \"Message scheduled for delivery\", \"conversation_id\": " + std::to_string(conversation_id) + ", \"message_id\": " + std::to_string(message_id) + ", \"scheduled_time\": \"" + send_time + "\"}", "application/json");
+            return true;
         }
         
-    } catch (const std::exception& e) {
-        res.status = toInt(StatusCodeType::BAD_REQUEST);
-        res.set_content("{\"status\": \"error\", \"message\": \"Invalid JSON or processing error\"}", "application/json");
+        // Rate limited: the reserved slot becomes the scheduled send time
+        ScheduledMessage deferred;
+        deferred.send_time = dueTime;
+        deferred.message_id = message_id;
+        deferred.conversation_id = conversation_id;
+        deferred.from = messageRequest.from;
+        deferred.to = messageRequest.to;
+        deferred.type = messageRequest.type;
+        deferred.body = messageRequest.body;
+        deferred.attachments = attachments;
+        deferred.timestamp = messageRequest.timestamp;
+        deferred.provider = provider;
+        deferred.rate_shaped = true;
+        deferred.priority = TaskPriority::Retry;
+        messageScheduler_->scheduleMessage(deferred);
+        
+        res.status = toInt(StatusCodeType::ACCEPTED);
+        res.set_content("{\"status\": \"queued\", \"message\": \"Message delayed by rate limit\", \"conversation_id\": " + std::to_string(conversation_id) + ", \"message_id\": " + std::to_string(message_id) + ", \"delay_ms\": " + std::to_string(rateDelay.count()) + "}", "application/json");
+        return true;
+    }
+    
+    // For immediate messages, store with sent_time and return provider response
+    std::string currentTime = getCurrentTimestamp();
+    int message_id = database->insertMessage(
+        conversation_id,
+        messageRequest.from,
+        messageRequest.to,
+        messageRequest.type,
+        messageRequest.body,
+        attachments,
+        providerResponse.provider_message_id,
+        messageRequest.timestamp,
+        "outbound",
+        currentTime // sent_time is set to current time for immediate messages
+    );
+    
+    if (message_id == -1) {
+        res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
+        res.set_content("{\"status\": \"error\", \"message\": \"Failed to store message\"}", "application/json");
+        return true;
+    }
+    
+    // Return response based on provider result
+    if (providerResponse.success) {
+        res.status = toInt(StatusCodeType::OK);
+        res.set_content("{\"status\": \"success\", \"message\": \"" + providerResponse.message + "\", \"conversation_id\": " + std::to_string(conversation_id) + ", \"message_id\": " + std::to_string(message_id) + ", \"provider_message_id\": \"" + providerResponse.provider_message_id + "\"}", "application/json");
+    } else {
+        res.status = providerResponse.http_status_code;
+        res.set_content("{\"status\": \"error\", \"message\": \"" + providerResponse.message + "\", \"error_code\": \"" + providerResponse.error_code + "\"}", "application/json");
     }
+    return true;
 }
 
 void MessageHandler::logRequest(const std::string& endpoint, const std::string& body) {
-    std::cout << "[" << endpoint << "] Received request: " << body << std::endl;
+    // Bodies can be large and contain message content; only include them at debug level
+    LOG_INFO("message_handler", "Received request", {{"endpoint", endpoint}, {"bytes", body.size()}});
+    LOG_DEBUG("message_handler", "Request body", {{"endpoint", endpoint}, {"body", body}});
 }
 
 
@@ -1,19 +1,32 @@
 #pragma once
 
 #include <httplib.h>
+#include <chrono>
+#include <functional>
 #include <string>
 #include <memory>
+#include <vector>
 #include "../utils/worker_pool.h"
+#include "../utils/ordered_dispatcher.h"
 #include "../utils/message_scheduler.h"
+#include "../utils/rate_shaper.h"
+#include "../utils/fair_queue.h"
+#include "../utils/send_queue.h"
 #include "../providers/messaging_provider.h"
+#include "../database/database_pool.h"
+
+namespace messaging_service {
+class Counter;
+}
 
 //This class handles sending messages
 class MessageHandler {
 public:
     /**
      * @brief Constructor - initializes the worker pool
+     * @param databasePool Connections shared with other handlers; must outlive the handler
      */
-    MessageHandler();
+    explicit MessageHandler(DatabasePool& databasePool);
     
     /**
      * @brief Destructor - stops the worker pool
@@ -34,7 +47,51 @@ public:
      */
     void handleSendEmail(const httplib::Request& req, httplib::Response& res);
     
+    /**
+     * @brief Load unsent scheduled and rate-deferred messages stored by a previous run
+     * Claims messages left by this node or released by a node that shut down.
+     * @return Number of messages handed to the scheduler
+     */
+    size_t recoverScheduledMessages();
+    
+    /**
+     * @brief Finish queued sends and hand unsent scheduled messages back to the database
+     * Stops the scheduler, waits up to timeout for the worker pool to go idle,
+     * drops sends still queued after that, then releases this node's scheduled
+     * messages so the next process to start can claim them.
+     * @param timeout Time queued sends get to finish
+     * @return true if every queued send finished in time
+     */
+    bool drain(std::chrono::milliseconds timeout);
+    
 private:
+    /**
+     * @brief Run a send at most once per Idempotency-Key header
+     * Without the header the send simply runs. With it, a retry of a finished
+     * send gets the stored response replayed, a retry arriving while the
+     * first is running waits for its response, and a key reused with a
+     * different body is refused with 422. A 429 or 5xx refusal made before
+     * the provider was called is not stored, so retrying it runs the send
+     * again; every response after the provider was called is stored, since
+     * a provider timeout or a failed store may hide a send that went out.
+     * @param req HTTP request carrying Idempotency-Key and X-Api-Key
+     * @param res HTTP response object to populate
+     * @param send Validates and sends the request, writing res; returns whether the provider was called
+     */
+    void handleIdempotent(const httplib::Request& req, httplib::Response& res, const std::function<bool()>& send);
+    
+    /**
+     * @brief Validate and send an SMS/MMS request
+     * @return true if the provider was called
+     */
+    bool sendSms(const httplib::Request& req, httplib::Response& res);
+    
+    /**
+     * @brief Validate and send an email request
+     * @return true if the provider was called
+     */
+    bool sendEmail(const httplib::Request& req, httplib::Response& res);
+    
     /**
      * @brief Log request information to console
      * @param endpoint The endpoint being accessed
@@ -42,6 +99,23 @@ private:
      */
     void logRequest(const std::string& endpoint, const std::string& body);
     
+    /**
+     * @brief Send, schedule or rate-defer a validated outbound message and store it
+     * @param messageRequest The validated message to send
+     * @param provider The provider selected for the message type
+     * @param attachments Raw attachments JSON to store with the message
+     * @param send_time Requested delivery time, or "null" to send now
+     * @param tenant Tenant immediate sends are fair-queued under
+     * @param res HTTP response object to populate with the result
+     * @return true if the provider was called or the message was stored for a later send
+     */
+    bool processOutboundMessage(const messaging_service::MessageRequest& messageRequest,
+                                std::shared_ptr<messaging_service::MessagingProvider> provider,
+                                const std::string& attachments,
+                                const std::string& send_time,
+                                const std::string& tenant,
+                                httplib::Response& res);
+    
     
     /**
      * @brief Get current timestamp in ISO format
@@ -49,13 +123,48 @@ private:
      */
     std::string getCurrentTimestamp();
     
+    /**
+     * @brief Connections leased per request, and for recovery and drain
+     */
+    DatabasePool& databasePool_;
+    
     /**
      * @brief Worker pool for handling provider sendMessage operations
      */
     std::unique_ptr<messaging_service::WorkerPool> workerPool_;
     
+    /**
+     * @brief Per-conversation serial lanes on top of the worker pool
+     */
+    std::unique_ptr<messaging_service::OrderedDispatcher> orderedDispatcher_;
+    
+    /**
+     * @brief Per-sender, per-recipient and per-provider token buckets
+     */
+    std::unique_ptr<messaging_service::RateShaper> rateShaper_;
+    
     /**
      * @brief Message scheduler for handling delayed message sending
      */
     std::unique_ptr<messaging_service::MessageScheduler> messageScheduler_;
+    
+    /**
+     * @brief Per-tenant deficit round robin queue in front of immediate sends
+     */
+    std::unique_ptr<messaging_service::FairQueue> fairQueue_;
+    
+    /**
+     * @brief Immediate sends through the fair queue onto the conversation lanes
+     */
+    std::unique_ptr<messaging_service::SendQueue> sendQueue_;
+    
+    /**
+     * @brief Count of sends refused because the tenant's queue was full
+     */
+    messaging_service::Counter* fairQueueRejected_;
+    
+    /**
+     * @brief Gauge callbacks registered with the metrics registry, removed on destruction
+     */
+    std::vector<uint64_t> metricCallbacks_;
 };
@@ -1,8 +1,12 @@
 #include "webhook_handler.h"
-#include "../database/database.h"
 #include "../utils/json_parser.h"
 #include "../types/status_codes.h"
-#include <iostream>
+#include "../utils/duplicate_filter.h"
+#include "../utils/logger.h"
+#include "../utils/metrics.h"
+
+WebhookHandler::WebhookHandler(DatabasePool& databasePool) : databasePool_(databasePool) {
+}
 
 void WebhookHandler::handleIncomingSms(const httplib::Request& req, httplib::Response& res) {
     logRequest("Incoming SMS Webhook", req.body);
@@ -35,24 +39,33 @@ void WebhookHandler::handleIncomingSms(const httplib::Request& req, httplib::Res
             return;
         }
         
+        // Redeliveries of a webhook seen recently are acknowledged without touching the database
+        std::string dedup_key = "sms:" + messaging_provider_id;
+        if (messaging_service::DuplicateFilter::instance().contains(dedup_key)) {
+            respondDuplicate(res, "filter", dedup_key);
+            return;
+        }
+        
         // Connect to database
-        Database db;
-        if (!db.connect()) {
+        auto db = databasePool_.acquire();
+        if (!db) {
             res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
             res.set_content("{\"status\": \"error\", \"message\": \"Database connection failed\"}", "application/json");
             return;
         }
         
         // Find or create conversation
-        int conversation_id = db.findOrCreateConversation(from, to);
+        int conversation_id = db->findOrCreateConversation(from, to);
         if (conversation_id == -1) {
             res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
             res.set_content("{\"status\": \"error\", \"message\": \"Failed to find or create conversation\"}", "application/json");
             return;
         }
         
-        // Store message in database - for inbound messages, sent_time is the timestamp
-        int message_id = db.insertMessage(
+        // Store message in database unless another delivery already did - for inbound messages, sent_time is the timestamp
+        bool duplicate = false;
+        int message_id = db->insertInboundMessage(
+            "sms",
             conversation_id,
             from,
             to,
@@ -61,8 +74,7 @@ void WebhookHandler::handleIncomingSms(const httplib::Request& req, httplib::Res
             attachments,
             messaging_provider_id,
             timestamp,
-            "inbound",
-            timestamp // For inbound messages, sent_time is the same as timestamp
+            duplicate
         );
         
         if (message_id == -1) {
@@ -70,12 +82,17 @@ void WebhookHandler::handleIncomingSms(const httplib::Request& req, httplib::Res
             res.set_content("{\"status\": \"error\", \"message\": \"Failed to store message\"}", "application/json");
             return;
         }
+        messaging_service::DuplicateFilter::instance().add(dedup_key);
+        if (duplicate) {
+            respondDuplicate(res, "database", dedup_key);
+            return;
+        }
         
         res.status = toInt(StatusCodeType::OK);
         res.set_content("{\"status\": \"success\", \"message\": \"SMS webhook processed\", \"conversation_id\": " + std::to_string(conversation_id) + "}", "application/json");
         
     } catch (const std::exception& e) {
-        std::cerr << "Error processing SMS webhook: " << e.what() << std::endl;
+        LOG_ERROR("webhook_handler", "Error processing SMS webhook", {{"error", e.what()}});
         res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
         res.set_content("{\"status\": \"error\", \"message\": \"Internal server error\"}", "application/json");
     }
@@ -102,23 +119,32 @@ void WebhookHandler::handleIncomingEmail(const httplib::Request& req, httplib::R
             return;
         }
 
-        Database db;
-        if (!db.connect()) {
+        // Redeliveries of a webhook seen recently are acknowledged without touching the database
+        std::string dedup_key = "email:" + xillio_id;
+        if (messaging_service::DuplicateFilter::instance().contains(dedup_key)) {
+            respondDuplicate(res, "filter", dedup_key);
+            return;
+        }
+
+        auto db = databasePool_.acquire();
+        if (!db) {
             res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
             res.set_content("{\"status\": \"error\", \"message\": \"Database connection failed\"}", "application/json");
             return;
         }
         
         // Find or create conversation
-        int conversation_id = db.findOrCreateConversation(from, to);
+        int conversation_id = db->findOrCreateConversation(from, to);
         if (conversation_id == -1) {
             res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
             res.set_content("{\"status\": \"error\", \"message\": \"Failed to find or create conversation\"}", "application/json");
             return;
         }
 
-        // Store message in database - for inbound messages, sent_time is the timestamp
-        int message_id = db.insertMessage(
+        // Store message in database unless another delivery already did - for inbound messages, sent_time is the timestamp
+        bool duplicate = false;
+        int message_id = db->insertInboundMessage(
+            "email",
             conversation_id,
             from,
             to,
@@ -127,8 +153,7 @@ void WebhookHandler::handleIncomingEmail(const httplib::Request& req, httplib::R
             attachments,
             xillio_id,
             timestamp,
-            "inbound",
-            timestamp // For inbound messages, sent_time is the same as timestamp
+            duplicate
         );
         
         if (message_id == -1) {
@@ -136,17 +161,36 @@ void WebhookHandler::handleIncomingEmail(const httplib::Request& req, httplib::R
             res.set_content("{\"status\": \"error\", \"message\": \"Failed to store message\"}", "application/json");
             return;
         }
+        messaging_service::DuplicateFilter::instance().add(dedup_key);
+        if (duplicate) {
+            respondDuplicate(res, "database", dedup_key);
+            return;
+        }
 
         res.status = toInt(StatusCodeType::OK);
         res.set_content("{\"status\": \"success\", \"message\": \"Email webhook processed\", \"conversation_id\": " + std::to_string(conversation_id) + "}", "application/json");
 
     } catch (const std::exception& e) {
-        std::cerr << "Error processing Email webhook: " << e.what() << std::endl;
+        LOG_ERROR("webhook_handler", "Error processing Email webhook", {{"error", e.what()}});
         res.status = toInt(StatusCodeType::INTERNAL_SERVER_ERROR);
         res.set_content("{\"status\": \"error\", \"message\": \"Internal server error\"}", "application/json");
     }
 }
 
+void WebhookHandler::respondDuplicate(httplib::Response& res, const std::string& check, const std::string& key) {
+    static auto& filterDuplicates = messaging_service::MetricsRegistry::instance().counter(
+        "webhook_duplicates_total", "Redelivered inbound webhooks acknowledged without storing a message", {{"check", "filter"}});
+    static auto& databaseDuplicates = messaging_service::MetricsRegistry::instance().counter(
+        "webhook_duplicates_total", "Redelivered inbound webhooks acknowledged without storing a message", {{"check", "database"}});
+    (check == "filter" ? filterDuplicates : databaseDuplicates).inc();
+    LOG_INFO("webhook_handler", "Duplicate webhook acknowledged", {{"key", key}, {"check", check}});
+    
+    // Providers stop redelivering once they get a 2xx
+    res.status = toInt(StatusCodeType::OK);
+    res.set_content("{\"status\": \"success\", \"message\": \"Duplicate webhook ignored\", \"duplicate\": true}", "application/json");
+}
+
 void WebhookHandler::logRequest(const std::string& endpoint, const std::string& body) {
-    std::cout << "[" << endpoint << "] Received webhook: " << body << std::endl;
+    LOG_INFO("webhook_handler", "Received webhook", {{"endpoint", endpoint}, {"bytes", body.size()}});
+    LOG_DEBUG("webhook_handler", "Webhook body", {{"endpoint", endpoint}, {"body", body}});
 }
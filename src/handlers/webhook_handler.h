@@ -2,10 +2,21 @@
 
 #include <httplib.h>
 #include <string>
+#include "../database/database_pool.h"
 
 //This class handles incoming messages
+//One instance serves every request; each request leases its own connection from the pool
 class WebhookHandler {
+private:
+    DatabasePool& databasePool_;
+    
 public:
+    /**
+     * @brief Constructor for WebhookHandler
+     * @param databasePool Connections shared with other handlers; must outlive the handler
+     */
+    explicit WebhookHandler(DatabasePool& databasePool);
+    
     /**
      * @brief Handle POST request for incoming SMS/MMS webhooks
      * @param req HTTP request object containing incoming SMS/MMS data
@@ -21,6 +32,14 @@ public:
     void handleIncomingEmail(const httplib::Request& req, httplib::Response& res);
     
 private:
+    /**
+     * @brief Acknowledge a webhook whose provider message id was already received
+     * @param res HTTP response object; set to 200 so the provider stops redelivering
+     * @param check Which check caught it, "filter" or "database"
+     * @param key Source-qualified provider message id, for the log
+     */
+    void respondDuplicate(httplib::Response& res, const std::string& check, const std::string& key);
+    
     /**
      * @brief Log request information to console
      * @param endpoint The endpoint being accessed
@@ -1,37 +1,132 @@
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
 #include <memory>
+#include <pthread.h>
 #include <string>
+#include <thread>
 #include "server/server.h"
+#include "server/server_config.h"
+#include "server/supervisor.h"
+#include "utils/id_generator.h"
+#include "utils/logger.h"
 
-int main(int argc, char* argv[]) {
-    int port = 8080; // Default port
-    
-    // Parse command line arguments
-    if (argc > 1) {
-        try {
-            port = std::stoi(argv[1]);
-            if (port < 1 || port > 65535) {
-                std::cerr << "Error: Port must be between 1 and 65535" << std::endl;
-                return 1;
+namespace {
+
+/**
+ * @brief Serve until SIGTERM or SIGINT, then drain
+ * SIGTERM and SIGINT must already be blocked so that every thread the server
+ * starts inherits the mask and only the waiter thread receives them. SIGTERM,
+ * sent by orchestrators, waits drain_delay for load balancers to notice the
+ * failing health check; SIGINT from a terminal stops accepting at once.
+ */
+int runServer(const messaging_service::ServerConfig& config) {
+    std::unique_ptr<MessagingServer> server;
+    try {
+        server = std::make_unique<MessagingServer>(config);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::atomic<bool> done{false};
+    std::thread signalWaiter([&server, &done] {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGTERM);
+        sigaddset(&signals, SIGINT);
+        bool stopRequested = false;
+        while (!done.load()) {
+            timespec tick{0, 200 * 1000 * 1000};
+            int received = sigtimedwait(&signals, nullptr, &tick);
+            if ((received == SIGTERM || received == SIGINT) && !stopRequested) {
+                LOG_INFO("server", "Shutting down", {{"signal", received}});
+                stopRequested = true;
+                server->shutdown(received == SIGTERM);
+            }
+            // Repeated until start() returns, in case the signal arrived before listening began
+            if (stopRequested) {
+                server->stop();
             }
-        } catch (const std::exception& e) {
-            std::cerr << "Error: Invalid port number '" << argv[1] << "'" << std::endl;
-            std::cerr << "Usage: " << argv[0] << " [port]" << std::endl;
-            return 1;
         }
-    }
-    
-    std::cout << "Starting Messaging Service on port " << port << "..." << std::endl;
-    
-    try {
-        auto server = std::make_unique<MessagingServer>(port);
+    });
 
+    int status = 0;
+    try {
         //loops
         server->start();
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
+        status = 1;
+    }
+
+    done = true;
+    signalWaiter.join();
+    server->drain();
+    return status;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            std::cout << messaging_service::ServerConfig::usage(argv[0]) << std::endl;
+            return 0;
+        }
+    }
+
+    // Parse config file, environment and command line arguments
+    messaging_service::ServerConfig config;
+    std::string error;
+    if (!messaging_service::ServerConfig::load(argc, argv, config, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        std::cerr << messaging_service::ServerConfig::usage(argv[0]) << std::endl;
         return 1;
     }
-    
-    return 0;
+
+    // Block shutdown signals before any thread exists; they are taken with sigtimedwait
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    size_t workers = config.resolvedWorkers();
+
+    // Each worker gets its own node id so message ids and scheduled-send claims
+    // stay unique across processes and across instances; NODE_ID is read here
+    // unmasked so a value outside the node-bit range is refused, not wrapped
+    const char* node = std::getenv("NODE_ID");
+    unsigned long nodeId = node ? std::strtoul(node, nullptr, 10) : 0;
+    uint16_t workerNodeId = 0;
+    if (nodeId > messaging_service::IdGenerator::kMaxNodeId ||
+        !messaging_service::IdGenerator::workerNodeId(static_cast<uint32_t>(nodeId), workers, workers - 1, workerNodeId)) {
+        std::cerr << "Error: NODE_ID " << nodeId << " with " << workers << " workers needs node ids up to "
+                  << (static_cast<unsigned long long>(nodeId) + 1) * workers - 1 << ", above the maximum of "
+                  << messaging_service::IdGenerator::kMaxNodeId << std::endl;
+        return 1;
+    }
+
+    std::cout << "Starting Messaging Service on port " << config.port << " with " << workers
+              << (workers == 1 ? " process" : " processes") << "..." << std::endl;
+
+    if (workers == 1) {
+        messaging_service::IdGenerator::instance().setNodeId(static_cast<uint16_t>(nodeId));
+        return runServer(config);
+    }
+
+    messaging_service::SupervisorOptions options;
+    options.workers = workers;
+    options.shutdownTimeout = std::chrono::seconds(config.shutdownTimeoutSec);
+    messaging_service::Supervisor supervisor(options, [&config, nodeId, workers](size_t index) {
+        uint16_t workerNodeId = 0;
+        messaging_service::IdGenerator::workerNodeId(static_cast<uint32_t>(nodeId), workers, index, workerNodeId);
+        messaging_service::IdGenerator::instance().setNodeId(workerNodeId);
+        return runServer(config);
+    });
+    return supervisor.run();
 }
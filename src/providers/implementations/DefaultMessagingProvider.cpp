@@ -1,7 +1,6 @@
 #include "DefaultMessagingProvider.h"
-#include <iostream>
-#include <random>
-#include <sstream>
+#include "../../utils/id_generator.h"
+#include "../../utils/logger.h"
 #include <algorithm>
 
 namespace messaging_service {
@@ -15,11 +14,8 @@ MessageResponse DefaultMessagingProvider::sendMessage(const MessageRequest& requ
     std::string mockMessageId = generateMockMessageId();
     
     // Log the simulated send
-    std::cout << "[DEFAULT PROVIDER] Simulating send via " << providerName_ 
-              << " - From: " << request.from 
-              << ", To: " << request.to 
-              << ", Type: " << request.type
-              << ", Message ID: " << mockMessageId << std::endl;
+    LOG_DEBUG("default_provider", "Simulated send", {{"provider", providerName_}, {"from", request.from},
+              {"to", request.to}, {"type", request.type}, {"message_id", mockMessageId}});
     
     // Always return success
     return MessageResponse(true, 
@@ -38,13 +34,13 @@ bool DefaultMessagingProvider::supportsMessageType(const std::string& messageTyp
 }
 
 std::string DefaultMessagingProvider::generateMockMessageId() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(100000, 999999);
+    char encoded[IdGenerator::kBase32Length];
+    IdGenerator::encodeBase32(IdGenerator::instance().next(), encoded);
     
-    std::ostringstream oss;
-    oss << providerName_ << "_" << dis(gen);
-    return oss.str();
+    std::string id;
+    id.reserve(providerName_.length() + 1 + IdGenerator::kBase32Length);
+    id.append(providerName_).append(1, '_').append(encoded, IdGenerator::kBase32Length);
+    return id;
 }
 
 } // namespace messaging_service
@@ -47,7 +47,7 @@ public:
 private:
     /**
      * @brief Generate a mock message ID for simulated responses
-     * @return Randomly generated message ID string
+     * @return Provider name followed by a unique Snowflake ID, e.g. "twilio_01J5K8..."
      */
     std::string generateMockMessageId();
 };
@@ -0,0 +1,255 @@
+#include "HttpMessagingProvider.h"
+#include "../../utils/json_parser.h"
+#include "../../utils/id_generator.h"
+#include "../../utils/logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace messaging_service {
+
+namespace {
+
+int envInt(const char* name, int fallback, int minimum = 1) {
+    const char* value = std::getenv(name);
+    if (!value) {
+        return fallback;
+    }
+    try {
+        int parsed = std::stoi(value);
+        return parsed >= minimum ? parsed : fallback;
+    } catch (const std::exception&) {
+        return fallback;
+    }
+}
+
+} // namespace
+
+HttpProviderConfig HttpProviderConfig::fromEnvironment(const std::string& baseUrl) {
+    HttpProviderConfig config;
+    config.baseUrl = baseUrl;
+    if (const char* path = std::getenv("HTTP_PROVIDER_SEND_PATH")) {
+        config.sendPath = path;
+    }
+    config.maxConnections = static_cast<size_t>(envInt("HTTP_PROVIDER_MAX_CONNECTIONS", static_cast<int>(config.maxConnections)));
+    config.connectTimeoutMs = envInt("HTTP_PROVIDER_CONNECT_TIMEOUT_MS", config.connectTimeoutMs);
+    config.readTimeoutMs = envInt("HTTP_PROVIDER_READ_TIMEOUT_MS", config.readTimeoutMs);
+    config.writeTimeoutMs = envInt("HTTP_PROVIDER_WRITE_TIMEOUT_MS", config.writeTimeoutMs);
+    config.checkoutTimeoutMs = envInt("HTTP_PROVIDER_CHECKOUT_TIMEOUT_MS", config.checkoutTimeoutMs);
+    config.maxRetries = envInt("HTTP_PROVIDER_MAX_RETRIES", config.maxRetries, 0);
+    return config;
+}
+
+HttpMessagingProvider::HttpMessagingProvider(const std::string& providerName,
+                                             const std::vector<std::string>& supportedTypes,
+                                             const HttpProviderConfig& config)
+    : providerName_(providerName), supportedTypes_(supportedTypes), config_(config),
+      openConnections_(0), requests_(0), failures_(0), retries_(0), connectionsOpened_(0),
+      connectionReuses_(0), connectionsDiscarded_(0), checkoutWaits_(0), checkoutTimeouts_(0),
+      checkoutWait_(&MetricsRegistry::instance().histogram("http_provider_checkout_wait_seconds",
+                    "Time sends wait for a pooled vendor connection", {{"provider", providerName}})),
+      checkoutTimeoutCount_(&MetricsRegistry::instance().counter("http_provider_checkout_timeouts_total",
+                            "Sends that gave up waiting for a pooled vendor connection", {{"provider", providerName}})) {
+    if (config_.maxConnections == 0) {
+        config_.maxConnections = 1;
+    }
+    idleConnections_.reserve(config_.maxConnections);
+    LOG_INFO("http_provider", "Provider configured", {{"provider", providerName_},
+             {"url", config_.baseUrl + config_.sendPath}, {"max_connections", config_.maxConnections}});
+}
+
+HttpMessagingProvider::~HttpMessagingProvider() {
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    idleConnections_.clear();
+}
+
+void HttpMessagingProvider::registerForAllTypes(const HttpProviderConfig& config) {
+    MessagingProviderFactory::registerProvider("http_sms", std::make_shared<HttpMessagingProvider>(
+        "http_sms", std::vector<std::string>{"sms", "mms"}, config));
+    MessagingProviderFactory::registerProvider("http_email", std::make_shared<HttpMessagingProvider>(
+        "http_email", std::vector<std::string>{"email"}, config));
+    
+    MessagingProviderFactory::setProviderForType("sms", "http_sms");
+    MessagingProviderFactory::setProviderForType("mms", "http_sms");
+    MessagingProviderFactory::setProviderForType("email", "http_email");
+}
+
+MessageResponse HttpMessagingProvider::sendMessage(const MessageRequest& request) {
+    requests_++;
+
+    // Vendors use the idempotency key to drop duplicate sends if we retry on a
+    // timeout, so it comes from the message and is the same on every attempt
+    std::string idempotencyKey = request.idempotency_key.empty() ? IdGenerator::instance().nextBase32()
+                                                                 : request.idempotency_key;
+    httplib::Headers headers = {
+        {"Accept", "application/json"},
+        {"Idempotency-Key", idempotencyKey}
+    };
+    std::string payload = buildPayload(request);
+
+    for (int attempt = 0; ; attempt++) {
+        auto checkoutStart = std::chrono::steady_clock::now();
+        auto client = acquireConnection();
+        checkoutWait_->observe(std::chrono::steady_clock::now() - checkoutStart);
+        if (!client) {
+            failures_++;
+            MessageResponse response(false, "No connection available to " + providerName_, "", 503);
+            response.error_code = "connection_pool_exhausted";
+            return response;
+        }
+
+        auto result = client->Post(config_.sendPath, headers, payload, "application/json");
+        if (result) {
+            int status = result->status;
+            std::string body = result->body;
+            releaseConnection(std::move(client), true);
+            return mapResponse(status, body);
+        }
+
+        // Transport-level failure: the socket is in an unknown state, do not reuse it.
+        // A kept-alive socket the vendor already closed fails this way too, so the
+        // send is tried again on a fresh connection before giving up.
+        auto error = result.error();
+        releaseConnection(std::move(client), false);
+        if (attempt < config_.maxRetries) {
+            retries_++;
+            LOG_DEBUG("http_provider", "Retrying send after transport error", {{"provider", providerName_},
+                      {"error", httplib::to_string(error)}, {"attempt", attempt + 1}});
+            continue;
+        }
+        failures_++;
+
+        bool timedOut = error == httplib::Error::ConnectionTimeout || error == httplib::Error::Read;
+        MessageResponse response(false, "Request to " + providerName_ + " failed: " + httplib::to_string(error),
+                                 "", timedOut ? 504 : 502);
+        response.error_code = timedOut ? "provider_timeout" : "provider_unreachable";
+        return response;
+    }
+}
+
+MessageResponse HttpMessagingProvider::mapResponse(int status, const std::string& body) {
+    std::map<std::string, std::string> fields;
+    try {
+        if (!body.empty()) {
+            fields = JsonParser::parse(body);
+        }
+    } catch (const std::exception&) {
+        fields.clear();
+    }
+
+    if (status >= 200 && status < 300) {
+        return MessageResponse(true, "Message sent successfully via " + providerName_, fields["id"], 200);
+    }
+
+    failures_++;
+    MessageResponse response(false, "Provider " + providerName_ + " returned HTTP " + std::to_string(status), "", status);
+    if (status == 429) {
+        response.error_code = "rate_limited";
+    } else if (status >= 500) {
+        response.error_code = "provider_error";
+    } else {
+        response.error_code = fields.count("error") ? fields["error"] : "rejected";
+    }
+    return response;
+}
+
+std::string HttpMessagingProvider::getProviderName() const {
+    return providerName_;
+}
+
+bool HttpMessagingProvider::supportsMessageType(const std::string& messageType) const {
+    return std::find(supportedTypes_.begin(), supportedTypes_.end(), messageType)
+           != supportedTypes_.end();
+}
+
+HttpProviderStats HttpMessagingProvider::getStats() const {
+    HttpProviderStats stats;
+    stats.requests = requests_.load();
+    stats.failures = failures_.load();
+    stats.retries = retries_.load();
+    stats.connectionsOpened = connectionsOpened_.load();
+    stats.connectionReuses = connectionReuses_.load();
+    stats.connectionsDiscarded = connectionsDiscarded_.load();
+    stats.checkoutWaits = checkoutWaits_.load();
+    stats.checkoutTimeouts = checkoutTimeouts_.load();
+
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    stats.idleConnections = idleConnections_.size();
+    stats.openConnections = openConnections_;
+    return stats;
+}
+
+std::unique_ptr<httplib::Client> HttpMessagingProvider::acquireConnection() {
+    std::unique_lock<std::mutex> lock(poolMutex_);
+
+    if (idleConnections_.empty() && openConnections_ >= config_.maxConnections) {
+        checkoutWaits_++;
+        bool available = poolCondition_.wait_for(lock, std::chrono::milliseconds(config_.checkoutTimeoutMs), [this] {
+            return !idleConnections_.empty() || openConnections_ < config_.maxConnections;
+        });
+        if (!available) {
+            checkoutTimeouts_++;
+            checkoutTimeoutCount_->inc();
+            return nullptr;
+        }
+    }
+
+    if (!idleConnections_.empty()) {
+        auto client = std::move(idleConnections_.back());
+        idleConnections_.pop_back();
+        connectionReuses_++;
+        return client;
+    }
+
+    // Reserve the slot before connecting so the lock is not held during setup
+    openConnections_++;
+    lock.unlock();
+    return openConnection();
+}
+
+void HttpMessagingProvider::releaseConnection(std::unique_ptr<httplib::Client> client, bool reusable) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex_);
+        if (reusable) {
+            idleConnections_.push_back(std::move(client));
+        } else {
+            openConnections_--;
+            connectionsDiscarded_++;
+        }
+    }
+    poolCondition_.notify_one();
+}
+
+std::unique_ptr<httplib::Client> HttpMessagingProvider::openConnection() {
+    auto client = std::make_unique<httplib::Client>(config_.baseUrl);
+    client->set_keep_alive(true);
+    client->set_connection_timeout(config_.connectTimeoutMs / 1000, (config_.connectTimeoutMs % 1000) * 1000);
+    client->set_read_timeout(config_.readTimeoutMs / 1000, (config_.readTimeoutMs % 1000) * 1000);
+    client->set_write_timeout(config_.writeTimeoutMs / 1000, (config_.writeTimeoutMs % 1000) * 1000);
+    connectionsOpened_++;
+    return client;
+}
+
+std::string HttpMessagingProvider::buildPayload(const MessageRequest& request) const {
+    std::string payload = "{";
+    payload += "\"from\":\"" + JsonParser::escape(request.from) + "\",";
+    payload += "\"to\":\"" + JsonParser::escape(request.to) + "\",";
+    payload += "\"type\":\"" + JsonParser::escape(request.type) + "\",";
+    payload += "\"body\":\"" + JsonParser::escape(request.body) + "\",";
+    if (!request.subject.empty()) {
+        payload += "\"subject\":\"" + JsonParser::escape(request.subject) + "\",";
+    }
+    payload += "\"attachments\":[";
+    for (size_t i = 0; i < request.attachments.size(); ++i) {
+        if (i > 0) {
+            payload += ",";
+        }
+        payload += "\"" + JsonParser::escape(request.attachments[i]) + "\"";
+    }
+    payload += "],";
+    payload += "\"timestamp\":\"" + JsonParser::escape(request.timestamp) + "\"";
+    payload += "}";
+    return payload;
+}
+
+} // namespace messaging_service
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "../messaging_provider.h"
+#include "../../utils/metrics.h"
+#include <httplib.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace messaging_service {
+
+/**
+ * @brief Connection and timeout settings for an HTTP-backed provider
+ */
+struct HttpProviderConfig {
+    std::string baseUrl;                  // scheme://host:port of the vendor API
+    std::string sendPath = "/v1/messages";
+    size_t maxConnections = 8;            // keep-alive connections per host
+    int connectTimeoutMs = 2000;
+    int readTimeoutMs = 5000;
+    int writeTimeoutMs = 5000;
+    int checkoutTimeoutMs = 1000;         // max wait for a free pooled connection
+    int maxRetries = 1;                   // further attempts after a transport error
+
+    /**
+     * @brief Build a config from HTTP_PROVIDER_* environment variables
+     * @param baseUrl The vendor base URL to use
+     * @return Config with environment overrides applied
+     */
+    static HttpProviderConfig fromEnvironment(const std::string& baseUrl);
+};
+
+/**
+ * @brief Snapshot of connection pool and request counters
+ */
+struct HttpProviderStats {
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+    uint64_t retries = 0;
+    uint64_t connectionsOpened = 0;
+    uint64_t connectionReuses = 0;
+    uint64_t connectionsDiscarded = 0;
+    uint64_t checkoutWaits = 0;
+    uint64_t checkoutTimeouts = 0;
+    size_t idleConnections = 0;
+    size_t openConnections = 0;
+};
+
+/**
+ * @brief MessagingProvider that talks to a vendor REST API over HTTP
+ * Requests are sent over a bounded pool of keep-alive connections so that
+ * concurrent sends from the worker pool reuse sockets instead of paying a
+ * TCP handshake per message.
+ */
+class HttpMessagingProvider : public MessagingProvider {
+public:
+    /**
+     * @brief Constructor for HttpMessagingProvider
+     * @param providerName The name identifier for this provider
+     * @param supportedTypes Vector of message types this provider supports
+     * @param config Vendor endpoint, pool size and timeout settings
+     */
+    HttpMessagingProvider(const std::string& providerName,
+                          const std::vector<std::string>& supportedTypes,
+                          const HttpProviderConfig& config);
+
+    ~HttpMessagingProvider() override;
+
+    /**
+     * @brief Register http_sms and http_email with the factory and route every type to them
+     * They become the only providers for their types in fixed and weighted
+     * routing, so no send reaches a simulated provider.
+     * @param config Vendor endpoint shared by both providers
+     */
+    static void registerForAllTypes(const HttpProviderConfig& config);
+
+    /**
+     * @brief POST the message to the vendor API using a pooled connection
+     * Transport errors are retried on a fresh connection up to maxRetries times.
+     * @param request The message request containing all necessary data
+     * @return Response mapped from the vendor's HTTP status and body
+     */
+    MessageResponse sendMessage(const MessageRequest& request) override;
+
+    /**
+     * @brief Get the provider name/identifier
+     * @return Provider name as specified in constructor
+     */
+    std::string getProviderName() const override;
+
+    /**
+     * @brief Check if this provider supports the given message type
+     * @param messageType The type of message to check (sms, mms, email)
+     * @return true if message type is in supported types list, false otherwise
+     */
+    bool supportsMessageType(const std::string& messageType) const override;
+
+    /**
+     * @brief Get connection reuse and request counters
+     * @return Current statistics snapshot
+     */
+    HttpProviderStats getStats() const;
+
+private:
+    /**
+     * @brief Check out an idle connection, opening a new one if under the limit
+     * @return Client to use, or nullptr if none became free before the timeout
+     */
+    std::unique_ptr<httplib::Client> acquireConnection();
+
+    /**
+     * @brief Return a connection to the pool
+     * @param client The connection being returned
+     * @param reusable false if the connection saw a transport error and must be closed
+     */
+    void releaseConnection(std::unique_ptr<httplib::Client> client, bool reusable);
+
+    /**
+     * @brief Create a new keep-alive client with the configured timeouts
+     */
+    std::unique_ptr<httplib::Client> openConnection();
+
+    /**
+     * @brief Map the vendor's HTTP status and JSON body onto a MessageResponse
+     */
+    MessageResponse mapResponse(int status, const std::string& body);
+
+    /**
+     * @brief Serialize the message request into the vendor JSON payload
+     */
+    std::string buildPayload(const MessageRequest& request) const;
+
+    std::string providerName_;
+    std::vector<std::string> supportedTypes_;
+    HttpProviderConfig config_;
+
+    // Connection pool
+    std::vector<std::unique_ptr<httplib::Client>> idleConnections_;
+    size_t openConnections_;
+    mutable std::mutex poolMutex_;
+    std::condition_variable poolCondition_;
+
+    // Statistics
+    std::atomic<uint64_t> requests_;
+    std::atomic<uint64_t> failures_;
+    std::atomic<uint64_t> retries_;
+    std::atomic<uint64_t> connectionsOpened_;
+    std::atomic<uint64_t> connectionReuses_;
+    std::atomic<uint64_t> connectionsDiscarded_;
+    std::atomic<uint64_t> checkoutWaits_;
+    std::atomic<uint64_t> checkoutTimeouts_;
+
+    // Exported metrics
+    Histogram* checkoutWait_;
+    Counter* checkoutTimeoutCount_;
+};
+
+} // namespace messaging_service
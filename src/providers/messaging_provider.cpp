@@ -1,5 +1,6 @@
 #include "messaging_provider.h"
 #include "implementations/DefaultMessagingProvider.h"
+#include <algorithm>
 #include <iostream>
 #include <map>
 
@@ -8,6 +9,8 @@ namespace messaging_service {
 // Provider registry
 static std::map<std::string, std::shared_ptr<MessagingProvider>> providerRegistry;
 static std::map<std::string, std::string> typeToProviderMapping;
+// Providers weighted routing may choose between, per message type
+static std::map<std::string, std::vector<std::string>> typeToProviderSet;
 
 // Initialize default providers
 static void initializeDefaultProviders() {
@@ -39,6 +42,11 @@ static void initializeDefaultProviders() {
     typeToProviderMapping["mms"] = "default_sms";
     typeToProviderMapping["email"] = "default_email";
     
+    // The simulators share traffic between themselves until real providers replace them
+    typeToProviderSet["sms"] = {"default_sms", "twilio"};
+    typeToProviderSet["mms"] = {"default_sms", "twilio"};
+    typeToProviderSet["email"] = {"default_email", "sendgrid", "xillio"};
+    
     initialized = true;
 }
 
@@ -64,6 +72,23 @@ std::shared_ptr<MessagingProvider> MessagingProviderFactory::getProviderForType(
     return nullptr;
 }
 
+std::vector<std::shared_ptr<MessagingProvider>> MessagingProviderFactory::getProvidersForType(const std::string& messageType) {
+    initializeDefaultProviders();
+    
+    std::vector<std::shared_ptr<MessagingProvider>> providers;
+    auto setIt = typeToProviderSet.find(messageType);
+    if (setIt == typeToProviderSet.end()) {
+        return providers;
+    }
+    for (const auto& name : setIt->second) {
+        auto it = providerRegistry.find(name);
+        if (it != providerRegistry.end() && it->second) {
+            providers.push_back(it->second);
+        }
+    }
+    return providers;
+}
+
 bool MessagingProviderFactory::setProviderForType(const std::string& messageType, const std::string& providerName) {
     initializeDefaultProviders();
     
@@ -78,8 +103,33 @@ bool MessagingProviderFactory::setProviderForType(const std::string& messageType
         return false;
     }
     
-    // Set the mapping
+    // Set the mapping; weighted routing now sends this type nowhere else
     typeToProviderMapping[messageType] = providerName;
+    typeToProviderSet[messageType] = {providerName};
+    return true;
+}
+
+bool MessagingProviderFactory::setProvidersForType(const std::string& messageType,
+                                                   const std::vector<std::string>& providerNames) {
+    initializeDefaultProviders();
+    
+    if (providerNames.empty()) {
+        return false;
+    }
+    for (const auto& name : providerNames) {
+        auto providerIt = providerRegistry.find(name);
+        if (providerIt == providerRegistry.end() || !providerIt->second->supportsMessageType(messageType)) {
+            return false;
+        }
+    }
+    
+    // Fixed routing keeps its provider if it is still in the set
+    auto mapped = typeToProviderMapping.find(messageType);
+    if (mapped == typeToProviderMapping.end() ||
+        std::find(providerNames.begin(), providerNames.end(), mapped->second) == providerNames.end()) {
+        typeToProviderMapping[messageType] = providerNames.front();
+    }
+    typeToProviderSet[messageType] = providerNames;
     return true;
 }
 
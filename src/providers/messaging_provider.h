@@ -52,6 +52,7 @@ struct MessageRequest {
     std::string messaging_provider_id;
     std::string timestamp;
     std::string direction;      // inbound, outbound
+    std::string idempotency_key; // Sent to the vendor unchanged on every attempt at this message
     
     MessageRequest() = default;
     
@@ -101,14 +102,33 @@ public:
      */
     static std::shared_ptr<MessagingProvider> getProviderForType(const std::string& messageType);
     
+    /**
+     * @brief Get the providers weighted routing may choose between for a message type
+     * Only providers configured for the type by setProviderForType() or
+     * setProvidersForType() are returned, never merely registered ones.
+     * @param messageType The type of message (sms, mms, email)
+     * @return Providers configured for this type, in configured order
+     */
+    static std::vector<std::shared_ptr<MessagingProvider>> getProvidersForType(const std::string& messageType);
+    
     /**
      * @brief Set the provider for a specific message type
+     * It also becomes the only provider weighted routing uses for the type.
      * @param messageType The type of message (sms, mms, email)
      * @param providerName The name of the provider to use for this type
      * @return true if successful, false if provider not found
      */
     static bool setProviderForType(const std::string& messageType, const std::string& providerName);
     
+    /**
+     * @brief Set the providers weighted routing chooses between for a message type
+     * The fixed mapping moves to the first of them unless it is already one of them.
+     * @param messageType The type of message (sms, mms, email)
+     * @param providerNames Registered providers supporting the type
+     * @return true if successful, false if the list is empty or a provider is unknown or unsuitable
+     */
+    static bool setProvidersForType(const std::string& messageType, const std::vector<std::string>& providerNames);
+    
     /**
      * @brief Register a custom provider
      * @param providerName The name to register the provider under
@@ -0,0 +1,184 @@
+#include "provider_router.h"
+#include "../utils/logger.h"
+#include "../utils/tracing.h"
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+
+namespace messaging_service {
+
+namespace {
+
+// Fraction of decisions that pick a random candidate so a provider that was
+// penalised once keeps getting probed and can recover
+constexpr double kExplorationRate = 0.02;
+
+// Latency floor so unmeasured or very fast providers still compare sensibly
+constexpr double kMinLatencyMs = 1.0;
+
+std::mt19937& threadRandom() {
+    thread_local std::mt19937 gen(std::random_device{}());
+    return gen;
+}
+
+} // namespace
+
+ProviderRouter::ProviderRouter(bool weighted, double alpha)
+    : weighted_(weighted), alpha_(alpha > 0.0 && alpha <= 1.0 ? alpha : 0.2) {}
+
+ProviderRouter& ProviderRouter::instance() {
+    static ProviderRouter router([] {
+        const char* mode = std::getenv("PROVIDER_ROUTING");
+        bool weighted = mode && std::string(mode) == "weighted";
+        LOG_INFO("provider_router", "Routing mode selected", {{"mode", weighted ? "weighted" : "fixed"}});
+        return weighted;
+    }());
+    return router;
+}
+
+std::shared_ptr<MessagingProvider> ProviderRouter::selectProviderForType(const std::string& messageType) {
+    if (!weighted_) {
+        return MessagingProviderFactory::getProviderForType(messageType);
+    }
+
+    auto candidates = MessagingProviderFactory::getProvidersForType(messageType);
+    if (candidates.empty()) {
+        return MessagingProviderFactory::getProviderForType(messageType);
+    }
+    return selectProvider(candidates);
+}
+
+std::shared_ptr<MessagingProvider> ProviderRouter::selectProvider(const std::vector<std::shared_ptr<MessagingProvider>>& candidates) {
+    if (candidates.empty()) {
+        return nullptr;
+    }
+    if (candidates.size() == 1) {
+        return candidates.front();
+    }
+
+    auto& gen = threadRandom();
+    std::uniform_int_distribution<size_t> pick(0, candidates.size() - 1);
+    size_t first = pick(gen);
+
+    std::uniform_real_distribution<double> roll(0.0, 1.0);
+    if (roll(gen) < kExplorationRate) {
+        return candidates[first];
+    }
+
+    // Sample a second, distinct candidate
+    size_t second = pick(gen);
+    if (second == first) {
+        second = (first + 1) % candidates.size();
+    }
+
+    double firstCost = cost(entryFor(candidates[first]->getProviderName()));
+    double secondCost = cost(entryFor(candidates[second]->getProviderName()));
+    return firstCost <= secondCost ? candidates[first] : candidates[second];
+}
+
+MessageResponse ProviderRouter::dispatch(const std::shared_ptr<MessagingProvider>& provider, const MessageRequest& request) {
+    Entry& entry = entryFor(provider->getProviderName());
+    entry.outstanding++;
+
+    auto start = std::chrono::steady_clock::now();
+    MessageResponse response;
+    {
+        Span span("provider.send");
+        span.setAttribute("provider", provider->getProviderName());
+        try {
+            response = provider->sendMessage(request);
+        } catch (const std::exception& e) {
+            response = MessageResponse(false, std::string("Provider error: ") + e.what(), "", 500);
+            response.error_code = "provider_exception";
+        }
+        span.setError(!response.success);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double latencyMs = std::chrono::duration<double, std::milli>(elapsed).count();
+
+    entry.outstanding--;
+    entry.latency->observe(elapsed);
+    if (!response.success) {
+        entry.errors->inc();
+    }
+
+    // A 4xx other than 429 means the vendor rejected this message, not that it is unhealthy
+    bool healthy = response.success ||
+                   (response.http_status_code >= 400 && response.http_status_code < 500 &&
+                    response.http_status_code != 429);
+    recordResult(provider->getProviderName(), latencyMs, healthy);
+    return response;
+}
+
+void ProviderRouter::recordResult(const std::string& providerName, double latencyMs, bool success) {
+    Entry& entry = entryFor(providerName);
+    entry.requests++;
+    if (!success) {
+        entry.failures++;
+    }
+
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    if (!entry.measured) {
+        entry.ewmaLatencyMs = latencyMs;
+        entry.successRate = success ? 1.0 : 0.0;
+        entry.measured = true;
+        return;
+    }
+    entry.ewmaLatencyMs += alpha_ * (latencyMs - entry.ewmaLatencyMs);
+    entry.successRate += alpha_ * ((success ? 1.0 : 0.0) - entry.successRate);
+}
+
+std::vector<ProviderStats> ProviderRouter::getStats() const {
+    std::vector<ProviderStats> stats;
+    std::lock_guard<std::mutex> lock(entriesMutex_);
+    stats.reserve(entries_.size());
+    for (const auto& pair : entries_) {
+        Entry& entry = *pair.second;
+        ProviderStats snapshot;
+        snapshot.name = pair.first;
+        snapshot.outstanding = entry.outstanding.load();
+        snapshot.requests = entry.requests.load();
+        snapshot.failures = entry.failures.load();
+        {
+            std::lock_guard<std::mutex> entryLock(entry.mutex);
+            snapshot.ewmaLatencyMs = entry.ewmaLatencyMs;
+            snapshot.successRate = entry.successRate;
+        }
+        stats.push_back(snapshot);
+    }
+    return stats;
+}
+
+bool ProviderRouter::isWeighted() const {
+    return weighted_;
+}
+
+ProviderRouter::Entry& ProviderRouter::entryFor(const std::string& providerName) {
+    std::lock_guard<std::mutex> lock(entriesMutex_);
+    auto& entry = entries_[providerName];
+    if (!entry) {
+        entry = std::make_unique<Entry>();
+        auto& registry = MetricsRegistry::instance();
+        entry->latency = &registry.histogram("provider_request_duration_seconds",
+                                             "Time spent in provider sendMessage calls", {{"provider", providerName}});
+        entry->errors = &registry.counter("provider_errors_total",
+                                          "Provider sends that failed or were rejected", {{"provider", providerName}});
+    }
+    return *entry;
+}
+
+double ProviderRouter::cost(Entry& entry) {
+    double latency;
+    double success;
+    {
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        // Unmeasured providers look as fast as possible so they get probed
+        // first, but their in-flight sends still count against them
+        latency = entry.measured ? std::max(entry.ewmaLatencyMs, kMinLatencyMs) : kMinLatencyMs;
+        success = entry.measured ? std::max(entry.successRate, 0.01) : 1.0;
+    }
+    double inFlight = static_cast<double>(entry.outstanding.load()) + 1.0;
+    return latency * inFlight / (success * success);
+}
+
+} // namespace messaging_service
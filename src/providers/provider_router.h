@@ -0,0 +1,124 @@
+#pragma once
+
+#include "messaging_provider.h"
+#include "../utils/metrics.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace messaging_service {
+
+/**
+ * @brief Snapshot of the routing statistics kept for one provider
+ */
+struct ProviderStats {
+    std::string name;
+    double ewmaLatencyMs = 0.0;   // exponentially weighted send latency
+    double successRate = 1.0;     // exponentially weighted success ratio
+    uint64_t outstanding = 0;     // sends currently in flight
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+};
+
+/**
+ * @brief Routes sends across providers using measured latency and success rate
+ *
+ * When weighted routing is enabled and several providers are configured for a
+ * message type, two candidates are sampled at random and the one with the
+ * lower expected cost is used (power-of-two-choices). Cost grows with EWMA
+ * latency, in-flight requests and failure rate, so a slow or failing vendor
+ * quickly sheds traffic while still being probed occasionally.
+ * With weighted routing disabled the fixed factory mapping is used.
+ */
+class ProviderRouter {
+public:
+    /**
+     * @brief Constructor
+     * @param weighted true to route by measured performance, false to use the fixed mapping
+     * @param alpha EWMA smoothing factor in (0, 1]; larger reacts faster
+     */
+    explicit ProviderRouter(bool weighted = false, double alpha = 0.2);
+
+    /**
+     * @brief Process-wide router, configured from PROVIDER_ROUTING (fixed|weighted)
+     */
+    static ProviderRouter& instance();
+
+    /**
+     * @brief Choose the provider for a message type
+     * @param messageType The type of message (sms, mms, email)
+     * @return Selected provider, or nullptr if none supports the type
+     */
+    std::shared_ptr<MessagingProvider> selectProviderForType(const std::string& messageType);
+
+    /**
+     * @brief Choose between candidate providers by power-of-two-choices
+     * @param candidates Providers able to handle the message
+     * @return Selected provider, or nullptr if candidates is empty
+     */
+    std::shared_ptr<MessagingProvider> selectProvider(const std::vector<std::shared_ptr<MessagingProvider>>& candidates);
+
+    /**
+     * @brief Send through a provider while tracking latency, outcome and in-flight count
+     * @param provider The provider to send with
+     * @param request The message request
+     * @return The provider's response (a 500 response if the provider threw)
+     */
+    MessageResponse dispatch(const std::shared_ptr<MessagingProvider>& provider, const MessageRequest& request);
+
+    /**
+     * @brief Record the outcome of a send made outside dispatch()
+     * @param providerName The provider that handled the send
+     * @param latencyMs Observed latency in milliseconds
+     * @param success Whether the provider handled the request successfully
+     */
+    void recordResult(const std::string& providerName, double latencyMs, bool success);
+
+    /**
+     * @brief Get statistics for every provider seen so far
+     * @return Per-provider statistics sorted by name
+     */
+    std::vector<ProviderStats> getStats() const;
+
+    /**
+     * @brief Check whether weighted routing is enabled
+     */
+    bool isWeighted() const;
+
+private:
+    struct Entry {
+        std::mutex mutex;
+        double ewmaLatencyMs = 0.0;
+        double successRate = 1.0;
+        bool measured = false;
+        std::atomic<uint64_t> outstanding{0};
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> failures{0};
+        Histogram* latency = nullptr;          // exported as provider_request_duration_seconds
+        Counter* errors = nullptr;             // exported as provider_errors_total
+    };
+
+    /**
+     * @brief Find or create the statistics entry for a provider
+     */
+    Entry& entryFor(const std::string& providerName);
+
+    /**
+     * @brief Expected cost of sending one more request to this provider
+     */
+    double cost(Entry& entry);
+
+    bool weighted_;
+    double alpha_;
+
+    // Entries are never removed, so references stay valid once created
+    std::map<std::string, std::unique_ptr<Entry>> entries_;
+    mutable std::mutex entriesMutex_;
+};
+
+} // namespace messaging_service
@@ -0,0 +1,598 @@
+#include "event_stream_server.h"
+#include "../utils/logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace messaging_service {
+
+namespace {
+
+constexpr size_t kMaxRequestBytes = 8192;
+constexpr int kPollTimeoutMs = 1000;
+constexpr int kMaxEventsPerWait = 256;
+
+// epoll tokens for the two descriptors that are not connections; connection ids start at 1
+constexpr uint64_t kWakeupToken = 0;
+constexpr uint64_t kListenerToken = UINT64_MAX;
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;   // SO_NOSIGPIPE is set on each socket instead
+#endif
+
+const char kStreamHeaders[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: close\r\n"
+    "X-Accel-Buffering: no\r\n"
+    "\r\n"
+    "retry: 3000\n\n";
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+// Decodes %XX escapes; '+' is kept, since unencoded phone numbers are the common case
+std::string percentDecode(const std::string& text) {
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() && std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            decoded += static_cast<char>(std::strtol(text.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else {
+            decoded += text[i];
+        }
+    }
+    return decoded;
+}
+
+std::string queryParameter(const std::string& query, const std::string& name) {
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+        std::string pair = query.substr(start, end - start);
+        size_t equals = pair.find('=');
+        if (equals != std::string::npos && pair.compare(0, equals, name) == 0) {
+            return percentDecode(pair.substr(equals + 1));
+        }
+        start = end + 1;
+    }
+    return "";
+}
+
+// SSE data lines end at a newline, so multi-line payloads are split across several
+void appendEvent(std::string& output, const EventSubscription::Item& item) {
+    if (item.reset) {
+        output += "event: reset\ndata: {}\n\n";
+        return;
+    }
+    output += "id: " + std::to_string(item.messageId) + "\nevent: message\n";
+    size_t start = 0;
+    while (true) {
+        size_t end = item.data.find('\n', start);
+        output += "data: ";
+        output.append(item.data, start, end == std::string::npos ? std::string::npos : end - start);
+        output += "\n";
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    output += "\n";
+}
+
+} // namespace
+
+struct EventStreamServer::Connection {
+    uint64_t id = 0;
+    int fd = -1;
+    bool watched = false;        // registered with epoll
+    bool watchingOutput = false; // EPOLLOUT is set, because output is waiting for the socket
+    bool streaming = false;
+    bool closeAfterFlush = false;
+    std::string input;
+    std::string output;
+    std::shared_ptr<EventSubscription> subscription;
+    std::chrono::steady_clock::time_point openedAt;
+    std::chrono::steady_clock::time_point lastWrite;
+};
+
+// Publishers record which connections have events and poke the serving thread through a pipe
+struct EventStreamServer::Wakeup {
+    int pipe[2] = {-1, -1};
+    std::mutex mutex;
+    std::vector<uint64_t> ready;
+
+    ~Wakeup() {
+        for (int fd : pipe) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    void notify(uint64_t id) {
+        bool first;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            first = ready.empty();
+            ready.push_back(id);
+        }
+        if (first) {
+            char byte = 1;
+            // A full pipe already guarantees a wakeup
+            ssize_t written = ::write(pipe[1], &byte, 1);
+            (void)written;
+        }
+    }
+};
+
+EventStreamServer::EventStreamServer(MessageEventHub& hub, const EventStreamOptions& options)
+    : hub_(hub), options_(options), listenSocket_(-1), epollFd_(-1), port_(0), running_(false),
+      wakeup_(std::make_shared<Wakeup>()), nextConnectionId_(1), connectionCount_(0), listenerWatched_(false) {
+}
+
+EventStreamServer::~EventStreamServer() {
+    stop();
+}
+
+bool EventStreamServer::start(const std::string& host, int port, bool reusePort) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), service.c_str(), &hints, &addresses) != 0) {
+        LOG_ERROR("events", "Failed to resolve event stream address", {{"host", host}, {"port", port}});
+        return false;
+    }
+
+    for (addrinfo* address = addresses; address && listenSocket_ < 0; address = address->ai_next) {
+        int fd = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (reusePort) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+        }
+        if (::bind(fd, address->ai_addr, address->ai_addrlen) == 0 && ::listen(fd, 1024) == 0 && setNonBlocking(fd)) {
+            listenSocket_ = fd;
+        } else {
+            ::close(fd);
+        }
+    }
+    freeaddrinfo(addresses);
+    if (listenSocket_ < 0) {
+        LOG_ERROR("events", "Failed to bind event stream port", {{"host", host}, {"port", port},
+                  {"error", std::strerror(errno)}});
+        return false;
+    }
+
+    sockaddr_storage bound = {};
+    socklen_t boundLength = sizeof(bound);
+    if (getsockname(listenSocket_, reinterpret_cast<sockaddr*>(&bound), &boundLength) == 0) {
+        char service[NI_MAXSERV];
+        if (getnameinfo(reinterpret_cast<sockaddr*>(&bound), boundLength, nullptr, 0, service, sizeof(service),
+                        NI_NUMERICSERV) == 0) {
+            port_ = std::atoi(service);
+        }
+    }
+
+    if (::pipe(wakeup_->pipe) != 0 || !setNonBlocking(wakeup_->pipe[0]) || !setNonBlocking(wakeup_->pipe[1])) {
+        LOG_ERROR("events", "Failed to create event stream wakeup pipe", {{"error", std::strerror(errno)}});
+        ::close(listenSocket_);
+        listenSocket_ = -1;
+        return false;
+    }
+
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    epoll_event wakeupEvent = {};
+    wakeupEvent.events = EPOLLIN;
+    wakeupEvent.data.u64 = kWakeupToken;
+    epoll_event listenerEvent = {};
+    listenerEvent.events = EPOLLIN;
+    listenerEvent.data.u64 = kListenerToken;
+    if (epollFd_ < 0 || ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeup_->pipe[0], &wakeupEvent) != 0 ||
+        ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenSocket_, &listenerEvent) != 0) {
+        LOG_ERROR("events", "Failed to create event stream epoll instance", {{"error", std::strerror(errno)}});
+        if (epollFd_ >= 0) {
+            ::close(epollFd_);
+            epollFd_ = -1;
+        }
+        ::close(listenSocket_);
+        listenSocket_ = -1;
+        return false;
+    }
+    listenerWatched_ = true;
+
+    running_ = true;
+    thread_ = std::thread(&EventStreamServer::run, this);
+    LOG_INFO("events", "Serving event streams", {{"host", host}, {"port", port_},
+             {"max_connections", options_.maxConnections}});
+    return true;
+}
+
+void EventStreamServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    wakeup_->notify(0);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    while (!connections_.empty()) {
+        closeConnection(connections_.begin()->first);
+    }
+    ::close(listenSocket_);
+    listenSocket_ = -1;
+    ::close(epollFd_);
+    epollFd_ = -1;
+}
+
+void EventStreamServer::run() {
+    std::vector<epoll_event> events(kMaxEventsPerWait);
+    auto lastHeartbeat = std::chrono::steady_clock::now();
+
+    while (running_) {
+        auto now = std::chrono::steady_clock::now();
+        if (!listenerWatched_ && now >= acceptPausedUntil_) {
+            watchListener(true);
+        }
+
+        int timeout = listenerWatched_ ? kPollTimeoutMs : 100;
+        int count = ::epoll_wait(epollFd_, events.data(), static_cast<int>(events.size()), timeout);
+        if (count < 0) {
+            if (errno != EINTR) {
+                LOG_ERROR("events", "epoll_wait failed", {{"error", std::strerror(errno)}});
+                break;
+            }
+            count = 0;
+        }
+
+        bool acceptReady = false;
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.u64 == kWakeupToken) {
+                char buffer[256];
+                while (::read(wakeup_->pipe[0], buffer, sizeof(buffer)) > 0) {
+                }
+            } else if (events[i].data.u64 == kListenerToken) {
+                acceptReady = true;
+            }
+        }
+        deliverPending();
+
+        // Only the connections epoll reported are touched; idle streams cost nothing per wakeup
+        for (int i = 0; i < count; ++i) {
+            uint64_t id = events[i].data.u64;
+            if (id == kWakeupToken || id == kListenerToken) {
+                continue;
+            }
+            auto found = connections_.find(id);
+            if (found == connections_.end()) {
+                continue;
+            }
+            Connection& connection = *found->second;
+            uint32_t ready = events[i].events;
+            bool keep = true;
+            if (ready & EPOLLERR) {
+                keep = false;
+            } else if (ready & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)) {
+                readFrom(id, connection);
+                keep = connections_.count(id) > 0;
+            }
+            // Also sends an error response the request just produced
+            if (keep && ((ready & EPOLLOUT) || !connection.output.empty())) {
+                keep = flush(connection);
+            }
+            if (!keep && connections_.count(id) > 0) {
+                closeConnection(id);
+            }
+        }
+
+        if (acceptReady) {
+            acceptConnections();
+        }
+
+        now = std::chrono::steady_clock::now();
+        expireRequests(now);
+        if (now - lastHeartbeat >= options_.heartbeatInterval) {
+            lastHeartbeat = now;
+            sendHeartbeats();
+        }
+    }
+}
+
+void EventStreamServer::expireRequests(std::chrono::steady_clock::time_point now) {
+    // Connections are queued in the order they were opened, so the oldest is always in front
+    while (!awaitingRequest_.empty()) {
+        auto found = connections_.find(awaitingRequest_.front());
+        if (found != connections_.end() && !found->second->streaming && !found->second->closeAfterFlush) {
+            if (now - found->second->openedAt <= options_.requestTimeout) {
+                return;
+            }
+            closeConnection(found->first);
+        }
+        awaitingRequest_.pop_front();
+    }
+}
+
+void EventStreamServer::watchListener(bool watch) {
+    epoll_event event = {};
+    event.events = watch ? static_cast<uint32_t>(EPOLLIN) : 0u;
+    event.data.u64 = kListenerToken;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, listenSocket_, &event);
+    listenerWatched_ = watch;
+}
+
+void EventStreamServer::watchOutput(Connection& connection) {
+    bool watchingOutput = !connection.output.empty();
+    if (!connection.watched || connection.watchingOutput == watchingOutput) {
+        return;
+    }
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP | (watchingOutput ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.u64 = connection.id;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.watchingOutput = watchingOutput;
+}
+
+void EventStreamServer::acceptConnections() {
+    while (true) {
+        int fd = ::accept(listenSocket_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // Out of descriptors; the pending connection stays queued, so stop watching the listener briefly
+                LOG_WARN("events", "Cannot accept event stream connection", {{"error", std::strerror(errno)}});
+                acceptPausedUntil_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+                watchListener(false);
+            }
+            return;
+        }
+        if (!setNonBlocking(fd)) {
+            ::close(fd);
+            continue;
+        }
+#ifdef SO_NOSIGPIPE
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+#endif
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        connection->openedAt = std::chrono::steady_clock::now();
+        connection->lastWrite = connection->openedAt;
+        if (connections_.size() >= options_.maxConnections) {
+            respondWithError(*connection, "503 Service Unavailable");
+            // Best effort; the client is told to retry rather than left waiting
+            flush(*connection);
+            ::close(fd);
+            continue;
+        }
+        connection->id = nextConnectionId_++;
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = connection->id;
+        if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            LOG_WARN("events", "Cannot watch event stream connection", {{"error", std::strerror(errno)}});
+            ::close(fd);
+            continue;
+        }
+        connection->watched = true;
+        awaitingRequest_.push_back(connection->id);
+        connections_.emplace(connection->id, std::move(connection));
+        connectionCount_ = connections_.size();
+    }
+}
+
+void EventStreamServer::readFrom(uint64_t id, Connection& connection) {
+    char buffer[4096];
+    while (true) {
+        ssize_t received = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received == 0) {
+            closeConnection(id);
+            return;
+        }
+        if (received < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                closeConnection(id);
+            }
+            return;
+        }
+        // Clients send nothing after the request; anything more is ignored
+        if (connection.streaming || connection.closeAfterFlush) {
+            continue;
+        }
+        connection.input.append(buffer, static_cast<size_t>(received));
+        if (connection.input.find("\r\n\r\n") != std::string::npos ||
+            connection.input.find("\n\n") != std::string::npos) {
+            handleRequest(id, connection);
+        } else if (connection.input.size() > kMaxRequestBytes) {
+            respondWithError(connection, "431 Request Header Fields Too Large");
+        }
+    }
+}
+
+void EventStreamServer::handleRequest(uint64_t id, Connection& connection) {
+    std::string request;
+    request.swap(connection.input);
+
+    size_t lineEnd = request.find('\n');
+    std::string requestLine = request.substr(0, lineEnd);
+    if (!requestLine.empty() && requestLine.back() == '\r') {
+        requestLine.pop_back();
+    }
+    size_t firstSpace = requestLine.find(' ');
+    size_t secondSpace = requestLine.find(' ', firstSpace + 1);
+    if (firstSpace == std::string::npos || secondSpace == std::string::npos) {
+        respondWithError(connection, "400 Bad Request");
+        return;
+    }
+    std::string method = requestLine.substr(0, firstSpace);
+    std::string target = requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+    std::string path = target.substr(0, target.find('?'));
+    std::string query = path.size() < target.size() ? target.substr(path.size() + 1) : "";
+
+    bool resumed = lowercase(request).find("\nlast-event-id:") != std::string::npos;
+
+    EventFilter filter;
+    const std::string conversationsPrefix = "/api/conversations/";
+    const std::string eventsSuffix = "/events";
+    if (path.size() > conversationsPrefix.size() + eventsSuffix.size() &&
+        path.compare(0, conversationsPrefix.size(), conversationsPrefix) == 0 &&
+        path.compare(path.size() - eventsSuffix.size(), eventsSuffix.size(), eventsSuffix) == 0) {
+        std::string id = path.substr(conversationsPrefix.size(),
+                                     path.size() - conversationsPrefix.size() - eventsSuffix.size());
+        if (id.size() > 9 || !std::all_of(id.begin(), id.end(), [](unsigned char c) { return std::isdigit(c); })) {
+            respondWithError(connection, "400 Bad Request");
+            return;
+        }
+        filter.conversationId = std::atoi(id.c_str());
+    } else if (path == "/api/events") {
+        filter.participant = queryParameter(query, "participant");
+        if (filter.participant.empty()) {
+            respondWithError(connection, "400 Bad Request");
+            return;
+        }
+    } else {
+        respondWithError(connection, "404 Not Found");
+        return;
+    }
+    if (method != "GET") {
+        respondWithError(connection, "405 Method Not Allowed");
+        return;
+    }
+
+    std::weak_ptr<Wakeup> wakeup = wakeup_;
+    connection.subscription = hub_.subscribe(filter, [wakeup, id] {
+        if (auto target = wakeup.lock()) {
+            target->notify(id);
+        }
+    });
+    if (!connection.subscription) {
+        respondWithError(connection, "400 Bad Request");
+        return;
+    }
+    connection.streaming = true;
+    connection.output += kStreamHeaders;
+    if (resumed) {
+        // Nothing is replayed, so a reconnecting client is told to catch up from the messages endpoint
+        EventSubscription::Item reset;
+        reset.reset = true;
+        appendEvent(connection.output, reset);
+    }
+    if (!flush(connection)) {
+        closeConnection(id);
+    }
+}
+
+void EventStreamServer::deliverPending() {
+    std::vector<uint64_t> ready;
+    {
+        std::lock_guard<std::mutex> lock(wakeup_->mutex);
+        ready.swap(wakeup_->ready);
+    }
+
+    std::vector<EventSubscription::Item> items;
+    for (uint64_t id : ready) {
+        auto found = connections_.find(id);
+        if (found == connections_.end() || !found->second->subscription) {
+            continue;
+        }
+        Connection& connection = *found->second;
+        items.clear();
+        connection.subscription->take(items);
+        for (const auto& item : items) {
+            appendEvent(connection.output, item);
+        }
+        if (connection.output.size() > options_.maxBufferedBytes || !flush(connection)) {
+            closeConnection(id);
+        }
+    }
+}
+
+void EventStreamServer::sendHeartbeats() {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<uint64_t> failed;
+    for (auto& entry : connections_) {
+        Connection& connection = *entry.second;
+        if (!connection.streaming || !connection.output.empty() ||
+            now - connection.lastWrite < options_.heartbeatInterval) {
+            continue;
+        }
+        connection.output += ": ping\n\n";
+        if (!flush(connection)) {
+            failed.push_back(entry.first);
+        }
+    }
+    for (uint64_t id : failed) {
+        closeConnection(id);
+    }
+}
+
+bool EventStreamServer::flush(Connection& connection) {
+    while (!connection.output.empty()) {
+        ssize_t sent = ::send(connection.fd, connection.output.data(), connection.output.size(), kSendFlags);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            // The socket is full; EPOLLOUT says when the rest can go
+            watchOutput(connection);
+            return true;
+        }
+        connection.output.erase(0, static_cast<size_t>(sent));
+        connection.lastWrite = std::chrono::steady_clock::now();
+    }
+    watchOutput(connection);
+    // An error response has been sent in full
+    return !connection.closeAfterFlush;
+}
+
+void EventStreamServer::respondWithError(Connection& connection, const std::string& status) {
+    connection.input.clear();
+    connection.output = "HTTP/1.1 " + status + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    connection.closeAfterFlush = true;
+}
+
+void EventStreamServer::closeConnection(uint64_t id) {
+    auto found = connections_.find(id);
+    if (found == connections_.end()) {
+        return;
+    }
+    hub_.unsubscribe(found->second->subscription);
+    if (found->second->watched) {
+        ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, found->second->fd, nullptr);
+    }
+    ::close(found->second->fd);
+    connections_.erase(found);
+    connectionCount_ = connections_.size();
+}
+
+} // namespace messaging_service
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "../utils/message_event_hub.h"
+
+namespace messaging_service {
+
+struct EventStreamOptions {
+    size_t maxConnections = 50000;
+    std::chrono::seconds heartbeatInterval{15};     // comment sent to idle streams so proxies keep them open
+    std::chrono::seconds requestTimeout{10};        // time a client gets to send its request line and headers
+    size_t maxBufferedBytes = 1024 * 1024;          // unsent bytes per connection before a slow client is dropped
+};
+
+/**
+ * @brief Serves Server-Sent Events streams of new messages on a separate port
+ *
+ * httplib holds one pool thread per connection for as long as a response is
+ * streaming, so idle event streams would use up the request threads. This
+ * listener instead multiplexes every stream on a single thread with epoll
+ * and non-blocking sockets. Each connection is registered once, EPOLLOUT is
+ * only set while output waits for the socket, and a wakeup touches only the
+ * connections that are ready or have events, so an idle subscriber costs a
+ * socket and a few hundred bytes and nothing per loop iteration.
+ *
+ *   GET /api/conversations/{id}/events      messages of one conversation
+ *   GET /api/events?participant={address}   messages from or to an address
+ *
+ * Each message is sent as "event: message" with the message id as the SSE
+ * id and the message JSON as data. "event: reset" means events were missed,
+ * because the client fell behind, reconnected with Last-Event-ID, or the
+ * server lost its database notifications; the client should re-read the
+ * messages endpoint. '+' in a participant is taken literally, so phone
+ * numbers need not be percent-encoded.
+ */
+class EventStreamServer {
+public:
+    explicit EventStreamServer(MessageEventHub& hub, const EventStreamOptions& options = EventStreamOptions());
+    ~EventStreamServer();
+
+    EventStreamServer(const EventStreamServer&) = delete;
+    EventStreamServer& operator=(const EventStreamServer&) = delete;
+
+    /**
+     * @brief Bind the port and start serving on a background thread
+     * @param port Port to listen on; 0 picks a free one, see getPort()
+     * @param reusePort Share the port with sibling worker processes
+     * @return false if the port could not be bound
+     */
+    bool start(const std::string& host, int port, bool reusePort);
+
+    /**
+     * @brief Close every stream and the listener, and join the serving thread
+     */
+    void stop();
+
+    int getPort() const { return port_; }
+
+    size_t getConnectionCount() const { return connectionCount_.load(); }
+
+private:
+    struct Connection;
+    struct Wakeup;
+
+    void run();
+    void acceptConnections();
+    void readFrom(uint64_t id, Connection& connection);
+    void handleRequest(uint64_t id, Connection& connection);
+    void deliverPending();
+    void sendHeartbeats();
+    // Close connections that have not finished their request within requestTimeout
+    void expireRequests(std::chrono::steady_clock::time_point now);
+    void watchListener(bool watch);
+    // Set EPOLLOUT while the connection has unsent output, and clear it once drained
+    void watchOutput(Connection& connection);
+
+    // Write as much buffered output as the socket takes; false if the connection should be closed
+    bool flush(Connection& connection);
+    void respondWithError(Connection& connection, const std::string& status);
+    void closeConnection(uint64_t id);
+
+    MessageEventHub& hub_;
+    const EventStreamOptions options_;
+
+    int listenSocket_;
+    int epollFd_;
+    int port_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    // Shared with subscription wake callbacks, which may outlive the server
+    std::shared_ptr<Wakeup> wakeup_;
+
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections_;
+    uint64_t nextConnectionId_;
+    std::atomic<size_t> connectionCount_;
+    std::deque<uint64_t> awaitingRequest_;   // connections in the order opened, until their request is read
+    bool listenerWatched_;
+    std::chrono::steady_clock::time_point acceptPausedUntil_;
+};
+
+} // namespace messaging_service
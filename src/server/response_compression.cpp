@@ -0,0 +1,81 @@
+#include "response_compression.h"
+#include "../utils/metrics.h"
+
+namespace messaging_service {
+
+ResponseCompressor::ResponseCompressor()
+    : minBytes_(1024),
+      gzipResponses_(&MetricsRegistry::instance().counter("http_compressed_responses_total",
+                                                          "Responses sent compressed", {{"encoding", "gzip"}})),
+      zstdResponses_(&MetricsRegistry::instance().counter("http_compressed_responses_total",
+                                                          "Responses sent compressed", {{"encoding", "zstd"}})) {
+}
+
+ResponseCompressor& ResponseCompressor::instance() {
+    static ResponseCompressor compressor;
+    return compressor;
+}
+
+void ResponseCompressor::setMinBytes(size_t minBytes) {
+    minBytes_.store(minBytes, std::memory_order_relaxed);
+}
+
+size_t ResponseCompressor::getMinBytes() const {
+    return minBytes_.load(std::memory_order_relaxed);
+}
+
+ContentEncoding ResponseCompressor::choose(const httplib::Request& req, size_t bodySize,
+                                           const std::string& contentType) const {
+    size_t minBytes = getMinBytes();
+    if (minBytes == 0 || bodySize < minBytes || !isCompressibleType(contentType)) {
+        return ContentEncoding::Identity;
+    }
+    return negotiateEncoding(req.get_header_value("Accept-Encoding"));
+}
+
+void ResponseCompressor::setEncodedContent(const httplib::Request& req, httplib::Response& res, const std::string& body,
+                                           ContentEncoding encoding, const std::string& contentType) {
+    res.set_content(body, contentType);
+    res.set_header("Content-Encoding", contentEncodingName(encoding));
+    res.set_header("Vary", "Accept-Encoding");
+    recordEncoded(encoding);
+    releaseAcceptEncoding(req);
+}
+
+void ResponseCompressor::compress(const httplib::Request& req, httplib::Response& res) {
+    // Chunked responses have no buffered body; httplib compresses those as they stream
+    if (res.body.empty()) {
+        return;
+    }
+    if (!res.has_header("Content-Encoding")) {
+        std::string contentType = res.get_header_value("Content-Type");
+        if (isCompressibleType(contentType) && getMinBytes() > 0 && res.body.size() >= getMinBytes()) {
+            res.set_header("Vary", "Accept-Encoding");
+        }
+        ContentEncoding encoding = choose(req, res.body.size(), contentType);
+        std::string compressed;
+        if (encoding != ContentEncoding::Identity && compressBody(res.body, encoding, compressed) &&
+            compressed.size() < res.body.size()) {
+            res.body.swap(compressed);
+            res.set_header("Content-Encoding", contentEncodingName(encoding));
+            recordEncoded(encoding);
+        }
+    }
+    releaseAcceptEncoding(req);
+}
+
+void ResponseCompressor::releaseAcceptEncoding(const httplib::Request& req) {
+    // httplib hands handlers a const view of a request it owns and only reads
+    // Accept-Encoding again when it writes the response
+    const_cast<httplib::Request&>(req).headers.erase("Accept-Encoding");
+}
+
+void ResponseCompressor::recordEncoded(ContentEncoding encoding) {
+    if (encoding == ContentEncoding::Gzip) {
+        gzipResponses_->inc();
+    } else if (encoding == ContentEncoding::Zstd) {
+        zstdResponses_->inc();
+    }
+}
+
+} // namespace messaging_service
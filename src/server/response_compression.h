@@ -0,0 +1,74 @@
+#pragma once
+
+#include <httplib.h>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include "../utils/compression.h"
+
+namespace messaging_service {
+
+class Counter;
+
+/**
+ * @brief Compresses response bodies for clients that accept gzip or zstd
+ *
+ * Runs as the server's post-routing handler, so every route gets it, and
+ * only compresses text and JSON bodies of at least getMinBytes() bytes;
+ * smaller bodies cost more CPU to compress than they save on the wire.
+ * Handlers that keep compressed copies of a body (the message page cache)
+ * set them with setEncodedContent() and are left alone.
+ *
+ * httplib is built with its own zlib support so it can inflate compressed
+ * request bodies and stream-compress chunked responses, but it would also
+ * compress every buffered body again regardless of size. Once a buffered
+ * response has been dealt with here, the request's Accept-Encoding header is
+ * dropped so httplib sends the body as it stands.
+ */
+class ResponseCompressor {
+public:
+    ResponseCompressor();
+
+    /**
+     * @brief Process-wide compressor configured by the server
+     */
+    static ResponseCompressor& instance();
+
+    /**
+     * @brief Smallest body worth compressing; 0 disables compression of buffered bodies
+     */
+    void setMinBytes(size_t minBytes);
+    size_t getMinBytes() const;
+
+    /**
+     * @brief Encoding to send a body in, or Identity if it should go out as is
+     * @param req Request carrying Accept-Encoding
+     * @param bodySize Uncompressed body size
+     * @param contentType Content-Type of the body
+     */
+    ContentEncoding choose(const httplib::Request& req, size_t bodySize, const std::string& contentType) const;
+
+    /**
+     * @brief Set an already compressed body as the response
+     * @param encoding Encoding the body is in, as returned by choose()
+     */
+    void setEncodedContent(const httplib::Request& req, httplib::Response& res, const std::string& body,
+                           ContentEncoding encoding, const std::string& contentType);
+
+    /**
+     * @brief Compress res.body in place if the client accepts it and it is worthwhile
+     */
+    void compress(const httplib::Request& req, httplib::Response& res);
+
+private:
+    // Stop httplib compressing a buffered body that has been handled here
+    static void releaseAcceptEncoding(const httplib::Request& req);
+
+    void recordEncoded(ContentEncoding encoding);
+
+    std::atomic<size_t> minBytes_;
+    Counter* gzipResponses_;
+    Counter* zstdResponses_;
+};
+
+} // namespace messaging_service
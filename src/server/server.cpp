@@ -1,25 +1,119 @@
 #include "server.h"
+#include "response_compression.h"
 #include "../handlers/message_handler.h"
 #include "../handlers/webhook_handler.h"
 #include "../handlers/conversation_handler.h"
-#include <iostream>
+#include "../providers/messaging_provider.h"
+#include "../providers/implementations/HttpMessagingProvider.h"
+#include "../providers/provider_router.h"
+#include "../types/status_codes.h"
+#include "../utils/admission_controller.h"
+#include "../utils/conditional_get.h"
+#include "../utils/json_parser.h"
+#include "../utils/logger.h"
+#include "../utils/message_event_hub.h"
+#include "../utils/message_page_cache.h"
+#include "../utils/id_generator.h"
+#include "../utils/metrics.h"
+#include "../utils/tracing.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <sys/socket.h>
+#include <thread>
 
-MessagingServer::MessagingServer(int port) : port_(port) {
+MessagingServer::MessagingServer(const messaging_service::ServerConfig& config) : config_(config), listeningSocket_(-1), draining_(false) {
     //initialize instance
     server_ = std::make_unique<httplib::Server>();
+    applyConfig();
+    
+    registerConfiguredProviders();
+    
+    databasePool_ = std::make_unique<DatabasePool>(config_.dbPoolSize, std::chrono::seconds(5),
+                                                   &messaging_service::AdmissionController::instance());
     
     // Initialize shared message handler with worker pool
-    messageHandler_ = std::make_unique<MessageHandler>();
+    messageHandler_ = std::make_unique<MessageHandler>(*databasePool_);
+    webhookHandler_ = std::make_unique<WebhookHandler>(*databasePool_);
+    conversationHandler_ = std::make_unique<ConversationHandler>(*databasePool_);
+    
+    messaging_service::MessagePageCache::instance().setBudget(config_.pageCacheMb * 1024 * 1024);
+    
+    partitionMaintainer_ = std::make_unique<PartitionMaintainer>(config_.messageRetentionMonths);
+    
+    notificationListener_ = std::make_unique<NotificationListener>();
+    if (config_.pageCacheMb > 0) {
+        setupCacheInvalidation();
+    }
+    if (config_.eventsPort > 0) {
+        messaging_service::EventStreamOptions eventOptions;
+        eventOptions.maxConnections = config_.eventsMaxStreams;
+        eventStreamServer_ = std::make_unique<messaging_service::EventStreamServer>(
+            messaging_service::MessageEventHub::instance(), eventOptions);
+        setupMessageEvents();
+    }
     
     setupRoutes();
 }
 
+void MessagingServer::applyConfig() {
+    size_t threads = config_.resolvedThreads();
+    size_t maxQueued = config_.maxQueuedRequests;
+    server_->new_task_queue = [threads, maxQueued] { return new httplib::ThreadPool(threads, maxQueued); };
+    
+    server_->set_keep_alive_max_count(config_.keepAliveMaxCount);
+    server_->set_keep_alive_timeout(config_.keepAliveTimeoutSec);
+    server_->set_read_timeout(config_.readTimeoutSec, 0);
+    server_->set_write_timeout(config_.writeTimeoutSec, 0);
+    server_->set_payload_max_length(config_.payloadMaxBytes);
+    
+    // Large buffered responses are compressed for clients that accept it, whatever the route
+    messaging_service::ResponseCompressor::instance().setMinBytes(config_.compressMinBytes);
+    server_->set_post_routing_handler([](const httplib::Request& req, httplib::Response& res) {
+        messaging_service::ResponseCompressor::instance().compress(req, res);
+    });
+    
+    // Replacing the socket options drops httplib's defaults, so SO_REUSEADDR is set here too.
+    // Worker processes each bind the port with SO_REUSEPORT and the kernel spreads connections
+    bool reusePort = config_.resolvedWorkers() > 1;
+    server_->set_socket_options([this, reusePort](socket_t sock) {
+        listeningSocket_ = sock;
+        int yes = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const void*>(&yes), sizeof(yes));
+        if (reusePort) {
+            setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const void*>(&yes), sizeof(yes));
+        }
+    });
+}
+
 void MessagingServer::start() {
-    std::cout << "Starting server on port " << port_ << "..." << std::endl;
+    LOG_INFO("server", "Starting server", {{"host", config_.host}, {"port", config_.port},
+             {"threads", config_.resolvedThreads()}, {"keep_alive_max_count", config_.keepAliveMaxCount},
+             {"keep_alive_timeout_s", config_.keepAliveTimeoutSec}, {"listen_backlog", config_.listenBacklog}});
     
-    // 0.0.0.0 listens on all interfaces
-    if (!server_->listen("0.0.0.0", port_)) {
-        throw std::runtime_error("Failed to start server on port " + std::to_string(port_));
+    // Scheduled messages left unsent by a previous run, or by a process that drained
+    messageHandler_->recoverScheduledMessages();
+    
+    // httplib listens with a small compile-time backlog; listening again on
+    // the bound socket raises it to the configured size
+    int boundPort = server_->bind_to_port(config_.host, config_.port);
+    if (boundPort < 0) {
+        throw std::runtime_error("Failed to bind server to " + config_.host + ":" + std::to_string(config_.port));
+    }
+    if (listeningSocket_ >= 0 && ::listen(listeningSocket_, config_.listenBacklog) != 0) {
+        LOG_WARN("server", "Failed to apply listen backlog", {{"listen_backlog", config_.listenBacklog}});
+    }
+    
+    if (eventStreamServer_ && !eventStreamServer_->start(config_.host, config_.eventsPort, config_.resolvedWorkers() > 1)) {
+        throw std::runtime_error("Failed to bind event streams to " + config_.host + ":" + std::to_string(config_.eventsPort));
+    }
+    notificationListener_->start();
+    partitionMaintainer_->start();
+    
+    if (!server_->listen_after_bind()) {
+        throw std::runtime_error("Failed to start server on port " + std::to_string(config_.port));
     }
 }
 
@@ -29,53 +123,267 @@ void MessagingServer::stop() {
     }
 }
 
+void MessagingServer::shutdown(bool waitForLoadBalancer) {
+    draining_ = true;
+    if (waitForLoadBalancer && config_.drainDelaySec > 0) {
+        LOG_INFO("server", "Draining, failing health checks before closing the listener",
+                 {{"drain_delay_s", config_.drainDelaySec}});
+        std::this_thread::sleep_for(std::chrono::seconds(config_.drainDelaySec));
+    }
+    // httplib closes the listener, then joins its threads once their current requests finish
+    stop();
+}
+
+bool MessagingServer::drain() {
+    draining_ = true;
+    // Clients reconnect to another instance and catch up from the reset they are sent there
+    if (eventStreamServer_) {
+        eventStreamServer_->stop();
+    }
+    notificationListener_->stop();
+    partitionMaintainer_->stop();
+    bool finished = messageHandler_->drain(std::chrono::seconds(config_.drainTimeoutSec));
+    messaging_service::Tracer::instance().flush();
+    LOG_INFO("server", "Drained", {{"queued_sends_finished", finished}});
+    messaging_service::Logger::instance().flush();
+    return finished;
+}
+
+void MessagingServer::setupMessageEvents() {
+    using namespace messaging_service;
+    
+    // Every process hears every insert, including its own, so local and remote writes take one path
+    notificationListener_->subscribe("message_events", [](Database& database, const std::vector<std::string>& payloads) {
+        auto& hub = MessageEventHub::instance();
+        for (const auto& payload : payloads) {
+            auto fields = JsonParser::parse(payload);
+            int conversationId = std::atoi(fields["conversation_id"].c_str());
+            if (!hub.isFollowed(conversationId, fields["from_address"], fields["to_address"])) {
+                continue;
+            }
+            MessageEvent event;
+            if (database.getMessageEvent(std::atoi(fields["id"].c_str()), fields["timestamp"], event)) {
+                hub.publish(event);
+            }
+        }
+    });
+    
+    // Inserts made while disconnected were never announced
+    notificationListener_->onConnect([](Database&, bool reconnected) {
+        if (reconnected) {
+            MessageEventHub::instance().publishReset();
+        }
+    });
+}
+
+void MessagingServer::setupCacheInvalidation() {
+    using namespace messaging_service;
+    
+    // Payloads are "<conversation id>.<version>"; this process's own writes have already invalidated
+    notificationListener_->subscribe("conversation_changes", [](Database&, const std::vector<std::string>& payloads) {
+        std::vector<int> conversationIds;
+        conversationIds.reserve(payloads.size());
+        for (const auto& payload : payloads) {
+            conversationIds.push_back(std::atoi(payload.c_str()));
+        }
+        std::sort(conversationIds.begin(), conversationIds.end());
+        conversationIds.erase(std::unique(conversationIds.begin(), conversationIds.end()), conversationIds.end());
+        MessagePageCache::instance().invalidate(conversationIds);
+    });
+    
+    // Writes made while not listening were never announced, so every cached page is checked
+    // against its conversation's version before hits are trusted again
+    notificationListener_->onConnect([](Database& database, bool) {
+        auto& cache = MessagePageCache::instance();
+        std::vector<std::pair<int, std::string>> cached = cache.getCachedTags();
+        std::vector<int> conversationIds;
+        for (const auto& page : cached) {
+            conversationIds.push_back(page.first);
+        }
+        std::vector<std::pair<int, std::string>> current;
+        if (!database.getConversationTags(conversationIds, current)) {
+            cache.clear();
+        } else {
+            std::map<int, std::string> currentTags(current.begin(), current.end());
+            std::vector<int> stale;
+            for (const auto& page : cached) {
+                auto tag = currentTags.find(page.first);
+                if (tag == currentTags.end() || makeEntityTag(tag->second) != page.second) {
+                    stale.push_back(page.first);
+                }
+            }
+            cache.invalidate(stale);
+            LOG_INFO("server", "Resynced page cache", {{"pages", cached.size()}, {"stale", stale.size()}});
+        }
+        cache.setCoherent(true);
+    });
+    notificationListener_->onDisconnect([] {
+        MessagePageCache::instance().setCoherent(false);
+    });
+}
+
+void MessagingServer::registerConfiguredProviders() {
+    using namespace messaging_service;
+    
+    const char* baseUrl = std::getenv("HTTP_PROVIDER_URL");
+    if (!baseUrl || std::string(baseUrl).empty()) {
+        return;
+    }
+    
+    HttpMessagingProvider::registerForAllTypes(HttpProviderConfig::fromEnvironment(baseUrl));
+}
+
 void MessagingServer::setupRoutes() {
     setupMessageRoutes();
     setupWebhookRoutes();
     setupConversationRoutes();
+    setupProviderRoutes();
     
     // Health check endpoint
-    server_->Get("/health", [](const httplib::Request&, httplib::Response& res) {
+    server_->Get("/health", [this](const httplib::Request&, httplib::Response& res) {
+        if (draining_.load()) {
+            res.status = toInt(StatusCodeType::SERVICE_UNAVAILABLE);
+            res.set_content("DRAINING", "text/plain");
+            return;
+        }
         res.set_content("OK", "text/plain");
     });
+    
+    // Prometheus scrape endpoint
+    server_->Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(messaging_service::MetricsRegistry::instance().renderPrometheus(),
+                        "text/plain; version=0.0.4");
+    });
+}
+
+httplib::Server::Handler MessagingServer::instrumented(const std::string& method, const std::string& route,
+                                                       httplib::Server::Handler handler) {
+    using namespace messaging_service;
+    auto& registry = MetricsRegistry::instance();
+    
+    // Resolve every series up front so the request path only touches atomics
+    Histogram* latency = &registry.histogram("http_request_duration_seconds", "Time spent handling HTTP requests",
+                                             {{"method", method}, {"route", route}});
+    std::array<Counter*, 5> responses;
+    for (size_t i = 0; i < responses.size(); ++i) {
+        responses[i] = &registry.counter("http_responses_total", "HTTP responses by status class",
+                                         {{"method", method}, {"route", route}, {"code", std::to_string(i + 1) + "xx"}});
+    }
+    
+    std::string spanName = method + " " + route;
+    return [handler, latency, responses, spanName](const httplib::Request& req, httplib::Response& res) {
+        auto start = std::chrono::steady_clock::now();
+        
+        // Honour a caller's request id so logs and traces line up across services
+        std::string requestId = req.get_header_value("X-Request-Id");
+        if (requestId.empty() || requestId.size() > 128) {
+            requestId = IdGenerator::instance().nextBase32();
+        }
+        res.set_header("X-Request-Id", requestId);
+        
+        TraceContext parent;
+        bool hasParent = TraceContext::fromTraceparent(req.get_header_value("traceparent"), parent);
+        RequestTrace trace(spanName, requestId, hasParent ? &parent : nullptr);
+        
+        handler(req, res);
+        latency->observe(std::chrono::steady_clock::now() - start);
+        
+        // httplib reports 200 for handlers that leave the status unset
+        int status = res.status < 100 ? 200 : res.status;
+        trace.setAttribute("http.status_code", std::to_string(status));
+        trace.setError(status >= 500);
+        size_t statusClass = static_cast<size_t>(status / 100);
+        if (statusClass >= 1 && statusClass <= responses.size()) {
+            responses[statusClass - 1]->inc();
+        }
+    };
+}
+
+httplib::Server::Handler MessagingServer::sheddable(httplib::Server::Handler handler) {
+    return [handler](const httplib::Request& req, httplib::Response& res) {
+        using namespace messaging_service;
+        if (!AdmissionController::instance().admit(AdmissionPriority::Low)) {
+            res.status = toInt(StatusCodeType::SERVICE_UNAVAILABLE);
+            res.set_header("Retry-After", "1");
+            res.set_content("{\"status\": \"error\", \"message\": \"Server overloaded, retry later\"}", "application/json");
+            return;
+        }
+        handler(req, res);
+    };
 }
 
 void MessagingServer::setupMessageRoutes() {
     // Send SMS/MMS
-    server_->Post("/api/messages/sms", [this](const httplib::Request& req, httplib::Response& res) {
+    server_->Post("/api/messages/sms", instrumented("POST", "/api/messages/sms", sheddable([this](const httplib::Request& req, httplib::Response& res) {
         messageHandler_->handleSendSms(req, res);
-    });
+    })));
     
     // Send Email
-    server_->Post("/api/messages/email", [this](const httplib::Request& req, httplib::Response& res) {
+    server_->Post("/api/messages/email", instrumented("POST", "/api/messages/email", sheddable([this](const httplib::Request& req, httplib::Response& res) {
         messageHandler_->handleSendEmail(req, res);
-    });
+    })));
 }
 
 void MessagingServer::setupWebhookRoutes() {
+    // Carriers retry failed webhooks aggressively, so these are never shed under load
     // Incoming SMS/MMS webhook
-    server_->Post("/api/webhooks/sms", [](const httplib::Request& req, httplib::Response& res) {
-        WebhookHandler handler;
-        handler.handleIncomingSms(req, res);
-    });
+    server_->Post("/api/webhooks/sms", instrumented("POST", "/api/webhooks/sms", [this](const httplib::Request& req, httplib::Response& res) {
+        webhookHandler_->handleIncomingSms(req, res);
+    }));
     
     // Incoming Email webhook
-    server_->Post("/api/webhooks/email", [](const httplib::Request& req, httplib::Response& res) {
-        WebhookHandler handler;
-        handler.handleIncomingEmail(req, res);
-    });
+    server_->Post("/api/webhooks/email", instrumented("POST", "/api/webhooks/email", [this](const httplib::Request& req, httplib::Response& res) {
+        webhookHandler_->handleIncomingEmail(req, res);
+    }));
 }
 
 void MessagingServer::setupConversationRoutes() {
     // Get conversations
-    server_->Get("/api/conversations", [](const httplib::Request& req, httplib::Response& res) {
-        ConversationHandler handler;
-        handler.handleGetConversations(req, res);
-    });
+    server_->Get("/api/conversations", instrumented("GET", "/api/conversations", sheddable([this](const httplib::Request& req, httplib::Response& res) {
+        conversationHandler_->handleGetConversations(req, res);
+    })));
     
     // Get messages for a conversation
-    server_->Get("/api/conversations/(.*)/messages", [](const httplib::Request& req, httplib::Response& res) {
-        ConversationHandler handler;
-        handler.handleGetMessages(req, res);
-    });
+    server_->Get("/api/conversations/(.*)/messages", instrumented("GET", "/api/conversations/{id}/messages", sheddable([this](const httplib::Request& req, httplib::Response& res) {
+        conversationHandler_->handleGetMessages(req, res);
+    })));
+}
+
+
+void MessagingServer::setupProviderRoutes() {
+    // Per-provider routing statistics and current type mappings
+    server_->Get("/api/providers", instrumented("GET", "/api/providers", [](const httplib::Request&, httplib::Response& res) {
+        using namespace messaging_service;
+        auto& router = ProviderRouter::instance();
+        
+        std::string json = "{\"routing\":\"";
+        json += router.isWeighted() ? "weighted" : "fixed";
+        json += "\",\"mappings\":{";
+        bool first = true;
+        for (const auto& mapping : MessagingProviderFactory::getProviderMappings()) {
+            if (!first) {
+                json += ",";
+            }
+            first = false;
+            json += "\"" + mapping.first + "\":\"" + mapping.second + "\"";
+        }
+        json += "},\"providers\":[";
+        first = true;
+        for (const auto& stats : router.getStats()) {
+            if (!first) {
+                json += ",";
+            }
+            first = false;
+            json += "{";
+            json += "\"name\":\"" + stats.name + "\",";
+            json += "\"ewma_latency_ms\":" + std::to_string(stats.ewmaLatencyMs) + ",";
+            json += "\"success_rate\":" + std::to_string(stats.successRate) + ",";
+            json += "\"outstanding\":" + std::to_string(stats.outstanding) + ",";
+            json += "\"requests\":" + std::to_string(stats.requests) + ",";
+            json += "\"failures\":" + std::to_string(stats.failures);
+            json += "}";
+        }
+        json += "]}";
+        res.set_content(json, "application/json");
+    }));
 }
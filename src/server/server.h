@@ -1,26 +1,52 @@
 #pragma once
 
 #include <httplib.h>
+#include <atomic>
 #include <memory>
 #include <string>
+#include "../database/database_pool.h"
+#include "../database/notification_listener.h"
+#include "../database/partition_maintainer.h"
+#include "../handlers/conversation_handler.h"
 #include "../handlers/message_handler.h"
+#include "../handlers/webhook_handler.h"
+#include "event_stream_server.h"
+#include "server_config.h"
 
 //This is the class containing the server functions. 
 class MessagingServer {
 private:
     //locally owned allocated smart pointer to an instance
     std::unique_ptr<httplib::Server> server_;
-    int port_;
+    messaging_service::ServerConfig config_;
+    socket_t listeningSocket_;   // captured from httplib's socket options callback
+    std::atomic<bool> draining_;  // /health fails once shutdown has begun
+    
+    // Connections leased by the message, webhook and conversation handlers;
+    // declared before them so it outlives all three
+    std::unique_ptr<DatabasePool> databasePool_;
     
     // Shared message handler instance with worker pool
     std::unique_ptr<MessageHandler> messageHandler_;
     
+    // Stateless apart from the pool, so one instance of each serves every request
+    std::unique_ptr<WebhookHandler> webhookHandler_;
+    std::unique_ptr<ConversationHandler> conversationHandler_;
+    
+    // Database notifications: new messages for event stream subscribers, and
+    // writes by other processes that make cached pages stale
+    std::unique_ptr<NotificationListener> notificationListener_;
+    std::unique_ptr<messaging_service::EventStreamServer> eventStreamServer_;
+    
+    // Creates upcoming monthly message partitions and drops expired ones
+    std::unique_ptr<PartitionMaintainer> partitionMaintainer_;
+    
 public:
     /**
      * @brief Constructor for MessagingServer
-     * @param port The port number to listen on (default 8080)
+     * @param config Listener, threading and connection settings
      */
-    MessagingServer(int port = 8080);
+    explicit MessagingServer(const messaging_service::ServerConfig& config = messaging_service::ServerConfig());
     
     /**
      * @brief Default destructor
@@ -37,7 +63,30 @@ public:
      */
     void stop();
     
+    /**
+     * @brief Begin a graceful shutdown
+     * Fails /health at once, then stops accepting connections. With
+     * waitForLoadBalancer the listener stays open for drain_delay first, so
+     * load balancers see the failing check and route new requests elsewhere.
+     * start() returns after requests already being handled have finished.
+     * @param waitForLoadBalancer Keep serving for drain_delay before stopping
+     */
+    void shutdown(bool waitForLoadBalancer);
+    
+    /**
+     * @brief Finish background work after start() has returned
+     * Waits up to drain_timeout for queued sends, hands unsent scheduled
+     * messages back to the database and flushes the trace and log writers.
+     * @return true if every queued send finished in time
+     */
+    bool drain();
+    
 private:
+    /**
+     * @brief Apply thread pool, keep-alive, timeout and payload settings to server_
+     */
+    void applyConfig();
+    
     /**
      * @brief Set up all HTTP routes and endpoints
      */
@@ -57,4 +106,44 @@ private:
      * @brief Set up conversation-related routes (get conversations, get messages)
      */
     void setupConversationRoutes();
+    
+    /**
+     * @brief Set up provider routing introspection routes
+     */
+    void setupProviderRoutes();
+    
+    /**
+     * @brief Wrap a route handler to record request latency and responses by status class
+     * @param method HTTP method, used as a metric label
+     * @param route Route template, used as a metric label
+     * @param handler The handler to wrap
+     * @return Handler that records metrics around the wrapped one
+     */
+    httplib::Server::Handler instrumented(const std::string& method, const std::string& route,
+                                          httplib::Server::Handler handler);
+    
+    /**
+     * @brief Wrap a low-priority route handler to reject requests with 503 while overloaded
+     * @param handler The handler to wrap
+     * @return Handler that consults the AdmissionController first
+     */
+    httplib::Server::Handler sheddable(httplib::Server::Handler handler);
+    
+    /**
+     * @brief Publish messages announced on the message_events channel to event stream subscribers
+     */
+    void setupMessageEvents();
+    
+    /**
+     * @brief Drop cached pages of conversations written by other processes, announced on conversation_changes
+     */
+    void setupCacheInvalidation();
+    
+    /**
+     * @brief Register network-backed providers configured via environment
+     * When HTTP_PROVIDER_URL is set, SMS/MMS and email are routed to an
+     * HttpMessagingProvider pointing at that vendor endpoint, in weighted
+     * mode as well; the simulated providers get no traffic.
+     */
+    void registerConfiguredProviders();
 };
@@ -0,0 +1,256 @@
+#include "server_config.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+namespace messaging_service {
+
+namespace {
+
+struct Setting {
+    const char* key;   // config file key; the flag is "--" + key with '_' as '-'
+    const char* env;
+};
+
+const Setting kSettings[] = {
+    {"host", "SERVER_HOST"},
+    {"port", "SERVER_PORT"},
+    {"threads", "SERVER_THREADS"},
+    {"expected_connections", "SERVER_EXPECTED_CONNECTIONS"},
+    {"max_queued_requests", "SERVER_MAX_QUEUED_REQUESTS"},
+    {"keep_alive_max_count", "SERVER_KEEP_ALIVE_MAX_COUNT"},
+    {"keep_alive_timeout", "SERVER_KEEP_ALIVE_TIMEOUT"},
+    {"read_timeout", "SERVER_READ_TIMEOUT"},
+    {"write_timeout", "SERVER_WRITE_TIMEOUT"},
+    {"payload_max_bytes", "SERVER_PAYLOAD_MAX_BYTES"},
+    {"listen_backlog", "SERVER_LISTEN_BACKLOG"},
+    {"workers", "SERVER_WORKERS"},
+    {"shutdown_timeout", "SERVER_SHUTDOWN_TIMEOUT"},
+    {"drain_delay", "SERVER_DRAIN_DELAY"},
+    {"drain_timeout", "SERVER_DRAIN_TIMEOUT"},
+    {"db_pool_size", "SERVER_DB_POOL_SIZE"},
+    {"page_cache_mb", "SERVER_PAGE_CACHE_MB"},
+    {"compress_min_bytes", "SERVER_COMPRESS_MIN_BYTES"},
+    {"events_port", "SERVER_EVENTS_PORT"},
+    {"events_max_streams", "SERVER_EVENTS_MAX_STREAMS"},
+    {"message_retention_months", "SERVER_MESSAGE_RETENTION_MONTHS"},
+};
+
+std::string trimmed(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::string flagToKey(const std::string& flag) {
+    std::string key = flag.substr(2);
+    std::replace(key.begin(), key.end(), '-', '_');
+    return key;
+}
+
+// Parses a whole-string integer within [min, max]
+bool parseInteger(const std::string& key, const std::string& value, long long min, long long max,
+                  long long& result, std::string& error) {
+    try {
+        size_t consumed = 0;
+        long long parsed = std::stoll(value, &consumed);
+        if (consumed == value.size() && parsed >= min && parsed <= max) {
+            result = parsed;
+            return true;
+        }
+    } catch (const std::exception&) {
+    }
+    error = "Invalid value for " + key + ": '" + value + "' (expected " + std::to_string(min) + "-" +
+            std::to_string(max) + ")";
+    return false;
+}
+
+template<typename T>
+bool assign(const std::string& key, const std::string& value, long long min, long long max,
+            T& field, std::string& error) {
+    long long parsed = 0;
+    if (!parseInteger(key, value, min, max, parsed, error)) {
+        return false;
+    }
+    field = static_cast<T>(parsed);
+    return true;
+}
+
+} // namespace
+
+bool ServerConfig::load(int argc, char* argv[], ServerConfig& config, std::string& error) {
+    ServerConfig loaded;
+
+    std::string file;
+    if (const char* path = std::getenv("SERVER_CONFIG")) {
+        file = path;
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            file = argv[i + 1];
+        } else if (arg.rfind("--config=", 0) == 0) {
+            file = arg.substr(9);
+        }
+    }
+
+    if (!file.empty() && !loaded.applyFile(file, error)) {
+        return false;
+    }
+    if (!loaded.applyEnvironment(error) || !loaded.applyArguments(argc, argv, error)) {
+        return false;
+    }
+    config = loaded;
+    return true;
+}
+
+bool ServerConfig::applyFile(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Cannot read config file " + path;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = trimmed(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            error = path + ":" + std::to_string(lineNumber) + ": expected key = value";
+            return false;
+        }
+        if (!set(trimmed(line.substr(0, equals)), trimmed(line.substr(equals + 1)), error)) {
+            error = path + ":" + std::to_string(lineNumber) + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ServerConfig::applyEnvironment(std::string& error) {
+    for (const auto& setting : kSettings) {
+        const char* value = std::getenv(setting.env);
+        if (value && *value && !set(setting.key, value, error)) {
+            error = std::string(setting.env) + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ServerConfig::applyArguments(int argc, char* argv[], std::string& error) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        // A bare first argument is the port, as before flags existed
+        if (i == 1 && arg.rfind("--", 0) != 0) {
+            if (!set("port", arg, error)) {
+                return false;
+            }
+            continue;
+        }
+        if (arg.rfind("--", 0) != 0) {
+            error = "Unexpected argument '" + arg + "'";
+            return false;
+        }
+
+        std::string key;
+        std::string value;
+        size_t equals = arg.find('=');
+        if (equals != std::string::npos) {
+            key = flagToKey(arg.substr(0, equals));
+            value = arg.substr(equals + 1);
+        } else {
+            key = flagToKey(arg);
+            if (i + 1 >= argc) {
+                error = "Missing value for " + arg;
+                return false;
+            }
+            value = argv[++i];
+        }
+
+        if (key == "config") {
+            continue;
+        }
+        if (!set(key, value, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ServerConfig::set(const std::string& key, const std::string& value, std::string& error) {
+    const long long maxSize = std::numeric_limits<int>::max();
+    if (key == "host") {
+        if (value.empty()) {
+            error = "Invalid value for host: ''";
+            return false;
+        }
+        host = value;
+        return true;
+    }
+    if (key == "port") return assign(key, value, 1, 65535, port, error);
+    if (key == "threads") return assign(key, value, 0, 4096, threads, error);
+    if (key == "expected_connections") return assign(key, value, 0, 65536, expectedConnections, error);
+    if (key == "max_queued_requests") return assign(key, value, 0, maxSize, maxQueuedRequests, error);
+    if (key == "keep_alive_max_count") return assign(key, value, 1, maxSize, keepAliveMaxCount, error);
+    if (key == "keep_alive_timeout") return assign(key, value, 1, 3600, keepAliveTimeoutSec, error);
+    if (key == "read_timeout") return assign(key, value, 1, 3600, readTimeoutSec, error);
+    if (key == "write_timeout") return assign(key, value, 1, 3600, writeTimeoutSec, error);
+    if (key == "payload_max_bytes") return assign(key, value, 1, maxSize, payloadMaxBytes, error);
+    if (key == "listen_backlog") return assign(key, value, 1, 65535, listenBacklog, error);
+    if (key == "workers") return assign(key, value, 0, 1024, workers, error);
+    if (key == "shutdown_timeout") return assign(key, value, 1, 3600, shutdownTimeoutSec, error);
+    if (key == "drain_delay") return assign(key, value, 0, 3600, drainDelaySec, error);
+    if (key == "drain_timeout") return assign(key, value, 0, 3600, drainTimeoutSec, error);
+    if (key == "db_pool_size") return assign(key, value, 1, 1024, dbPoolSize, error);
+    if (key == "page_cache_mb") return assign(key, value, 0, 65536, pageCacheMb, error);
+    if (key == "compress_min_bytes") return assign(key, value, 0, maxSize, compressMinBytes, error);
+    if (key == "events_port") return assign(key, value, 0, 65535, eventsPort, error);
+    if (key == "events_max_streams") return assign(key, value, 1, 1048576, eventsMaxStreams, error);
+    if (key == "message_retention_months") return assign(key, value, 0, 1200, messageRetentionMonths, error);
+
+    error = "Unknown setting '" + key + "'";
+    return false;
+}
+
+size_t ServerConfig::resolvedThreads() const {
+    if (threads > 0) {
+        return threads;
+    }
+    // Split across worker processes, which share the connections
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    size_t processes = resolvedWorkers();
+    size_t perCore = (cores * 4 + processes - 1) / processes;
+    size_t perConnection = (expectedConnections + processes - 1) / processes;
+    return std::max({perCore, perConnection, static_cast<size_t>(8)});
+}
+
+size_t ServerConfig::resolvedWorkers() const {
+    if (workers > 0) {
+        return workers;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::string ServerConfig::usage(const std::string& program) {
+    std::string text = "Usage: " + program + " [port] [--config FILE]";
+    for (const auto& setting : kSettings) {
+        std::string flag = std::string("--") + setting.key;
+        std::replace(flag.begin(), flag.end(), '_', '-');
+        text += " [" + flag + " VALUE]";
+    }
+    return text;
+}
+
+} // namespace messaging_service
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace messaging_service {
+
+/**
+ * @brief Listener, threading and connection settings for MessagingServer
+ *
+ * Settings are layered: built-in defaults, then a config file, then
+ * SERVER_* environment variables, then command-line flags. The config file
+ * holds one "key = value" per line ('#' starts a comment) using the same
+ * keys as the flags without their leading dashes, e.g. "threads = 32".
+ *
+ * | key                  | env                           | flag                    |
+ * |----------------------|-------------------------------|-------------------------|
+ * | host                 | SERVER_HOST                   | --host                  |
+ * | port                 | SERVER_PORT                   | --port or first arg     |
+ * | threads              | SERVER_THREADS                | --threads               |
+ * | expected_connections | SERVER_EXPECTED_CONNECTIONS   | --expected-connections  |
+ * | max_queued_requests  | SERVER_MAX_QUEUED_REQUESTS    | --max-queued-requests   |
+ * | keep_alive_max_count | SERVER_KEEP_ALIVE_MAX_COUNT   | --keep-alive-max-count  |
+ * | keep_alive_timeout   | SERVER_KEEP_ALIVE_TIMEOUT     | --keep-alive-timeout    |
+ * | read_timeout         | SERVER_READ_TIMEOUT           | --read-timeout          |
+ * | write_timeout        | SERVER_WRITE_TIMEOUT          | --write-timeout         |
+ * | payload_max_bytes    | SERVER_PAYLOAD_MAX_BYTES      | --payload-max-bytes     |
+ * | listen_backlog       | SERVER_LISTEN_BACKLOG         | --listen-backlog        |
+ * | workers              | SERVER_WORKERS                | --workers               |
+ * | shutdown_timeout     | SERVER_SHUTDOWN_TIMEOUT       | --shutdown-timeout      |
+ * | drain_delay          | SERVER_DRAIN_DELAY            | --drain-delay           |
+ * | drain_timeout        | SERVER_DRAIN_TIMEOUT          | --drain-timeout         |
+ * | db_pool_size         | SERVER_DB_POOL_SIZE           | --db-pool-size          |
+ * | page_cache_mb        | SERVER_PAGE_CACHE_MB          | --page-cache-mb         |
+ * | compress_min_bytes   | SERVER_COMPRESS_MIN_BYTES     | --compress-min-bytes    |
+ * | events_port          | SERVER_EVENTS_PORT            | --events-port           |
+ * | events_max_streams   | SERVER_EVENTS_MAX_STREAMS     | --events-max-streams    |
+ * | message_retention_months | SERVER_MESSAGE_RETENTION_MONTHS | --message-retention-months |
+ *
+ * The file is named with --config or SERVER_CONFIG.
+ */
+struct ServerConfig {
+    std::string host = "0.0.0.0";
+    int port = 8080;
+    size_t threads = 0;               // HTTP worker threads; 0 sizes from cores and expected connections
+    size_t expectedConnections = 0;   // concurrent keep-alive clients the server should hold without queueing
+    size_t maxQueuedRequests = 0;     // accepted connections waiting for a thread; 0 is unbounded
+    size_t keepAliveMaxCount = 100;   // requests served on one connection before it is closed
+    int keepAliveTimeoutSec = 5;      // idle time before a keep-alive connection is closed
+    int readTimeoutSec = 5;
+    int writeTimeoutSec = 5;
+    size_t payloadMaxBytes = 1024 * 1024;
+    int listenBacklog = 1024;         // pending connections the kernel queues before accept
+    size_t workers = 1;               // server processes sharing the port with SO_REUSEPORT; 0 is one per core
+    int shutdownTimeoutSec = 30;      // time workers get to exit after SIGTERM before being killed
+    int drainDelaySec = 5;            // time /health reports draining before SIGTERM stops accepting connections
+    int drainTimeoutSec = 15;         // time queued background work gets to finish after the listener stops
+    size_t dbPoolSize = 16;           // database connections shared by message, webhook and conversation requests
+    size_t pageCacheMb = 64;          // memory for cached conversation message pages; 0 disables the cache
+    size_t compressMinBytes = 1024;   // smallest response body sent compressed; 0 disables compression
+    int eventsPort = 8081;            // port serving message event streams; 0 disables them
+    size_t eventsMaxStreams = 50000;  // open event streams per process
+    int messageRetentionMonths = 0;   // whole months of messages kept before the current one; 0 keeps everything
+
+    /**
+     * @brief Build a config from defaults, config file, environment and arguments
+     * @param argc Argument count from main
+     * @param argv Arguments from main
+     * @param config Receives the result
+     * @param error Receives a description of the first invalid setting
+     * @return false if the file cannot be read or a setting is invalid
+     */
+    static bool load(int argc, char* argv[], ServerConfig& config, std::string& error);
+
+    /**
+     * @brief Apply "key = value" lines from a config file
+     */
+    bool applyFile(const std::string& path, std::string& error);
+
+    /**
+     * @brief Apply SERVER_* environment variables
+     */
+    bool applyEnvironment(std::string& error);
+
+    /**
+     * @brief Apply command-line flags; --config is skipped since load() reads it first
+     */
+    bool applyArguments(int argc, char* argv[], std::string& error);
+
+    /**
+     * @brief Set one setting by its config-file key
+     * @return false if the key is unknown or the value is out of range
+     */
+    bool set(const std::string& key, const std::string& value, std::string& error);
+
+    /**
+     * @brief Worker thread count to use in each server process
+     *
+     * httplib serves each connection on one thread for the connection's whole
+     * keep-alive lifetime, and handlers block on the database and providers,
+     * so the pool is sized for concurrency rather than for CPU: at least
+     * expected_connections, and at least four threads per core, divided
+     * between the worker processes.
+     */
+    size_t resolvedThreads() const;
+
+    /**
+     * @brief Number of server processes to run
+     */
+    size_t resolvedWorkers() const;
+
+    /**
+     * @brief Usage text for the supported flags
+     */
+    static std::string usage(const std::string& program);
+};
+
+} // namespace messaging_service
@@ -0,0 +1,181 @@
+#include "supervisor.h"
+#include "../utils/logger.h"
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <ctime>
+#include <pthread.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace messaging_service {
+
+namespace {
+
+constexpr long kPollIntervalNs = 100 * 1000 * 1000;
+
+std::string describeStatus(int status) {
+    if (WIFEXITED(status)) {
+        return "exit " + std::to_string(WEXITSTATUS(status));
+    }
+    if (WIFSIGNALED(status)) {
+        return "signal " + std::to_string(WTERMSIG(status));
+    }
+    return "status " + std::to_string(status);
+}
+
+} // namespace
+
+Supervisor::Supervisor(const SupervisorOptions& options, WorkerFunction worker)
+    : options_(options), worker_(std::move(worker)), slots_(std::max<size_t>(1, options.workers)),
+      stopRequested_(false), restarts_(0) {
+    sigemptyset(&previousMask_);
+}
+
+int Supervisor::run() {
+    // Signals are taken synchronously with sigtimedwait rather than in handlers
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &signals, &previousMask_);
+
+    LOG_INFO("supervisor", "Starting workers", {{"workers", slots_.size()}, {"pid", static_cast<int>(getpid())}});
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        spawn(i);
+    }
+
+    bool stopping = false;
+    bool killed = false;
+    bool cleanShutdown = true;
+    std::chrono::steady_clock::time_point deadline;
+
+    while (true) {
+        timespec tick{0, kPollIntervalNs};
+        int received = sigtimedwait(&signals, nullptr, &tick);
+        if (received == SIGTERM || received == SIGINT) {
+            LOG_INFO("supervisor", "Shutdown requested", {{"signal", received}});
+            stopRequested_ = true;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (stopRequested_ && !stopping) {
+            stopping = true;
+            deadline = now + options_.shutdownTimeout;
+            for (const auto& slot : slots_) {
+                if (slot.pid > 0) {
+                    kill(slot.pid, SIGTERM);
+                }
+            }
+        }
+
+        reapExited(stopping, cleanShutdown);
+
+        if (stopping) {
+            if (!anyRunning()) {
+                break;
+            }
+            if (!killed && now >= deadline) {
+                LOG_WARN("supervisor", "Workers did not exit in time, killing",
+                         {{"timeout_ms", static_cast<long long>(options_.shutdownTimeout.count())}});
+                for (const auto& slot : slots_) {
+                    if (slot.pid > 0) {
+                        kill(slot.pid, SIGKILL);
+                    }
+                }
+                killed = true;
+                cleanShutdown = false;
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i].pid < 0 && now >= slots_[i].restartAt) {
+                restarts_++;
+                spawn(i);
+            }
+        }
+    }
+
+    LOG_INFO("supervisor", "All workers stopped", {{"clean", cleanShutdown}});
+    pthread_sigmask(SIG_SETMASK, &previousMask_, nullptr);
+    return cleanShutdown ? 0 : 1;
+}
+
+void Supervisor::requestStop() {
+    stopRequested_ = true;
+}
+
+size_t Supervisor::getRestartCount() const {
+    return restarts_.load();
+}
+
+void Supervisor::spawn(size_t index) {
+    Slot& slot = slots_[index];
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Child: only this thread exists; give it a working logger and the caller's signal mask
+        Logger::reinitializeAfterFork();
+        pthread_sigmask(SIG_SETMASK, &previousMask_, nullptr);
+        std::exit(worker_(index));
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (pid < 0) {
+        LOG_ERROR("supervisor", "Failed to fork worker", {{"worker", index}});
+        slot.restartDelay = std::max(slot.restartDelay, options_.minRestartDelay);
+        slot.restartAt = now + slot.restartDelay;
+        return;
+    }
+
+    slot.pid = pid;
+    slot.startedAt = now;
+    LOG_INFO("supervisor", "Worker started", {{"worker", index}, {"pid", static_cast<int>(pid)}});
+}
+
+void Supervisor::reapExited(bool stopping, bool& cleanShutdown) {
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        Slot& slot = slots_[i];
+        if (slot.pid <= 0) {
+            continue;
+        }
+        int status = 0;
+        if (waitpid(slot.pid, &status, WNOHANG) != slot.pid) {
+            continue;
+        }
+        pid_t exited = slot.pid;
+        slot.pid = -1;
+
+        if (stopping) {
+            bool clean = (WIFEXITED(status) && WEXITSTATUS(status) == 0) ||
+                         (WIFSIGNALED(status) && WTERMSIG(status) == SIGTERM);
+            if (!clean) {
+                cleanShutdown = false;
+            }
+            LOG_INFO("supervisor", "Worker stopped", {{"worker", i}, {"pid", static_cast<int>(exited)},
+                     {"status", describeStatus(status)}});
+            continue;
+        }
+
+        // A worker that keeps dying on start is restarted with growing delays
+        if (now - slot.startedAt >= options_.stableUptime) {
+            slot.restartDelay = std::chrono::milliseconds(0);
+        } else if (slot.restartDelay.count() == 0) {
+            slot.restartDelay = options_.minRestartDelay;
+        } else {
+            slot.restartDelay = std::min(slot.restartDelay * 2, options_.maxRestartDelay);
+        }
+        slot.restartAt = now + slot.restartDelay;
+        LOG_WARN("supervisor", "Worker exited, restarting", {{"worker", i}, {"pid", static_cast<int>(exited)},
+                 {"status", describeStatus(status)}, {"restart_in_ms", static_cast<long long>(slot.restartDelay.count())}});
+    }
+}
+
+bool Supervisor::anyRunning() const {
+    return std::any_of(slots_.begin(), slots_.end(), [](const Slot& slot) { return slot.pid > 0; });
+}
+
+} // namespace messaging_service
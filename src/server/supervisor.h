@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <functional>
+#include <sys/types.h>
+#include <vector>
+
+namespace messaging_service {
+
+/**
+ * @brief Settings for Supervisor
+ */
+struct SupervisorOptions {
+    size_t workers = 1;
+    std::chrono::milliseconds shutdownTimeout{30000};   // SIGKILL workers still running after this
+    std::chrono::milliseconds minRestartDelay{1000};    // delay before restarting a worker that crashed on start
+    std::chrono::milliseconds maxRestartDelay{30000};
+    std::chrono::milliseconds stableUptime{10000};      // uptime after which a crash restarts immediately
+};
+
+/**
+ * @brief Runs and restarts a fixed set of worker processes
+ *
+ * Each worker is forked from the supervisor and runs the worker function
+ * with its index; the function's return value becomes the process exit
+ * code. Workers that exit while the supervisor is running are restarted,
+ * immediately if they had been up for a while and with exponential backoff
+ * if they keep dying on start. On SIGTERM or SIGINT (or requestStop()) the
+ * supervisor forwards SIGTERM to every worker, waits for them to exit and
+ * kills any still running after the shutdown timeout.
+ *
+ * The supervisor should fork before the process starts any threads: only
+ * the forking thread exists in the child.
+ */
+class Supervisor {
+public:
+    using WorkerFunction = std::function<int(size_t workerIndex)>;
+
+    Supervisor(const SupervisorOptions& options, WorkerFunction worker);
+
+    Supervisor(const Supervisor&) = delete;
+    Supervisor& operator=(const Supervisor&) = delete;
+
+    /**
+     * @brief Start the workers and supervise them until shutdown
+     * @return 0 if every worker exited cleanly on shutdown, 1 otherwise
+     */
+    int run();
+
+    /**
+     * @brief Begin shutdown as if SIGTERM had been received; safe from any thread
+     */
+    void requestStop();
+
+    /**
+     * @brief Number of times a worker has been restarted
+     */
+    size_t getRestartCount() const;
+
+private:
+    struct Slot {
+        pid_t pid = -1;
+        std::chrono::steady_clock::time_point startedAt;
+        std::chrono::steady_clock::time_point restartAt;
+        std::chrono::milliseconds restartDelay{0};
+    };
+
+    void spawn(size_t index);
+    void reapExited(bool stopping, bool& cleanShutdown);
+    bool anyRunning() const;
+
+    SupervisorOptions options_;
+    WorkerFunction worker_;
+    std::vector<Slot> slots_;
+    sigset_t previousMask_;   // signal mask before run(), restored in workers
+    std::atomic<bool> stopRequested_;
+    std::atomic<size_t> restarts_;
+};
+
+} // namespace messaging_service
@@ -0,0 +1,83 @@
+#include "mock_vendor.h"
+#include <chrono>
+#include <random>
+#include <thread>
+
+namespace messaging_service {
+
+MockVendor::MockVendor(const VendorOptions& options)
+    : options_(options), requestCount_(0), duplicateCount_(0), nextMessageId_(1) {}
+
+void MockVendor::attach(httplib::Server& server) {
+    server.Post("/v1/messages", [this](const httplib::Request& req, httplib::Response& res) {
+        handleSend(req, res);
+    });
+
+    server.Get("/stats", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content("{\"requests\": " + std::to_string(getRequestCount()) +
+                        ", \"duplicates\": " + std::to_string(getDuplicateCount()) +
+                        ", \"connections\": " + std::to_string(getConnectionCount()) + "}",
+                        "application/json");
+    });
+}
+
+uint64_t MockVendor::getRequestCount() const {
+    return requestCount_.load();
+}
+
+uint64_t MockVendor::getDuplicateCount() const {
+    return duplicateCount_.load();
+}
+
+size_t MockVendor::getConnectionCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connections_.size();
+}
+
+void MockVendor::handleSend(const httplib::Request& req, httplib::Response& res) {
+    requestCount_++;
+    std::string key = req.get_header_value("Idempotency-Key");
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_.insert(req.remote_addr + ":" + std::to_string(req.remote_port));
+
+        auto sent = key.empty() ? sentByKey_.end() : sentByKey_.find(key);
+        if (sent != sentByKey_.end()) {
+            duplicateCount_++;
+            res.status = 200;
+            res.set_content("{\"id\": \"" + sent->second + "\", \"status\": \"queued\"}", "application/json");
+            return;
+        }
+    }
+
+    if (options_.latencyMs > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(options_.latencyMs));
+    }
+
+    thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_real_distribution<double> roll(0.0, 1.0);
+    double value = roll(gen);
+
+    if (value < options_.throttleRate) {
+        res.status = 429;
+        res.set_header("Retry-After", "1");
+        res.set_content("{\"error\": \"rate_limited\"}", "application/json");
+        return;
+    }
+    if (value < options_.throttleRate + options_.errorRate) {
+        res.status = 500;
+        res.set_content("{\"error\": \"internal_error\"}", "application/json");
+        return;
+    }
+
+    // Recorded even if the client gave up waiting, as a real vendor would have sent it
+    std::string id = "vendor-" + std::to_string(nextMessageId_++);
+    if (!key.empty()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sentByKey_.emplace(key, id);
+    }
+    res.status = 202;
+    res.set_content("{\"id\": \"" + id + "\", \"status\": \"queued\"}", "application/json");
+}
+
+} // namespace messaging_service
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <httplib.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+namespace messaging_service {
+
+/**
+ * @brief Behaviour of the stand-in vendor API
+ */
+struct VendorOptions {
+    int port = 9090;
+    int latencyMs = 0;         // artificial delay per request
+    double errorRate = 0.0;    // fraction of requests answered with 500
+    double throttleRate = 0.0; // fraction of requests answered with 429
+};
+
+/**
+ * @brief Local stand-in for a Twilio/SendGrid-style vendor API
+ * Serves POST /v1/messages and GET /stats on an httplib::Server, so
+ * HttpMessagingProvider (keep-alive pooling, timeouts, retries and error
+ * handling) can be exercised without calling a real third party. Like real
+ * vendors it answers a repeated Idempotency-Key with the original message id
+ * instead of sending again.
+ */
+class MockVendor {
+public:
+    explicit MockVendor(const VendorOptions& options);
+
+    /**
+     * @brief Register the vendor routes on a server
+     * @param server Server that must outlive its use of this vendor
+     */
+    void attach(httplib::Server& server);
+
+    /**
+     * @brief Requests served on /v1/messages, duplicates included
+     */
+    uint64_t getRequestCount() const;
+
+    /**
+     * @brief Requests answered from an Idempotency-Key seen before
+     */
+    uint64_t getDuplicateCount() const;
+
+    /**
+     * @brief Distinct client address:port pairs, approximating TCP connections opened
+     */
+    size_t getConnectionCount() const;
+
+private:
+    void handleSend(const httplib::Request& req, httplib::Response& res);
+
+    VendorOptions options_;
+    std::atomic<uint64_t> requestCount_;
+    std::atomic<uint64_t> duplicateCount_;
+    std::atomic<uint64_t> nextMessageId_;
+
+    mutable std::mutex mutex_;
+    std::set<std::string> connections_;
+    std::unordered_map<std::string, std::string> sentByKey_;  // Idempotency-Key -> vendor id
+};
+
+} // namespace messaging_service
@@ -0,0 +1,65 @@
+// Local stand-in for a Twilio/SendGrid-style vendor API.
+// Command-line entry point for MockVendor, used to exercise
+// HttpMessagingProvider without calling a real third party.
+#include "mock_vendor.h"
+#include <iostream>
+#include <string>
+
+using messaging_service::MockVendor;
+using messaging_service::VendorOptions;
+
+namespace {
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--port N] [--latency-ms N] [--error-rate F] [--throttle-rate F]" << std::endl;
+}
+
+bool parseOptions(int argc, char* argv[], VendorOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--port") {
+                options.port = std::stoi(value);
+            } else if (arg == "--latency-ms") {
+                options.latencyMs = std::stoi(value);
+            } else if (arg == "--error-rate") {
+                options.errorRate = std::stod(value);
+            } else if (arg == "--throttle-rate") {
+                options.throttleRate = std::stod(value);
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return options.port >= 1 && options.port <= 65535;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    VendorOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    httplib::Server server;
+    MockVendor vendor(options);
+    vendor.attach(server);
+
+    std::cout << "[MOCK VENDOR] Listening on port " << options.port
+              << " (latency " << options.latencyMs << "ms, error rate " << options.errorRate
+              << ", throttle rate " << options.throttleRate << ")" << std::endl;
+
+    if (!server.listen("0.0.0.0", options.port)) {
+        std::cerr << "[MOCK VENDOR] Failed to listen on port " << options.port << std::endl;
+        return 1;
+    }
+    return 0;
+}
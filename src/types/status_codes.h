@@ -8,6 +8,9 @@ enum class StatusCodeType : int {
     ACCEPTED = 202,
     NO_CONTENT = 204,
     
+    // 3xx Redirection
+    NOT_MODIFIED = 304,
+    
     // 4xx Client Error
     BAD_REQUEST = 400,
     UNAUTHORIZED = 401,
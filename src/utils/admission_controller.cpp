@@ -0,0 +1,95 @@
+#include "admission_controller.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace messaging_service {
+
+namespace {
+
+long envMillis(const char* name, long fallback) {
+    const char* value = std::getenv(name);
+    if (!value) {
+        return fallback;
+    }
+    try {
+        return std::max(0L, std::stol(value));
+    } catch (const std::exception&) {
+        return fallback;
+    }
+}
+
+} // namespace
+
+AdmissionConfig AdmissionConfig::fromEnvironment() {
+    AdmissionConfig config;
+    config.target = std::chrono::milliseconds(envMillis("ADMISSION_TARGET_MS", config.target.count()));
+    config.interval = std::chrono::milliseconds(envMillis("ADMISSION_INTERVAL_MS", config.interval.count()));
+    return config;
+}
+
+AdmissionController::AdmissionController(const AdmissionConfig& config)
+    : targetNs_(std::chrono::duration_cast<std::chrono::nanoseconds>(config.target).count()),
+      intervalNs_(std::chrono::duration_cast<std::chrono::nanoseconds>(config.interval).count()),
+      firstAboveNs_(0), lastSampleNs_(0), overloaded_(false), rejected_(0),
+      rejectedCounter_(&MetricsRegistry::instance().counter("admission_rejected_total",
+                                                            "Requests shed because queue delay stayed above target")) {
+}
+
+AdmissionController& AdmissionController::instance() {
+    static AdmissionController controller(AdmissionConfig::fromEnvironment());
+    return controller;
+}
+
+void AdmissionController::recordSojourn(Clock::duration sojourn, Clock::time_point now) {
+    if (targetNs_ <= 0) {
+        return;
+    }
+    int64_t nowNs = toNanos(now);
+    lastSampleNs_.store(nowNs, std::memory_order_relaxed);
+
+    if (std::chrono::duration_cast<std::chrono::nanoseconds>(sojourn).count() < targetNs_) {
+        // The queue drained to below target at least once, so it is not standing
+        firstAboveNs_.store(0, std::memory_order_relaxed);
+        if (overloaded_.exchange(false, std::memory_order_relaxed)) {
+            LOG_INFO("admission", "Queue delay back below target, admitting all requests");
+        }
+        return;
+    }
+
+    int64_t firstAbove = firstAboveNs_.load(std::memory_order_relaxed);
+    if (firstAbove == 0) {
+        firstAboveNs_.compare_exchange_strong(firstAbove, nowNs + intervalNs_, std::memory_order_relaxed);
+    } else if (nowNs >= firstAbove && !overloaded_.exchange(true, std::memory_order_relaxed)) {
+        LOG_WARN("admission", "Queue delay above target for a full interval, shedding low priority requests",
+                 {{"target_ms", targetNs_ / 1000000}, {"sojourn_ms",
+                  std::chrono::duration_cast<std::chrono::milliseconds>(sojourn).count()}});
+    }
+}
+
+bool AdmissionController::admit(AdmissionPriority priority, Clock::time_point now) {
+    if (priority == AdmissionPriority::High || !isOverloaded(now)) {
+        return true;
+    }
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    rejectedCounter_->inc();
+    return false;
+}
+
+bool AdmissionController::isOverloaded(Clock::time_point now) const {
+    if (!overloaded_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    return toNanos(now) - lastSampleNs_.load(std::memory_order_relaxed) < intervalNs_;
+}
+
+uint64_t AdmissionController::getRejectedCount() const {
+    return rejected_.load(std::memory_order_relaxed);
+}
+
+int64_t AdmissionController::toNanos(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace messaging_service
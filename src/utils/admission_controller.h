@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace messaging_service {
+
+class Counter;
+
+/**
+ * @brief Configuration for AdmissionController
+ */
+struct AdmissionConfig {
+    std::chrono::milliseconds target{20};     // acceptable standing queue delay; 0 disables shedding
+    std::chrono::milliseconds interval{100};  // how long delay must stay above target
+
+    /**
+     * @brief Build a config from ADMISSION_TARGET_MS and ADMISSION_INTERVAL_MS
+     */
+    static AdmissionConfig fromEnvironment();
+};
+
+/**
+ * @brief Whether a request may be shed under load
+ */
+enum class AdmissionPriority {
+    High,   // always admitted, e.g. carrier webhooks that would otherwise be retried in bursts
+    Low     // rejected while the server is overloaded
+};
+
+/**
+ * @brief CoDel-style load shedding driven by queue sojourn times
+ *
+ * Queues in front of shared resources (the worker pool, the database pool)
+ * report how long each item waited. A short burst raises some waits but the
+ * queue soon empties again; a standing queue keeps even the shortest wait
+ * high. So, as in CoDel, the server counts as overloaded once every wait
+ * reported over a whole interval exceeded the target, i.e. the minimum delay
+ * over the interval is above target, and recovers with the first wait below
+ * target. While overloaded, low-priority requests are rejected up front
+ * rather than joining the queue, which keeps the delay of admitted work, and
+ * so tail latency, bounded.
+ */
+class AdmissionController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit AdmissionController(const AdmissionConfig& config = AdmissionConfig());
+
+    /**
+     * @brief Process-wide controller, configured from the environment
+     */
+    static AdmissionController& instance();
+
+    /**
+     * @brief Report how long an item waited in a queue before being served
+     * @param sojourn Time the item spent queued
+     * @param now Time it left the queue
+     */
+    void recordSojourn(Clock::duration sojourn, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Decide whether to accept new work
+     * @param priority Priority of the work
+     * @param now Current time
+     * @return false if the work should be rejected with 503
+     */
+    bool admit(AdmissionPriority priority, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief true while queue delay has stayed above target for an interval
+     * Ends on its own when no waits have been reported for an interval, since
+     * an idle queue has no delay.
+     */
+    bool isOverloaded(Clock::time_point now = Clock::now()) const;
+
+    /**
+     * @brief Number of requests rejected by admit()
+     */
+    uint64_t getRejectedCount() const;
+
+private:
+    static int64_t toNanos(Clock::time_point time);
+
+    int64_t targetNs_;
+    int64_t intervalNs_;
+
+    // Time the current run of over-target waits must last until; 0 when the last wait was below target
+    std::atomic<int64_t> firstAboveNs_;
+    std::atomic<int64_t> lastSampleNs_;
+    std::atomic<bool> overloaded_;
+    std::atomic<uint64_t> rejected_;
+
+    Counter* rejectedCounter_;
+};
+
+} // namespace messaging_service
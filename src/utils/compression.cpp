@@ -0,0 +1,156 @@
+#include "compression.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <zlib.h>
+#ifdef CPPHTTPLIB_ZSTD_SUPPORT
+#include <zstd.h>
+#endif
+
+namespace messaging_service {
+
+namespace {
+
+// Level 6 is zlib's default; higher levels cost far more CPU for little gain on JSON
+constexpr int kGzipLevel = 6;
+constexpr int kZstdLevel = 3;
+
+std::string trimmed(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+bool gzipCompress(const std::string& input, std::string& output) {
+    z_stream stream = {};
+    // 15 window bits plus 16 selects the gzip wrapper rather than raw zlib
+    if (deflateInit2(&stream, kGzipLevel, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    output.resize(deflateBound(&stream, input.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+    stream.avail_out = static_cast<uInt>(output.size());
+
+    int result = deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
+
+#ifdef CPPHTTPLIB_ZSTD_SUPPORT
+bool zstdCompress(const std::string& input, std::string& output) {
+    output.resize(ZSTD_compressBound(input.size()));
+    size_t size = ZSTD_compress(&output[0], output.size(), input.data(), input.size(), kZstdLevel);
+    if (ZSTD_isError(size)) {
+        return false;
+    }
+    output.resize(size);
+    return true;
+}
+#endif
+
+} // namespace
+
+const char* contentEncodingName(ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::Gzip: return "gzip";
+        case ContentEncoding::Zstd: return "zstd";
+        case ContentEncoding::Identity: break;
+    }
+    return "identity";
+}
+
+bool isEncodingAvailable(ContentEncoding encoding) {
+#ifdef CPPHTTPLIB_ZSTD_SUPPORT
+    (void)encoding;
+    return true;
+#else
+    return encoding != ContentEncoding::Zstd;
+#endif
+}
+
+ContentEncoding negotiateEncoding(const std::string& acceptEncoding) {
+    // Preference for each coding; -1 when the header does not mention it
+    double gzip = -1;
+    double zstd = -1;
+    double wildcard = -1;
+
+    std::stringstream codings(acceptEncoding);
+    std::string coding;
+    while (std::getline(codings, coding, ',')) {
+        std::string name = coding;
+        double quality = 1.0;
+        size_t semicolon = coding.find(';');
+        if (semicolon != std::string::npos) {
+            name = coding.substr(0, semicolon);
+            std::string parameter = lowercase(trimmed(coding.substr(semicolon + 1)));
+            if (parameter.compare(0, 2, "q=") == 0) {
+                quality = std::strtod(parameter.c_str() + 2, nullptr);
+            }
+        }
+        name = lowercase(trimmed(name));
+        if (name == "gzip" || name == "x-gzip") {
+            gzip = quality;
+        } else if (name == "zstd") {
+            zstd = quality;
+        } else if (name == "*") {
+            wildcard = quality;
+        }
+    }
+
+    if (gzip < 0) {
+        gzip = wildcard;
+    }
+    if (zstd < 0) {
+        zstd = wildcard;
+    }
+    if (!isEncodingAvailable(ContentEncoding::Zstd)) {
+        zstd = 0;
+    }
+
+    if (zstd > 0 && zstd >= gzip) {
+        return ContentEncoding::Zstd;
+    }
+    if (gzip > 0) {
+        return ContentEncoding::Gzip;
+    }
+    return ContentEncoding::Identity;
+}
+
+bool isCompressibleType(const std::string& contentType) {
+    std::string type = lowercase(trimmed(contentType.substr(0, contentType.find(';'))));
+    if (type == "text/event-stream") {
+        return false;
+    }
+    return type.compare(0, 5, "text/") == 0 || type == "application/json" || type == "application/xml" ||
+           type == "application/javascript";
+}
+
+bool compressBody(const std::string& input, ContentEncoding encoding, std::string& output) {
+    switch (encoding) {
+        case ContentEncoding::Gzip:
+            return gzipCompress(input, output);
+        case ContentEncoding::Zstd:
+#ifdef CPPHTTPLIB_ZSTD_SUPPORT
+            return zstdCompress(input, output);
+#else
+            return false;
+#endif
+        case ContentEncoding::Identity:
+            break;
+    }
+    return false;
+}
+
+} // namespace messaging_service
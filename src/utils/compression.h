@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace messaging_service {
+
+/**
+ * @brief Content codings the server can produce
+ *
+ * zstd is only available when built against libzstd, which defines
+ * CPPHTTPLIB_ZSTD_SUPPORT.
+ */
+enum class ContentEncoding {
+    Identity,
+    Gzip,
+    Zstd
+};
+
+constexpr size_t kContentEncodingCount = 3;
+
+/**
+ * @brief Name used in Content-Encoding and Accept-Encoding, e.g. "gzip"
+ */
+const char* contentEncodingName(ContentEncoding encoding);
+
+/**
+ * @brief Whether this build can produce the encoding
+ */
+bool isEncodingAvailable(ContentEncoding encoding);
+
+/**
+ * @brief Pick the best available encoding the client accepts
+ *
+ * Honours q-values, including q=0 to refuse a coding, and "*". Between
+ * codings of equal preference zstd is chosen over gzip. An empty header
+ * means no compression.
+ * @param acceptEncoding Value of the Accept-Encoding request header
+ */
+ContentEncoding negotiateEncoding(const std::string& acceptEncoding);
+
+/**
+ * @brief Whether a response of this Content-Type is worth compressing
+ * True for text, JSON and XML; false for event streams, which are flushed per event.
+ */
+bool isCompressibleType(const std::string& contentType);
+
+/**
+ * @brief Compress a whole body
+ * @param input Uncompressed body
+ * @param encoding Gzip, or Zstd when available
+ * @param output Receives the compressed body
+ * @return false if the encoding is unavailable or compression failed
+ */
+bool compressBody(const std::string& input, ContentEncoding encoding, std::string& output);
+
+} // namespace messaging_service
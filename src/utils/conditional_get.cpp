@@ -0,0 +1,63 @@
+#include "conditional_get.h"
+#include <ctime>
+#include <sstream>
+
+namespace messaging_service {
+
+namespace {
+
+std::string trimmed(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(begin, end - begin + 1);
+}
+
+// Weak comparison ignores the W/ prefix on either side
+std::string opaqueTag(const std::string& tag) {
+    return tag.compare(0, 2, "W/") == 0 ? tag.substr(2) : tag;
+}
+
+// Parses an IMF-fixdate such as "Sun, 06 Nov 1994 08:49:37 GMT"
+bool parseHttpDate(const std::string& text, time_t& time) {
+    std::tm parts = {};
+    const char* end = strptime(text.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &parts);
+    if (!end || *end != '\0') {
+        return false;
+    }
+    time = timegm(&parts);
+    return true;
+}
+
+} // namespace
+
+std::string makeEntityTag(const std::string& token) {
+    return "W/\"" + token + "\"";
+}
+
+bool isNotModified(const std::string& ifNoneMatch, const std::string& ifModifiedSince,
+                   const std::string& etag, const std::string& lastModified) {
+    if (!trimmed(ifNoneMatch).empty()) {
+        std::stringstream tags(ifNoneMatch);
+        std::string tag;
+        while (std::getline(tags, tag, ',')) {
+            tag = trimmed(tag);
+            if (tag == "*" || (!etag.empty() && opaqueTag(tag) == opaqueTag(etag))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    time_t since;
+    time_t modified;
+    if (ifModifiedSince.empty() || !parseHttpDate(trimmed(ifModifiedSince), since) ||
+        !parseHttpDate(lastModified, modified)) {
+        return false;
+    }
+    return modified <= since;
+}
+
+} // namespace messaging_service
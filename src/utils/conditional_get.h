@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+namespace messaging_service {
+
+/**
+ * @brief Build a weak entity tag from a version token
+ * Tags are weak because a compressed and an uncompressed response share one.
+ * @param token Opaque token that changes whenever the resource does
+ * @return The tag, e.g. W/"12.3"
+ */
+std::string makeEntityTag(const std::string& token);
+
+/**
+ * @brief Decide whether a conditional GET can be answered with 304 Not Modified
+ *
+ * As in RFC 9110, If-None-Match is compared with weak comparison and, when
+ * present, If-Modified-Since is ignored. Either header may be empty.
+ * @param ifNoneMatch Value of the If-None-Match request header
+ * @param ifModifiedSince Value of the If-Modified-Since request header
+ * @param etag Current entity tag of the resource
+ * @param lastModified Current Last-Modified HTTP-date of the resource, or empty
+ * @return true if the client's copy is current
+ */
+bool isNotModified(const std::string& ifNoneMatch, const std::string& ifModifiedSince,
+                   const std::string& etag, const std::string& lastModified);
+
+} // namespace messaging_service
@@ -0,0 +1,117 @@
+#include "duplicate_filter.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace messaging_service {
+
+namespace {
+
+uint64_t mix(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+} // namespace
+
+DuplicateFilter::DuplicateFilter(size_t capacity, std::chrono::seconds ttl, double falsePositiveRate)
+    : capacity_(std::max<size_t>(capacity, 1)), ttl_(ttl), currentStarted_(Clock::now()) {
+    // Optimal sizing: m = -n ln p / (ln 2)^2 bits and k = (m / n) ln 2 hash functions
+    double ln2 = std::log(2.0);
+    double bits = -static_cast<double>(capacity_) * std::log(falsePositiveRate) / (ln2 * ln2);
+    bitCount_ = std::max<size_t>(64, static_cast<size_t>(std::ceil(bits)));
+    hashCount_ = std::max<size_t>(1, static_cast<size_t>(std::lround(bits / capacity_ * ln2)));
+    current_.words.assign((bitCount_ + 63) / 64, 0);
+    previous_.words.assign(current_.words.size(), 0);
+}
+
+DuplicateFilter& DuplicateFilter::instance() {
+    static DuplicateFilter filter;
+    static uint64_t sizeGauge = MetricsRegistry::instance().addGaugeCallback("webhook_duplicate_filter_bytes",
+        "Memory held by the inbound webhook duplicate filter", {},
+        [] { return static_cast<double>(filter.getSizeBytes()); });
+    (void)sizeGauge;
+    return filter;
+}
+
+bool DuplicateFilter::contains(const std::string& key, Clock::time_point now) {
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    hash(key, h1, h2);
+    std::lock_guard<std::mutex> lock(mutex_);
+    rotateIfDue(now);
+    return test(current_, h1, h2) || test(previous_, h1, h2);
+}
+
+void DuplicateFilter::add(const std::string& key, Clock::time_point now) {
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    hash(key, h1, h2);
+    std::lock_guard<std::mutex> lock(mutex_);
+    rotateIfDue(now);
+    if (test(current_, h1, h2)) {
+        return;
+    }
+    // Double hashing: bit i is h1 + i * h2
+    for (size_t i = 0; i < hashCount_; i++) {
+        uint64_t bit = (h1 + i * h2) % bitCount_;
+        current_.words[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+    current_.count++;
+}
+
+void DuplicateFilter::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::fill(current_.words.begin(), current_.words.end(), 0);
+    std::fill(previous_.words.begin(), previous_.words.end(), 0);
+    current_.count = 0;
+    previous_.count = 0;
+}
+
+size_t DuplicateFilter::getSizeBytes() const {
+    return (current_.words.size() + previous_.words.size()) * sizeof(uint64_t);
+}
+
+void DuplicateFilter::rotateIfDue(Clock::time_point now) {
+    auto age = now - currentStarted_;
+    if (age < ttl_ && current_.count < capacity_) {
+        return;
+    }
+    // Nothing was added for at least ttl, so every key in either generation is old enough to forget
+    if (age >= 2 * ttl_) {
+        std::fill(previous_.words.begin(), previous_.words.end(), 0);
+        previous_.count = 0;
+    } else {
+        std::swap(previous_, current_);
+    }
+    std::fill(current_.words.begin(), current_.words.end(), 0);
+    current_.count = 0;
+    currentStarted_ = now;
+}
+
+bool DuplicateFilter::test(const Generation& generation, uint64_t h1, uint64_t h2) const {
+    if (generation.count == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < hashCount_; i++) {
+        uint64_t bit = (h1 + i * h2) % bitCount_;
+        if (!(generation.words[bit / 64] & (uint64_t(1) << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DuplicateFilter::hash(const std::string& key, uint64_t& h1, uint64_t& h2) {
+    // FNV-1a, then two independent mixes; a zero step would set the same bit k times
+    uint64_t value = 0xcbf29ce484222325ULL;
+    for (unsigned char c : key) {
+        value = (value ^ c) * 0x100000001b3ULL;
+    }
+    h1 = mix(value);
+    h2 = mix(value ^ 0x6a09e667f3bcc909ULL) | 1;
+}
+
+} // namespace messaging_service
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace messaging_service {
+
+/**
+ * @brief Bloom filter of recently seen keys that forgets them after a TTL
+ *
+ * Keys go into the current generation. Once it is ttl old, or holds its
+ * capacity, it becomes the previous generation and a fresh one starts, so
+ * a key is remembered for between ttl and twice ttl (less only if more than
+ * capacity keys arrive within ttl). contains() never misses a remembered
+ * key and wrongly reports an unseen one with about falsePositiveRate
+ * probability per generation checked.
+ *
+ * Used in front of the webhook receipts table: a redelivered webhook is
+ * answered from memory, and anything the filter does not know is left to
+ * the database's unique index.
+ */
+class DuplicateFilter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param capacity Keys per generation the false positive rate is sized for
+     * @param ttl Minimum time a key is remembered
+     * @param falsePositiveRate Target chance that an unseen key is reported as seen
+     */
+    explicit DuplicateFilter(size_t capacity = 1000000, std::chrono::seconds ttl = std::chrono::hours(24),
+                             double falsePositiveRate = 1e-9);
+
+    /**
+     * @brief Process-wide filter for inbound webhook provider ids
+     */
+    static DuplicateFilter& instance();
+
+    /**
+     * @brief Whether the key was added within the TTL
+     */
+    bool contains(const std::string& key, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Remember a key
+     */
+    void add(const std::string& key, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Forget every key
+     */
+    void clear();
+
+    size_t getHashCount() const { return hashCount_; }
+    size_t getSizeBytes() const;
+
+private:
+    struct Generation {
+        std::vector<uint64_t> words;
+        size_t count = 0;
+    };
+
+    // Start a new generation once the current one is full or ttl old; expects mutex_ held
+    void rotateIfDue(Clock::time_point now);
+    bool test(const Generation& generation, uint64_t h1, uint64_t h2) const;
+
+    static void hash(const std::string& key, uint64_t& h1, uint64_t& h2);
+
+    const size_t capacity_;
+    const std::chrono::seconds ttl_;
+    size_t bitCount_;
+    size_t hashCount_;
+
+    mutable std::mutex mutex_;
+    Generation current_;
+    Generation previous_;
+    Clock::time_point currentStarted_;
+};
+
+} // namespace messaging_service
@@ -0,0 +1,146 @@
+#include "fair_queue.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace messaging_service {
+
+namespace {
+
+long envLong(const char* name, long fallback) {
+    const char* value = std::getenv(name);
+    if (!value) {
+        return fallback;
+    }
+    try {
+        return std::stol(value);
+    } catch (const std::exception&) {
+        return fallback;
+    }
+}
+
+} // namespace
+
+FairQueueConfig FairQueueConfig::fromEnvironment() {
+    FairQueueConfig config;
+    config.maxInFlight = static_cast<size_t>(std::max(1L, envLong("TENANT_MAX_IN_FLIGHT", config.maxInFlight)));
+    config.maxQueuedPerTenant = static_cast<size_t>(std::max(0L, envLong("TENANT_MAX_QUEUED", config.maxQueuedPerTenant)));
+    config.defaultWeight = static_cast<unsigned>(std::max(1L, envLong("TENANT_DEFAULT_WEIGHT", config.defaultWeight)));
+
+    if (const char* weights = std::getenv("TENANT_WEIGHTS")) {
+        std::stringstream entries(weights);
+        std::string entry;
+        while (std::getline(entries, entry, ',')) {
+            size_t equals = entry.rfind('=');
+            if (equals == std::string::npos || equals == 0) {
+                LOG_WARN("fair_queue", "Ignoring malformed tenant weight", {{"entry", entry}});
+                continue;
+            }
+            try {
+                long weight = std::stol(entry.substr(equals + 1));
+                if (weight > 0) {
+                    config.weights[entry.substr(0, equals)] = static_cast<unsigned>(weight);
+                    continue;
+                }
+            } catch (const std::exception&) {
+            }
+            LOG_WARN("fair_queue", "Ignoring malformed tenant weight", {{"entry", entry}});
+        }
+    }
+    return config;
+}
+
+FairQueue::FairQueue(const FairQueueConfig& config)
+    : config_(config), queued_(0), inFlight_(0) {
+    config_.maxInFlight = std::max<size_t>(1, config_.maxInFlight);
+    config_.defaultWeight = std::max(1u, config_.defaultWeight);
+}
+
+bool FairQueue::enqueue(const std::string& tenant, Task start) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = tenants_.find(tenant);
+        if (it == tenants_.end()) {
+            auto entry = std::make_unique<Tenant>();
+            entry->name = tenant;
+            auto weight = config_.weights.find(tenant);
+            entry->quantum = weight != config_.weights.end() ? std::max(1u, weight->second) : config_.defaultWeight;
+            ring_.push_back(entry.get());
+            it = tenants_.emplace(tenant, std::move(entry)).first;
+        } else if (config_.maxQueuedPerTenant > 0 && it->second->tasks.size() >= config_.maxQueuedPerTenant) {
+            return false;
+        }
+        it->second->tasks.push_back(std::move(start));
+        queued_++;
+    }
+    pump();
+    return true;
+}
+
+void FairQueue::complete() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (inFlight_ > 0) {
+            inFlight_--;
+        }
+    }
+    pump();
+}
+
+size_t FairQueue::getQueuedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_;
+}
+
+size_t FairQueue::getActiveTenantCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tenants_.size();
+}
+
+size_t FairQueue::getInFlightCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inFlight_;
+}
+
+void FairQueue::pump() {
+    while (true) {
+        Task next;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (inFlight_ >= config_.maxInFlight || ring_.empty()) {
+                return;
+            }
+            next = dequeueLocked();
+            inFlight_++;
+        }
+        // A start that fails calls complete() itself, which re-enters pump() without the lock held
+        next();
+    }
+}
+
+FairQueue::Task FairQueue::dequeueLocked() {
+    Tenant& tenant = *ring_.front();
+
+    // A tenant reaching the head with no credit left gets this visit's quantum (>= 1)
+    if (tenant.deficit < 1) {
+        tenant.deficit += tenant.quantum;
+    }
+    Task task = std::move(tenant.tasks.front());
+    tenant.tasks.pop_front();
+    tenant.deficit--;
+    queued_--;
+
+    if (tenant.tasks.empty()) {
+        // Leaving the ring forfeits unspent credit, as in DRR
+        ring_.pop_front();
+        tenants_.erase(tenant.name);
+    } else if (tenant.deficit < 1) {
+        // Visit over; go to the back of the round
+        ring_.pop_front();
+        ring_.push_back(&tenant);
+    }
+    return task;
+}
+
+} // namespace messaging_service
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace messaging_service {
+
+/**
+ * @brief Configuration for FairQueue
+ */
+struct FairQueueConfig {
+    size_t maxInFlight = 10;          // tasks started and not yet completed
+    size_t maxQueuedPerTenant = 4;    // enqueue fails beyond this; 0 is unbounded
+    unsigned defaultWeight = 1;
+    std::unordered_map<std::string, unsigned> weights;   // per tenant, overriding defaultWeight
+
+    /**
+     * @brief Build a config from TENANT_* environment variables
+     * TENANT_WEIGHTS is a comma separated list of tenant=weight pairs, e.g.
+     * "acme=4,+15550001=2". TENANT_MAX_IN_FLIGHT, TENANT_MAX_QUEUED and
+     * TENANT_DEFAULT_WEIGHT set the other fields.
+     */
+    static FairQueueConfig fromEnvironment();
+};
+
+/**
+ * @brief Deficit round robin queue that shares a concurrency limit between tenants
+ *
+ * Each tenant with queued work sits in a round-robin ring and is credited
+ * its weight in sends per visit, so a tenant flooding the queue only delays
+ * its own backlog while tenants with a send or two still go out on the next
+ * round. Every send costs one credit, so the tenant at the head of the ring
+ * can always send after at most one top-up, which keeps enqueue and dequeue
+ * O(1) however many tenants are queued. A tenant's entry is dropped as soon
+ * as its queue empties, so idle tenants cost nothing.
+ *
+ * Callers wait on an HTTP thread while their task is queued, so each tenant
+ * may only have a few tasks waiting (maxQueuedPerTenant) and is refused
+ * beyond that: a flooding tenant then holds at most its queued tasks plus the
+ * in-flight slots, and the remaining HTTP threads stay free for other tenants.
+ *
+ * At most maxInFlight tasks run at once. Started tasks must call complete()
+ * exactly once when they finish, which starts the next task in turn. Tasks
+ * are started on the thread that called enqueue() or complete(), outside the
+ * queue lock, so a start function should only hand the work off.
+ */
+class FairQueue {
+public:
+    using Task = std::function<void()>;
+
+    explicit FairQueue(const FairQueueConfig& config = FairQueueConfig());
+
+    /**
+     * @brief Queue a task behind the tenant's earlier tasks
+     * @param tenant Tenant the task is charged to
+     * @param start Function that starts the task; runs when it is the tenant's turn and a slot is free
+     * @return false if the tenant already has maxQueuedPerTenant tasks queued
+     */
+    bool enqueue(const std::string& tenant, Task start);
+
+    /**
+     * @brief Mark a started task as finished and start the next one, if any
+     */
+    void complete();
+
+    /**
+     * @brief Number of tasks waiting to start
+     */
+    size_t getQueuedCount() const;
+
+    /**
+     * @brief Number of tenants with tasks waiting to start
+     */
+    size_t getActiveTenantCount() const;
+
+    /**
+     * @brief Number of started tasks that have not completed
+     */
+    size_t getInFlightCount() const;
+
+private:
+    struct Tenant {
+        std::string name;
+        std::deque<Task> tasks;
+        int64_t quantum = 1;    // credit added per visit, the tenant's weight
+        int64_t deficit = 0;    // unspent credit from this visit
+    };
+
+    // Start queued tasks while slots are free
+    void pump();
+
+    // Take the next task in round-robin order; expects mutex_ held and a non-empty ring
+    Task dequeueLocked();
+
+    FairQueueConfig config_;
+
+    mutable std::mutex mutex_;
+    // Only tenants with queued tasks. Held by pointer so ring entries stay
+    // valid when the map rehashes as tenants come and go.
+    std::unordered_map<std::string, std::unique_ptr<Tenant>> tenants_;
+    std::deque<Tenant*> ring_;
+    size_t queued_;
+    size_t inFlight_;
+};
+
+} // namespace messaging_service
@@ -0,0 +1,147 @@
+#include "id_generator.h"
+#include <chrono>
+#include <charconv>
+#include <cstdlib>
+
+namespace messaging_service {
+
+namespace {
+
+constexpr char kBase32Alphabet[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+
+uint64_t currentMs() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+}
+
+int decodeBase32Char(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+    // Crockford aliases
+    if (c == 'O') return 0;
+    if (c == 'I' || c == 'L') return 1;
+    for (int i = 10; i < 32; ++i) {
+        if (kBase32Alphabet[i] == c) return i;
+    }
+    return -1;
+}
+
+} // namespace
+
+IdGenerator::IdGenerator(uint16_t nodeId)
+    : nodeId_(static_cast<uint16_t>(nodeId & kMaxNodeId)) {}
+
+IdGenerator& IdGenerator::instance() {
+    static IdGenerator generator([] {
+        const char* node = std::getenv("NODE_ID");
+        return node ? static_cast<uint16_t>(std::strtoul(node, nullptr, 10)) : static_cast<uint16_t>(0);
+    }());
+    return generator;
+}
+
+uint64_t IdGenerator::next() {
+    constexpr uint64_t sequenceMask = (1ULL << kSequenceBits) - 1;
+    constexpr uint64_t timestampMask = (1ULL << kTimestampBits) - 1;
+
+    size_t slot = threadSlot();
+    std::atomic<uint64_t>& state = slots_[slot].state;
+
+    uint64_t now = currentMs() - kEpochMs;
+    uint64_t current = state.load(std::memory_order_relaxed);
+    uint64_t updated;
+    do {
+        uint64_t lastMs = current >> kSequenceBits;
+        uint64_t sequence = current & sequenceMask;
+        if (now > lastMs) {
+            updated = now << kSequenceBits;
+        } else if (sequence < sequenceMask) {
+            // Same millisecond, or the clock stepped backwards: stay monotonic
+            updated = current + 1;
+        } else {
+            // Sequence exhausted for this millisecond: borrow the next one
+            updated = (lastMs + 1) << kSequenceBits;
+        }
+    } while (!state.compare_exchange_weak(current, updated, std::memory_order_relaxed));
+
+    uint64_t timestamp = (updated >> kSequenceBits) & timestampMask;
+    uint64_t sequence = updated & sequenceMask;
+    uint64_t node = nodeId_.load(std::memory_order_relaxed);
+
+    return (timestamp << (kNodeBits + kSlotBits + kSequenceBits)) |
+           (node << (kSlotBits + kSequenceBits)) |
+           (static_cast<uint64_t>(slot) << kSequenceBits) |
+           sequence;
+}
+
+std::string IdGenerator::nextBase32() {
+    return toBase32(next());
+}
+
+void IdGenerator::setNodeId(uint16_t nodeId) {
+    nodeId_.store(static_cast<uint16_t>(nodeId & kMaxNodeId), std::memory_order_relaxed);
+}
+
+uint16_t IdGenerator::getNodeId() const {
+    return nodeId_.load(std::memory_order_relaxed);
+}
+
+bool IdGenerator::workerNodeId(uint32_t nodeId, size_t workers, size_t index, uint16_t& workerNodeId) {
+    if (workers == 0 || index >= workers ||
+        static_cast<uint64_t>(nodeId) * workers + workers - 1 > kMaxNodeId) {
+        return false;
+    }
+    workerNodeId = static_cast<uint16_t>(nodeId * workers + index);
+    return true;
+}
+
+void IdGenerator::encodeBase32(uint64_t id, char* out) {
+    // 13 digits of 5 bits cover 65 bits; the first digit carries the top 4
+    for (size_t i = kBase32Length; i-- > 0;) {
+        out[i] = kBase32Alphabet[id & 0x1f];
+        id >>= 5;
+    }
+}
+
+std::string IdGenerator::toBase32(uint64_t id) {
+    char buffer[kBase32Length];
+    encodeBase32(id, buffer);
+    return std::string(buffer, kBase32Length);
+}
+
+bool IdGenerator::fromBase32(const std::string& text, uint64_t& id) {
+    if (text.length() != kBase32Length) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < text.length(); ++i) {
+        int digit = decodeBase32Char(text[i]);
+        if (digit < 0 || (i == 0 && digit > 0x0f)) {
+            return false;
+        }
+        value = (value << 5) | static_cast<uint64_t>(digit);
+    }
+    id = value;
+    return true;
+}
+
+std::string IdGenerator::toDecimal(uint64_t id) {
+    char buffer[20];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), id);
+    return std::string(buffer, result.ptr);
+}
+
+uint64_t IdGenerator::timestampMs(uint64_t id) {
+    return (id >> (kNodeBits + kSlotBits + kSequenceBits)) + kEpochMs;
+}
+
+uint16_t IdGenerator::nodeId(uint64_t id) {
+    return static_cast<uint16_t>((id >> (kSlotBits + kSequenceBits)) & kMaxNodeId);
+}
+
+size_t IdGenerator::threadSlot() {
+    static std::atomic<size_t> nextSlot{0};
+    thread_local size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % kSlotCount;
+    return slot;
+}
+
+} // namespace messaging_service
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace messaging_service {
+
+/**
+ * @brief Lock-free Snowflake-style 64-bit ID generator
+ *
+ * Layout (most significant first):
+ *   1 bit unused | 41 bits milliseconds since 2024-01-01 | 10 bits node id |
+ *   4 bits thread slot | 8 bits sequence
+ *
+ * Each thread is pinned to one of 16 slots and advances that slot's
+ * (timestamp, sequence) pair with a single CAS, so threads on different slots
+ * never contend and no locks or iostreams are involved. When a slot's 256
+ * sequence values for the current millisecond are used up, it borrows the
+ * next millisecond instead of spinning. IDs are unique per node and roughly
+ * time-ordered.
+ */
+class IdGenerator {
+public:
+    static constexpr int kTimestampBits = 41;
+    static constexpr int kNodeBits = 10;
+    static constexpr int kSlotBits = 4;
+    static constexpr int kSequenceBits = 8;
+    static constexpr uint16_t kMaxNodeId = (1u << kNodeBits) - 1;
+
+    // 2024-01-01T00:00:00Z in milliseconds since the Unix epoch
+    static constexpr uint64_t kEpochMs = 1704067200000ULL;
+
+    // Length of a base32-encoded ID
+    static constexpr size_t kBase32Length = 13;
+
+    /**
+     * @brief Constructor
+     * @param nodeId Node identifier embedded in every ID (masked to 10 bits)
+     */
+    explicit IdGenerator(uint16_t nodeId = 0);
+
+    /**
+     * @brief Process-wide generator; node id comes from the NODE_ID environment variable
+     */
+    static IdGenerator& instance();
+
+    /**
+     * @brief Generate the next unique ID
+     * @return 64-bit ID
+     */
+    uint64_t next();
+
+    /**
+     * @brief Generate the next ID encoded as base32
+     * @return 13-character Crockford base32 string
+     */
+    std::string nextBase32();
+
+    /**
+     * @brief Change the node id embedded in subsequently generated IDs
+     * @param nodeId New node identifier (masked to 10 bits)
+     */
+    void setNodeId(uint16_t nodeId);
+
+    /**
+     * @brief Get the node id embedded in generated IDs
+     */
+    uint16_t getNodeId() const;
+
+    /**
+     * @brief Node id for one of the worker processes of an instance
+     *
+     * An instance running N workers owns node ids NODE_ID * N through
+     * NODE_ID * N + N - 1, so instances with different NODE_IDs and the same
+     * worker count never share a node id, in message ids or in claimed
+     * scheduled sends.
+     * @param nodeId The instance's NODE_ID
+     * @param workers Worker processes the instance runs
+     * @param index This worker's index, below workers
+     * @param workerNodeId Receives the worker's node id
+     * @return false if the instance's node ids do not fit in kNodeBits
+     */
+    static bool workerNodeId(uint32_t nodeId, size_t workers, size_t index, uint16_t& workerNodeId);
+
+    /**
+     * @brief Encode an ID as fixed-width Crockford base32 (lexicographic order == numeric order)
+     * @param id The ID to encode
+     * @param out Buffer of at least kBase32Length characters (not null-terminated)
+     */
+    static void encodeBase32(uint64_t id, char* out);
+
+    /**
+     * @brief Encode an ID as a base32 string
+     */
+    static std::string toBase32(uint64_t id);
+
+    /**
+     * @brief Decode a base32 ID produced by encodeBase32
+     * @param text The encoded ID
+     * @param id Receives the decoded value
+     * @return true if text was a valid encoding
+     */
+    static bool fromBase32(const std::string& text, uint64_t& id);
+
+    /**
+     * @brief Encode an ID in decimal without iostreams
+     */
+    static std::string toDecimal(uint64_t id);
+
+    /**
+     * @brief Extract the Unix timestamp in milliseconds from an ID
+     */
+    static uint64_t timestampMs(uint64_t id);
+
+    /**
+     * @brief Extract the node id from an ID
+     */
+    static uint16_t nodeId(uint64_t id);
+
+private:
+    static constexpr size_t kSlotCount = 1u << kSlotBits;
+
+    struct alignas(64) Slot {
+        // (milliseconds since kEpochMs << kSequenceBits) | sequence
+        std::atomic<uint64_t> state{0};
+    };
+
+    /**
+     * @brief Slot index for the calling thread
+     */
+    static size_t threadSlot();
+
+    Slot slots_[kSlotCount];
+    std::atomic<uint16_t> nodeId_;
+};
+
+} // namespace messaging_service
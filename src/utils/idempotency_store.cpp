@@ -0,0 +1,134 @@
+#include "idempotency_store.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+namespace messaging_service {
+
+IdempotencyStore::IdempotencyStore(size_t maxEntries, std::chrono::seconds ttl, size_t shardCount)
+    : maxEntriesPerShard_(std::max<size_t>(1, maxEntries / std::max<size_t>(1, shardCount))), ttl_(ttl) {
+    for (size_t i = 0; i < std::max<size_t>(1, shardCount); i++) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+IdempotencyStore& IdempotencyStore::instance() {
+    static IdempotencyStore store;
+    static uint64_t entriesGauge = MetricsRegistry::instance().addGaugeCallback("idempotency_keys",
+        "Idempotency keys held in memory, in flight or completed", {},
+        [] { return static_cast<double>(store.getEntryCount()); });
+    (void)entriesGauge;
+    return store;
+}
+
+IdempotencyStore::Outcome IdempotencyStore::begin(const std::string& key, const std::string& fingerprint,
+                                                  std::chrono::milliseconds wait, IdempotentResponse& response) {
+    Shard& shard = shardFor(key);
+    auto deadline = std::chrono::steady_clock::now() + wait;
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        evictLocked(shard, now);
+
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()) {
+            Entry entry;
+            entry.fingerprint = fingerprint;
+            entry.pending = std::make_shared<Pending>();
+            shard.entries.emplace(key, std::move(entry));
+            return Outcome::Acquired;
+        }
+        if (it->second.fingerprint != fingerprint) {
+            return Outcome::Mismatch;
+        }
+        if (!it->second.pending) {
+            response = it->second.response;
+            return Outcome::Replayed;
+        }
+
+        // Coalesce with the request already running; look again once it completes or gives up
+        std::shared_ptr<Pending> pending = it->second.pending;
+        if (!pending->done.wait_until(lock, deadline, [&pending] { return pending->finished; })) {
+            return Outcome::InProgress;
+        }
+    }
+}
+
+void IdempotencyStore::complete(const std::string& key, const IdempotentResponse& response) {
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end() || !it->second.pending) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    it->second.pending->finished = true;
+    it->second.pending->done.notify_all();
+    it->second.pending.reset();
+    it->second.response = response;
+    it->second.expiresAt = now + ttl_;
+    shard.expiry.emplace_back(it->second.expiresAt, key);
+    shard.completedCount++;
+    evictLocked(shard, now);
+}
+
+void IdempotencyStore::abandon(const std::string& key) {
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end() || !it->second.pending) {
+        return;
+    }
+    it->second.pending->finished = true;
+    it->second.pending->done.notify_all();
+    shard.entries.erase(it);
+}
+
+size_t IdempotencyStore::getEntryCount() const {
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        count += shard->entries.size();
+    }
+    return count;
+}
+
+bool IdempotencyStore::isFinal(int status, bool dispatched) {
+    return dispatched || (status < 500 && status != 429);
+}
+
+std::string IdempotencyStore::fingerprint(const std::string& method, const std::string& path, const std::string& body) {
+    // FNV-1a over the three parts; only compared with other fingerprints of the same key
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const std::string* part : {&method, &path, &body}) {
+        for (unsigned char c : *part) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        hash = (hash ^ 0xff) * 0x100000001b3ULL;
+    }
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+    return text;
+}
+
+IdempotencyStore::Shard& IdempotencyStore::shardFor(const std::string& key) {
+    return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+void IdempotencyStore::evictLocked(Shard& shard, std::chrono::steady_clock::time_point now) {
+    // Completed keys share one ttl, so completion order is expiry order
+    while (!shard.expiry.empty() &&
+           (shard.expiry.front().first <= now || shard.completedCount > maxEntriesPerShard_)) {
+        auto it = shard.entries.find(shard.expiry.front().second);
+        // A key that expired and was used again has a later expiry record of its own
+        if (it != shard.entries.end() && !it->second.pending &&
+            it->second.expiresAt == shard.expiry.front().first) {
+            shard.entries.erase(it);
+            shard.completedCount--;
+        }
+        shard.expiry.pop_front();
+    }
+}
+
+} // namespace messaging_service
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace messaging_service {
+
+/**
+ * @brief Response stored for an idempotency key and replayed to its retries
+ */
+struct IdempotentResponse {
+    int status = 0;
+    std::string body;
+    std::string contentType;
+};
+
+/**
+ * @brief In-process record of requests made with an Idempotency-Key
+ *
+ * The first request with a key acquires it and runs; requests with the same
+ * key that arrive while it runs wait for its response instead of running
+ * again, and later ones get the stored response replayed until it expires.
+ * If the first request gives the key up with abandon(), one waiter acquires
+ * it in its place. A key is bound to a fingerprint of the request it was
+ * first used with, and reusing it for a different request is refused.
+ *
+ * Keys are spread over independently locked shards, so unrelated requests
+ * do not contend. Completed keys expire after ttl; beyond maxEntries the
+ * oldest completed keys are dropped early. The database table behind it
+ * extends the guarantee across processes and restarts.
+ */
+class IdempotencyStore {
+public:
+    enum class Outcome {
+        Acquired,     // run the request, then complete() or abandon() the key
+        Replayed,     // response holds the stored response
+        Mismatch,     // the key was used for a different request
+        InProgress    // the request holding the key did not finish within the wait
+    };
+
+    /**
+     * @param maxEntries Completed keys kept in memory
+     * @param ttl Time a completed key is replayed for
+     * @param shardCount Independently locked partitions of the key space
+     */
+    explicit IdempotencyStore(size_t maxEntries = 100000, std::chrono::seconds ttl = std::chrono::hours(24),
+                              size_t shardCount = 64);
+
+    /**
+     * @brief Process-wide store used by the outbound send handlers
+     */
+    static IdempotencyStore& instance();
+
+    /**
+     * @brief Claim a key, or get the response of the request that holds it
+     * @param key Idempotency key, scoped by the caller to the client
+     * @param fingerprint Fingerprint of the request, see fingerprint()
+     * @param wait How long to wait for an in-flight request with the same key
+     * @param response Receives the stored response when Replayed
+     */
+    Outcome begin(const std::string& key, const std::string& fingerprint,
+                  std::chrono::milliseconds wait, IdempotentResponse& response);
+
+    /**
+     * @brief Store the response of an acquired key and hand it to waiting requests
+     */
+    void complete(const std::string& key, const IdempotentResponse& response);
+
+    /**
+     * @brief Give up an acquired key without a response, so it can be retried
+     */
+    void abandon(const std::string& key);
+
+    size_t getEntryCount() const;
+
+    /**
+     * @brief Whether a response completes its key, rather than being abandoned for a retry
+     * A 429 or 5xx given before the provider was called sent nothing, so the
+     * key is abandoned and a retry runs. Any response after the provider was
+     * called is final, since a timeout or failed store may hide a send.
+     * @param status HTTP status of the response
+     * @param dispatched Whether the provider was called
+     */
+    static bool isFinal(int status, bool dispatched);
+
+    /**
+     * @brief Fingerprint of a request's method, path and body
+     */
+    static std::string fingerprint(const std::string& method, const std::string& path, const std::string& body);
+
+private:
+    // Shared by the request holding a key and the requests waiting on it; guarded by the shard mutex
+    struct Pending {
+        std::condition_variable done;
+        bool finished = false;
+    };
+
+    struct Entry {
+        std::string fingerprint;
+        std::shared_ptr<Pending> pending;     // null once completed
+        IdempotentResponse response;
+        std::chrono::steady_clock::time_point expiresAt;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> expiry;   // completion order
+        size_t completedCount = 0;
+    };
+
+    Shard& shardFor(const std::string& key);
+
+    // Drop expired keys, then the oldest completed ones over the shard's share; expects the shard locked
+    void evictLocked(Shard& shard, std::chrono::steady_clock::time_point now);
+
+    const size_t maxEntriesPerShard_;
+    const std::chrono::seconds ttl_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace messaging_service
@@ -1,8 +1,10 @@
 #include "json_parser.h"
+#include "tracing.h"
 #include <iostream>
 #include <sstream>
 
 std::map<std::string, std::string> JsonParser::parse(const std::string& json) {
+    messaging_service::Span span("json.parse");
     std::map<std::string, std::string> result;
     
     // Remove whitespace
@@ -104,6 +106,33 @@ std::string JsonParser::unescapeJsonString(const std::string& str) {
     return result;
 }
 
+std::string JsonParser::escape(const std::string& str) {
+    std::string result;
+    result.reserve(str.length());
+    for (char c : str) {
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\b': result += "\\b"; break;
+            case '\f': result += "\\f"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    static const char hex[] = "0123456789abcdef";
+                    result += "\\u00";
+                    result += hex[(c >> 4) & 0x0f];
+                    result += hex[c & 0x0f];
+                } else {
+                    result += c;
+                }
+                break;
+        }
+    }
+    return result;
+}
+
 void JsonParser::trim(std::string& str) {
     // Remove leading whitespace
     size_t start = str.find_first_not_of(" \t\n\r");
@@ -19,6 +19,13 @@ public:
      */
     static void trim(std::string& str);
     
+    /**
+     * @brief Escape a string so it can be embedded in a JSON string literal
+     * @param str The raw string to escape
+     * @return Escaped string (without surrounding quotes)
+     */
+    static std::string escape(const std::string& str);
+    
 private:
     /**
      * @brief Extract a specific value from JSON string by key
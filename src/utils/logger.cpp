@@ -0,0 +1,397 @@
+#include "logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+namespace messaging_service {
+
+namespace {
+
+std::atomic<uint64_t> nextLoggerId{1};
+
+std::atomic<Logger*> processLogger{nullptr};
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+int64_t nowNs() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+// Bounded writer into a record's text buffer; excess input is dropped
+class RecordWriter {
+public:
+    RecordWriter(char* out, size_t capacity) : out_(out), capacity_(capacity), length_(0), truncated_(false) {}
+
+    void put(char c) {
+        if (length_ < capacity_) {
+            out_[length_++] = c;
+        } else {
+            truncated_ = true;
+        }
+    }
+
+    void put(const char* text, size_t length) {
+        for (size_t i = 0; i < length; ++i) {
+            put(text[i]);
+        }
+    }
+
+    void put(const std::string& text) {
+        put(text.data(), text.size());
+    }
+
+    // Newlines and control characters are escaped so one record stays one line
+    void putEscaped(const std::string& text, bool escapeQuotes) {
+        for (char c : text) {
+            switch (c) {
+                case '\n': put("\\n", 2); break;
+                case '\r': put("\\r", 2); break;
+                case '\t': put("\\t", 2); break;
+                case '"':
+                    if (escapeQuotes) {
+                        put('\\');
+                    }
+                    put(c);
+                    break;
+                case '\\':
+                    if (escapeQuotes) {
+                        put('\\');
+                    }
+                    put(c);
+                    break;
+                default:
+                    put(static_cast<unsigned char>(c) < 0x20 ? '?' : c);
+                    break;
+            }
+        }
+    }
+
+    uint16_t finish() {
+        if (truncated_ && capacity_ >= 3) {
+            std::memcpy(out_ + capacity_ - 3, "...", 3);
+        }
+        return static_cast<uint16_t>(length_);
+    }
+
+private:
+    char* out_;
+    size_t capacity_;
+    size_t length_;
+    bool truncated_;
+};
+
+bool needsQuotes(const std::string& value) {
+    if (value.empty()) {
+        return true;
+    }
+    for (char c : value) {
+        if (c == ' ' || c == '=' || c == '"' || static_cast<unsigned char>(c) < 0x20) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+LogField::LogField(const char* key, double value) : key(key), quoted(false) {
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+    this->value.assign(buffer, length > 0 ? static_cast<size_t>(length) : 0);
+}
+
+LoggerConfig LoggerConfig::fromEnvironment() {
+    LoggerConfig config;
+    if (const char* level = std::getenv("LOG_LEVEL")) {
+        Logger::parseLevel(level, config.level);
+    }
+    return config;
+}
+
+LogSampler::LogSampler(uint32_t perSecond)
+    : perSecond_(perSecond), windowSecond_(0), count_(0), suppressed_(0) {}
+
+bool LogSampler::allow(uint64_t& suppressed) {
+    int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    int64_t window = windowSecond_.load(std::memory_order_relaxed);
+    if (second != window && windowSecond_.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+        count_.store(0, std::memory_order_relaxed);
+    }
+
+    if (count_.fetch_add(1, std::memory_order_relaxed) < perSecond_) {
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+Logger::Ring::Ring(size_t capacity)
+    : slots(roundUpToPowerOfTwo(std::max<size_t>(2, capacity))), mask(slots.size() - 1) {}
+
+Logger::Logger(const LoggerConfig& config, Sink sink)
+    : id_(nextLoggerId.fetch_add(1)), level_(static_cast<uint8_t>(config.level)),
+      ringCapacity_(config.ringCapacity), flushInterval_(config.flushInterval), sink_(std::move(sink)),
+      flushRequested_(0), flushCompleted_(0), stop_(false), droppedTotal_(0) {
+    if (!sink_) {
+        sink_ = [](const std::string& batch) {
+            std::fwrite(batch.data(), 1, batch.size(), stdout);
+            std::fflush(stdout);
+        };
+    }
+    writer_ = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(writerMutex_);
+        stop_ = true;
+    }
+    writerCondition_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+Logger& Logger::instance() {
+    // Never destroyed, so objects logging from their own static destructors stay safe
+    static std::once_flag created;
+    std::call_once(created, [] {
+        processLogger.store(new Logger(LoggerConfig::fromEnvironment()));
+        std::atexit([] { Logger::instance().flush(); });
+    });
+    return *processLogger.load(std::memory_order_acquire);
+}
+
+void Logger::reinitializeAfterFork() {
+    Logger* inherited = processLogger.load();
+    if (!inherited) {
+        return;
+    }
+    LoggerConfig config = LoggerConfig::fromEnvironment();
+    config.level = inherited->getLevel();
+    processLogger.store(new Logger(config));
+}
+
+void Logger::log(LogLevel level, const char* component, const std::string& message,
+                 std::initializer_list<LogField> fields) {
+    if (!enabled(level)) {
+        return;
+    }
+
+    Ring* ring = ringForThisThread();
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t tail = ring->tail.load(std::memory_order_acquire);
+    if (head - tail >= ring->slots.size()) {
+        // Never block a request thread on logging
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& record = ring->slots[head & ring->mask];
+    record.timeNs = nowNs();
+    record.level = level;
+    record.length = formatRecord(record.text, component, message, fields);
+    ring->head.store(head + 1, std::memory_order_release);
+
+    if (level >= LogLevel::Error) {
+        writerCondition_.notify_one();
+    }
+}
+
+void Logger::setLevel(LogLevel level) {
+    level_.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel() const {
+    return static_cast<LogLevel>(level_.load(std::memory_order_relaxed));
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(writerMutex_);
+    if (stop_) {
+        return;
+    }
+    uint64_t ticket = ++flushRequested_;
+    writerCondition_.notify_all();
+    flushedCondition_.wait(lock, [this, ticket] { return flushCompleted_ >= ticket || stop_; });
+}
+
+uint64_t Logger::getDroppedCount() const {
+    return droppedTotal_.load();
+}
+
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warn: return "WARN";
+        case LogLevel::Error: return "ERROR";
+    }
+    return "INFO";
+}
+
+bool Logger::parseLevel(const std::string& text, LogLevel& level) {
+    std::string lower = text;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (lower == "debug") {
+        level = LogLevel::Debug;
+    } else if (lower == "info") {
+        level = LogLevel::Info;
+    } else if (lower == "warn" || lower == "warning") {
+        level = LogLevel::Warn;
+    } else if (lower == "error") {
+        level = LogLevel::Error;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+Logger::Ring* Logger::ringForThisThread() {
+    struct ThreadRing {
+        uint64_t loggerId;
+        std::shared_ptr<Ring> ring;
+    };
+    // Usually a single entry: the process-wide logger
+    thread_local std::vector<ThreadRing> threadRings;
+
+    for (const auto& entry : threadRings) {
+        if (entry.loggerId == id_) {
+            return entry.ring.get();
+        }
+    }
+
+    auto ring = std::make_shared<Ring>(ringCapacity_);
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        rings_.push_back(ring);
+    }
+    threadRings.push_back(ThreadRing{id_, ring});
+    return ring.get();
+}
+
+uint16_t Logger::formatRecord(char* out, const char* component, const std::string& message,
+                              std::initializer_list<LogField> fields) {
+    RecordWriter writer(out, kMaxRecordLength);
+    writer.put('[');
+    writer.put(component, std::strlen(component));
+    writer.put("] ", 2);
+    writer.putEscaped(message, false);
+
+    for (const auto& field : fields) {
+        writer.put(' ');
+        writer.put(field.key, std::strlen(field.key));
+        writer.put('=');
+        if (field.quoted && needsQuotes(field.value)) {
+            writer.put('"');
+            writer.putEscaped(field.value, true);
+            writer.put('"');
+        } else {
+            writer.putEscaped(field.value, false);
+        }
+    }
+    return writer.finish();
+}
+
+void Logger::appendLine(std::string& batch, const Record& record) {
+    std::time_t seconds = static_cast<std::time_t>(record.timeNs / 1000000000);
+    int millis = static_cast<int>((record.timeNs / 1000000) % 1000);
+    std::tm tm = {};
+    gmtime_r(&seconds, &tm);
+
+    char prefix[48];
+    size_t length = std::strftime(prefix, sizeof(prefix), "%Y-%m-%dT%H:%M:%S", &tm);
+    length += std::snprintf(prefix + length, sizeof(prefix) - length, ".%03dZ %s ", millis, levelName(record.level));
+
+    batch.append(prefix, length);
+    batch.append(record.text, record.length);
+    batch.push_back('\n');
+}
+
+void Logger::writerLoop() {
+    while (true) {
+        uint64_t ticket;
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(writerMutex_);
+            writerCondition_.wait_for(lock, flushInterval_, [this] {
+                return stop_ || flushRequested_ > flushCompleted_;
+            });
+            ticket = flushRequested_;
+            stopping = stop_;
+        }
+
+        drainOnce();
+
+        {
+            std::lock_guard<std::mutex> lock(writerMutex_);
+            flushCompleted_ = std::max(flushCompleted_, ticket);
+        }
+        flushedCondition_.notify_all();
+
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+bool Logger::drainOnce() {
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        rings = rings_;
+    }
+
+    std::string batch;
+    for (const auto& ring : rings) {
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        size_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            appendLine(batch, ring->slots[tail & ring->mask]);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+
+        uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            droppedTotal_ += dropped;
+            Record notice;
+            notice.timeNs = nowNs();
+            notice.level = LogLevel::Warn;
+            notice.length = formatRecord(notice.text, "logger", "Log buffer full, records dropped",
+                                         {{"dropped", static_cast<unsigned long long>(dropped)}});
+            appendLine(batch, notice);
+        }
+    }
+
+    {
+        // Forget rings whose thread has exited and that have been fully drained
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        rings.clear();
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::shared_ptr<Ring>& ring) {
+            return ring.use_count() == 1 &&
+                   ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire);
+        }), rings_.end());
+    }
+
+    if (batch.empty()) {
+        return false;
+    }
+    sink_(batch);
+    return true;
+}
+
+} // namespace messaging_service
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace messaging_service {
+
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info = 1,
+    Warn = 2,
+    Error = 3
+};
+
+/**
+ * @brief One structured key/value pair attached to a log line
+ */
+struct LogField {
+    LogField(const char* key, const std::string& value) : key(key), value(value), quoted(true) {}
+    LogField(const char* key, const char* value) : key(key), value(value ? value : ""), quoted(true) {}
+    LogField(const char* key, int value) : key(key), value(std::to_string(value)), quoted(false) {}
+    LogField(const char* key, long value) : key(key), value(std::to_string(value)), quoted(false) {}
+    LogField(const char* key, long long value) : key(key), value(std::to_string(value)), quoted(false) {}
+    LogField(const char* key, unsigned value) : key(key), value(std::to_string(value)), quoted(false) {}
+    LogField(const char* key, unsigned long value) : key(key), value(std::to_string(value)), quoted(false) {}
+    LogField(const char* key, unsigned long long value) : key(key), value(std::to_string(value)), quoted(false) {}
+    LogField(const char* key, double value);
+    LogField(const char* key, bool value) : key(key), value(value ? "true" : "false"), quoted(false) {}
+
+    const char* key;
+    std::string value;
+    bool quoted;   // strings are quoted when they contain spaces, quotes or '='
+};
+
+/**
+ * @brief Configuration for Logger
+ */
+struct LoggerConfig {
+    LogLevel level = LogLevel::Info;
+    size_t ringCapacity = 1024;          // records buffered per thread (rounded up to a power of two)
+    std::chrono::milliseconds flushInterval{5};
+
+    /**
+     * @brief Build a config from LOG_LEVEL (debug, info, warn, error)
+     */
+    static LoggerConfig fromEnvironment();
+};
+
+/**
+ * @brief Per-call-site limiter for noisy log lines
+ *
+ * Allows up to perSecond lines per wall-clock second; lines beyond that are
+ * counted and the count is reported on the next line that gets through.
+ */
+class LogSampler {
+public:
+    explicit LogSampler(uint32_t perSecond);
+
+    /**
+     * @brief Decide whether this occurrence should be logged
+     * @param suppressed Receives the number of lines dropped since the last allowed one
+     * @return true if the line should be logged
+     */
+    bool allow(uint64_t& suppressed);
+
+private:
+    uint32_t perSecond_;
+    std::atomic<int64_t> windowSecond_;
+    std::atomic<uint32_t> count_;
+    std::atomic<uint64_t> suppressed_;
+};
+
+/**
+ * @brief Asynchronous logger with per-thread lock-free ring buffers
+ *
+ * A logging thread formats its line into a fixed-size slot of its own
+ * single-producer/single-consumer ring and returns; it never takes a lock
+ * shared with other threads or touches the output stream. A background
+ * writer drains all rings and writes them in batches. If a ring is full the
+ * record is dropped and counted instead of blocking the caller.
+ *
+ * Lines are logfmt style:
+ *   2024-11-01T14:00:00.123Z INFO [scheduler] Message sent message_id=42 provider="twilio"
+ */
+class Logger {
+public:
+    // Receives a batch of complete, newline-terminated lines
+    using Sink = std::function<void(const std::string& batch)>;
+
+    static constexpr size_t kMaxRecordLength = 480;
+
+    explicit Logger(const LoggerConfig& config = LoggerConfig(), Sink sink = nullptr);
+
+    /**
+     * @brief Destructor - flushes buffered records and stops the writer
+     */
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /**
+     * @brief Process-wide logger writing to stdout, configured from the environment
+     */
+    static Logger& instance();
+
+    /**
+     * @brief Replace the process-wide logger in a freshly forked child
+     *
+     * fork() does not copy the writer thread, so the inherited logger would
+     * buffer records forever. The inherited instance is abandoned (not
+     * destroyed; its mutexes may have been held at fork time) and a new one
+     * with the same level takes over. Call before the child starts threads.
+     */
+    static void reinitializeAfterFork();
+
+    /**
+     * @brief Check whether a level would be logged; use before building fields
+     */
+    bool enabled(LogLevel level) const {
+        return static_cast<uint8_t>(level) >= level_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Queue one log line
+     * @param level Severity
+     * @param component Short subsystem name, e.g. "scheduler"
+     * @param message Human readable message
+     * @param fields Structured key/value pairs appended after the message
+     */
+    void log(LogLevel level, const char* component, const std::string& message,
+             std::initializer_list<LogField> fields = {});
+
+    void setLevel(LogLevel level);
+    LogLevel getLevel() const;
+
+    /**
+     * @brief Block until every record queued before this call has been written
+     */
+    void flush();
+
+    /**
+     * @brief Number of records dropped because a thread's ring was full
+     */
+    uint64_t getDroppedCount() const;
+
+    static const char* levelName(LogLevel level);
+    static bool parseLevel(const std::string& text, LogLevel& level);
+
+private:
+    struct Record {
+        int64_t timeNs;
+        LogLevel level;
+        uint16_t length;
+        char text[kMaxRecordLength];
+    };
+
+    // Single-producer/single-consumer ring owned by one logging thread
+    struct Ring {
+        explicit Ring(size_t capacity);
+
+        std::vector<Record> slots;
+        size_t mask;
+        alignas(64) std::atomic<size_t> head{0};    // written by the producer
+        alignas(64) std::atomic<size_t> tail{0};    // written by the writer
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    Ring* ringForThisThread();
+
+    // Format "[component] message k=v ..." into a record's text
+    static uint16_t formatRecord(char* out, const char* component, const std::string& message,
+                                 std::initializer_list<LogField> fields);
+
+    // Append a record as a full line (timestamp and level prefix) to a batch
+    static void appendLine(std::string& batch, const Record& record);
+
+    void writerLoop();
+
+    // Drain every ring into one batch; returns true if anything was written
+    bool drainOnce();
+
+    uint64_t id_;
+    std::atomic<uint8_t> level_;
+    size_t ringCapacity_;
+    std::chrono::milliseconds flushInterval_;
+    Sink sink_;
+
+    std::mutex ringsMutex_;      // guards rings_; taken once per thread at registration
+    std::vector<std::shared_ptr<Ring>> rings_;
+
+    std::mutex writerMutex_;
+    std::condition_variable writerCondition_;
+    std::condition_variable flushedCondition_;
+    uint64_t flushRequested_;
+    uint64_t flushCompleted_;
+    bool stop_;
+    std::atomic<uint64_t> droppedTotal_;
+    std::thread writer_;
+};
+
+} // namespace messaging_service
+
+#define MESSAGING_LOG(level, ...) \
+    do { \
+        auto& messagingLogger_ = ::messaging_service::Logger::instance(); \
+        if (messagingLogger_.enabled(level)) { \
+            messagingLogger_.log(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+// Usage: LOG_INFO("scheduler", "Message sent", {{"message_id", id}, {"provider", name}});
+#define LOG_DEBUG(...) MESSAGING_LOG(::messaging_service::LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) MESSAGING_LOG(::messaging_service::LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) MESSAGING_LOG(::messaging_service::LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) MESSAGING_LOG(::messaging_service::LogLevel::Error, __VA_ARGS__)
+
+// Like the macros above, but at most perSecond lines per second from this call site
+#define LOG_SAMPLED(perSecond, level, component, message, ...) \
+    do { \
+        auto& messagingLogger_ = ::messaging_service::Logger::instance(); \
+        if (messagingLogger_.enabled(level)) { \
+            static ::messaging_service::LogSampler messagingSampler_(perSecond); \
+            uint64_t messagingSuppressed_ = 0; \
+            if (messagingSampler_.allow(messagingSuppressed_)) { \
+                if (messagingSuppressed_ > 0) { \
+                    messagingLogger_.log(level, component, \
+                        std::string(message) + " (" + std::to_string(messagingSuppressed_) + " similar suppressed)", \
+                        ##__VA_ARGS__); \
+                } else { \
+                    messagingLogger_.log(level, component, message, ##__VA_ARGS__); \
+                } \
+            } \
+        } \
+    } while (0)
@@ -0,0 +1,185 @@
+#include "message_event_hub.h"
+#include "metrics.h"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace messaging_service {
+
+EventSubscription::EventSubscription(EventFilter filter, size_t capacity, std::function<void()> wake)
+    : filter_(std::move(filter)), capacity_(std::max<size_t>(capacity, 1)), wake_(std::move(wake)), resets_(0) {
+}
+
+size_t EventSubscription::take(std::vector<Item>& items) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = pending_.size();
+    std::move(pending_.begin(), pending_.end(), std::back_inserter(items));
+    pending_.clear();
+    return count;
+}
+
+uint64_t EventSubscription::getResetCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return resets_;
+}
+
+bool EventSubscription::push(Item item) {
+    bool wasEmpty;
+    bool fellBehind = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wasEmpty = pending_.empty();
+        if (!pending_.empty() && pending_.back().reset) {
+            // Already behind; the client re-reads everything once it catches up
+            return false;
+        }
+        if (item.reset || pending_.size() >= capacity_) {
+            if (!item.reset) {
+                resets_++;
+                fellBehind = true;
+            }
+            pending_.clear();
+            item = Item();
+            item.reset = true;
+        }
+        pending_.push_back(std::move(item));
+    }
+    if (wasEmpty && wake_) {
+        wake_();
+    }
+    return fellBehind;
+}
+
+MessageEventHub::MessageEventHub(size_t bufferCapacity)
+    : bufferCapacity_(bufferCapacity), subscriberCount_(0),
+      published_(&MetricsRegistry::instance().counter("message_events_published_total",
+                                                      "Message events queued for event stream subscribers")),
+      resets_(&MetricsRegistry::instance().counter("message_event_subscriber_resets_total",
+                                                   "Event stream subscribers that fell behind and were reset")) {
+}
+
+MessageEventHub& MessageEventHub::instance() {
+    static MessageEventHub hub;
+    static uint64_t subscribersGauge = MetricsRegistry::instance().addGaugeCallback("message_event_subscribers",
+        "Connected event stream subscribers", {},
+        [] { return static_cast<double>(hub.getSubscriberCount()); });
+    (void)subscribersGauge;
+    return hub;
+}
+
+std::shared_ptr<EventSubscription> MessageEventHub::subscribe(const EventFilter& filter, std::function<void()> wake) {
+    if (filter.conversationId <= 0 && filter.participant.empty()) {
+        return nullptr;
+    }
+    auto subscription = std::make_shared<EventSubscription>(filter, bufferCapacity_, std::move(wake));
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (filter.conversationId > 0) {
+        byConversation_[filter.conversationId].push_back(subscription);
+    } else {
+        byParticipant_[filter.participant].push_back(subscription);
+    }
+    subscriberCount_++;
+    return subscription;
+}
+
+void MessageEventHub::unsubscribe(const std::shared_ptr<EventSubscription>& subscription) {
+    if (!subscription) {
+        return;
+    }
+    const EventFilter& filter = subscription->getFilter();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (filter.conversationId > 0) {
+        auto subscribers = byConversation_.find(filter.conversationId);
+        if (subscribers != byConversation_.end()) {
+            if (remove(subscribers->second, subscription)) {
+                subscriberCount_--;
+            }
+            if (subscribers->second.empty()) {
+                byConversation_.erase(subscribers);
+            }
+        }
+    } else {
+        auto subscribers = byParticipant_.find(filter.participant);
+        if (subscribers != byParticipant_.end()) {
+            if (remove(subscribers->second, subscription)) {
+                subscriberCount_--;
+            }
+            if (subscribers->second.empty()) {
+                byParticipant_.erase(subscribers);
+            }
+        }
+    }
+}
+
+void MessageEventHub::publish(const MessageEvent& event) {
+    // Collected under the lock and pushed outside it, so wake callbacks never hold up subscribe()
+    Subscribers matching;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto byConversation = byConversation_.find(event.conversationId);
+        if (byConversation != byConversation_.end()) {
+            matching = byConversation->second;
+        }
+        auto from = byParticipant_.find(event.fromAddress);
+        if (from != byParticipant_.end()) {
+            matching.insert(matching.end(), from->second.begin(), from->second.end());
+        }
+        if (event.toAddress != event.fromAddress) {
+            auto to = byParticipant_.find(event.toAddress);
+            if (to != byParticipant_.end()) {
+                matching.insert(matching.end(), to->second.begin(), to->second.end());
+            }
+        }
+    }
+
+    for (const auto& subscription : matching) {
+        EventSubscription::Item item;
+        item.messageId = event.messageId;
+        item.data = event.json;
+        if (subscription->push(std::move(item))) {
+            resets_->inc();
+        }
+    }
+    published_->inc();
+}
+
+void MessageEventHub::publishReset() {
+    Subscribers all;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& subscribers : byConversation_) {
+            all.insert(all.end(), subscribers.second.begin(), subscribers.second.end());
+        }
+        for (const auto& subscribers : byParticipant_) {
+            all.insert(all.end(), subscribers.second.begin(), subscribers.second.end());
+        }
+    }
+    for (const auto& subscription : all) {
+        EventSubscription::Item item;
+        item.reset = true;
+        subscription->push(std::move(item));
+    }
+}
+
+bool MessageEventHub::isFollowed(int conversationId, const std::string& fromAddress,
+                                 const std::string& toAddress) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return byConversation_.count(conversationId) > 0 || byParticipant_.count(fromAddress) > 0 ||
+           byParticipant_.count(toAddress) > 0;
+}
+
+size_t MessageEventHub::getSubscriberCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscriberCount_;
+}
+
+bool MessageEventHub::remove(Subscribers& subscribers, const std::shared_ptr<EventSubscription>& subscription) {
+    auto found = std::find(subscribers.begin(), subscribers.end(), subscription);
+    if (found == subscribers.end()) {
+        return false;
+    }
+    subscribers.erase(found);
+    return true;
+}
+
+} // namespace messaging_service
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace messaging_service {
+
+class Counter;
+
+/**
+ * @brief A message written to the database, as pushed to event stream subscribers
+ */
+struct MessageEvent {
+    int messageId = 0;
+    int conversationId = 0;
+    std::string fromAddress;
+    std::string toAddress;
+    std::string json;   // the message object, as listed by GET /api/conversations/{id}/messages
+};
+
+/**
+ * @brief Which messages a subscriber receives
+ * Either every message of one conversation, or every message sent from or
+ * to one participant address.
+ */
+struct EventFilter {
+    int conversationId = 0;     // > 0 to follow a conversation
+    std::string participant;    // non-empty to follow an address
+};
+
+/**
+ * @brief Events waiting to be written to one subscriber
+ *
+ * Holds at most a fixed number of events. A subscriber that falls further
+ * behind loses its backlog and gets a single reset instead, telling the
+ * client to re-read the messages endpoint, so a stalled client costs
+ * bounded memory and never slows publishers down.
+ */
+class EventSubscription {
+public:
+    struct Item {
+        bool reset = false;     // events were dropped; the client should resync
+        int messageId = 0;
+        std::string data;
+    };
+
+    /**
+     * @param filter Messages to receive
+     * @param capacity Events held before the backlog is dropped
+     * @param wake Called when the first event arrives while none are pending; must not block
+     */
+    EventSubscription(EventFilter filter, size_t capacity, std::function<void()> wake);
+
+    const EventFilter& getFilter() const { return filter_; }
+
+    /**
+     * @brief Move every pending event to the end of items
+     * @return Number of events moved
+     */
+    size_t take(std::vector<Item>& items);
+
+    /**
+     * @brief Times this subscriber fell behind and had its backlog dropped
+     */
+    uint64_t getResetCount() const;
+
+private:
+    friend class MessageEventHub;
+
+    // Queue an event, or a reset in place of the backlog once full; true if this push overflowed it
+    bool push(Item item);
+
+    const EventFilter filter_;
+    const size_t capacity_;
+    const std::function<void()> wake_;
+
+    mutable std::mutex mutex_;
+    std::deque<Item> pending_;
+    uint64_t resets_;
+};
+
+/**
+ * @brief Fans out newly written messages to event stream subscribers
+ *
+ * Subscribers are indexed by conversation and by participant, so publishing
+ * costs the number of matching subscribers rather than the number
+ * connected. Each subscriber buffers independently; publish() never waits
+ * for one to drain.
+ */
+class MessageEventHub {
+public:
+    /**
+     * @param bufferCapacity Events each subscriber holds before it is reset
+     */
+    explicit MessageEventHub(size_t bufferCapacity = 256);
+
+    /**
+     * @brief Process-wide hub fed by the database notification listener
+     */
+    static MessageEventHub& instance();
+
+    /**
+     * @brief Start receiving events that match filter
+     * @param wake See EventSubscription
+     * @return The subscription, or null if the filter names neither a conversation nor a participant
+     */
+    std::shared_ptr<EventSubscription> subscribe(const EventFilter& filter, std::function<void()> wake);
+
+    void unsubscribe(const std::shared_ptr<EventSubscription>& subscription);
+
+    /**
+     * @brief Queue an event for every subscriber following its conversation or either address
+     */
+    void publish(const MessageEvent& event);
+
+    /**
+     * @brief Queue a reset for every subscriber
+     * Used when events may have been missed, e.g. after the listener reconnected.
+     */
+    void publishReset();
+
+    /**
+     * @brief Whether anyone follows the conversation or either address
+     * Lets the publisher skip loading a message nobody is waiting for.
+     */
+    bool isFollowed(int conversationId, const std::string& fromAddress, const std::string& toAddress) const;
+
+    size_t getSubscriberCount() const;
+
+private:
+    using Subscribers = std::vector<std::shared_ptr<EventSubscription>>;
+
+    static bool remove(Subscribers& subscribers, const std::shared_ptr<EventSubscription>& subscription);
+
+    const size_t bufferCapacity_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<int, Subscribers> byConversation_;
+    std::unordered_map<std::string, Subscribers> byParticipant_;
+    size_t subscriberCount_;
+
+    Counter* published_;
+    Counter* resets_;
+};
+
+} // namespace messaging_service
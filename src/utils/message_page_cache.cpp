@@ -0,0 +1,215 @@
+#include "message_page_cache.h"
+#include "metrics.h"
+#include <iterator>
+
+namespace messaging_service {
+
+MessagePageCache::MessagePageCache(size_t budgetBytes)
+    : budgetBytes_(budgetBytes), sizeBytes_(0), tombstones_(0), clock_(0), floor_(0), coherent_(false),
+      hits_(&MetricsRegistry::instance().counter("message_page_cache_hits_total",
+                                                 "Conversation message pages served from memory")),
+      misses_(&MetricsRegistry::instance().counter("message_page_cache_misses_total",
+                                                   "Conversation message pages read from the database")) {
+}
+
+MessagePageCache& MessagePageCache::instance() {
+    static MessagePageCache cache;
+    static uint64_t sizeGauge = MetricsRegistry::instance().addGaugeCallback("message_page_cache_bytes",
+        "Memory held by cached conversation message pages", {},
+        [] { return static_cast<double>(cache.getSizeBytes()); });
+    static uint64_t coherentGauge = MetricsRegistry::instance().addGaugeCallback("message_page_cache_coherent",
+        "1 while writes from other processes invalidate the page cache, 0 while hits are revalidated", {},
+        [] { return cache.isCoherent() ? 1.0 : 0.0; });
+    (void)sizeGauge;
+    (void)coherentGauge;
+    return cache;
+}
+
+bool MessagePageCache::get(int conversationId, const std::string& pageKey, CachedPage& page) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto conversation = conversations_.find(conversationId);
+    if (conversation != conversations_.end()) {
+        auto cached = conversation->second.pages.find(pageKey);
+        if (cached != conversation->second.pages.end()) {
+            lru_.splice(lru_.begin(), lru_, cached->second);
+            page = cached->second->page;
+            hits_->inc();
+            return true;
+        }
+    }
+    misses_->inc();
+    return false;
+}
+
+MessagePageCache::Ticket MessagePageCache::beginFill() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return clock_;
+}
+
+bool MessagePageCache::put(int conversationId, const std::string& pageKey, CachedPage page, Ticket ticket) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t cost = kPageOverhead + pageKey.size() + contentSize(page);
+    if (cost > budgetBytes_) {
+        return false;
+    }
+
+    auto conversation = conversations_.find(conversationId);
+    if (conversation == conversations_.end()) {
+        if (ticket < floor_) {
+            return false;
+        }
+        conversation = conversations_.emplace(conversationId, Conversation()).first;
+    } else {
+        // Written to after the page was read, so the page may be missing that write
+        if (conversation->second.invalidatedAt > ticket) {
+            return false;
+        }
+        if (conversation->second.pages.empty()) {
+            tombstones_--;
+        }
+    }
+
+    auto existing = conversation->second.pages.find(pageKey);
+    if (existing != conversation->second.pages.end()) {
+        erasePageLocked(existing->second);
+    }
+    lru_.push_front(Page{conversationId, pageKey, std::move(page)});
+    conversation->second.pages[pageKey] = lru_.begin();
+    sizeBytes_ += pageCost(lru_.front());
+
+    evictLocked();
+    return true;
+}
+
+bool MessagePageCache::attachEncoding(int conversationId, const std::string& pageKey, const std::string& etag,
+                                      ContentEncoding encoding, const std::string& encodedBody) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto conversation = conversations_.find(conversationId);
+    if (conversation == conversations_.end()) {
+        return false;
+    }
+    auto cached = conversation->second.pages.find(pageKey);
+    if (cached == conversation->second.pages.end() || cached->second->page.etag != etag) {
+        return false;
+    }
+    std::string& slot = cached->second->page.encodedBodies[static_cast<size_t>(encoding)];
+    if (slot.empty()) {
+        slot = encodedBody;
+        sizeBytes_ += slot.size();
+        evictLocked();
+    }
+    return true;
+}
+
+void MessagePageCache::invalidate(int conversationId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    invalidateLocked(conversationId);
+}
+
+void MessagePageCache::invalidate(const std::vector<int>& conversationIds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int conversationId : conversationIds) {
+        invalidateLocked(conversationId);
+    }
+}
+
+void MessagePageCache::setCoherent(bool coherent) {
+    coherent_.store(coherent);
+}
+
+bool MessagePageCache::isCoherent() const {
+    return coherent_.load();
+}
+
+std::vector<std::pair<int, std::string>> MessagePageCache::getCachedTags() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<int, std::string>> tags;
+    tags.reserve(lru_.size());
+    for (const auto& page : lru_) {
+        tags.emplace_back(page.conversationId, page.page.etag);
+    }
+    return tags;
+}
+
+void MessagePageCache::invalidateLocked(int conversationId) {
+    auto result = conversations_.emplace(conversationId, Conversation());
+    Conversation& conversation = result.first->second;
+    if (result.second || !conversation.pages.empty()) {
+        tombstones_++;
+    }
+    while (!conversation.pages.empty()) {
+        erasePageLocked(conversation.pages.begin()->second);
+    }
+    conversation.invalidatedAt = ++clock_;
+
+    if (tombstones_ > kMaxTombstones) {
+        // Forget invalidations wholesale; fills that started before now are refused instead
+        for (auto it = conversations_.begin(); it != conversations_.end();) {
+            it = it->second.pages.empty() ? conversations_.erase(it) : std::next(it);
+        }
+        tombstones_ = 0;
+        floor_ = clock_;
+    }
+}
+
+void MessagePageCache::setBudget(size_t budgetBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budgetBytes_ = budgetBytes;
+    evictLocked();
+}
+
+void MessagePageCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    conversations_.clear();
+    sizeBytes_ = 0;
+    tombstones_ = 0;
+    // Pages being read now may predate invalidations that were just forgotten
+    floor_ = ++clock_;
+}
+
+size_t MessagePageCache::getSizeBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sizeBytes_;
+}
+
+size_t MessagePageCache::getPageCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size();
+}
+
+size_t MessagePageCache::contentSize(const CachedPage& page) {
+    size_t size = page.body.size() + page.etag.size() + page.lastModified.size();
+    for (const auto& encoded : page.encodedBodies) {
+        size += encoded.size();
+    }
+    return size;
+}
+
+size_t MessagePageCache::pageCost(const Page& page) {
+    return kPageOverhead + page.key.size() + contentSize(page.page);
+}
+
+void MessagePageCache::evictLocked() {
+    while (sizeBytes_ > budgetBytes_ && !lru_.empty()) {
+        auto victim = std::prev(lru_.end());
+        auto conversation = conversations_.find(victim->conversationId);
+        erasePageLocked(victim);
+        if (conversation->second.pages.empty()) {
+            // Keep the record only while it still guards against a stale fill
+            if (conversation->second.invalidatedAt > floor_) {
+                tombstones_++;
+            } else {
+                conversations_.erase(conversation);
+            }
+        }
+    }
+}
+
+void MessagePageCache::erasePageLocked(PageList::iterator page) {
+    sizeBytes_ -= pageCost(*page);
+    conversations_[page->conversationId].pages.erase(page->key);
+    lru_.erase(page);
+}
+
+} // namespace messaging_service
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "compression.h"
+
+namespace messaging_service {
+
+class Counter;
+
+/**
+ * @brief A serialized page and the validators it was read at
+ */
+struct CachedPage {
+    std::string body;
+    std::string etag;           // empty if the page was read without a version
+    std::string lastModified;
+    std::array<std::string, kContentEncodingCount> encodedBodies;   // compressed copies by ContentEncoding, empty until needed
+};
+
+/**
+ * @brief In-process cache of serialized conversation message pages
+ *
+ * Pages are keyed by conversation and a page key (the cursor, empty for the
+ * whole conversation) and evicted least recently used once their bodies
+ * exceed the memory budget. Database write paths call invalidate() for the
+ * conversation they touched, which drops every page of that conversation.
+ *
+ * A page read from the database just before a write could otherwise be
+ * stored just after its invalidation. Readers therefore take a ticket with
+ * beginFill() before querying, and put() refuses pages whose ticket predates
+ * the conversation's last invalidation.
+ *
+ * Writes made by other processes arrive as database notifications. While
+ * the notification listener is connected the cache is coherent and hits can
+ * be served as they are; otherwise readers must check a hit's etag against
+ * the conversation's current version first.
+ */
+class MessagePageCache {
+public:
+    using Ticket = uint64_t;
+
+    /**
+     * @brief Constructor for MessagePageCache
+     * @param budgetBytes Memory allowed for cached pages; 0 disables caching
+     */
+    explicit MessagePageCache(size_t budgetBytes = 64 * 1024 * 1024);
+
+    /**
+     * @brief Process-wide cache used by the conversation handler and database writes
+     */
+    static MessagePageCache& instance();
+
+    /**
+     * @brief Look up a cached page
+     * @param page Receives the page on a hit
+     * @return true on a hit
+     */
+    bool get(int conversationId, const std::string& pageKey, CachedPage& page);
+
+    /**
+     * @brief Take a ticket before reading a page from the database
+     */
+    Ticket beginFill();
+
+    /**
+     * @brief Store a page read from the database
+     * @param ticket Ticket taken by beginFill() before the page was read
+     * @return false if the conversation was invalidated since the ticket or the page exceeds the budget
+     */
+    bool put(int conversationId, const std::string& pageKey, CachedPage page, Ticket ticket);
+
+    /**
+     * @brief Keep a compressed copy of a cached page so it is compressed only once
+     * @param etag Tag of the page the copy was made from; ignored if the page changed since
+     * @return false if the page is no longer cached at that tag
+     */
+    bool attachEncoding(int conversationId, const std::string& pageKey, const std::string& etag,
+                        ContentEncoding encoding, const std::string& encodedBody);
+    
+    /**
+     * @brief Drop every cached page of a conversation after a write to it
+     */
+    void invalidate(int conversationId);
+
+    /**
+     * @brief Drop every cached page of several conversations under one lock
+     */
+    void invalidate(const std::vector<int>& conversationIds);
+
+    /**
+     * @brief Record whether writes from every process currently reach invalidate()
+     */
+    void setCoherent(bool coherent);
+
+    /**
+     * @brief Whether hits can be served without checking the conversation's version
+     */
+    bool isCoherent() const;
+
+    /**
+     * @brief Conversation id and etag of every cached page, for checking against the database
+     */
+    std::vector<std::pair<int, std::string>> getCachedTags() const;
+
+    /**
+     * @brief Change the memory budget, evicting pages to fit
+     */
+    void setBudget(size_t budgetBytes);
+
+    /**
+     * @brief Drop every cached page
+     */
+    void clear();
+
+    size_t getSizeBytes() const;
+    size_t getPageCount() const;
+
+private:
+    struct Page {
+        int conversationId;
+        std::string key;
+        CachedPage page;
+    };
+    using PageList = std::list<Page>;
+
+    struct Conversation {
+        std::unordered_map<std::string, PageList::iterator> pages;
+        Ticket invalidatedAt = 0;
+    };
+
+    // Bookkeeping charged per page on top of its key and contents
+    static constexpr size_t kPageOverhead = 128;
+    // Conversations without pages kept only to remember their invalidation
+    static constexpr size_t kMaxTombstones = 4096;
+
+    static size_t contentSize(const CachedPage& page);
+    static size_t pageCost(const Page& page);
+
+    // Drop a conversation's pages and record the invalidation; expects mutex_ held
+    void invalidateLocked(int conversationId);
+
+    // Evict least recently used pages until the cache fits the budget; expects mutex_ held
+    void evictLocked();
+
+    // Unlink one page; expects mutex_ held
+    void erasePageLocked(PageList::iterator page);
+
+    mutable std::mutex mutex_;
+    size_t budgetBytes_;
+    size_t sizeBytes_;
+    PageList lru_;                                          // most recently used first
+    std::unordered_map<int, Conversation> conversations_;
+    size_t tombstones_;                                     // conversations with no pages
+    Ticket clock_;
+    Ticket floor_;                                          // tickets below this are refused for unknown conversations
+    std::atomic<bool> coherent_;
+
+    Counter* hits_;
+    Counter* misses_;
+};
+
+} // namespace messaging_service
@@ -1,14 +1,24 @@
 #include "message_scheduler.h"
 #include "../database/database.h"
-#include <iostream>
+#include "../providers/provider_router.h"
+#include "logger.h"
 #include <sstream>
 #include <iomanip>
 #include <ctime>
 
 namespace messaging_service {
 
-MessageScheduler::MessageScheduler(WorkerPool* worker_pool) 
-    : worker_pool_(worker_pool) {
+namespace {
+
+// Stored messages are keyed by their row id, which every later attempt shares
+std::string outboundIdempotencyKey(int message_id) {
+    return "message-" + std::to_string(message_id);
+}
+
+} // namespace
+
+MessageScheduler::MessageScheduler(OrderedDispatcher* dispatcher, RateShaper* rate_shaper) 
+    : dispatcher_(dispatcher), rate_shaper_(rate_shaper) {
 }
 
 MessageScheduler::~MessageScheduler() {
@@ -22,7 +32,7 @@ void MessageScheduler::start() {
     
     running_.store(true);
     scheduler_thread_ = std::thread(&MessageScheduler::schedulerLoop, this);
-    std::cout << "[MESSAGE SCHEDULER] Started scheduler thread" << std::endl;
+    LOG_INFO("scheduler", "Started scheduler thread");
 }
 
 void MessageScheduler::stop() {
@@ -37,7 +47,7 @@ void MessageScheduler::stop() {
         scheduler_thread_.join();
     }
     
-    std::cout << "[MESSAGE SCHEDULER] Stopped scheduler thread" << std::endl;
+    LOG_INFO("scheduler", "Stopped scheduler thread");
 }
 
 void MessageScheduler::scheduleMessage(int message_id, int conversation_id,
@@ -51,7 +61,7 @@ void MessageScheduler::scheduleMessage(int message_id, int conversation_id,
     auto current_time = std::chrono::system_clock::now();
     
     if (scheduled_time <= current_time) {
-        std::cout << "[MESSAGE SCHEDULER] Scheduled time is in the past, sending immediately" << std::endl;
+        LOG_INFO("scheduler", "Scheduled time is in the past, sending immediately", {{"message_id", message_id}});
         // Send immediately
         ScheduledMessage message;
         message.send_time = current_time;
@@ -84,18 +94,32 @@ void MessageScheduler::scheduleMessage(int message_id, int conversation_id,
     message.timestamp = timestamp;
     message.provider = provider;
     
+    scheduleMessage(message);
+}
+
+void MessageScheduler::scheduleMessage(const ScheduledMessage& message) {
+    // Remember the scheduling request's trace so the eventual send joins it
+    ScheduledMessage queued = message;
+    if (!queued.trace.valid()) {
+        CapturedTrace current = CapturedTrace::current();
+        if (current.trace) {
+            queued.trace = Tracer::currentContext();
+            queued.request_id = current.trace->requestId();
+        }
+    }
+    
     // Add to priority queue
     {
         std::lock_guard<std::mutex> lock(queue_mutex_);
-        scheduled_messages_.push(message);
+        scheduled_messages_.push(std::move(queued));
     }
     
     // Notify scheduler thread
     cv_.notify_one();
     
-    auto delay = std::chrono::duration_cast<std::chrono::seconds>(scheduled_time - current_time);
-    std::cout << "[MESSAGE SCHEDULER] Scheduled message " << message_id << " for delivery in " 
-              << delay.count() << " seconds" << std::endl;
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(message.send_time - std::chrono::system_clock::now());
+    LOG_INFO("scheduler", "Scheduled message", {{"message_id", message.message_id},
+             {"delay_ms", static_cast<long long>(delay.count())}, {"rate_limited", message.rate_shaped}});
 }
 
 size_t MessageScheduler::getScheduledMessageCount() const {
@@ -104,7 +128,7 @@ size_t MessageScheduler::getScheduledMessageCount() const {
 }
 
 void MessageScheduler::schedulerLoop() {
-    std::cout << "[MESSAGE SCHEDULER] Scheduler loop started" << std::endl;
+    LOG_DEBUG("scheduler", "Scheduler loop started");
     
     while (running_.load()) {
         std::unique_lock<std::mutex> lock(queue_mutex_);
@@ -124,7 +148,7 @@ void MessageScheduler::schedulerLoop() {
             scheduled_messages_.pop();
             lock.unlock(); // Release lock before sending
             
-            std::cout << "[MESSAGE SCHEDULER] Sending scheduled message " << next_message.message_id << std::endl;
+            LOG_DEBUG("scheduler", "Message due", {{"message_id", next_message.message_id}});
             sendScheduledMessage(next_message);
         } else {
             // Wait until the next message is due
@@ -136,17 +160,47 @@ void MessageScheduler::schedulerLoop() {
         }
     }
     
-    std::cout << "[MESSAGE SCHEDULER] Scheduler loop ended" << std::endl;
+    LOG_DEBUG("scheduler", "Scheduler loop ended");
 }
 
 void MessageScheduler::sendScheduledMessage(const ScheduledMessage& message) {
-    // Submit to worker pool for actual sending
-    worker_pool_->submit([this, message]() {
-        std::cout << "[MESSAGE SCHEDULER] Executing scheduled message send for message " << message.message_id << std::endl;
+    // Messages that have not yet reserved a rate slot must do so before sending
+    if (rate_shaper_ && !message.rate_shaped) {
+        std::chrono::milliseconds delay(0);
+        ScheduledMessage deferred = message;
+        if (!rate_shaper_->reserve(message.from, message.to, message.provider->getProviderName(), delay)) {
+            // Backlog for this sender/recipient is too deep; try to reserve again later
+            deferred.send_time = std::chrono::system_clock::now() + std::chrono::minutes(1);
+            deferred.priority = TaskPriority::Retry;
+            LOG_WARN("scheduler", "Rate limit backlog full, retrying in 60 seconds", {{"message_id", message.message_id}});
+            scheduleMessage(deferred);
+            return;
+        }
+        if (delay.count() > 0) {
+            deferred.send_time = std::chrono::system_clock::now() + delay;
+            deferred.rate_shaped = true;
+            deferred.priority = TaskPriority::Retry;
+            scheduleMessage(deferred);
+            return;
+        }
+    }
+    
+    // Submit to the conversation's lane so sends within a conversation stay in order
+    dispatcher_->submit(static_cast<uint64_t>(message.conversation_id), [this, message]() {
+        // Deferred sends start their own root span under the request that scheduled them
+        std::unique_ptr<RequestTrace> trace;
+        if (message.trace.valid()) {
+            trace = std::make_unique<RequestTrace>("scheduler.send", message.request_id, &message.trace);
+            trace->setAttribute("message.id", std::to_string(message.message_id));
+        }
+        LOG_DEBUG("scheduler", "Sending scheduled message", {{"message_id", message.message_id}});
         
         // Create message request
         MessageRequest messageRequest(message.from, message.to, message.type, message.body, 
                                     message.provider->getProviderName(), message.timestamp, "outbound");
+        // Rate-limit deferrals and recovery after a restart send the stored row
+        // again, so the vendor sees the same key each time
+        messageRequest.idempotency_key = outboundIdempotencyKey(message.message_id);
         
         // Parse attachments if provided
         if (message.attachments != "null" && !message.attachments.empty()) {
@@ -158,7 +212,10 @@ void MessageScheduler::sendScheduledMessage(const ScheduledMessage& message) {
         }
         
         // Send the message
-        auto response = message.provider->sendMessage(messageRequest);
+        auto response = ProviderRouter::instance().dispatch(message.provider, messageRequest);
+        if (trace) {
+            trace->setError(!response.success);
+        }
         
         // Update the sent_time in the database
         Database db;
@@ -167,21 +224,20 @@ void MessageScheduler::sendScheduledMessage(const ScheduledMessage& message) {
             
             // Update the specific message's sent_time field
             if (response.success) {
-                if (db.updateMessageSentTime(message.message_id, currentTime)) {
-                    std::cout << "[MESSAGE SCHEDULER] Updated sent_time for message " << message.message_id 
-                              << " to " << currentTime << std::endl;
+                if (db.updateMessageSentTime(message.message_id, message.timestamp, currentTime, response.provider_message_id)) {
+                    LOG_INFO("scheduler", "Scheduled message sent", {{"message_id", message.message_id},
+                             {"sent_time", currentTime}, {"provider", message.provider->getProviderName()}});
                 } else {
-                    std::cerr << "[MESSAGE SCHEDULER] Failed to update sent_time for message " << message.message_id << std::endl;
+                    LOG_ERROR("scheduler", "Failed to update sent_time", {{"message_id", message.message_id}});
                 }
             } else {
-                std::cerr << "[MESSAGE SCHEDULER] Scheduled message send failed for message " << message.message_id 
-                          << ": " << response.message << std::endl;
+                LOG_WARN("scheduler", "Scheduled message send failed", {{"message_id", message.message_id},
+                         {"error", response.message}});
             }
         } else {
-            std::cerr << "[MESSAGE SCHEDULER] Failed to connect to database to update sent_time for message " 
-                      << message.message_id << std::endl;
+            LOG_ERROR("scheduler", "Database connection failed, sent_time not updated", {{"message_id", message.message_id}});
         }
-    });
+    }, message.priority);
 }
 
 std::chrono::system_clock::time_point MessageScheduler::parseSendTime(const std::string& send_time) {
@@ -191,7 +247,7 @@ std::chrono::system_clock::time_point MessageScheduler::parseSendTime(const std:
     ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
     
     if (ss.fail()) {
-        std::cerr << "[MESSAGE SCHEDULER] Failed to parse scheduled time: " << send_time << std::endl;
+        LOG_WARN("scheduler", "Failed to parse scheduled time", {{"send_time", send_time}});
         return std::chrono::system_clock::now(); // Return current time as fallback
     }
     
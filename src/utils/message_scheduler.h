@@ -9,7 +9,9 @@
 #include <memory>
 #include <string>
 
-#include "worker_pool.h"
+#include "ordered_dispatcher.h"
+#include "rate_shaper.h"
+#include "tracing.h"
 #include "../providers/messaging_provider.h"
 
 namespace messaging_service {
@@ -26,6 +28,10 @@ struct ScheduledMessage {
     std::string provider_message_id;
     std::string timestamp;
     std::shared_ptr<MessagingProvider> provider;
+    bool rate_shaped = false;   // send_time is a slot already reserved with the RateShaper
+    TaskPriority priority = TaskPriority::Scheduled;   // worker pool class the send runs in
+    TraceContext trace;         // span that scheduled the message; the send continues its trace
+    std::string request_id;
     
     // For min-heap (earliest time first)
     bool operator>(const ScheduledMessage& other) const {
@@ -35,7 +41,7 @@ struct ScheduledMessage {
 
 class MessageScheduler {
 public:
-    MessageScheduler(WorkerPool* worker_pool);
+    MessageScheduler(OrderedDispatcher* dispatcher, RateShaper* rate_shaper = nullptr);
     ~MessageScheduler();
     
     // Start the scheduler thread
@@ -52,9 +58,15 @@ public:
                         const std::string& timestamp, const std::string& send_time,
                         std::shared_ptr<MessagingProvider> provider);
     
+    // Schedule a fully populated message (used to defer rate-limited sends)
+    void scheduleMessage(const ScheduledMessage& message);
+    
     // Get the number of scheduled messages
     size_t getScheduledMessageCount() const;
     
+    // Parse send_time string to time_point
+    static std::chrono::system_clock::time_point parseSendTime(const std::string& send_time);
+    
 private:
     // The main scheduler loop
     void schedulerLoop();
@@ -62,9 +74,6 @@ private:
     // Send a scheduled message
     void sendScheduledMessage(const ScheduledMessage& message);
     
-    // Parse send_time string to time_point
-    std::chrono::system_clock::time_point parseSendTime(const std::string& send_time);
-    
     // Get current timestamp in ISO format
     std::string getCurrentTimestamp();
     
@@ -77,8 +86,11 @@ private:
     std::thread scheduler_thread_;
     std::atomic<bool> running_{false};
     
-    // Worker pool for sending messages
-    WorkerPool* worker_pool_;
+    // Per-conversation lanes that send due messages in order
+    OrderedDispatcher* dispatcher_;
+    
+    // Optional rate shaper consulted before a due message is sent
+    RateShaper* rate_shaper_;
 };
 
 } // namespace messaging_service
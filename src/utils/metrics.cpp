@@ -0,0 +1,254 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace messaging_service {
+
+namespace metrics_detail {
+
+size_t threadStripe() {
+    static std::atomic<size_t> nextStripe{0};
+    thread_local size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % kStripes;
+    return stripe;
+}
+
+} // namespace metrics_detail
+
+namespace {
+
+// Bucket bounds exported to Prometheus, in seconds
+constexpr double kExportBoundsSeconds[] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+    0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0
+};
+
+std::string formatNumber(double value) {
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.10g", value);
+    return std::string(buffer, length > 0 ? static_cast<size_t>(length) : 0);
+}
+
+std::string escapeLabelValue(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// Renders {a="1",b="2"} with an optional extra label appended (used for "le")
+std::string renderLabels(const MetricLabels& labels, const std::string& extraName = "",
+                         const std::string& extraValue = "") {
+    if (labels.empty() && extraName.empty()) {
+        return "";
+    }
+    std::string text = "{";
+    bool first = true;
+    for (const auto& label : labels) {
+        if (!first) {
+            text += ",";
+        }
+        first = false;
+        text += label.first + "=\"" + escapeLabelValue(label.second) + "\"";
+    }
+    if (!extraName.empty()) {
+        if (!first) {
+            text += ",";
+        }
+        text += extraName + "=\"" + extraValue + "\"";
+    }
+    text += "}";
+    return text;
+}
+
+} // namespace
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& cell : cells_) {
+        total += cell.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t Histogram::count() const {
+    uint64_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t Histogram::sum() const {
+    uint64_t total = 0;
+    for (const auto& cell : sums_) {
+        total += cell.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t Histogram::percentile(double quantile) const {
+    std::array<uint64_t, kBucketCount> snapshot;
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        snapshot[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += snapshot[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    quantile = std::min(1.0, std::max(0.0, quantile));
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(total))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += snapshot[i];
+        if (seen >= rank) {
+            return bucketUpperBound(i);
+        }
+    }
+    return kMaxValue;
+}
+
+uint64_t Histogram::countAtOrBelow(uint64_t micros) const {
+    size_t last = bucketIndex(std::min(micros, kMaxValue));
+    uint64_t total = 0;
+    for (size_t i = 0; i <= last; ++i) {
+        total += buckets_[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t index) {
+    if (index < 2 * kSubBucketHalf) {
+        return index;
+    }
+    size_t shift = index / kSubBucketHalf - 1;
+    uint64_t subBucket = index - shift * kSubBucketHalf;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    Series& series = seriesFor(name, help, Type::Counter, labels);
+    return *series.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    Series& series = seriesFor(name, help, Type::Gauge, labels);
+    return *series.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    Series& series = seriesFor(name, help, Type::Histogram, labels);
+    return *series.histogram;
+}
+
+uint64_t MetricsRegistry::addGaugeCallback(const std::string& name, const std::string& help,
+                                           const MetricLabels& labels, std::function<double()> callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Family& family = families_[name];
+    if (family.series.empty()) {
+        family.help = help;
+        family.type = Type::Gauge;
+    }
+    auto series = std::make_unique<Series>();
+    series->labels = labels;
+    series->callbackId = nextCallbackId_++;
+    series->callback = std::move(callback);
+    uint64_t id = series->callbackId;
+    family.series.push_back(std::move(series));
+    return id;
+}
+
+void MetricsRegistry::removeGaugeCallback(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& family : families_) {
+        auto& series = family.second.series;
+        series.erase(std::remove_if(series.begin(), series.end(), [id](const std::unique_ptr<Series>& entry) {
+            return entry->callbackId == id;
+        }), series.end());
+    }
+}
+
+std::string MetricsRegistry::renderPrometheus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string text;
+    text.reserve(families_.size() * 256);
+
+    for (const auto& entry : families_) {
+        const std::string& name = entry.first;
+        const Family& family = entry.second;
+        if (family.series.empty()) {
+            continue;
+        }
+
+        const char* type = family.type == Type::Counter ? "counter" :
+                           family.type == Type::Gauge ? "gauge" : "histogram";
+        text += "# HELP " + name + " " + family.help + "\n";
+        text += "# TYPE " + name + " " + type + "\n";
+
+        for (const auto& series : family.series) {
+            if (series->counter) {
+                text += name + renderLabels(series->labels) + " " + std::to_string(series->counter->value()) + "\n";
+            } else if (series->gauge) {
+                text += name + renderLabels(series->labels) + " " + std::to_string(series->gauge->value()) + "\n";
+            } else if (series->callback) {
+                text += name + renderLabels(series->labels) + " " + formatNumber(series->callback()) + "\n";
+            } else if (series->histogram) {
+                const Histogram& histogram = *series->histogram;
+                for (double bound : kExportBoundsSeconds) {
+                    uint64_t micros = static_cast<uint64_t>(bound * 1e6);
+                    text += name + "_bucket" + renderLabels(series->labels, "le", formatNumber(bound)) + " " +
+                            std::to_string(histogram.countAtOrBelow(micros)) + "\n";
+                }
+                uint64_t count = histogram.count();
+                text += name + "_bucket" + renderLabels(series->labels, "le", "+Inf") + " " + std::to_string(count) + "\n";
+                text += name + "_sum" + renderLabels(series->labels) + " " +
+                        formatNumber(static_cast<double>(histogram.sum()) / 1e6) + "\n";
+                text += name + "_count" + renderLabels(series->labels) + " " + std::to_string(count) + "\n";
+            }
+        }
+    }
+    return text;
+}
+
+MetricsRegistry::Series& MetricsRegistry::seriesFor(const std::string& name, const std::string& help,
+                                                    Type type, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Family& family = families_[name];
+    if (family.series.empty()) {
+        family.help = help;
+        family.type = type;
+    }
+    for (auto& series : family.series) {
+        if (series->labels == labels && !series->callback) {
+            return *series;
+        }
+    }
+
+    auto series = std::make_unique<Series>();
+    series->labels = labels;
+    switch (type) {
+        case Type::Counter: series->counter = std::make_unique<Counter>(); break;
+        case Type::Gauge: series->gauge = std::make_unique<Gauge>(); break;
+        case Type::Histogram: series->histogram = std::make_unique<Histogram>(); break;
+    }
+    family.series.push_back(std::move(series));
+    return *family.series.back();
+}
+
+} // namespace messaging_service
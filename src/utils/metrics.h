@@ -0,0 +1,215 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace messaging_service {
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+namespace metrics_detail {
+
+constexpr size_t kStripes = 16;
+
+// Stable per-thread index used to spread updates over striped cells
+size_t threadStripe();
+
+struct alignas(64) PaddedCounter {
+    std::atomic<uint64_t> value{0};
+};
+
+} // namespace metrics_detail
+
+/**
+ * @brief Monotonic counter
+ *
+ * Increments go to one of several cache-line sized cells chosen per thread,
+ * so concurrent writers do not contend; reads sum the cells.
+ */
+class Counter {
+public:
+    void inc(uint64_t amount = 1) {
+        cells_[metrics_detail::threadStripe()].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const;
+
+private:
+    std::array<metrics_detail::PaddedCounter, metrics_detail::kStripes> cells_;
+};
+
+/**
+ * @brief Value that can go up and down
+ */
+class Gauge {
+public:
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void add(int64_t amount) { value_.fetch_add(amount, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+/**
+ * @brief Log-linear (HDR style) histogram of durations in microseconds
+ *
+ * Each power of two is split into 16 linear sub-buckets, so any recorded
+ * value is reported within about 6% of its true value across a range of
+ * 1us to roughly 19 hours. Recording is one bit scan and two relaxed atomic
+ * adds, with no locks.
+ */
+class Histogram {
+public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr uint64_t kSubBucketHalf = 1ULL << (kSubBucketBits - 1);
+    static constexpr uint64_t kMaxValue = (1ULL << 36) - 1;
+    static constexpr size_t kBucketCount = (36 - kSubBucketBits + 2) * kSubBucketHalf;
+
+    /**
+     * @brief Record one value in microseconds; larger values are clamped
+     */
+    void record(uint64_t micros) {
+        if (micros > kMaxValue) {
+            micros = kMaxValue;
+        }
+        buckets_[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+        sums_[metrics_detail::threadStripe()].value.fetch_add(micros, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record a duration
+     */
+    template<typename Rep, typename Period>
+    void observe(std::chrono::duration<Rep, Period> duration) {
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        record(micros > 0 ? static_cast<uint64_t>(micros) : 0);
+    }
+
+    /**
+     * @brief Number of recorded values
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Sum of recorded values in microseconds
+     */
+    uint64_t sum() const;
+
+    /**
+     * @brief Value at a quantile in microseconds
+     * @param quantile In [0, 1], e.g. 0.99
+     * @return Upper bound of the bucket holding the quantile, or 0 when empty
+     */
+    uint64_t percentile(double quantile) const;
+
+    /**
+     * @brief Number of recorded values less than or equal to a bound
+     * Values sharing the bound's bucket are counted, so the result may
+     * include values up to one bucket width above the bound.
+     */
+    uint64_t countAtOrBelow(uint64_t micros) const;
+
+    static size_t bucketIndex(uint64_t value) {
+        if (value < 2 * kSubBucketHalf) {
+            return static_cast<size_t>(value);
+        }
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - kSubBucketBits + 1;
+        return static_cast<size_t>(shift) * kSubBucketHalf + static_cast<size_t>(value >> shift);
+    }
+
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+    std::array<metrics_detail::PaddedCounter, metrics_detail::kStripes> sums_;
+};
+
+/**
+ * @brief Records the time from construction to destruction into a histogram
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+
+    ~ScopedTimer() {
+        histogram_.observe(std::chrono::steady_clock::now() - start_);
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @brief Named metric families rendered in the Prometheus text format
+ *
+ * Looking a metric up takes a lock, so callers look up once and keep the
+ * returned reference; metrics are never removed and references stay valid
+ * for the registry's lifetime. Histograms are exported in seconds.
+ */
+class MetricsRegistry {
+public:
+    /**
+     * @brief Process-wide registry served at /metrics
+     */
+    static MetricsRegistry& instance();
+
+    Counter& counter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+
+    /**
+     * @brief Register a gauge whose value is read from a callback at scrape time
+     * @return Id to pass to removeGaugeCallback when the source goes away
+     */
+    uint64_t addGaugeCallback(const std::string& name, const std::string& help, const MetricLabels& labels,
+                              std::function<double()> callback);
+
+    void removeGaugeCallback(uint64_t id);
+
+    /**
+     * @brief Render every metric in the Prometheus text exposition format
+     */
+    std::string renderPrometheus() const;
+
+private:
+    enum class Type { Counter, Gauge, Histogram };
+
+    struct Series {
+        MetricLabels labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        uint64_t callbackId = 0;
+        std::function<double()> callback;
+    };
+
+    struct Family {
+        std::string help;
+        Type type;
+        std::vector<std::unique_ptr<Series>> series;
+    };
+
+    Series& seriesFor(const std::string& name, const std::string& help, Type type, const MetricLabels& labels);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+    uint64_t nextCallbackId_ = 1;
+};
+
+} // namespace messaging_service
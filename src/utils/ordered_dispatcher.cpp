@@ -0,0 +1,193 @@
+#include "ordered_dispatcher.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace messaging_service {
+
+OrderedDispatcher::OrderedDispatcher(WorkerPool* workerPool, size_t laneCount)
+    : workerPool_(workerPool), pendingTasks_(0), outstandingDrains_(0) {
+    laneCount = std::max<size_t>(1, laneCount);
+    lanes_.reserve(laneCount);
+    for (size_t i = 0; i < laneCount; ++i) {
+        lanes_.push_back(std::make_unique<Lane>());
+    }
+    LOG_INFO("dispatcher", "Initialized ordered dispatch lanes", {{"lanes", laneCount}});
+}
+
+OrderedDispatcher::~OrderedDispatcher() {
+    // Drain tasks hold pointers to our lanes; let any in flight finish first
+    while (outstandingDrains_.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+size_t OrderedDispatcher::getLaneCount() const {
+    return lanes_.size();
+}
+
+size_t OrderedDispatcher::getPendingTaskCount() const {
+    return pendingTasks_.load();
+}
+
+size_t OrderedDispatcher::discardPending() {
+    size_t dropped = 0;
+    for (auto& lane : lanes_) {
+        std::deque<Entry> discarded;
+        {
+            std::lock_guard<std::mutex> lock(lane->mutex);
+            discarded.swap(lane->mailbox);
+            lane->waiting.fill(0);
+            pendingTasks_ -= discarded.size();
+        }
+        // A drain already scheduled for the lane finds it empty and goes idle
+        dropped += discarded.size();
+    }
+    return dropped;
+}
+
+size_t OrderedDispatcher::Lane::mostUrgent() const {
+    for (size_t i = 0; i < kTaskPriorityCount; ++i) {
+        if (waiting[i] > 0) {
+            return i;
+        }
+    }
+    return kTaskPriorityCount;
+}
+
+void OrderedDispatcher::enqueue(uint64_t key, TaskPriority priority, std::function<void()> task) {
+    Lane& lane = laneFor(key);
+    size_t index = static_cast<size_t>(priority);
+    bool laneBusy = false;
+    {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        lane.mailbox.push_back(Entry{priority, std::move(task)});
+        lane.waiting[index]++;
+        pendingTasks_++;
+        
+        // A drain already queued at least this urgently, or the one running
+        // with none queued behind it, will pick the task up
+        if (lane.queuedDrains > 0 ? index >= lane.queuedPriority : lane.running) {
+            return;
+        }
+        // Otherwise queue a drain at this priority, even if a less urgent one is
+        // already queued; the lane's earlier tasks then run at this priority too
+        laneBusy = lane.queuedDrains > 0 || lane.running;
+        lane.queuedDrains++;
+        lane.queuedPriority = std::min(lane.queuedPriority, index);
+        outstandingDrains_++;
+    }
+
+    try {
+        workerPool_->submit(priority, [this, &lane]() { drain(&lane); });
+    } catch (const std::exception&) {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        lane.queuedDrains--;
+        if (lane.queuedDrains == 0) {
+            lane.queuedPriority = kTaskPriorityCount;
+        }
+        outstandingDrains_--;
+        if (laneBusy) {
+            // Pool is stopping; the drain already queued or running reaches the task
+            return;
+        }
+        // Pool is stopped: the lane was idle, so ours is the only queued task
+        lane.mailbox.pop_back();
+        lane.waiting[index]--;
+        pendingTasks_--;
+        throw;
+    }
+}
+
+void OrderedDispatcher::drain(Lane* lane) {
+    {
+        std::lock_guard<std::mutex> lock(lane->mutex);
+        lane->queuedDrains--;
+        if (lane->queuedDrains == 0) {
+            lane->queuedPriority = kTaskPriorityCount;
+        }
+        if (lane->running) {
+            // Queued to reach urgent work sooner, but another drain got to the lane first
+            lane = nullptr;
+        } else {
+            lane->running = true;
+        }
+    }
+    if (!lane) {
+        outstandingDrains_--;
+        return;
+    }
+
+    size_t ran = 0;
+    while (true) {
+        std::function<void()> task;
+        bool finished = false;
+        size_t requeueAt = kTaskPriorityCount;
+        {
+            std::lock_guard<std::mutex> lock(lane->mutex);
+            if (lane->mailbox.empty()) {
+                lane->running = false;
+                finished = true;
+            } else if (ran < kDrainBatch) {
+                Entry& next = lane->mailbox.front();
+                lane->waiting[static_cast<size_t>(next.priority)]--;
+                task = std::move(next.task);
+                lane->mailbox.pop_front();
+                pendingTasks_--;
+            } else {
+                // Batch used up: yield the worker to other lanes
+                lane->running = false;
+                if (lane->queuedDrains > 0) {
+                    // A drain queued for more urgent work continues the lane
+                    finished = true;
+                } else {
+                    requeueAt = lane->mostUrgent();
+                    lane->queuedDrains++;
+                    lane->queuedPriority = requeueAt;
+                }
+            }
+        }
+
+        if (finished) {
+            // Only after the lane lock is released, so the destructor may proceed
+            outstandingDrains_--;
+            return;
+        }
+
+        if (requeueAt != kTaskPriorityCount) {
+            // Requeue behind other lanes so a busy conversation cannot monopolise
+            // a worker; the new drain takes over this one's outstanding count
+            try {
+                workerPool_->submit(static_cast<TaskPriority>(requeueAt), [this, lane]() { drain(lane); });
+                return;
+            } catch (const std::exception&) {
+                // Pool is stopping; finish this lane here
+                std::lock_guard<std::mutex> lock(lane->mutex);
+                lane->queuedDrains--;
+                if (lane->queuedDrains == 0) {
+                    lane->queuedPriority = kTaskPriorityCount;
+                }
+                lane->running = true;
+                ran = 0;
+                continue;
+            }
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            LOG_ERROR("dispatcher", "Task execution failed", {{"error", e.what()}});
+        }
+        ran++;
+    }
+}
+
+OrderedDispatcher::Lane& OrderedDispatcher::laneFor(uint64_t key) {
+    // Fibonacci hashing spreads clustered ids across lanes
+    uint64_t hash = key * 11400714819323198485ULL;
+    return *lanes_[(hash >> 32) % lanes_.size()];
+}
+
+} // namespace messaging_service
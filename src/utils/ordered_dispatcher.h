@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tracing.h"
+#include "worker_pool.h"
+
+namespace messaging_service {
+
+/**
+ * @brief Runs tasks in submission order per key on top of a WorkerPool
+ *
+ * Keys (conversation ids) hash onto a fixed set of serial lanes. Each lane is
+ * a small mailbox with its own mutex: while it has work, exactly one drain
+ * task for it sits in the worker pool, so tasks sharing a lane never overlap
+ * or reorder, and tasks on different lanes run in parallel. No lock is shared
+ * between lanes on the dispatch path.
+ *
+ * A lane is one FIFO whatever the priority of its tasks, so tasks sharing a
+ * lane never reorder. Its drain task is queued in the pool at the priority
+ * of the most urgent task waiting in the lane: an interactive send that
+ * hashes onto a lane of scheduled bulk raises the whole lane ahead of other
+ * bulk in the pool, and runs once the tasks queued before it have.
+ */
+class OrderedDispatcher {
+public:
+    /**
+     * @brief Constructor
+     * @param workerPool Pool that executes lane drain tasks (not owned)
+     * @param laneCount Number of serial lanes; more lanes means fewer unrelated
+     *                  conversations queued behind each other (default: 256)
+     */
+    explicit OrderedDispatcher(WorkerPool* workerPool, size_t laneCount = 256);
+    
+    /**
+     * @brief Destructor - waits for drain tasks still running on the pool
+     */
+    ~OrderedDispatcher();
+
+    /**
+     * @brief Submit a task to run after every earlier task with the same key
+     * @param key Ordering key, e.g. conversation id
+     * @param f Function to execute
+     * @param priority Scheduling class of the task (default: interactive)
+     * @return Future containing the result of the task
+     */
+    template<typename F>
+    auto submit(uint64_t key, F&& f, TaskPriority priority = TaskPriority::Interactive)
+        -> std::future<decltype(f())>;
+
+    /**
+     * @brief Get the number of lanes
+     */
+    size_t getLaneCount() const;
+
+    /**
+     * @brief Get the number of tasks queued in lanes and not yet started
+     */
+    size_t getPendingTaskCount() const;
+
+    /**
+     * @brief Drop every task queued in a lane that has not started
+     * Used when shutdown runs out of time. Futures of dropped tasks report
+     * std::future_errc::broken_promise; running tasks are unaffected.
+     * @return Number of tasks dropped
+     */
+    size_t discardPending();
+
+private:
+    struct Entry {
+        TaskPriority priority;
+        std::function<void()> task;
+    };
+
+    struct Lane {
+        std::mutex mutex;
+        std::deque<Entry> mailbox;
+        std::array<size_t, kTaskPriorityCount> waiting{};   // queued tasks per class
+        size_t queuedDrains = 0;       // drain tasks for this lane waiting in the pool
+        size_t queuedPriority = kTaskPriorityCount;   // most urgent class of those drains
+        bool running = false;          // a drain task is taking tasks from the lane
+
+        size_t mostUrgent() const;     // index of the most urgent class waiting in the lane
+    };
+
+    // Append a task to a lane and schedule a drain if none would reach it soon enough
+    void enqueue(uint64_t key, TaskPriority priority, std::function<void()> task);
+
+    // Queue a drain task for a lane; expects queuedDrains already counted
+    void scheduleDrain(Lane* lane, TaskPriority priority);
+
+    // Run queued tasks of a lane; runs on a worker thread
+    void drain(Lane* lane);
+
+    Lane& laneFor(uint64_t key);
+
+    // Tasks run per drain before yielding the worker to other lanes
+    static constexpr size_t kDrainBatch = 16;
+
+    WorkerPool* workerPool_;
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    std::atomic<size_t> pendingTasks_;
+    std::atomic<size_t> outstandingDrains_;   // drain tasks queued or running
+};
+
+// Template implementation
+template<typename F>
+auto OrderedDispatcher::submit(uint64_t key, F&& f, TaskPriority priority) -> std::future<decltype(f())> {
+    using ReturnType = decltype(f());
+
+    auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<F>(f));
+    std::future<ReturnType> result = task->get_future();
+
+    // The task continues the submitter's trace, with its time in the queue as a stage
+    CapturedTrace trace = CapturedTrace::current();
+    if (!trace.trace) {
+        enqueue(key, priority, [task]() { (*task)(); });
+        return result;
+    }
+    auto enqueued = std::chrono::system_clock::now();
+    enqueue(key, priority, [task, trace, enqueued]() {
+        recordSpan(trace, "worker_pool.wait", enqueued, std::chrono::system_clock::now());
+        TraceScope scope(trace);
+        (*task)();
+    });
+
+    return result;
+}
+
+} // namespace messaging_service
@@ -0,0 +1,220 @@
+#include "rate_shaper.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+namespace messaging_service {
+
+namespace {
+
+double envDouble(const char* name, double fallback) {
+    const char* value = std::getenv(name);
+    if (!value) {
+        return fallback;
+    }
+    try {
+        return std::stod(value);
+    } catch (const std::exception&) {
+        return fallback;
+    }
+}
+
+RateLimit limitFromEnvironment(const char* rateName, const char* burstName) {
+    RateLimit limit;
+    limit.ratePerSecond = std::max(0.0, envDouble(rateName, 0.0));
+    limit.burst = std::max(1.0, envDouble(burstName, 1.0));
+    return limit;
+}
+
+} // namespace
+
+RateShaperConfig RateShaperConfig::fromEnvironment() {
+    RateShaperConfig config;
+    config.perSender = limitFromEnvironment("RATE_LIMIT_SENDER_PER_SEC", "RATE_LIMIT_SENDER_BURST");
+    config.perRecipient = limitFromEnvironment("RATE_LIMIT_RECIPIENT_PER_SEC", "RATE_LIMIT_RECIPIENT_BURST");
+    config.perProvider = limitFromEnvironment("RATE_LIMIT_PROVIDER_PER_SEC", "RATE_LIMIT_PROVIDER_BURST");
+    config.idleTtl = std::chrono::seconds(static_cast<long>(envDouble("RATE_LIMIT_IDLE_TTL_SEC", 300)));
+    config.maxDelay = std::chrono::seconds(static_cast<long>(envDouble("RATE_LIMIT_MAX_DELAY_SEC", 3600)));
+    return config;
+}
+
+TokenBucketTable::TokenBucketTable(const RateLimit& limit, size_t shardCount, std::chrono::seconds idleTtl)
+    : limit_(limit), emissionIntervalNs_(0), burstToleranceNs_(0),
+      idleTtlNs_(std::chrono::duration_cast<std::chrono::nanoseconds>(idleTtl).count()) {
+    if (limit_.enabled()) {
+        emissionIntervalNs_ = static_cast<int64_t>(1e9 / limit_.ratePerSecond);
+        burstToleranceNs_ = static_cast<int64_t>((std::max(1.0, limit_.burst) - 1.0) * emissionIntervalNs_);
+    }
+    shardCount = std::max<size_t>(1, shardCount);
+    shards_.reserve(shardCount);
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+TokenBucketTable::Clock::time_point TokenBucketTable::conformingAt(const std::string& key, Clock::time_point now) {
+    if (!enabled()) {
+        return now;
+    }
+    Shard& shard = shardFor(key);
+    auto it = shard.buckets.find(key);
+    if (it == shard.buckets.end()) {
+        return now;
+    }
+    int64_t allowedNs = it->second.tatNs - burstToleranceNs_;
+    int64_t nowNs = toNs(now);
+    return allowedNs <= nowNs ? now : now + std::chrono::nanoseconds(allowedNs - nowNs);
+}
+
+void TokenBucketTable::consume(const std::string& key, Clock::time_point at) {
+    if (!enabled()) {
+        return;
+    }
+    Shard& shard = shardFor(key);
+    int64_t atNs = toNs(at);
+    int64_t nowNs = toNs(Clock::now());
+
+    auto result = shard.buckets.emplace(key, Bucket{atNs, nowNs});
+    Bucket& bucket = result.first->second;
+    bucket.tatNs = std::max(bucket.tatNs, atNs) + emissionIntervalNs_;
+    bucket.lastSeenNs = nowNs;
+
+    // Amortised idle eviction: sweep a shard at most every quarter TTL
+    if (nowNs - shard.lastSweepNs > idleTtlNs_ / 4) {
+        sweepLocked(shard, nowNs);
+    }
+}
+
+void TokenBucketTable::refund(const std::string& key) {
+    if (!enabled()) {
+        return;
+    }
+    Shard& shard = shardFor(key);
+    auto it = shard.buckets.find(key);
+    if (it == shard.buckets.end()) {
+        return;
+    }
+    // TAT is the sum of all reservations, so stepping it back one interval
+    // returns one token no matter which reservation it was
+    it->second.tatNs -= emissionIntervalNs_;
+}
+
+std::unique_lock<std::mutex> TokenBucketTable::lockShard(const std::string& key) {
+    return std::unique_lock<std::mutex>(shardFor(key).mutex);
+}
+
+size_t TokenBucketTable::evictIdle(Clock::time_point now) {
+    size_t removed = 0;
+    int64_t nowNs = toNs(now);
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        removed += sweepLocked(*shard, nowNs);
+    }
+    return removed;
+}
+
+size_t TokenBucketTable::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->buckets.size();
+    }
+    return total;
+}
+
+TokenBucketTable::Shard& TokenBucketTable::shardFor(const std::string& key) {
+    return *shards_[std::hash<std::string>{}(key) % shards_.size()];
+}
+
+size_t TokenBucketTable::sweepLocked(Shard& shard, int64_t nowNs) {
+    size_t removed = 0;
+    for (auto it = shard.buckets.begin(); it != shard.buckets.end();) {
+        // A bucket whose TAT has passed is full, so dropping it changes nothing
+        bool full = it->second.tatNs <= nowNs;
+        bool idle = nowNs - it->second.lastSeenNs > idleTtlNs_;
+        if (full && idle) {
+            it = shard.buckets.erase(it);
+            removed++;
+        } else {
+            ++it;
+        }
+    }
+    shard.lastSweepNs = nowNs;
+    return removed;
+}
+
+int64_t TokenBucketTable::toNs(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+RateShaper::RateShaper(const RateShaperConfig& config)
+    : config_(config),
+      senders_(config.perSender, config.shardCount, config.idleTtl),
+      recipients_(config.perRecipient, config.shardCount, config.idleTtl),
+      providers_(config.perProvider, config.shardCount, config.idleTtl) {
+    if (enabled()) {
+        LOG_INFO("rate_shaper", "Outbound rate limits enabled", {{"sender_per_sec", config_.perSender.ratePerSecond},
+                 {"recipient_per_sec", config_.perRecipient.ratePerSecond},
+                 {"provider_per_sec", config_.perProvider.ratePerSecond}});
+    }
+}
+
+bool RateShaper::reserve(const std::string& from, const std::string& to, const std::string& provider,
+                         std::chrono::milliseconds& delay) {
+    delay = std::chrono::milliseconds(0);
+    if (!enabled()) {
+        return true;
+    }
+
+    // Lock one shard per level, always in the same level order, so the
+    // check-and-consume across the hierarchy is atomic without a global lock
+    auto senderLock = senders_.lockShard(from);
+    auto recipientLock = recipients_.lockShard(to);
+    auto providerLock = providers_.lockShard(provider);
+
+    auto now = Clock::now();
+    auto at = std::max({senders_.conformingAt(from, now),
+                        recipients_.conformingAt(to, now),
+                        providers_.conformingAt(provider, now)});
+
+    if (at - now > config_.maxDelay) {
+        return false;
+    }
+
+    senders_.consume(from, at);
+    recipients_.consume(to, at);
+    providers_.consume(provider, at);
+
+    // Round up so a caller sleeping for the delay never sends early
+    delay = std::chrono::duration_cast<std::chrono::milliseconds>(at - now + std::chrono::microseconds(999));
+    return true;
+}
+
+void RateShaper::release(const std::string& from, const std::string& to, const std::string& provider) {
+    if (!enabled()) {
+        return;
+    }
+
+    auto senderLock = senders_.lockShard(from);
+    auto recipientLock = recipients_.lockShard(to);
+    auto providerLock = providers_.lockShard(provider);
+    senders_.refund(from);
+    recipients_.refund(to);
+    providers_.refund(provider);
+}
+
+bool RateShaper::enabled() const {
+    return senders_.enabled() || recipients_.enabled() || providers_.enabled();
+}
+
+size_t RateShaper::bucketCount() const {
+    return senders_.size() + recipients_.size() + providers_.size();
+}
+
+size_t RateShaper::evictIdle() {
+    auto now = Clock::now();
+    return senders_.evictIdle(now) + recipients_.evictIdle(now) + providers_.evictIdle(now);
+}
+
+} // namespace messaging_service
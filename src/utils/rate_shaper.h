@@ -0,0 +1,183 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace messaging_service {
+
+/**
+ * @brief Sustained rate and burst size for one level of the bucket hierarchy
+ */
+struct RateLimit {
+    double ratePerSecond = 0.0;   // 0 disables this level
+    double burst = 1.0;           // tokens available after an idle period
+
+    bool enabled() const { return ratePerSecond > 0.0; }
+};
+
+/**
+ * @brief Configuration for RateShaper
+ */
+struct RateShaperConfig {
+    RateLimit perSender;          // keyed by from-number / from-address
+    RateLimit perRecipient;       // keyed by to-number / to-address
+    RateLimit perProvider;        // keyed by provider name
+    std::chrono::seconds idleTtl{300};    // evict buckets idle for this long
+    std::chrono::seconds maxDelay{3600};  // reject instead of queueing beyond this
+    size_t shardCount = 64;
+
+    /**
+     * @brief Build a config from RATE_LIMIT_* environment variables
+     * All levels are disabled unless their *_PER_SEC variable is set.
+     */
+    static RateShaperConfig fromEnvironment();
+};
+
+/**
+ * @brief Sharded table of token buckets for one key space
+ *
+ * Buckets use the GCRA formulation: each key stores only its theoretical
+ * arrival time (TAT), so a bucket is 16 bytes plus its key. A bucket whose
+ * TAT has passed is indistinguishable from a fresh one, which makes idle
+ * eviction lossless; the TTL only avoids churn for keys that come back.
+ */
+class TokenBucketTable {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucketTable(const RateLimit& limit, size_t shardCount, std::chrono::seconds idleTtl);
+
+    // conformingAt(), consume() and refund() expect the caller to hold lockShard(key)
+
+    /**
+     * @brief Earliest time a send for this key conforms to the limit
+     * @param key Bucket key
+     * @param now Current time
+     * @return now or a later time point
+     */
+    Clock::time_point conformingAt(const std::string& key, Clock::time_point now);
+
+    /**
+     * @brief Take one token for a send happening at the given time
+     * @param key Bucket key
+     * @param at Time the send will happen (>= conformingAt)
+     */
+    void consume(const std::string& key, Clock::time_point at);
+
+    /**
+     * @brief Give back one token taken by consume() for a send that did not happen
+     * @param key Bucket key
+     */
+    void refund(const std::string& key);
+
+    /**
+     * @brief Lock the shard owning a key; used to make hierarchical reservations atomic
+     */
+    std::unique_lock<std::mutex> lockShard(const std::string& key);
+
+    /**
+     * @brief Remove buckets idle for longer than the TTL from every shard
+     * @param now Current time
+     * @return Number of buckets removed
+     */
+    size_t evictIdle(Clock::time_point now);
+
+    /**
+     * @brief Number of live buckets
+     */
+    size_t size() const;
+
+    bool enabled() const { return limit_.enabled(); }
+
+private:
+    struct Bucket {
+        int64_t tatNs;        // theoretical arrival time
+        int64_t lastSeenNs;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Bucket> buckets;
+        int64_t lastSweepNs = 0;
+    };
+
+    Shard& shardFor(const std::string& key);
+
+    /**
+     * @brief Drop idle buckets from a shard whose lock is held
+     */
+    size_t sweepLocked(Shard& shard, int64_t nowNs);
+
+    static int64_t toNs(Clock::time_point time);
+
+    RateLimit limit_;
+    int64_t emissionIntervalNs_;   // 1 / rate
+    int64_t burstToleranceNs_;     // (burst - 1) / rate
+    int64_t idleTtlNs_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+/**
+ * @brief Hierarchical rate shaping across sender, recipient and provider
+ *
+ * reserve() finds the first instant at which all three buckets conform and
+ * takes a token from each for that instant. Callers send immediately when the
+ * returned delay is zero and otherwise hand the message to the scheduler, so
+ * bursts are smoothed rather than rejected.
+ */
+class RateShaper {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RateShaper(const RateShaperConfig& config);
+
+    /**
+     * @brief Reserve a send slot for a message
+     * @param from Sender address
+     * @param to Recipient address
+     * @param provider Provider name
+     * @param delay Receives how long the caller must wait before sending
+     * @return true if reserved; false if the wait would exceed maxDelay (nothing is consumed)
+     */
+    bool reserve(const std::string& from, const std::string& to, const std::string& provider,
+                 std::chrono::milliseconds& delay);
+
+    /**
+     * @brief Return the tokens of a reservation whose send will not happen
+     * Callers that fail after reserve() succeeded call this, so the sender is
+     * not throttled for a send that was never made.
+     * @param from Sender address
+     * @param to Recipient address
+     * @param provider Provider name
+     */
+    void release(const std::string& from, const std::string& to, const std::string& provider);
+
+    /**
+     * @brief Check whether any level of shaping is enabled
+     */
+    bool enabled() const;
+
+    /**
+     * @brief Total number of live buckets across all levels
+     */
+    size_t bucketCount() const;
+
+    /**
+     * @brief Evict idle buckets from every level
+     * @return Number of buckets removed
+     */
+    size_t evictIdle();
+
+private:
+    RateShaperConfig config_;
+    TokenBucketTable senders_;
+    TokenBucketTable recipients_;
+    TokenBucketTable providers_;
+};
+
+} // namespace messaging_service
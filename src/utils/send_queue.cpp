@@ -0,0 +1,55 @@
+#include "send_queue.h"
+#include "logger.h"
+#include "tracing.h"
+#include <future>
+#include <memory>
+
+namespace messaging_service {
+
+SendQueue::SendQueue(FairQueue* fairQueue, OrderedDispatcher* dispatcher)
+    : fairQueue_(fairQueue), dispatcher_(dispatcher) {}
+
+SendQueue::Outcome SendQueue::send(const std::string& tenant, uint64_t laneKey,
+                                   const std::function<MessageResponse()>& send, MessageResponse& response) {
+    // The promise is only ever fulfilled by the lane task, which catches what
+    // the send throws, so an exception from the future means it never ran
+    auto result = std::make_shared<std::promise<MessageResponse>>();
+    auto future = result->get_future();
+    CapturedTrace trace = CapturedTrace::current();
+    FairQueue* fairQueue = fairQueue_;
+    OrderedDispatcher* dispatcher = dispatcher_;
+    bool queued = fairQueue->enqueue(tenant, [fairQueue, dispatcher, result, trace, laneKey, send]() {
+        // Continue the request's trace on whichever thread starts the send
+        TraceScope scope(trace);
+        try {
+            dispatcher->submit(laneKey, [fairQueue, result, send]() {
+                MessageResponse sent;
+                try {
+                    sent = send();
+                } catch (const std::exception& e) {
+                    sent = MessageResponse(false, e.what(), "", 500);
+                } catch (...) {
+                    sent = MessageResponse(false, "Provider send failed", "", 500);
+                }
+                result->set_value(sent);
+                fairQueue->complete();
+            }, TaskPriority::Interactive);
+        } catch (...) {
+            result->set_exception(std::current_exception());
+            fairQueue->complete();
+        }
+    });
+    if (!queued) {
+        return Outcome::TenantQueueFull;
+    }
+
+    try {
+        response = future.get();
+    } catch (const std::exception& e) {
+        LOG_WARN("send_queue", "Send not dispatched", {{"error", e.what()}});
+        return Outcome::Unavailable;
+    }
+    return Outcome::Sent;
+}
+
+} // namespace messaging_service
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "fair_queue.h"
+#include "ordered_dispatcher.h"
+#include "../providers/messaging_provider.h"
+
+namespace messaging_service {
+
+/**
+ * @brief Path of an immediate send from the request thread to the provider
+ *
+ * The tenant's fair queue decides when the send reaches the dispatcher, so
+ * one tenant's burst cannot fill the worker pool ahead of everyone else, and
+ * the conversation's lane then runs it after the sends queued before it.
+ * The request thread waits for the provider's response.
+ *
+ * send() tells a send that never reached the provider (tenant backlog full,
+ * worker pool stopped, or the lane discarded on drain) apart from one that
+ * did, so callers can treat the first as a refusal that is safe to retry.
+ */
+class SendQueue {
+public:
+    enum class Outcome {
+        Sent,              // the send function ran; response holds its result
+        TenantQueueFull,   // refused by the fair queue, nothing ran
+        Unavailable        // the dispatcher could not take it, nothing ran
+    };
+
+    /**
+     * @param fairQueue Per-tenant queue in front of the dispatcher (not owned)
+     * @param dispatcher Per-conversation lanes the sends run on (not owned)
+     */
+    SendQueue(FairQueue* fairQueue, OrderedDispatcher* dispatcher);
+
+    /**
+     * @brief Queue a send and wait for it to finish
+     * @param tenant Tenant the send is charged to
+     * @param laneKey Ordering key, e.g. conversation id
+     * @param send Calls the provider; an exception becomes a 500 response
+     * @param response Receives the result when Sent
+     */
+    Outcome send(const std::string& tenant, uint64_t laneKey,
+                 const std::function<MessageResponse()>& send, MessageResponse& response);
+
+private:
+    FairQueue* fairQueue_;
+    OrderedDispatcher* dispatcher_;
+};
+
+} // namespace messaging_service
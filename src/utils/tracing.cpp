@@ -0,0 +1,440 @@
+#include "tracing.h"
+#include "json_parser.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace messaging_service {
+
+namespace {
+
+struct ThreadTraceState {
+    std::shared_ptr<Trace> trace;
+    uint64_t spanId = 0;
+};
+
+thread_local ThreadTraceState threadTrace;
+
+uint64_t randomId() {
+    thread_local std::mt19937_64 generator(std::random_device{}() ^
+                                           std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    uint64_t id;
+    do {
+        id = generator();
+    } while (id == 0);
+    return id;
+}
+
+double randomUnit() {
+    return static_cast<double>(randomId() >> 11) / static_cast<double>(1ULL << 53);
+}
+
+int64_t toUnixNs(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+int64_t nowUnixNs() {
+    return toUnixNs(std::chrono::system_clock::now());
+}
+
+void appendHex(std::string& out, uint64_t value) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    out.append(buffer, 16);
+}
+
+std::string hex(uint64_t value) {
+    std::string out;
+    appendHex(out, value);
+    return out;
+}
+
+bool parseHex(const std::string& text, size_t offset, size_t length, uint64_t& value) {
+    if (offset + length > text.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = offset; i < offset + length; ++i) {
+        char c = text[i];
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return false;
+        value = (value << 4) | static_cast<uint64_t>(digit);
+    }
+    return true;
+}
+
+} // namespace
+
+std::string TraceContext::traceIdHex() const {
+    std::string out;
+    appendHex(out, traceIdHigh);
+    appendHex(out, traceIdLow);
+    return out;
+}
+
+std::string TraceContext::toTraceparent() const {
+    return "00-" + traceIdHex() + "-" + hex(spanId) + (sampled ? "-01" : "-00");
+}
+
+bool TraceContext::fromTraceparent(const std::string& header, TraceContext& context) {
+    // 00-<32 hex>-<16 hex>-<2 hex>
+    if (header.size() < 55 || header[2] != '-' || header[35] != '-' || header[52] != '-') {
+        return false;
+    }
+    TraceContext parsed;
+    uint64_t flags = 0;
+    if (!parseHex(header, 3, 16, parsed.traceIdHigh) || !parseHex(header, 19, 16, parsed.traceIdLow) ||
+        !parseHex(header, 36, 16, parsed.spanId) || !parseHex(header, 53, 2, flags)) {
+        return false;
+    }
+    if (!parsed.valid() || parsed.spanId == 0) {
+        return false;
+    }
+    parsed.sampled = (flags & 0x01) != 0;
+    context = parsed;
+    return true;
+}
+
+TracerConfig TracerConfig::fromEnvironment() {
+    TracerConfig config;
+    if (const char* rate = std::getenv("TRACE_SAMPLE_RATE")) {
+        config.sampleRate = std::min(1.0, std::max(0.0, std::atof(rate)));
+    }
+    if (const char* slow = std::getenv("TRACE_SLOW_MS")) {
+        config.slowThresholdMs = std::max(0L, std::atol(slow));
+    }
+    if (const char* file = std::getenv("TRACE_EXPORT_FILE")) {
+        config.exportFile = file;
+    }
+    return config;
+}
+
+Tracer::Tracer(const TracerConfig& config)
+    : config_(config), enabled_(config.sampleRate > 0.0 || config.slowThresholdMs > 0),
+      writing_(false), stop_(false), dropped_(0) {
+    if (!config_.exportFile.empty() && config_.sampleRate > 0.0) {
+        exporter_ = std::thread(&Tracer::exporterLoop, this);
+    }
+    if (enabled_) {
+        LOG_INFO("tracer", "Tracing enabled", {{"sample_rate", config_.sampleRate},
+                 {"slow_ms", static_cast<long long>(config_.slowThresholdMs)}, {"export_file", config_.exportFile}});
+    }
+}
+
+Tracer::~Tracer() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        stop_ = true;
+    }
+    queueCondition_.notify_all();
+    if (exporter_.joinable()) {
+        exporter_.join();
+    }
+}
+
+Tracer& Tracer::instance() {
+    // Never destroyed, like Logger::instance(), so late spans have somewhere to go
+    static Tracer* tracer = [] {
+        Tracer* created = new Tracer(TracerConfig::fromEnvironment());
+        std::atexit([] { Tracer::instance().flush(); });
+        return created;
+    }();
+    return *tracer;
+}
+
+void Tracer::flush() {
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    if (!exporter_.joinable()) {
+        return;
+    }
+    drainedCondition_.wait(lock, [this] { return (queue_.empty() && !writing_) || stop_; });
+}
+
+uint64_t Tracer::getDroppedCount() const {
+    return dropped_.load();
+}
+
+TraceContext Tracer::currentContext() {
+    if (!threadTrace.trace) {
+        return TraceContext();
+    }
+    TraceContext context = threadTrace.trace->context();
+    context.spanId = threadTrace.spanId;
+    return context;
+}
+
+void Tracer::finish(Trace& trace) {
+    const TraceContext& context = trace.context();
+    bool exportTrace = context.sampled && exporter_.joinable();
+    if (!exportTrace && config_.slowThresholdMs <= 0) {
+        return;
+    }
+
+    std::vector<SpanData> spans = trace.spans();
+    const SpanData* root = nullptr;
+    for (const auto& span : spans) {
+        if (span.spanId == context.spanId) {
+            root = &span;
+        }
+    }
+
+    if (root && config_.slowThresholdMs > 0) {
+        int64_t durationNs = root->endNs - root->startNs;
+        if (durationNs >= config_.slowThresholdMs * 1000000) {
+            // Total time per stage, in the order stages first started
+            std::vector<const SpanData*> ordered;
+            for (const auto& span : spans) {
+                if (&span != root) {
+                    ordered.push_back(&span);
+                }
+            }
+            std::sort(ordered.begin(), ordered.end(), [](const SpanData* a, const SpanData* b) {
+                return a->startNs < b->startNs;
+            });
+            std::vector<std::pair<std::string, int64_t>> stages;
+            for (const SpanData* span : ordered) {
+                auto it = std::find_if(stages.begin(), stages.end(), [span](const std::pair<std::string, int64_t>& stage) {
+                    return stage.first == span->name;
+                });
+                if (it == stages.end()) {
+                    stages.emplace_back(span->name, span->endNs - span->startNs);
+                } else {
+                    it->second += span->endNs - span->startNs;
+                }
+            }
+            std::string breakdown;
+            for (const auto& stage : stages) {
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "=%.2fms", static_cast<double>(stage.second) / 1e6);
+                breakdown += (breakdown.empty() ? "" : " ") + stage.first + buffer;
+            }
+            LOG_WARN("trace", "Slow request", {{"request_id", trace.requestId()}, {"trace_id", context.traceIdHex()},
+                     {"name", root->name}, {"duration_ms", static_cast<double>(durationNs) / 1e6}, {"stages", breakdown}});
+        }
+    }
+
+    if (exportTrace) {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (queue_.size() >= config_.maxQueuedTraces) {
+            dropped_++;
+            return;
+        }
+        queue_.emplace_back(context, std::move(spans));
+        queueCondition_.notify_one();
+    }
+}
+
+void Tracer::exporterLoop() {
+    FILE* file = std::fopen(config_.exportFile.c_str(), "a");
+    if (!file) {
+        LOG_ERROR("tracer", "Failed to open trace export file", {{"path", config_.exportFile}});
+    }
+
+    while (true) {
+        std::deque<std::pair<TraceContext, std::vector<SpanData>>> batch;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueCondition_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (queue_.empty() && stop_) {
+                break;
+            }
+            batch.swap(queue_);
+            writing_ = true;
+        }
+
+        if (file) {
+            for (const auto& trace : batch) {
+                std::string line = toOtlpJson(trace.first, trace.second);
+                line += '\n';
+                std::fwrite(line.data(), 1, line.size(), file);
+            }
+            std::fflush(file);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            writing_ = false;
+        }
+        drainedCondition_.notify_all();
+    }
+
+    if (file) {
+        std::fclose(file);
+    }
+    drainedCondition_.notify_all();
+}
+
+std::string Tracer::toOtlpJson(const TraceContext& context, const std::vector<SpanData>& spans) {
+    std::string json = "{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":\"service.name\","
+                       "\"value\":{\"stringValue\":\"messaging-service\"}}]},"
+                       "\"scopeSpans\":[{\"scope\":{\"name\":\"messaging-service\"},\"spans\":[";
+    std::string traceId = context.traceIdHex();
+    bool first = true;
+    for (const auto& span : spans) {
+        if (!first) {
+            json += ",";
+        }
+        first = false;
+        json += "{\"traceId\":\"" + traceId + "\",\"spanId\":\"" + hex(span.spanId) + "\",";
+        if (span.parentSpanId != 0) {
+            json += "\"parentSpanId\":\"" + hex(span.parentSpanId) + "\",";
+        }
+        json += "\"name\":\"" + JsonParser::escape(span.name) + "\",";
+        // SERVER for the root of a request, INTERNAL for stages
+        json += "\"kind\":" + std::string(span.spanId == context.spanId ? "2" : "1") + ",";
+        json += "\"startTimeUnixNano\":\"" + std::to_string(span.startNs) + "\",";
+        json += "\"endTimeUnixNano\":\"" + std::to_string(span.endNs) + "\",";
+        json += "\"attributes\":[";
+        for (size_t i = 0; i < span.attributes.size(); ++i) {
+            if (i > 0) {
+                json += ",";
+            }
+            json += "{\"key\":\"" + JsonParser::escape(span.attributes[i].first) +
+                    "\",\"value\":{\"stringValue\":\"" + JsonParser::escape(span.attributes[i].second) + "\"}}";
+        }
+        json += "],\"status\":{\"code\":" + std::string(span.error ? "2" : "0") + "}}";
+    }
+    json += "]}]}]}";
+    return json;
+}
+
+Trace::Trace(Tracer& tracer, const TraceContext& context, std::string requestId)
+    : tracer_(tracer), context_(context), requestId_(std::move(requestId)) {
+    spans_.reserve(16);
+}
+
+void Trace::addSpan(SpanData span) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    spans_.push_back(std::move(span));
+}
+
+std::vector<SpanData> Trace::spans() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spans_;
+}
+
+CapturedTrace CapturedTrace::current() {
+    CapturedTrace captured;
+    captured.trace = threadTrace.trace;
+    captured.parentSpanId = threadTrace.spanId;
+    return captured;
+}
+
+RequestTrace::RequestTrace(const std::string& name, const std::string& requestId,
+                           const TraceContext* parent, Tracer& tracer)
+    : previousSpanId_(0) {
+    if (!tracer.enabled()) {
+        return;
+    }
+
+    TraceContext context;
+    if (parent && parent->valid()) {
+        context = *parent;
+        root_.parentSpanId = parent->spanId;
+    } else {
+        context.traceIdHigh = randomId();
+        context.traceIdLow = randomId();
+        context.sampled = randomUnit() < tracer.config_.sampleRate;
+    }
+    context.spanId = randomId();
+
+    root_.name = name;
+    root_.spanId = context.spanId;
+    root_.startNs = nowUnixNs();
+    root_.attributes.emplace_back("request.id", requestId);
+
+    trace_ = std::make_shared<Trace>(tracer, context, requestId);
+    previousTrace_ = std::move(threadTrace.trace);
+    previousSpanId_ = threadTrace.spanId;
+    threadTrace.trace = trace_;
+    threadTrace.spanId = root_.spanId;
+}
+
+RequestTrace::~RequestTrace() {
+    if (!trace_) {
+        return;
+    }
+    root_.endNs = nowUnixNs();
+    threadTrace.trace = std::move(previousTrace_);
+    threadTrace.spanId = previousSpanId_;
+
+    trace_->addSpan(std::move(root_));
+    trace_->tracer().finish(*trace_);
+}
+
+void RequestTrace::setAttribute(const std::string& key, const std::string& value) {
+    if (trace_) {
+        root_.attributes.emplace_back(key, value);
+    }
+}
+
+void RequestTrace::setError(bool error) {
+    root_.error = error;
+}
+
+TraceContext RequestTrace::context() const {
+    return trace_ ? trace_->context() : TraceContext();
+}
+
+Span::Span(const char* name) : trace_(threadTrace.trace.get()), previousSpanId_(0) {
+    if (!trace_) {
+        return;
+    }
+    data_.name = name;
+    data_.spanId = randomId();
+    data_.parentSpanId = threadTrace.spanId;
+    data_.startNs = nowUnixNs();
+    previousSpanId_ = threadTrace.spanId;
+    threadTrace.spanId = data_.spanId;
+}
+
+Span::~Span() {
+    if (!trace_) {
+        return;
+    }
+    data_.endNs = nowUnixNs();
+    threadTrace.spanId = previousSpanId_;
+    trace_->addSpan(std::move(data_));
+}
+
+void Span::setAttribute(const std::string& key, const std::string& value) {
+    if (trace_) {
+        data_.attributes.emplace_back(key, value);
+    }
+}
+
+void Span::setError(bool error) {
+    data_.error = error;
+}
+
+TraceScope::TraceScope(const CapturedTrace& captured)
+    : previousTrace_(std::move(threadTrace.trace)), previousSpanId_(threadTrace.spanId) {
+    threadTrace.trace = captured.trace;
+    threadTrace.spanId = captured.parentSpanId;
+}
+
+TraceScope::~TraceScope() {
+    threadTrace.trace = std::move(previousTrace_);
+    threadTrace.spanId = previousSpanId_;
+}
+
+void recordSpan(const CapturedTrace& captured, const char* name,
+                std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end) {
+    if (!captured.trace) {
+        return;
+    }
+    SpanData span;
+    span.name = name;
+    span.spanId = randomId();
+    span.parentSpanId = captured.parentSpanId;
+    span.startNs = toUnixNs(start);
+    span.endNs = toUnixNs(end);
+    captured.trace->addSpan(std::move(span));
+}
+
+} // namespace messaging_service
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace messaging_service {
+
+/**
+ * @brief Identifies a position in a trace; small enough to store with a scheduled message
+ */
+struct TraceContext {
+    uint64_t traceIdHigh = 0;
+    uint64_t traceIdLow = 0;
+    uint64_t spanId = 0;
+    bool sampled = false;
+
+    bool valid() const { return traceIdHigh != 0 || traceIdLow != 0; }
+
+    /**
+     * @brief 32 lowercase hex digits, as used by OTLP and W3C trace context
+     */
+    std::string traceIdHex() const;
+
+    /**
+     * @brief Render as a W3C traceparent header value
+     */
+    std::string toTraceparent() const;
+
+    /**
+     * @brief Parse a W3C traceparent header ("00-<trace id>-<span id>-<flags>")
+     * @return false if the value is malformed; the context is left unchanged
+     */
+    static bool fromTraceparent(const std::string& header, TraceContext& context);
+};
+
+/**
+ * @brief One finished span
+ */
+struct SpanData {
+    std::string name;
+    uint64_t spanId = 0;
+    uint64_t parentSpanId = 0;
+    int64_t startNs = 0;   // unix epoch nanoseconds
+    int64_t endNs = 0;
+    bool error = false;
+    std::vector<std::pair<std::string, std::string>> attributes;
+};
+
+/**
+ * @brief Configuration for Tracer
+ */
+struct TracerConfig {
+    double sampleRate = 0.0;       // fraction of traces exported to the file
+    int64_t slowThresholdMs = 0;   // log a stage breakdown for traces slower than this; 0 disables
+    std::string exportFile;        // OTLP JSON lines; empty disables export
+    size_t maxQueuedTraces = 1024; // traces waiting for the exporter before new ones are dropped
+
+    /**
+     * @brief Build a config from TRACE_SAMPLE_RATE, TRACE_SLOW_MS and TRACE_EXPORT_FILE
+     */
+    static TracerConfig fromEnvironment();
+};
+
+class Trace;
+
+/**
+ * @brief Collects spans and decides what happens to finished traces
+ *
+ * Tracing is off unless sampling or the slow-request log is configured; then
+ * every Span is a thread-local check and nothing else. When on, spans are
+ * buffered with their trace. A finished trace is queued for the exporter
+ * thread if it was sampled, and summarised in one log line if it was slow,
+ * so slow requests are visible even when they were not sampled.
+ */
+class Tracer {
+public:
+    explicit Tracer(const TracerConfig& config);
+
+    /**
+     * @brief Destructor - writes queued traces and stops the exporter
+     */
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    /**
+     * @brief Process-wide tracer, configured from the environment; flushed at exit
+     */
+    static Tracer& instance();
+
+    bool enabled() const { return enabled_; }
+
+    /**
+     * @brief Block until every finished trace queued so far has been written
+     */
+    void flush();
+
+    /**
+     * @brief Number of traces dropped because the export queue was full
+     */
+    uint64_t getDroppedCount() const;
+
+    /**
+     * @brief Context of the span currently active on this thread (invalid if none)
+     */
+    static TraceContext currentContext();
+
+    /**
+     * @brief Serialise a trace as one OTLP/JSON ExportTraceServiceRequest
+     */
+    static std::string toOtlpJson(const TraceContext& context, const std::vector<SpanData>& spans);
+
+private:
+    friend class RequestTrace;
+
+    // Called when the root span of a trace ends
+    void finish(Trace& trace);
+
+    void exporterLoop();
+
+    TracerConfig config_;
+    bool enabled_;
+
+    std::mutex queueMutex_;
+    std::condition_variable queueCondition_;
+    std::condition_variable drainedCondition_;
+    std::deque<std::pair<TraceContext, std::vector<SpanData>>> queue_;
+    bool writing_;
+    bool stop_;
+    std::atomic<uint64_t> dropped_;
+    std::thread exporter_;
+};
+
+/**
+ * @brief A trace being recorded; shared by the threads working on one request
+ */
+class Trace {
+public:
+    Trace(Tracer& tracer, const TraceContext& context, std::string requestId);
+
+    const TraceContext& context() const { return context_; }
+    const std::string& requestId() const { return requestId_; }
+
+    void addSpan(SpanData span);
+
+    /**
+     * @brief Copy of the spans recorded so far
+     */
+    std::vector<SpanData> spans() const;
+
+    Tracer& tracer() { return tracer_; }
+
+private:
+    Tracer& tracer_;
+    TraceContext context_;   // trace id, root span id and sampling decision
+    std::string requestId_;
+    mutable std::mutex mutex_;
+    std::vector<SpanData> spans_;
+};
+
+/**
+ * @brief Handle used to continue a trace on another thread
+ */
+struct CapturedTrace {
+    std::shared_ptr<Trace> trace;
+    uint64_t parentSpanId = 0;
+
+    /**
+     * @brief Capture the trace and span active on this thread
+     */
+    static CapturedTrace current();
+};
+
+/**
+ * @brief Root span of a request or of a scheduled send
+ *
+ * Installs a new trace on the current thread for its lifetime. The trace id
+ * comes from the parent context when one is given, so a scheduled send and
+ * the request that scheduled it share a trace.
+ */
+class RequestTrace {
+public:
+    /**
+     * @brief Constructor
+     * @param name Root span name, e.g. "POST /api/messages/sms"
+     * @param requestId Request id reported with the trace
+     * @param parent Remote or earlier context to continue, or nullptr
+     * @param tracer Tracer to report to
+     */
+    RequestTrace(const std::string& name, const std::string& requestId,
+                 const TraceContext* parent = nullptr, Tracer& tracer = Tracer::instance());
+    ~RequestTrace();
+
+    RequestTrace(const RequestTrace&) = delete;
+    RequestTrace& operator=(const RequestTrace&) = delete;
+
+    void setAttribute(const std::string& key, const std::string& value);
+    void setError(bool error);
+
+    /**
+     * @brief Context of the root span; invalid when tracing is disabled
+     */
+    TraceContext context() const;
+
+private:
+    std::shared_ptr<Trace> trace_;
+    SpanData root_;
+    std::shared_ptr<Trace> previousTrace_;
+    uint64_t previousSpanId_;
+};
+
+/**
+ * @brief Child span timing one stage; a no-op when no trace is active
+ */
+class Span {
+public:
+    explicit Span(const char* name);
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    void setAttribute(const std::string& key, const std::string& value);
+    void setError(bool error);
+
+    bool active() const { return trace_ != nullptr; }
+
+private:
+    Trace* trace_;
+    SpanData data_;
+    uint64_t previousSpanId_;
+};
+
+/**
+ * @brief Makes a captured trace current on this thread for its lifetime
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const CapturedTrace& captured);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    std::shared_ptr<Trace> previousTrace_;
+    uint64_t previousSpanId_;
+};
+
+/**
+ * @brief Record a span with explicit times, e.g. time spent waiting in a queue
+ * @param captured Trace the span belongs to; ignored if it has no trace
+ * @param name Span name
+ * @param start Start time
+ * @param end End time
+ */
+void recordSpan(const CapturedTrace& captured, const char* name,
+                std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end);
+
+} // namespace messaging_service
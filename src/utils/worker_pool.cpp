@@ -1,11 +1,81 @@
 #include "worker_pool.h"
-#include <iostream>
+#include "logger.h"
 #include <algorithm>
+#include <cstdlib>
 
 namespace messaging_service {
 
-WorkerPool::WorkerPool(size_t numWorkers) 
-    : numWorkers_(numWorkers), stop_(false), running_(true), pendingTasks_(0) {
+namespace {
+
+unsigned envWeight(const char* name, unsigned fallback) {
+    const char* value = std::getenv(name);
+    if (!value) {
+        return fallback;
+    }
+    try {
+        long parsed = std::stol(value);
+        return parsed > 0 ? static_cast<unsigned>(parsed) : fallback;
+    } catch (const std::exception&) {
+        return fallback;
+    }
+}
+
+} // namespace
+
+PriorityWeights PriorityWeights::fromEnvironment() {
+    PriorityWeights weights;
+    weights.interactive = envWeight("WORKER_WEIGHT_INTERACTIVE", weights.interactive);
+    weights.scheduled = envWeight("WORKER_WEIGHT_SCHEDULED", weights.scheduled);
+    weights.retry = envWeight("WORKER_WEIGHT_RETRY", weights.retry);
+    return weights;
+}
+
+const char* taskPriorityName(TaskPriority priority) {
+    switch (priority) {
+        case TaskPriority::Interactive: return "interactive";
+        case TaskPriority::Scheduled: return "scheduled";
+        case TaskPriority::Retry: return "retry";
+    }
+    return "unknown";
+}
+
+PriorityScheduler::PriorityScheduler(const PriorityWeights& weights) : pass_{}, clock_(0) {
+    // Strides are inversely proportional to weight; a zero weight counts as one
+    const uint64_t kStrideUnit = 1 << 20;
+    std::array<unsigned, kTaskPriorityCount> weightFor{weights.interactive, weights.scheduled, weights.retry};
+    for (size_t i = 0; i < kTaskPriorityCount; ++i) {
+        stride_[i] = kStrideUnit / std::max(1u, weightFor[i]);
+    }
+}
+
+void PriorityScheduler::activate(TaskPriority priority) {
+    uint64_t& pass = pass_[static_cast<size_t>(priority)];
+    pass = std::max(pass, clock_);
+}
+
+TaskPriority PriorityScheduler::next(const std::array<bool, kTaskPriorityCount>& waiting) {
+    size_t chosen = kTaskPriorityCount;
+    for (size_t i = 0; i < kTaskPriorityCount; ++i) {
+        // Ties go to the more urgent class, which comes first
+        if (waiting[i] && (chosen == kTaskPriorityCount || pass_[i] < pass_[chosen])) {
+            chosen = i;
+        }
+    }
+    if (chosen == kTaskPriorityCount) {
+        chosen = 0;
+    }
+    clock_ = pass_[chosen];
+    pass_[chosen] += stride_[chosen];
+    return static_cast<TaskPriority>(chosen);
+}
+
+WorkerPool::WorkerPool(size_t numWorkers, AdmissionController* admission, const PriorityWeights& weights) 
+    : numWorkers_(numWorkers), weights_(weights), scheduler_(weights), queuedTasks_(0), activeTasks_(0),
+      stop_(false), running_(true), pendingTasks_(0), admission_(admission) {
+    for (size_t i = 0; i < kTaskPriorityCount; ++i) {
+        queues_[i].queueWait = &MetricsRegistry::instance().histogram("worker_pool_queue_wait_seconds",
+            "Time tasks wait in the worker pool queue", {{"priority", taskPriorityName(static_cast<TaskPriority>(i))}});
+    }
     
     // Create worker threads
     workers_.reserve(numWorkers_);
@@ -13,7 +83,8 @@ WorkerPool::WorkerPool(size_t numWorkers)
         workers_.emplace_back(&WorkerPool::workerLoop, this);
     }
     
-    std::cout << "[WORKER POOL] Initialized with " << numWorkers_ << " workers" << std::endl;
+    LOG_INFO("worker_pool", "Initialized", {{"workers", numWorkers_}, {"interactive_weight", weights_.interactive},
+             {"scheduled_weight", weights_.scheduled}, {"retry_weight", weights_.retry}});
 }
 
 WorkerPool::~WorkerPool() {
@@ -29,18 +100,26 @@ void WorkerPool::workerLoop() {
             std::unique_lock<std::mutex> lock(queueMutex_);
             
             // Wait for a task or stop signal
-            condition_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+            condition_.wait(lock, [this] { return stop_ || queuedTasks_ > 0; });
             
             // Check if we should stop
-            if (stop_ && tasks_.empty()) {
+            if (stop_ && queuedTasks_ == 0) {
                 break;
             }
             
-            // Get the next task
-            if (!tasks_.empty()) {
-                task = std::move(tasks_.front());
-                tasks_.pop();
+            // Get the next task from the class whose turn it is
+            if (queuedTasks_ > 0) {
+                std::array<bool, kTaskPriorityCount> waiting;
+                for (size_t i = 0; i < kTaskPriorityCount; ++i) {
+                    waiting[i] = !queues_[i].tasks.empty();
+                }
+                PriorityQueue& queue = queues_[static_cast<size_t>(scheduler_.next(waiting))];
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop();
+                queue.pending--;
+                queuedTasks_--;
                 pendingTasks_--;
+                activeTasks_++;
             }
         }
         
@@ -49,7 +128,13 @@ void WorkerPool::workerLoop() {
             try {
                 task();
             } catch (const std::exception& e) {
-                std::cerr << "[WORKER POOL] Task execution failed: " << e.what() << std::endl;
+                LOG_ERROR("worker_pool", "Task execution failed", {{"error", e.what()}});
+            }
+            
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            activeTasks_--;
+            if (activeTasks_ == 0 && queuedTasks_ == 0) {
+                idleCondition_.notify_all();
             }
         }
     }
@@ -71,16 +156,66 @@ size_t WorkerPool::getPendingTaskCount() const {
     return pendingTasks_.load();
 }
 
+size_t WorkerPool::getPendingTaskCount(TaskPriority priority) const {
+    return queues_[static_cast<size_t>(priority)].pending.load();
+}
+
+const PriorityWeights& WorkerPool::getPriorityWeights() const {
+    return weights_;
+}
+
 bool WorkerPool::isRunning() const {
     return running_.load();
 }
 
+bool WorkerPool::waitIdle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    return idleCondition_.wait_for(lock, timeout, [this] { return activeTasks_ == 0 && queuedTasks_ == 0; });
+}
+
+void WorkerPool::push(TaskPriority priority, std::function<void()> task) {
+    PriorityQueue& queue = queues_[static_cast<size_t>(priority)];
+    auto enqueued = std::chrono::steady_clock::now();
+    Histogram* queueWait = queue.queueWait;
+    
+    // Only interactive waits drive load shedding: a bulk backlog is expected to
+    // queue, and shedding client requests would not shorten it
+    AdmissionController* admission = priority == TaskPriority::Interactive ? admission_ : nullptr;
+    
+    {
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        
+        // Check if we can accept new tasks
+        if (stop_) {
+            throw std::runtime_error("WorkerPool is stopped");
+        }
+        
+        if (queue.tasks.empty()) {
+            scheduler_.activate(priority);
+        }
+        queue.tasks.emplace([task = std::move(task), enqueued, queueWait, admission]() {
+            auto started = std::chrono::steady_clock::now();
+            queueWait->observe(started - enqueued);
+            if (admission) {
+                admission->recordSojourn(started - enqueued, started);
+            }
+            task();
+        });
+        queue.pending++;
+        queuedTasks_++;
+        pendingTasks_++;
+    }
+    
+    // Notify one worker
+    condition_.notify_one();
+}
+
 void WorkerPool::stop() {
     if (stop_) {
         return; // Already stopped
     }
     
-    std::cout << "[WORKER POOL] Stopping worker pool..." << std::endl;
+    LOG_INFO("worker_pool", "Stopping worker pool");
     
     {
         // Signal all workers to stop
@@ -99,7 +234,7 @@ void WorkerPool::stop() {
     }
     
     running_ = false;
-    std::cout << "[WORKER POOL] Worker pool stopped" << std::endl;
+    LOG_INFO("worker_pool", "Worker pool stopped");
 }
 
 } // namespace messaging_service
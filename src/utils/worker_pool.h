@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <thread>
 #include <vector>
 #include <queue>
@@ -9,19 +10,91 @@
 #include <future>
 #include <atomic>
 #include <memory>
+#include <chrono>
+
+#include "admission_controller.h"
+#include "metrics.h"
 
 namespace messaging_service {
 
+/**
+ * @brief Scheduling class of work submitted to a WorkerPool
+ */
+enum class TaskPriority {
+    Interactive,   // sends a client is waiting on
+    Scheduled,     // scheduled and campaign sends that came due
+    Retry          // sends deferred by rate limits and retried later
+};
+
+constexpr size_t kTaskPriorityCount = 3;
+
+/**
+ * @brief Metric label for a priority class
+ */
+const char* taskPriorityName(TaskPriority priority);
+
+/**
+ * @brief Relative share of workers each priority class gets while all are busy
+ */
+struct PriorityWeights {
+    unsigned interactive = 8;
+    unsigned scheduled = 2;
+    unsigned retry = 1;
+
+    /**
+     * @brief Build weights from WORKER_WEIGHT_INTERACTIVE, WORKER_WEIGHT_SCHEDULED and WORKER_WEIGHT_RETRY
+     */
+    static PriorityWeights fromEnvironment();
+};
+
+/**
+ * @brief Weighted choice between priority classes (stride scheduling)
+ *
+ * Each class has a virtual clock that advances by 1/weight whenever the class
+ * is served, and the waiting class with the earliest clock goes next. Busy
+ * classes therefore share service in proportion to their weights and even the
+ * lightest one is never starved. A class that had nothing waiting rejoins at
+ * the current clock, so it cannot bank its idle time and then monopolise.
+ * Not thread-safe; callers hold their own lock.
+ */
+class PriorityScheduler {
+public:
+    explicit PriorityScheduler(const PriorityWeights& weights = PriorityWeights());
+
+    /**
+     * @brief Note that a class went from having nothing waiting to having work
+     */
+    void activate(TaskPriority priority);
+
+    /**
+     * @brief Pick the class to serve next and charge it for one task
+     * @param waiting Which classes have work; at least one must be true
+     */
+    TaskPriority next(const std::array<bool, kTaskPriorityCount>& waiting);
+
+private:
+    std::array<uint64_t, kTaskPriorityCount> stride_;
+    std::array<uint64_t, kTaskPriorityCount> pass_;
+    uint64_t clock_;
+};
+
 /**
  * @brief Thread-safe worker pool for handling provider sendMessage operations
+ *
+ * Tasks queue per priority class and idle workers pick the next class with a
+ * PriorityScheduler, so a large burst of scheduled sends takes at most its
+ * weighted share of the workers while interactive sends are waiting.
  */
 class WorkerPool {
 public:
     /**
      * @brief Constructor with configurable number of workers
      * @param numWorkers Number of worker threads (default: 10)
+     * @param admission Controller told how long each interactive task waited, or nullptr
+     * @param weights Share of the workers each priority class gets under contention
      */
-    explicit WorkerPool(size_t numWorkers = 10);
+    explicit WorkerPool(size_t numWorkers = 10, AdmissionController* admission = nullptr,
+                        const PriorityWeights& weights = PriorityWeights());
     
     /**
      * @brief Destructor - stops all workers and waits for completion
@@ -29,13 +102,22 @@ public:
     ~WorkerPool();
     
     /**
-     * @brief Submit a task to the worker pool
+     * @brief Submit an interactive task to the worker pool
      * @param task Function to execute
      * @return Future containing the result of the task
      */
     template<typename F, typename... Args>
     auto submit(F&& f, Args&&... args) -> std::future<decltype(f(args...))>;
     
+    /**
+     * @brief Submit a task in the given priority class
+     * @param priority Scheduling class of the task
+     * @param task Function to execute
+     * @return Future containing the result of the task
+     */
+    template<typename F, typename... Args>
+    auto submit(TaskPriority priority, F&& f, Args&&... args) -> std::future<decltype(f(args...))>;
+    
     /**
      * @brief Get the number of active workers
      * @return Number of worker threads
@@ -48,18 +130,45 @@ public:
      */
     size_t getPendingTaskCount() const;
     
+    /**
+     * @brief Get the number of pending tasks in one priority class
+     */
+    size_t getPendingTaskCount(TaskPriority priority) const;
+    
+    /**
+     * @brief Weights the pool schedules priority classes with
+     */
+    const PriorityWeights& getPriorityWeights() const;
+    
     /**
      * @brief Check if the worker pool is running
      * @return true if running, false if stopped
      */
     bool isRunning() const;
     
+    /**
+     * @brief Wait until no task is queued or running
+     * Tasks may still be submitted while waiting, e.g. by tasks that requeue themselves.
+     * @param timeout Longest time to wait
+     * @return true if the pool became idle, false on timeout
+     */
+    bool waitIdle(std::chrono::milliseconds timeout);
+    
     /**
      * @brief Stop the worker pool and wait for all tasks to complete
      */
     void stop();
 
 private:
+    struct PriorityQueue {
+        std::queue<std::function<void()>> tasks;   // guarded by queueMutex_
+        std::atomic<size_t> pending{0};
+        Histogram* queueWait = nullptr;             // time tasks wait before a worker picks them up
+    };
+    
+    // Queue a wrapped task in its priority class
+    void push(TaskPriority priority, std::function<void()> task);
+    
     // Worker thread function
     void workerLoop();
     
@@ -72,12 +181,19 @@ private:
     // Worker threads
     std::vector<std::thread> workers_;
     
-    // Task queue
-    std::queue<std::function<void()>> tasks_;
+    // Task queues, one per priority class
+    std::array<PriorityQueue, kTaskPriorityCount> queues_;
+    PriorityWeights weights_;
+    PriorityScheduler scheduler_;   // guarded by queueMutex_
+    size_t queuedTasks_;            // across all classes, guarded by queueMutex_
     
     // Synchronization primitives
     mutable std::mutex queueMutex_;
     std::condition_variable condition_;
+    std::condition_variable idleCondition_;
+    
+    // Tasks taken from the queue and still running (guarded by queueMutex_)
+    size_t activeTasks_;
     
     // Control flags
     std::atomic<bool> stop_;
@@ -86,11 +202,18 @@ private:
     // Statistics
     mutable std::mutex statsMutex_;
     std::atomic<size_t> pendingTasks_;
+    
+    AdmissionController* admission_;
 };
 
 // Template implementation
 template<typename F, typename... Args>
 auto WorkerPool::submit(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
+    return submit(TaskPriority::Interactive, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<typename F, typename... Args>
+auto WorkerPool::submit(TaskPriority priority, F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
     using ReturnType = decltype(f(args...));
     
     // Create a packaged task
@@ -101,23 +224,7 @@ auto WorkerPool::submit(F&& f, Args&&... args) -> std::future<decltype(f(args...
     // Get future from the task
     std::future<ReturnType> result = task->get_future();
     
-    {
-        // Lock the queue
-        std::unique_lock<std::mutex> lock(queueMutex_);
-        
-        // Check if we can accept new tasks
-        if (stop_) {
-            throw std::runtime_error("WorkerPool is stopped");
-        }
-        
-        // Add task to queue
-        tasks_.emplace([task]() { (*task)(); });
-        pendingTasks_++;
-    }
-    
-    // Notify one worker
-    condition_.notify_one();
-    
+    push(priority, [task]() { (*task)(); });
     return result;
 }
 
@@ -0,0 +1,81 @@
+#include "test_framework.h"
+#include "../src/utils/admission_controller.h"
+#include <chrono>
+
+using namespace messaging_service;
+
+namespace {
+
+AdmissionConfig testConfig() {
+    AdmissionConfig config;
+    config.target = std::chrono::milliseconds(10);
+    config.interval = std::chrono::milliseconds(100);
+    return config;
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for AdmissionController class
+ */
+void runAdmissionControllerTests(TestFramework& framework) {
+
+    // Test that a burst shorter than the interval does not shed anything
+    TEST("AdmissionController::admit - tolerates short bursts") {
+        AdmissionController controller(testConfig());
+        auto now = AdmissionController::Clock::now();
+        controller.recordSojourn(std::chrono::milliseconds(50), now);
+        controller.recordSojourn(std::chrono::milliseconds(50), now + std::chrono::milliseconds(60));
+        controller.recordSojourn(std::chrono::milliseconds(1), now + std::chrono::milliseconds(80));
+        controller.recordSojourn(std::chrono::milliseconds(50), now + std::chrono::milliseconds(150));
+
+        ASSERT_FALSE(controller.isOverloaded(now + std::chrono::milliseconds(150)));
+        ASSERT_TRUE(controller.admit(AdmissionPriority::Low, now + std::chrono::milliseconds(150)));
+        return true;
+    });
+
+    // Test that a standing queue sheds low priority work but never high priority work
+    TEST("AdmissionController::admit - sheds low priority during a standing queue") {
+        AdmissionController controller(testConfig());
+        auto now = AdmissionController::Clock::now();
+        for (int ms = 0; ms <= 120; ms += 20) {
+            controller.recordSojourn(std::chrono::milliseconds(30), now + std::chrono::milliseconds(ms));
+        }
+        auto later = now + std::chrono::milliseconds(130);
+
+        ASSERT_TRUE(controller.isOverloaded(later));
+        ASSERT_FALSE(controller.admit(AdmissionPriority::Low, later));
+        ASSERT_TRUE(controller.admit(AdmissionPriority::High, later));
+        ASSERT_EQUAL(1u, controller.getRejectedCount());
+
+        // One wait below target shows the queue drained
+        controller.recordSojourn(std::chrono::milliseconds(2), later);
+        ASSERT_TRUE(controller.admit(AdmissionPriority::Low, later));
+        return true;
+    });
+
+    // Test that overload ends when the queues go quiet
+    TEST("AdmissionController::isOverloaded - clears when no waits are reported") {
+        AdmissionController controller(testConfig());
+        auto now = AdmissionController::Clock::now();
+        controller.recordSojourn(std::chrono::milliseconds(30), now);
+        controller.recordSojourn(std::chrono::milliseconds(30), now + std::chrono::milliseconds(100));
+
+        ASSERT_TRUE(controller.isOverloaded(now + std::chrono::milliseconds(150)));
+        ASSERT_FALSE(controller.isOverloaded(now + std::chrono::milliseconds(250)));
+        return true;
+    });
+
+    // Test that a zero target disables shedding
+    TEST("AdmissionController::admit - zero target never sheds") {
+        AdmissionConfig config = testConfig();
+        config.target = std::chrono::milliseconds(0);
+        AdmissionController controller(config);
+        auto now = AdmissionController::Clock::now();
+        controller.recordSojourn(std::chrono::seconds(5), now);
+        controller.recordSojourn(std::chrono::seconds(5), now + std::chrono::seconds(1));
+
+        ASSERT_TRUE(controller.admit(AdmissionPriority::Low, now + std::chrono::seconds(1)));
+        return true;
+    });
+}
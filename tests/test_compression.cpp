@@ -0,0 +1,106 @@
+#include "test_framework.h"
+#include "../src/utils/compression.h"
+#include "../src/utils/message_page_cache.h"
+#include <string>
+#include <zlib.h>
+
+using namespace messaging_service;
+
+namespace {
+
+// Inflate a gzip body the way a client would
+bool gunzip(const std::string& input, std::string& output) {
+    z_stream stream = {};
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+        return false;
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    char buffer[4096];
+    int result = Z_OK;
+    while (result == Z_OK) {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        result = inflate(&stream, Z_NO_FLUSH);
+        output.append(buffer, sizeof(buffer) - stream.avail_out);
+    }
+    inflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for the response compression helpers
+ */
+void runCompressionTests(TestFramework& framework) {
+
+    // Test Accept-Encoding negotiation, including q-values and wildcards
+    TEST("negotiateEncoding - honours q-values and availability") {
+        ASSERT_TRUE(negotiateEncoding("") == ContentEncoding::Identity);
+        ASSERT_TRUE(negotiateEncoding("gzip") == ContentEncoding::Gzip);
+        ASSERT_TRUE(negotiateEncoding("deflate, GZIP;q=0.5") == ContentEncoding::Gzip);
+        ASSERT_TRUE(negotiateEncoding("gzip;q=0") == ContentEncoding::Identity);
+        ASSERT_TRUE(negotiateEncoding("br, identity") == ContentEncoding::Identity);
+        ASSERT_TRUE(negotiateEncoding("*;q=0.1, gzip;q=0") != ContentEncoding::Gzip);
+
+        ContentEncoding preferred = isEncodingAvailable(ContentEncoding::Zstd) ? ContentEncoding::Zstd
+                                                                              : ContentEncoding::Gzip;
+        ASSERT_TRUE(negotiateEncoding("gzip, zstd") == preferred);
+        ASSERT_TRUE(negotiateEncoding("*") == preferred);
+        ASSERT_TRUE(negotiateEncoding("gzip, zstd;q=0.5") == ContentEncoding::Gzip);
+        return true;
+    });
+
+    // Test which content types are worth compressing
+    TEST("isCompressibleType - text and JSON but not event streams") {
+        ASSERT_TRUE(isCompressibleType("application/json"));
+        ASSERT_TRUE(isCompressibleType("text/plain; version=0.0.4"));
+        ASSERT_TRUE(isCompressibleType("Application/JSON; charset=utf-8"));
+        ASSERT_FALSE(isCompressibleType("text/event-stream"));
+        ASSERT_FALSE(isCompressibleType("image/png"));
+        ASSERT_FALSE(isCompressibleType(""));
+        return true;
+    });
+
+    // Test that gzip output is a valid gzip stream of the input and much smaller for JSON
+    TEST("compressBody - gzip round trip") {
+        std::string body = "{\"messages\": [";
+        for (int i = 0; i < 200; i++) {
+            body += "{\"id\":" + std::to_string(i) + ",\"body\":\"Hello again, this is a long email thread\"},";
+        }
+        body += "{}]}";
+
+        std::string compressed;
+        ASSERT_TRUE(compressBody(body, ContentEncoding::Gzip, compressed));
+        ASSERT_TRUE(compressed.size() * 5 < body.size());
+        std::string restored;
+        ASSERT_TRUE(gunzip(compressed, restored));
+        ASSERT_EQUAL(body, restored);
+
+        ASSERT_FALSE(compressBody(body, ContentEncoding::Identity, compressed));
+        return true;
+    });
+
+    // Test that compressed copies are kept with a cached page only while it is current
+    TEST("MessagePageCache::attachEncoding - keeps copies for the current page only") {
+        MessagePageCache cache;
+        CachedPage page;
+        page.body = std::string(2000, 'a');
+        page.etag = "W/\"3.1\"";
+        ASSERT_TRUE(cache.put(3, "", page, cache.beginFill()));
+        size_t before = cache.getSizeBytes();
+
+        ASSERT_TRUE(cache.attachEncoding(3, "", "W/\"3.1\"", ContentEncoding::Gzip, "gz"));
+        ASSERT_FALSE(cache.attachEncoding(3, "", "W/\"3.0\"", ContentEncoding::Gzip, "old"));
+        ASSERT_EQUAL(before + 2, cache.getSizeBytes());
+
+        CachedPage cached;
+        ASSERT_TRUE(cache.get(3, "", cached));
+        ASSERT_EQUAL(std::string("gz"), cached.encodedBodies[static_cast<size_t>(ContentEncoding::Gzip)]);
+
+        cache.invalidate(3);
+        ASSERT_FALSE(cache.attachEncoding(3, "", "W/\"3.1\"", ContentEncoding::Gzip, "gz"));
+        return true;
+    });
+}
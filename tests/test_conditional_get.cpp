@@ -0,0 +1,41 @@
+#include "test_framework.h"
+#include "../src/utils/conditional_get.h"
+#include <string>
+
+using namespace messaging_service;
+
+/**
+ * @brief Test cases for conditional GET helpers
+ */
+void runConditionalGetTests(TestFramework& framework) {
+
+    // Test that If-None-Match uses weak comparison against any listed tag
+    TEST("isNotModified - matches If-None-Match tags weakly") {
+        std::string etag = makeEntityTag("42.7");
+        ASSERT_EQUAL(std::string("W/\"42.7\""), etag);
+
+        ASSERT_TRUE(isNotModified("W/\"42.7\"", "", etag, ""));
+        ASSERT_TRUE(isNotModified("\"42.7\"", "", etag, ""));
+        ASSERT_TRUE(isNotModified("W/\"1.1\", W/\"42.7\"", "", etag, ""));
+        ASSERT_TRUE(isNotModified("*", "", etag, ""));
+        ASSERT_FALSE(isNotModified("W/\"42.6\"", "", etag, ""));
+        ASSERT_FALSE(isNotModified("", "", etag, ""));
+        return true;
+    });
+
+    // Test If-Modified-Since and its precedence rules
+    TEST("isNotModified - compares If-Modified-Since only without If-None-Match") {
+        std::string etag = makeEntityTag("42.7");
+        std::string lastModified = "Tue, 14 Jan 2025 10:30:00 GMT";
+
+        ASSERT_TRUE(isNotModified("", "Tue, 14 Jan 2025 10:30:00 GMT", etag, lastModified));
+        ASSERT_TRUE(isNotModified("", "Wed, 15 Jan 2025 08:00:00 GMT", etag, lastModified));
+        ASSERT_FALSE(isNotModified("", "Tue, 14 Jan 2025 10:29:59 GMT", etag, lastModified));
+
+        // A stale tag wins over a current date, and unparseable dates never match
+        ASSERT_FALSE(isNotModified("W/\"42.6\"", "Wed, 15 Jan 2025 08:00:00 GMT", etag, lastModified));
+        ASSERT_FALSE(isNotModified("", "yesterday", etag, lastModified));
+        ASSERT_FALSE(isNotModified("", "Wed, 15 Jan 2025 08:00:00 GMT", etag, ""));
+        return true;
+    });
+}
@@ -0,0 +1,79 @@
+#include "test_framework.h"
+#include "../src/utils/duplicate_filter.h"
+#include <chrono>
+#include <string>
+
+using namespace messaging_service;
+
+/**
+ * @brief Test cases for DuplicateFilter
+ */
+void runDuplicateFilterTests(TestFramework& framework) {
+
+    // Test that added keys are found and others are not
+    TEST("DuplicateFilter::contains - remembers added keys") {
+        DuplicateFilter filter(1000, std::chrono::seconds(60));
+        auto now = DuplicateFilter::Clock::now();
+        ASSERT_FALSE(filter.contains("sms:abc", now));
+        filter.add("sms:abc", now);
+        ASSERT_TRUE(filter.contains("sms:abc", now));
+        ASSERT_FALSE(filter.contains("email:abc", now));
+        ASSERT_TRUE(filter.getHashCount() >= 20);
+
+        filter.clear();
+        ASSERT_FALSE(filter.contains("sms:abc", now));
+        return true;
+    });
+
+    // Test that keys are kept for at least the TTL and dropped within twice the TTL
+    TEST("DuplicateFilter - forgets keys after the TTL") {
+        DuplicateFilter filter(1000, std::chrono::seconds(60));
+        auto start = DuplicateFilter::Clock::now();
+        filter.add("a", start);
+        filter.add("b", start + std::chrono::seconds(59));
+
+        // The first generation rotates to previous, so both are still known
+        ASSERT_TRUE(filter.contains("a", start + std::chrono::seconds(61)));
+        ASSERT_TRUE(filter.contains("b", start + std::chrono::seconds(61)));
+
+        // Another rotation drops them
+        ASSERT_FALSE(filter.contains("a", start + std::chrono::seconds(122)));
+        ASSERT_FALSE(filter.contains("b", start + std::chrono::seconds(122)));
+
+        // After a long quiet period nothing survives, even from the current generation
+        filter.add("c", start + std::chrono::seconds(130));
+        ASSERT_FALSE(filter.contains("c", start + std::chrono::seconds(300)));
+        return true;
+    });
+
+    // Test that a full generation rotates early, keeping recent keys
+    TEST("DuplicateFilter - rotates when a generation fills") {
+        DuplicateFilter filter(10, std::chrono::seconds(3600));
+        auto now = DuplicateFilter::Clock::now();
+        for (int i = 0; i < 25; i++) {
+            filter.add("key" + std::to_string(i), now);
+        }
+        ASSERT_FALSE(filter.contains("key0", now));
+        ASSERT_TRUE(filter.contains("key15", now));
+        ASSERT_TRUE(filter.contains("key24", now));
+        return true;
+    });
+
+    // Test the false positive rate at capacity with a loose target
+    TEST("DuplicateFilter - false positives near the target rate") {
+        DuplicateFilter filter(10000, std::chrono::seconds(3600), 0.01);
+        auto now = DuplicateFilter::Clock::now();
+        for (int i = 0; i < 9999; i++) {
+            filter.add("seen" + std::to_string(i), now);
+        }
+        int falsePositives = 0;
+        for (int i = 0; i < 100000; i++) {
+            if (filter.contains("unseen" + std::to_string(i), now)) {
+                falsePositives++;
+            }
+        }
+        // 1% expected; allow for variance
+        ASSERT_TRUE(falsePositives < 2000);
+        return true;
+    });
+}
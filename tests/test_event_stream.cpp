@@ -0,0 +1,217 @@
+#include "test_framework.h"
+#include "../src/server/event_stream_server.h"
+#include "../src/utils/message_event_hub.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace messaging_service;
+
+namespace {
+
+MessageEvent makeEvent(int messageId, int conversationId, const std::string& from, const std::string& to) {
+    MessageEvent event;
+    event.messageId = messageId;
+    event.conversationId = conversationId;
+    event.fromAddress = from;
+    event.toAddress = to;
+    event.json = "{\"id\":" + std::to_string(messageId) + "}";
+    return event;
+}
+
+// Blocking client socket with a read timeout, so a missing event fails the test instead of hanging it
+int connectTo(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    timeval timeout{2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Reads until text appears in what has been received, or the read times out
+bool readUntil(int fd, const std::string& text, std::string& received) {
+    char buffer[1024];
+    while (received.find(text) == std::string::npos) {
+        ssize_t count = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (count <= 0) {
+            return false;
+        }
+        received.append(buffer, static_cast<size_t>(count));
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for MessageEventHub and EventStreamServer
+ */
+void runEventStreamTests(TestFramework& framework) {
+
+    // Test that events reach subscribers of the conversation or of either address only
+    TEST("MessageEventHub::publish - delivers to matching subscribers") {
+        MessageEventHub hub;
+        auto conversation = hub.subscribe({7, ""}, nullptr);
+        auto sender = hub.subscribe({0, "+15550001"}, nullptr);
+        auto other = hub.subscribe({0, "+15559999"}, nullptr);
+        ASSERT_TRUE(hub.subscribe({0, ""}, nullptr) == nullptr);
+        ASSERT_EQUAL(3u, hub.getSubscriberCount());
+        ASSERT_TRUE(hub.isFollowed(9, "a@example.com", "+15550001"));
+        ASSERT_FALSE(hub.isFollowed(9, "a@example.com", "b@example.com"));
+
+        hub.publish(makeEvent(1, 7, "+15550001", "+15550002"));
+        std::vector<EventSubscription::Item> items;
+        ASSERT_EQUAL(1u, conversation->take(items));
+        ASSERT_EQUAL(1, items[0].messageId);
+        ASSERT_EQUAL(std::string("{\"id\":1}"), items[0].data);
+        ASSERT_EQUAL(1u, sender->take(items));
+        ASSERT_EQUAL(0u, other->take(items));
+
+        hub.unsubscribe(conversation);
+        hub.publish(makeEvent(2, 7, "+15550002", "+15550001"));
+        ASSERT_EQUAL(0u, conversation->take(items));
+        ASSERT_EQUAL(1u, sender->take(items));
+        ASSERT_EQUAL(2u, hub.getSubscriberCount());
+        return true;
+    });
+
+    // Test that a subscriber that falls behind gets one reset in place of its backlog
+    TEST("EventSubscription - bounded buffer resets when full") {
+        MessageEventHub hub(2);
+        int wakes = 0;
+        auto subscription = hub.subscribe({3, ""}, [&wakes] { wakes++; });
+        for (int i = 1; i <= 5; i++) {
+            hub.publish(makeEvent(i, 3, "a", "b"));
+        }
+        ASSERT_EQUAL(1, wakes);
+        ASSERT_EQUAL(1u, subscription->getResetCount());
+
+        std::vector<EventSubscription::Item> items;
+        ASSERT_EQUAL(1u, subscription->take(items));
+        ASSERT_TRUE(items[0].reset);
+
+        // Caught up, so events flow again and the next one wakes the consumer
+        items.clear();
+        hub.publish(makeEvent(6, 3, "a", "b"));
+        ASSERT_EQUAL(2, wakes);
+        ASSERT_EQUAL(1u, subscription->take(items));
+        ASSERT_FALSE(items[0].reset);
+        ASSERT_EQUAL(6, items[0].messageId);
+        return true;
+    });
+
+    // Test a full round trip: subscribe over HTTP, publish, read the SSE frame
+    TEST("EventStreamServer - streams published messages as server-sent events") {
+        MessageEventHub hub;
+        EventStreamServer server(hub);
+        ASSERT_TRUE(server.start("127.0.0.1", 0, false));
+        ASSERT_TRUE(server.getPort() > 0);
+
+        int client = connectTo(server.getPort());
+        ASSERT_TRUE(client >= 0);
+        std::string request = "GET /api/events?participant=%2B15550001 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        ASSERT_TRUE(::send(client, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size()));
+
+        std::string received;
+        ASSERT_TRUE(readUntil(client, "retry: 3000\n\n", received));
+        ASSERT_TRUE(received.find("HTTP/1.1 200 OK") == 0);
+        ASSERT_TRUE(received.find("Content-Type: text/event-stream") != std::string::npos);
+        ASSERT_EQUAL(1u, hub.getSubscriberCount());
+
+        MessageEvent event = makeEvent(42, 5, "+15550001", "+15550002");
+        event.json = "{\"id\":42,\n\"body\":\"hi\"}";
+        hub.publish(event);
+        received.clear();
+        ASSERT_TRUE(readUntil(client, "\n\n", received));
+        ASSERT_EQUAL(std::string("id: 42\nevent: message\ndata: {\"id\":42,\ndata: \"body\":\"hi\"}\n\n"), received);
+
+        ::close(client);
+        server.stop();
+        ASSERT_EQUAL(0u, hub.getSubscriberCount());
+        return true;
+    });
+
+    // Test that output the socket cannot take at once is sent when the client catches up
+    TEST("EventStreamServer - drains a backlog once a slow client reads") {
+        MessageEventHub hub;
+        EventStreamOptions options;
+        options.maxBufferedBytes = 64 * 1024 * 1024;
+        EventStreamServer server(hub, options);
+        ASSERT_TRUE(server.start("127.0.0.1", 0, false));
+
+        int client = connectTo(server.getPort());
+        ASSERT_TRUE(client >= 0);
+        std::string request = "GET /api/conversations/9/events HTTP/1.1\r\n\r\n";
+        ::send(client, request.data(), request.size(), 0);
+        std::string received;
+        ASSERT_TRUE(readUntil(client, "retry: 3000\n\n", received));
+
+        // Far more than the socket buffers hold, so most of it waits for EPOLLOUT
+        const int eventCount = 200;
+        for (int i = 1; i <= eventCount; i++) {
+            MessageEvent event = makeEvent(i, 9, "a", "b");
+            event.json = "{\"body\":\"" + std::string(32 * 1024, 'x') + "\"}";
+            hub.publish(event);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        std::string last = "id: " + std::to_string(eventCount) + "\n";
+        std::vector<char> buffer(64 * 1024);
+        size_t total = 0;
+        std::string tail;
+        while (tail.find(last) == std::string::npos) {
+            ssize_t count = ::recv(client, buffer.data(), buffer.size(), 0);
+            ASSERT_TRUE(count > 0);
+            total += static_cast<size_t>(count);
+            tail.append(buffer.data(), static_cast<size_t>(count));
+            if (tail.size() > 2 * buffer.size()) {
+                tail.erase(0, tail.size() - buffer.size());
+            }
+        }
+        ASSERT_TRUE(total > static_cast<size_t>(eventCount) * 32 * 1024);
+        ASSERT_EQUAL(1u, server.getConnectionCount());
+
+        ::close(client);
+        server.stop();
+        return true;
+    });
+
+    // Test that unknown paths and other methods are refused and the connection closed
+    TEST("EventStreamServer - rejects unknown routes") {
+        MessageEventHub hub;
+        EventStreamServer server(hub);
+        ASSERT_TRUE(server.start("127.0.0.1", 0, false));
+
+        int client = connectTo(server.getPort());
+        ASSERT_TRUE(client >= 0);
+        std::string request = "GET /api/conversations/abc/events HTTP/1.1\r\n\r\n";
+        ::send(client, request.data(), request.size(), 0);
+        std::string received;
+        ASSERT_TRUE(readUntil(client, "\r\n\r\n", received));
+        ASSERT_TRUE(received.find("HTTP/1.1 400") == 0);
+        ::close(client);
+
+        client = connectTo(server.getPort());
+        request = "POST /api/conversations/4/events HTTP/1.1\r\n\r\n";
+        ::send(client, request.data(), request.size(), 0);
+        received.clear();
+        ASSERT_TRUE(readUntil(client, "\r\n\r\n", received));
+        ASSERT_TRUE(received.find("HTTP/1.1 405") == 0);
+        ::close(client);
+        ASSERT_EQUAL(0u, hub.getSubscriberCount());
+        return true;
+    });
+}
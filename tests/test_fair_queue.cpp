@@ -0,0 +1,158 @@
+#include "test_framework.h"
+#include "../src/utils/fair_queue.h"
+#include <string>
+#include <vector>
+
+using namespace messaging_service;
+
+namespace {
+
+// One send at a time, so each complete() starts exactly one queued task;
+// backlogs are unbounded so ordering tests can queue freely
+FairQueueConfig serialConfig() {
+    FairQueueConfig config;
+    config.maxInFlight = 1;
+    config.maxQueuedPerTenant = 0;
+    return config;
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for FairQueue class
+ */
+void runFairQueueTests(TestFramework& framework) {
+
+    // Test that tenants are served in proportion to their weights
+    TEST("FairQueue::enqueue - serves tenants in proportion to weight") {
+        FairQueueConfig config = serialConfig();
+        config.weights["heavy"] = 3;
+        FairQueue queue(config);
+        std::vector<std::string> started;
+
+        // Occupy the only slot so the rest queue up behind it
+        queue.enqueue("blocker", [&] { started.push_back("blocker"); });
+        for (int i = 0; i < 6; i++) {
+            queue.enqueue("heavy", [&] { started.push_back("heavy"); });
+            queue.enqueue("light", [&] { started.push_back("light"); });
+        }
+        ASSERT_EQUAL(12u, queue.getQueuedCount());
+        ASSERT_EQUAL(2u, queue.getActiveTenantCount());
+
+        for (int i = 0; i < 8; i++) {
+            queue.complete();
+        }
+        std::vector<std::string> expected = {"blocker", "heavy", "heavy", "heavy", "light",
+                                             "heavy", "heavy", "heavy", "light"};
+        ASSERT_TRUE(started == expected);
+
+        // The heavy tenant has drained; the light tenant's backlog goes out alone
+        ASSERT_EQUAL(1u, queue.getActiveTenantCount());
+        ASSERT_EQUAL(4u, queue.getQueuedCount());
+        return true;
+    });
+
+    // Test that a flooding tenant does not delay a tenant with a single send
+    TEST("FairQueue::enqueue - a flood does not starve other tenants") {
+        FairQueue queue(serialConfig());
+        std::vector<std::string> started;
+
+        queue.enqueue("noisy", [&] { started.push_back("noisy-0"); });
+        for (int i = 1; i <= 100; i++) {
+            queue.enqueue("noisy", [&, i] { started.push_back("noisy-" + std::to_string(i)); });
+        }
+        queue.enqueue("quiet", [&] { started.push_back("quiet"); });
+
+        queue.complete();
+        queue.complete();
+        ASSERT_EQUAL(3u, started.size());
+        ASSERT_EQUAL(std::string("noisy-1"), started[1]);
+        ASSERT_EQUAL(std::string("quiet"), started[2]);
+        return true;
+    });
+
+    // Test that a tenant's tasks start in the order they were queued
+    TEST("FairQueue::enqueue - keeps each tenant's tasks in order") {
+        FairQueue queue(serialConfig());
+        std::vector<int> started;
+
+        for (int i = 0; i < 5; i++) {
+            queue.enqueue("tenant", [&, i] { started.push_back(i); });
+        }
+        while (queue.getQueuedCount() > 0) {
+            queue.complete();
+        }
+        ASSERT_TRUE((started == std::vector<int>{0, 1, 2, 3, 4}));
+        ASSERT_EQUAL(0u, queue.getActiveTenantCount());
+        return true;
+    });
+
+    // Test that ring entries survive the tenant map rehashing as tenants join
+    TEST("FairQueue::enqueue - keeps rotating while thousands of tenants join") {
+        FairQueue queue(serialConfig());
+        std::vector<int> started;
+
+        queue.enqueue("blocker", [&] { started.push_back(-1); });
+        for (int i = 0; i < 5000; i++) {
+            queue.enqueue("tenant-" + std::to_string(i), [&, i] { started.push_back(i); });
+            queue.enqueue("tenant-" + std::to_string(i), [&, i] { started.push_back(i); });
+        }
+        ASSERT_EQUAL(5000u, queue.getActiveTenantCount());
+
+        // One send per tenant per round, in the order the tenants arrived
+        while (queue.getQueuedCount() > 0) {
+            queue.complete();
+        }
+        ASSERT_EQUAL(10001u, started.size());
+        for (int i = 0; i < 5000; i++) {
+            ASSERT_EQUAL(i, started[1 + i]);
+            ASSERT_EQUAL(i, started[5001 + i]);
+        }
+        ASSERT_EQUAL(0u, queue.getActiveTenantCount());
+        return true;
+    });
+
+    // Test that the default backlog limit keeps a flooding tenant to a few waiting requests
+    TEST("FairQueue::enqueue - refuses a tenant beyond a small default backlog") {
+        FairQueueConfig config;
+        config.maxInFlight = 1;
+        FairQueue queue(config);
+
+        ASSERT_TRUE(queue.enqueue("noisy", [] {}));
+        size_t accepted = 0;
+        while (queue.enqueue("noisy", [] {})) {
+            accepted++;
+            ASSERT_TRUE(accepted <= 16);
+        }
+        ASSERT_EQUAL(FairQueueConfig().maxQueuedPerTenant, accepted);
+        ASSERT_TRUE(queue.enqueue("quiet", [] {}));
+        return true;
+    });
+
+    // Test the in-flight limit and the per-tenant backlog limit
+    TEST("FairQueue::enqueue - enforces in-flight and per-tenant limits") {
+        FairQueueConfig config;
+        config.maxInFlight = 2;
+        config.maxQueuedPerTenant = 2;
+        FairQueue queue(config);
+        int started = 0;
+
+        // Two start at once, two more queue, the fifth is refused
+        for (int i = 0; i < 4; i++) {
+            ASSERT_TRUE(queue.enqueue("tenant", [&] { started++; }));
+        }
+        ASSERT_FALSE(queue.enqueue("tenant", [&] { started++; }));
+        ASSERT_EQUAL(2, started);
+        ASSERT_EQUAL(2u, queue.getInFlightCount());
+        ASSERT_EQUAL(2u, queue.getQueuedCount());
+
+        // Another tenant's backlog is counted separately
+        ASSERT_TRUE(queue.enqueue("other", [&] { started++; }));
+
+        queue.complete();
+        ASSERT_EQUAL(3, started);
+        ASSERT_EQUAL(2u, queue.getInFlightCount());
+        ASSERT_TRUE(queue.enqueue("tenant", [&] { started++; }));
+        return true;
+    });
+}
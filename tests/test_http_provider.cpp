@@ -0,0 +1,297 @@
+#include "test_framework.h"
+#include "../src/providers/implementations/HttpMessagingProvider.h"
+#include "../src/providers/provider_router.h"
+#include "../src/tools/mock_vendor.h"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace messaging_service;
+
+namespace {
+
+// An httplib server on an ephemeral loopback port, stopped when it goes out of scope
+class LocalServer {
+public:
+    LocalServer() {
+        port_ = server_.bind_to_any_port("127.0.0.1");
+        thread_ = std::thread([this] { server_.listen_after_bind(); });
+        server_.wait_until_ready();
+    }
+
+    ~LocalServer() {
+        server_.stop();
+        thread_.join();
+    }
+
+    httplib::Server& server() { return server_; }
+    std::string url() const { return "http://127.0.0.1:" + std::to_string(port_); }
+
+private:
+    httplib::Server server_;
+    std::thread thread_;
+    int port_;
+};
+
+HttpProviderConfig makeConfig(const std::string& url) {
+    HttpProviderConfig config;
+    config.baseUrl = url;
+    config.maxConnections = 2;
+    config.connectTimeoutMs = 500;
+    config.readTimeoutMs = 1000;
+    config.writeTimeoutMs = 1000;
+    config.checkoutTimeoutMs = 1000;
+    config.maxRetries = 1;
+    return config;
+}
+
+MessageRequest makeRequest() {
+    return MessageRequest("+15550001", "+15550002", "sms", "hello", "http_test", "2024-11-01T14:00:00Z");
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for HttpMessagingProvider and MockVendor
+ */
+void runHttpProviderTests(TestFramework& framework) {
+
+    // Test that sequential sends share one kept-alive connection
+    TEST("HttpMessagingProvider::sendMessage - reuses keep-alive connections") {
+        LocalServer local;
+        MockVendor vendor(VendorOptions{});
+        vendor.attach(local.server());
+        HttpMessagingProvider provider("http_keepalive", {"sms"}, makeConfig(local.url()));
+
+        for (int i = 0; i < 5; i++) {
+            MessageResponse response = provider.sendMessage(makeRequest());
+            ASSERT_TRUE(response.success);
+            ASSERT_EQUAL(std::string("vendor-") + std::to_string(i + 1), response.provider_message_id);
+        }
+        ASSERT_EQUAL(5u, static_cast<unsigned>(vendor.getRequestCount()));
+        ASSERT_EQUAL(1u, vendor.getConnectionCount());
+
+        HttpProviderStats stats = provider.getStats();
+        ASSERT_EQUAL(1u, static_cast<unsigned>(stats.connectionsOpened));
+        ASSERT_EQUAL(4u, static_cast<unsigned>(stats.connectionReuses));
+        ASSERT_EQUAL(1u, stats.idleConnections);
+        ASSERT_EQUAL(0u, static_cast<unsigned>(stats.failures));
+        return true;
+    });
+
+    // Test that vendor error statuses are mapped and not retried
+    TEST("HttpMessagingProvider::sendMessage - maps vendor errors without retrying") {
+        LocalServer throttling;
+        VendorOptions throttled;
+        throttled.throttleRate = 1.0;
+        MockVendor throttlingVendor(throttled);
+        throttlingVendor.attach(throttling.server());
+        HttpMessagingProvider limited("http_throttled", {"sms"}, makeConfig(throttling.url()));
+
+        MessageResponse response = limited.sendMessage(makeRequest());
+        ASSERT_FALSE(response.success);
+        ASSERT_EQUAL(429, response.http_status_code);
+        ASSERT_EQUAL(std::string("rate_limited"), response.error_code);
+        ASSERT_EQUAL(1u, static_cast<unsigned>(throttlingVendor.getRequestCount()));
+
+        LocalServer failing;
+        VendorOptions broken;
+        broken.errorRate = 1.0;
+        MockVendor failingVendor(broken);
+        failingVendor.attach(failing.server());
+        HttpMessagingProvider erroring("http_erroring", {"sms"}, makeConfig(failing.url()));
+
+        response = erroring.sendMessage(makeRequest());
+        ASSERT_EQUAL(500, response.http_status_code);
+        ASSERT_EQUAL(std::string("provider_error"), response.error_code);
+        ASSERT_EQUAL(1u, static_cast<unsigned>(failingVendor.getRequestCount()));
+
+        // The connection is still usable after an HTTP-level error
+        ASSERT_EQUAL(0u, static_cast<unsigned>(erroring.getStats().retries));
+        ASSERT_EQUAL(0u, static_cast<unsigned>(erroring.getStats().connectionsDiscarded));
+        return true;
+    });
+
+    // Test that a timed out send is retried on a new connection with the same key
+    TEST("HttpMessagingProvider::sendMessage - retries a timeout with the same Idempotency-Key") {
+        LocalServer local;
+        std::mutex mutex;
+        std::vector<std::string> keys;
+        local.server().Post("/v1/messages", [&](const httplib::Request& req, httplib::Response& res) {
+            size_t attempt;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                keys.push_back(req.get_header_value("Idempotency-Key"));
+                attempt = keys.size();
+            }
+            if (attempt == 1) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            }
+            res.status = 202;
+            res.set_content("{\"id\": \"vendor-1\"}", "application/json");
+        });
+        HttpProviderConfig config = makeConfig(local.url());
+        config.readTimeoutMs = 100;
+        HttpMessagingProvider provider("http_retry", {"sms"}, config);
+
+        MessageRequest request = makeRequest();
+        request.idempotency_key = "message-42";
+        MessageResponse response = provider.sendMessage(request);
+        ASSERT_TRUE(response.success);
+        ASSERT_EQUAL(std::string("vendor-1"), response.provider_message_id);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ASSERT_EQUAL(2u, keys.size());
+        ASSERT_EQUAL(std::string("message-42"), keys[0]);
+        ASSERT_EQUAL(keys[0], keys[1]);
+
+        HttpProviderStats stats = provider.getStats();
+        ASSERT_EQUAL(1u, static_cast<unsigned>(stats.retries));
+        ASSERT_EQUAL(1u, static_cast<unsigned>(stats.connectionsDiscarded));
+        ASSERT_EQUAL(0u, static_cast<unsigned>(stats.failures));
+        return true;
+    });
+
+    // Test that sending the same message again reaches the vendor as a duplicate
+    TEST("HttpMessagingProvider::sendMessage - sends a message's own key on every send") {
+        LocalServer local;
+        MockVendor vendor(VendorOptions{});
+        vendor.attach(local.server());
+        HttpMessagingProvider provider("http_message_key", {"sms"}, makeConfig(local.url()));
+
+        MessageRequest request = makeRequest();
+        request.idempotency_key = "message-7";
+        MessageResponse first = provider.sendMessage(request);
+        MessageResponse again = provider.sendMessage(request);
+        ASSERT_TRUE(first.success && again.success);
+        ASSERT_EQUAL(first.provider_message_id, again.provider_message_id);
+        ASSERT_EQUAL(1u, static_cast<unsigned>(vendor.getDuplicateCount()));
+
+        // Requests without a key get a fresh one per send
+        MessageResponse unkeyed = provider.sendMessage(makeRequest());
+        ASSERT_NOT_EQUAL(first.provider_message_id, unkeyed.provider_message_id);
+        return true;
+    });
+
+    // Test that a vendor slower than the read timeout fails with 504 once retries run out
+    TEST("HttpMessagingProvider::sendMessage - gives up on timeouts after the retries") {
+        LocalServer local;
+        VendorOptions slow;
+        slow.latencyMs = 300;
+        MockVendor vendor(slow);
+        vendor.attach(local.server());
+        HttpProviderConfig config = makeConfig(local.url());
+        config.readTimeoutMs = 100;
+        HttpMessagingProvider provider("http_timeout", {"sms"}, config);
+
+        MessageResponse response = provider.sendMessage(makeRequest());
+        ASSERT_FALSE(response.success);
+        ASSERT_EQUAL(504, response.http_status_code);
+        ASSERT_EQUAL(std::string("provider_timeout"), response.error_code);
+
+        HttpProviderStats stats = provider.getStats();
+        ASSERT_EQUAL(1u, static_cast<unsigned>(stats.retries));
+        ASSERT_EQUAL(1u, static_cast<unsigned>(stats.failures));
+        ASSERT_EQUAL(2u, static_cast<unsigned>(stats.connectionsDiscarded));
+        ASSERT_EQUAL(0u, stats.openConnections);
+        return true;
+    });
+
+    // Test that an unreachable vendor is reported as 502 after the retries
+    TEST("HttpMessagingProvider::sendMessage - reports an unreachable vendor") {
+        int port;
+        {
+            // A port that was just free is very likely to refuse connections
+            LocalServer closed;
+            port = std::stoi(closed.url().substr(closed.url().rfind(':') + 1));
+        }
+        HttpMessagingProvider provider("http_unreachable", {"sms"}, makeConfig("http://127.0.0.1:" + std::to_string(port)));
+
+        MessageResponse response = provider.sendMessage(makeRequest());
+        ASSERT_FALSE(response.success);
+        ASSERT_EQUAL(502, response.http_status_code);
+        ASSERT_EQUAL(std::string("provider_unreachable"), response.error_code);
+        ASSERT_EQUAL(1u, static_cast<unsigned>(provider.getStats().retries));
+        return true;
+    });
+
+    // Test that a send fails fast when every pooled connection stays busy
+    TEST("HttpMessagingProvider::sendMessage - fails when no connection frees up in time") {
+        LocalServer local;
+        VendorOptions slow;
+        slow.latencyMs = 300;
+        MockVendor vendor(slow);
+        vendor.attach(local.server());
+        HttpProviderConfig config = makeConfig(local.url());
+        config.maxConnections = 1;
+        config.checkoutTimeoutMs = 20;
+        HttpMessagingProvider provider("http_exhausted", {"sms"}, config);
+
+        MessageResponse first;
+        std::thread busy([&] { first = provider.sendMessage(makeRequest()); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        MessageResponse second = provider.sendMessage(makeRequest());
+        busy.join();
+
+        ASSERT_TRUE(first.success);
+        ASSERT_EQUAL(503, second.http_status_code);
+        ASSERT_EQUAL(std::string("connection_pool_exhausted"), second.error_code);
+        ASSERT_EQUAL(1u, static_cast<unsigned>(provider.getStats().checkoutTimeouts));
+        return true;
+    });
+
+    // Test that with the vendor configured, weighted routing never picks a simulated provider
+    TEST("HttpMessagingProvider::registerForAllTypes - weighted routing sends only to the vendor") {
+        LocalServer local;
+        MockVendor vendor(VendorOptions{});
+        vendor.attach(local.server());
+        HttpMessagingProvider::registerForAllTypes(makeConfig(local.url()));
+        ProviderRouter router(true);
+
+        // The simulators stay registered, and unmeasured ones would look cheapest
+        ASSERT_TRUE(MessagingProviderFactory::createProvider("twilio") != nullptr);
+        for (int i = 0; i < 20; i++) {
+            for (const std::string type : {"sms", "mms", "email"}) {
+                auto provider = router.selectProviderForType(type);
+                ASSERT_TRUE(provider != nullptr);
+                ASSERT_EQUAL(type == "email" ? std::string("http_email") : std::string("http_sms"),
+                             provider->getProviderName());
+                MessageRequest request = makeRequest();
+                request.type = type;
+                ASSERT_TRUE(router.dispatch(provider, request).success);
+            }
+        }
+        ASSERT_EQUAL(60u, static_cast<unsigned>(vendor.getRequestCount()));
+
+        // Later tests expect the simulators back
+        MessagingProviderFactory::setProvidersForType("sms", {"default_sms", "twilio"});
+        MessagingProviderFactory::setProvidersForType("mms", {"default_sms", "twilio"});
+        MessagingProviderFactory::setProvidersForType("email", {"default_email", "sendgrid", "xillio"});
+        return true;
+    });
+
+    // Test that the mock vendor answers a repeated Idempotency-Key with the original id
+    TEST("MockVendor - replays the message id for a repeated Idempotency-Key") {
+        LocalServer local;
+        MockVendor vendor(VendorOptions{});
+        vendor.attach(local.server());
+        httplib::Client client(local.url());
+        httplib::Headers headers = {{"Idempotency-Key", "abc"}};
+
+        auto first = client.Post("/v1/messages", headers, "{}", "application/json");
+        auto repeat = client.Post("/v1/messages", headers, "{}", "application/json");
+        auto other = client.Post("/v1/messages", "{}", "application/json");
+        ASSERT_TRUE(first && repeat && other);
+        ASSERT_EQUAL(202, first->status);
+        ASSERT_EQUAL(200, repeat->status);
+        ASSERT_EQUAL(first->body, repeat->body);
+        ASSERT_NOT_EQUAL(first->body, other->body);
+        ASSERT_EQUAL(1u, static_cast<unsigned>(vendor.getDuplicateCount()));
+
+        auto stats = client.Get("/stats");
+        ASSERT_TRUE(stats && stats->body.find("\"requests\": 3") != std::string::npos);
+        return true;
+    });
+}
@@ -0,0 +1,137 @@
+#include "test_framework.h"
+#include "../src/utils/id_generator.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace messaging_service;
+
+/**
+ * @brief Test cases for IdGenerator class
+ */
+void runIdGeneratorTests(TestFramework& framework) {
+    
+    TEST("IdGenerator::next - strictly increasing on one thread") {
+        IdGenerator generator(1);
+        uint64_t previous = generator.next();
+        for (int i = 0; i < 100000; ++i) {
+            uint64_t id = generator.next();
+            ASSERT_TRUE(id > previous);
+            previous = id;
+        }
+        return true;
+    });
+    
+    TEST("IdGenerator::next - unique across threads") {
+        IdGenerator generator(2);
+        const int threadCount = 8;
+        const int perThread = 50000;
+        std::vector<std::vector<uint64_t>> results(threadCount);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&generator, &results, t, perThread]() {
+                results[t].reserve(perThread);
+                for (int i = 0; i < perThread; ++i) {
+                    results[t].push_back(generator.next());
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        
+        std::unordered_set<uint64_t> seen;
+        for (const auto& ids : results) {
+            for (uint64_t id : ids) {
+                ASSERT_TRUE(seen.insert(id).second);
+            }
+        }
+        ASSERT_EQUAL(static_cast<size_t>(threadCount * perThread), seen.size());
+        return true;
+    });
+    
+    TEST("IdGenerator::next - embeds node id and current time") {
+        IdGenerator generator(513);
+        uint64_t id = generator.next();
+        ASSERT_EQUAL(513, IdGenerator::nodeId(id));
+        
+        auto nowMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        uint64_t idMs = IdGenerator::timestampMs(id);
+        ASSERT_TRUE(idMs <= nowMs + 1000 && idMs + 1000 >= nowMs);
+        return true;
+    });
+    
+    TEST("IdGenerator::setNodeId - masks to 10 bits") {
+        IdGenerator generator;
+        generator.setNodeId(1024 + 7);
+        ASSERT_EQUAL(7, generator.getNodeId());
+        ASSERT_EQUAL(7, IdGenerator::nodeId(generator.next()));
+        return true;
+    });
+    
+    TEST("IdGenerator::workerNodeId - instances with different NODE_IDs do not overlap") {
+        uint16_t nodeId = 0;
+        std::unordered_set<uint16_t> seen;
+        for (uint32_t instance = 0; instance < 3; instance++) {
+            for (size_t index = 0; index < 4; index++) {
+                ASSERT_TRUE(IdGenerator::workerNodeId(instance, 4, index, nodeId));
+                ASSERT_TRUE(seen.insert(nodeId).second);
+            }
+        }
+        ASSERT_TRUE(IdGenerator::workerNodeId(5, 1, 0, nodeId));
+        ASSERT_EQUAL(5, nodeId);
+
+        // The instance's last worker must still fit in the node bits
+        ASSERT_TRUE(IdGenerator::workerNodeId(255, 4, 3, nodeId));
+        ASSERT_EQUAL(IdGenerator::kMaxNodeId, nodeId);
+        ASSERT_FALSE(IdGenerator::workerNodeId(256, 4, 0, nodeId));
+        ASSERT_FALSE(IdGenerator::workerNodeId(0, 4, 4, nodeId));
+        return true;
+    });
+    
+    TEST("IdGenerator::toBase32 - fixed width round trip") {
+        std::vector<uint64_t> values = {0, 1, 31, 32, 123456789012345ULL, UINT64_MAX};
+        for (uint64_t value : values) {
+            std::string encoded = IdGenerator::toBase32(value);
+            ASSERT_EQUAL(IdGenerator::kBase32Length, encoded.length());
+            uint64_t decoded = 0;
+            ASSERT_TRUE(IdGenerator::fromBase32(encoded, decoded));
+            ASSERT_TRUE(decoded == value);
+        }
+        ASSERT_EQUAL("0000000000000", IdGenerator::toBase32(0));
+        ASSERT_EQUAL("FZZZZZZZZZZZZ", IdGenerator::toBase32(UINT64_MAX));
+        return true;
+    });
+    
+    TEST("IdGenerator::toBase32 - preserves ordering") {
+        IdGenerator generator(3);
+        std::string previous = IdGenerator::toBase32(generator.next());
+        for (int i = 0; i < 1000; ++i) {
+            std::string current = IdGenerator::toBase32(generator.next());
+            ASSERT_TRUE(current > previous);
+            previous = current;
+        }
+        return true;
+    });
+    
+    TEST("IdGenerator::fromBase32 - rejects invalid input") {
+        uint64_t value = 0;
+        ASSERT_FALSE(IdGenerator::fromBase32("", value));
+        ASSERT_FALSE(IdGenerator::fromBase32("ABC", value));
+        ASSERT_FALSE(IdGenerator::fromBase32("000000000000U", value));
+        ASSERT_FALSE(IdGenerator::fromBase32("G000000000000", value));
+        return true;
+    });
+    
+    TEST("IdGenerator::toDecimal - matches std::to_string") {
+        std::vector<uint64_t> values = {0, 9, 10, 18446744073709551615ULL};
+        for (uint64_t value : values) {
+            ASSERT_EQUAL(std::to_string(value), IdGenerator::toDecimal(value));
+        }
+        return true;
+    });
+}
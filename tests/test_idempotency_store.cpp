@@ -0,0 +1,120 @@
+#include "test_framework.h"
+#include "../src/utils/idempotency_store.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace messaging_service;
+
+namespace {
+
+IdempotentResponse makeResponse(int status, const std::string& body) {
+    IdempotentResponse response;
+    response.status = status;
+    response.body = body;
+    response.contentType = "application/json";
+    return response;
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for IdempotencyStore
+ */
+void runIdempotencyStoreTests(TestFramework& framework) {
+
+    // Test that the first request acquires a key and later ones replay its response
+    TEST("IdempotencyStore::begin - replays completed keys") {
+        IdempotencyStore store;
+        std::string fingerprint = IdempotencyStore::fingerprint("POST", "/api/messages/sms", "{\"body\":\"hi\"}");
+        IdempotentResponse response;
+        ASSERT_TRUE(store.begin("k1", fingerprint, std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Acquired);
+        store.complete("k1", makeResponse(200, "{\"message_id\":7}"));
+
+        ASSERT_TRUE(store.begin("k1", fingerprint, std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Replayed);
+        ASSERT_EQUAL(200, response.status);
+        ASSERT_EQUAL(std::string("{\"message_id\":7}"), response.body);
+        ASSERT_EQUAL(1u, store.getEntryCount());
+
+        // The same key for another request is refused; other keys are independent
+        std::string other = IdempotencyStore::fingerprint("POST", "/api/messages/sms", "{\"body\":\"bye\"}");
+        ASSERT_TRUE(other != fingerprint);
+        ASSERT_TRUE(store.begin("k1", other, std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Mismatch);
+        ASSERT_TRUE(store.begin("k2", other, std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Acquired);
+        return true;
+    });
+
+    // Test that a duplicate arriving mid-flight waits for and receives the original's response
+    TEST("IdempotencyStore::begin - coalesces with an in-flight request") {
+        IdempotencyStore store;
+        IdempotentResponse response;
+        ASSERT_TRUE(store.begin("k", "f", std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Acquired);
+
+        std::atomic<bool> replayed(false);
+        IdempotentResponse waited;
+        std::thread duplicate([&] {
+            replayed = store.begin("k", "f", std::chrono::seconds(5), waited) == IdempotencyStore::Outcome::Replayed;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        store.complete("k", makeResponse(202, "queued"));
+        duplicate.join();
+        ASSERT_TRUE(replayed.load());
+        ASSERT_EQUAL(202, waited.status);
+        ASSERT_EQUAL(std::string("queued"), waited.body);
+
+        // A waiter that runs out of time is told the key is still in progress
+        ASSERT_TRUE(store.begin("slow", "f", std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Acquired);
+        ASSERT_TRUE(store.begin("slow", "f", std::chrono::milliseconds(10), response) == IdempotencyStore::Outcome::InProgress);
+        return true;
+    });
+
+    // Test that abandoning a key lets a waiting duplicate run instead
+    TEST("IdempotencyStore::abandon - hands the key to a waiter") {
+        IdempotencyStore store;
+        IdempotentResponse response;
+        ASSERT_TRUE(store.begin("k", "f", std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Acquired);
+
+        std::atomic<bool> acquired(false);
+        std::thread duplicate([&] {
+            IdempotentResponse ignored;
+            acquired = store.begin("k", "f", std::chrono::seconds(5), ignored) == IdempotencyStore::Outcome::Acquired;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        store.abandon("k");
+        duplicate.join();
+        ASSERT_TRUE(acquired.load());
+        return true;
+    });
+
+    // Test that completed keys expire after the TTL and beyond the entry limit
+    TEST("IdempotencyStore - expires completed keys") {
+        IdempotencyStore expiring(100, std::chrono::seconds(0), 1);
+        IdempotentResponse response;
+        ASSERT_TRUE(expiring.begin("k", "f", std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Acquired);
+        expiring.complete("k", makeResponse(200, "sent"));
+        ASSERT_TRUE(expiring.begin("k", "f", std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Acquired);
+
+        IdempotencyStore bounded(2, std::chrono::seconds(3600), 1);
+        for (int i = 0; i < 3; i++) {
+            std::string key = "k" + std::to_string(i);
+            ASSERT_TRUE(bounded.begin(key, "f", std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Acquired);
+            bounded.complete(key, makeResponse(200, key));
+        }
+        ASSERT_EQUAL(2u, bounded.getEntryCount());
+        ASSERT_TRUE(bounded.begin("k0", "f", std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Acquired);
+        ASSERT_TRUE(bounded.begin("k2", "f", std::chrono::milliseconds(0), response) == IdempotencyStore::Outcome::Replayed);
+        return true;
+    });
+
+    // Test that failures after the provider was called are final
+    TEST("IdempotencyStore::isFinal - only refusals before dispatch are retried") {
+        ASSERT_FALSE(IdempotencyStore::isFinal(503, false));
+        ASSERT_FALSE(IdempotencyStore::isFinal(429, false));
+        ASSERT_TRUE(IdempotencyStore::isFinal(400, false));
+        ASSERT_TRUE(IdempotencyStore::isFinal(504, true));
+        ASSERT_TRUE(IdempotencyStore::isFinal(500, true));
+        ASSERT_TRUE(IdempotencyStore::isFinal(200, true));
+        return true;
+    });
+}
@@ -76,4 +76,26 @@ void runJsonParserTests(TestFramework& framework) {
         ASSERT_EQUAL("{\"key\": \"value\"}", str);
         return true;
     });
+    
+    TEST("JsonParser::escape - plain string unchanged") {
+        ASSERT_EQUAL("hello world", JsonParser::escape("hello world"));
+        return true;
+    });
+    
+    TEST("JsonParser::escape - quotes and backslashes") {
+        ASSERT_EQUAL("say \\\"hi\\\" \\\\", JsonParser::escape("say \"hi\" \\"));
+        return true;
+    });
+    
+    TEST("JsonParser::escape - control characters") {
+        ASSERT_EQUAL("a\\nb\\tc\\u0001", JsonParser::escape(std::string("a\nb\tc\x01")));
+        return true;
+    });
+    
+    TEST("JsonParser::escape - round trip through parse") {
+        std::string body = "line1\n\"quoted\"";
+        auto parsed = JsonParser::parse("{\"body\": \"" + JsonParser::escape(body) + "\"}");
+        ASSERT_EQUAL(body, parsed["body"]);
+        return true;
+    });
 }
@@ -0,0 +1,153 @@
+#include "test_framework.h"
+#include "../src/utils/logger.h"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace messaging_service;
+
+namespace {
+
+// Collects everything a Logger writes
+struct CapturedOutput {
+    std::mutex mutex;
+    std::string text;
+
+    Logger::Sink sink() {
+        return [this](const std::string& batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            text += batch;
+        };
+    }
+
+    size_t count(const std::string& needle) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t found = 0;
+        for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+            found++;
+        }
+        return found;
+    }
+};
+
+} // namespace
+
+/**
+ * @brief Test cases for Logger and LogSampler classes
+ */
+void runLoggerTests(TestFramework& framework) {
+    
+    TEST("Logger::log - formats level, component, message and fields") {
+        CapturedOutput output;
+        Logger logger(LoggerConfig(), output.sink());
+        logger.log(LogLevel::Info, "scheduler", "Message sent",
+                   {{"message_id", 42}, {"provider", "twilio"}, {"note", "two words"}, {"ok", true}});
+        logger.flush();
+        
+        ASSERT_EQUAL(1u, output.count(" INFO [scheduler] Message sent message_id=42 provider=twilio note=\"two words\" ok=true\n"));
+        ASSERT_EQUAL(1u, output.count("Z INFO"));
+        return true;
+    });
+    
+    TEST("Logger::log - filters below the configured level") {
+        CapturedOutput output;
+        LoggerConfig config;
+        config.level = LogLevel::Warn;
+        Logger logger(config, output.sink());
+        
+        ASSERT_FALSE(logger.enabled(LogLevel::Info));
+        ASSERT_TRUE(logger.enabled(LogLevel::Error));
+        logger.log(LogLevel::Debug, "test", "hidden debug");
+        logger.log(LogLevel::Info, "test", "hidden info");
+        logger.log(LogLevel::Error, "test", "shown error");
+        logger.flush();
+        
+        ASSERT_EQUAL(0u, output.count("hidden"));
+        ASSERT_EQUAL(1u, output.count("ERROR [test] shown error"));
+        return true;
+    });
+    
+    TEST("Logger::log - escapes newlines and quotes and truncates long lines") {
+        CapturedOutput output;
+        Logger logger(LoggerConfig(), output.sink());
+        logger.log(LogLevel::Info, "test", "line one\nline two", {{"body", "{\"a\": 1}"}});
+        logger.log(LogLevel::Info, "test", std::string(2000, 'x'));
+        logger.flush();
+        
+        ASSERT_EQUAL(1u, output.count("line one\\nline two body=\"{\\\"a\\\": 1}\"\n"));
+        ASSERT_EQUAL(1u, output.count("xxx...\n"));
+        ASSERT_EQUAL(2u, output.count("\n"));
+        return true;
+    });
+    
+    TEST("Logger::log - delivers every record from many threads") {
+        CapturedOutput output;
+        Logger logger(LoggerConfig(), output.sink());
+        
+        const int threads = 8;
+        const int perThread = 500;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&logger, t]() {
+                for (int i = 0; i < perThread; ++i) {
+                    logger.log(LogLevel::Info, "load", "tick", {{"thread", t}, {"i", i}});
+                    if (i % 100 == 99) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        logger.flush();
+        
+        ASSERT_EQUAL(static_cast<size_t>(threads * perThread), output.count("[load] tick") + logger.getDroppedCount());
+        ASSERT_EQUAL(0u, logger.getDroppedCount());
+        return true;
+    });
+    
+    TEST("Logger::log - drops instead of blocking when a ring is full") {
+        CapturedOutput output;
+        LoggerConfig config;
+        config.ringCapacity = 4;
+        config.flushInterval = std::chrono::milliseconds(1000);
+        Logger logger(config, output.sink());
+        
+        for (int i = 0; i < 20; ++i) {
+            logger.log(LogLevel::Info, "test", "burst");
+        }
+        logger.flush();
+        
+        ASSERT_EQUAL(4u, output.count("[test] burst"));
+        ASSERT_EQUAL(16u, logger.getDroppedCount());
+        ASSERT_EQUAL(1u, output.count("records dropped dropped=16"));
+        return true;
+    });
+    
+    TEST("LogSampler::allow - limits lines per second and reports suppressed") {
+        LogSampler sampler(3);
+        uint64_t suppressed = 0;
+        int allowed = 0;
+        for (int i = 0; i < 10; ++i) {
+            if (sampler.allow(suppressed)) {
+                allowed++;
+            }
+        }
+        // The window may roll over once during the loop
+        ASSERT_TRUE(allowed >= 3 && allowed <= 6);
+        return true;
+    });
+    
+    TEST("Logger::parseLevel - accepts level names case-insensitively") {
+        LogLevel level = LogLevel::Info;
+        ASSERT_TRUE(Logger::parseLevel("DEBUG", level));
+        ASSERT_TRUE(level == LogLevel::Debug);
+        ASSERT_TRUE(Logger::parseLevel("warning", level));
+        ASSERT_TRUE(level == LogLevel::Warn);
+        ASSERT_FALSE(Logger::parseLevel("verbose", level));
+        ASSERT_TRUE(level == LogLevel::Warn);
+        return true;
+    });
+}
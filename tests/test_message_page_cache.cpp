@@ -0,0 +1,121 @@
+#include "test_framework.h"
+#include "../src/utils/message_page_cache.h"
+#include <string>
+#include <vector>
+
+using namespace messaging_service;
+
+namespace {
+
+CachedPage pageOf(const std::string& body) {
+    CachedPage page;
+    page.body = body;
+    page.etag = "W/\"1.1\"";
+    return page;
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for MessagePageCache class
+ */
+void runMessagePageCacheTests(TestFramework& framework) {
+
+    // Test that a stored page is served until its conversation is written to
+    TEST("MessagePageCache::invalidate - drops only the written conversation") {
+        MessagePageCache cache;
+        CachedPage cached;
+        ASSERT_FALSE(cache.get(1, "", cached));
+
+        ASSERT_TRUE(cache.put(1, "", pageOf("{\"messages\": [1]}"), cache.beginFill()));
+        ASSERT_TRUE(cache.put(1, "after=5", pageOf("{\"messages\": [6]}"), cache.beginFill()));
+        ASSERT_TRUE(cache.put(2, "", pageOf("{\"messages\": [2]}"), cache.beginFill()));
+        ASSERT_TRUE(cache.get(1, "", cached));
+        ASSERT_EQUAL(std::string("{\"messages\": [1]}"), cached.body);
+
+        cache.invalidate(1);
+        ASSERT_FALSE(cache.get(1, "", cached));
+        ASSERT_FALSE(cache.get(1, "after=5", cached));
+        ASSERT_TRUE(cache.get(2, "", cached));
+        ASSERT_EQUAL(1u, cache.getPageCount());
+        return true;
+    });
+
+    // Test that a page read before a write is not stored after it
+    TEST("MessagePageCache::put - refuses pages read before an invalidation") {
+        MessagePageCache cache;
+        CachedPage cached;
+
+        auto staleTicket = cache.beginFill();
+        cache.invalidate(7);
+        ASSERT_FALSE(cache.put(7, "", pageOf("stale"), staleTicket));
+        ASSERT_FALSE(cache.get(7, "", cached));
+
+        // Other conversations are unaffected, and a fresh read is accepted
+        ASSERT_TRUE(cache.put(8, "", pageOf("other"), staleTicket));
+        ASSERT_TRUE(cache.put(7, "", pageOf("fresh"), cache.beginFill()));
+        ASSERT_TRUE(cache.get(7, "", cached));
+        ASSERT_EQUAL(std::string("fresh"), cached.body);
+
+        // Clearing forgets invalidations, so every read in progress is refused
+        auto ticket = cache.beginFill();
+        cache.clear();
+        ASSERT_FALSE(cache.put(9, "", pageOf("maybe stale"), ticket));
+        return true;
+    });
+
+    // Test that the least recently used pages are evicted to stay within budget
+    TEST("MessagePageCache::put - evicts least recently used pages over budget") {
+        std::string page(1000, 'x');
+        MessagePageCache cache(3 * 1200);
+        CachedPage cached;
+
+        ASSERT_TRUE(cache.put(1, "", pageOf(page), cache.beginFill()));
+        ASSERT_TRUE(cache.put(2, "", pageOf(page), cache.beginFill()));
+        ASSERT_TRUE(cache.put(3, "", pageOf(page), cache.beginFill()));
+        ASSERT_TRUE(cache.get(1, "", cached));    // 2 is now least recently used
+        ASSERT_TRUE(cache.put(4, "", pageOf(page), cache.beginFill()));
+
+        ASSERT_EQUAL(3u, cache.getPageCount());
+        ASSERT_FALSE(cache.get(2, "", cached));
+        ASSERT_TRUE(cache.get(1, "", cached));
+        ASSERT_TRUE(cache.getSizeBytes() <= 3 * 1200u);
+
+        // Pages larger than the whole budget are never stored, and a zero budget disables the cache
+        ASSERT_FALSE(cache.put(5, "", pageOf(std::string(4000, 'y')), cache.beginFill()));
+        cache.setBudget(0);
+        ASSERT_EQUAL(0u, cache.getPageCount());
+        ASSERT_FALSE(cache.put(1, "", pageOf(page), cache.beginFill()));
+        return true;
+    });
+
+    // Test the batch invalidation and tag listing used for other processes' writes
+    TEST("MessagePageCache::invalidate - batches and cached tags for resync") {
+        MessagePageCache cache;
+        ASSERT_FALSE(cache.isCoherent());
+        cache.setCoherent(true);
+        ASSERT_TRUE(cache.isCoherent());
+
+        auto ticket = cache.beginFill();
+        for (int id = 1; id <= 3; id++) {
+            CachedPage page = pageOf("{}");
+            page.etag = "W/\"" + std::to_string(id) + ".4\"";
+            ASSERT_TRUE(cache.put(id, "", page, ticket));
+        }
+        auto tags = cache.getCachedTags();
+        ASSERT_EQUAL(3u, tags.size());
+        bool foundSecond = false;
+        for (const auto& tag : tags) {
+            foundSecond = foundSecond || (tag.first == 2 && tag.second == "W/\"2.4\"");
+        }
+        ASSERT_TRUE(foundSecond);
+
+        cache.invalidate(std::vector<int>{1, 3, 9});
+        CachedPage cached;
+        ASSERT_FALSE(cache.get(1, "", cached));
+        ASSERT_TRUE(cache.get(2, "", cached));
+        ASSERT_FALSE(cache.get(3, "", cached));
+        ASSERT_FALSE(cache.put(3, "", pageOf("{}"), ticket));
+        return true;
+    });
+}
@@ -0,0 +1,101 @@
+#include "test_framework.h"
+#include "../src/utils/metrics.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace messaging_service;
+
+/**
+ * @brief Test cases for Counter, Histogram and MetricsRegistry classes
+ */
+void runMetricsTests(TestFramework& framework) {
+    
+    TEST("Counter::inc - sums increments from many threads") {
+        Counter counter;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&counter]() {
+                for (int i = 0; i < 10000; ++i) {
+                    counter.inc();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        ASSERT_EQUAL(80000u, counter.value());
+        return true;
+    });
+    
+    TEST("Histogram::bucketIndex - bounds are contiguous and monotonic") {
+        for (uint64_t value = 0; value < 100000; ++value) {
+            size_t index = Histogram::bucketIndex(value);
+            ASSERT_TRUE(value <= Histogram::bucketUpperBound(index));
+            if (index > 0) {
+                ASSERT_TRUE(value > Histogram::bucketUpperBound(index - 1));
+            }
+        }
+        ASSERT_TRUE(Histogram::bucketIndex(Histogram::kMaxValue) < Histogram::kBucketCount);
+        return true;
+    });
+    
+    TEST("Histogram::percentile - within bucket precision") {
+        Histogram histogram;
+        for (uint64_t value = 1; value <= 10000; ++value) {
+            histogram.record(value);
+        }
+        ASSERT_EQUAL(10000u, histogram.count());
+        ASSERT_EQUAL(50005000u, histogram.sum());
+        
+        uint64_t p50 = histogram.percentile(0.5);
+        uint64_t p99 = histogram.percentile(0.99);
+        ASSERT_TRUE(p50 >= 5000 && p50 <= 5000 * 107 / 100);
+        ASSERT_TRUE(p99 >= 9900 && p99 <= 9900 * 107 / 100);
+        ASSERT_EQUAL(0u, Histogram().percentile(0.5));
+        return true;
+    });
+    
+    TEST("Histogram::record - recording is cheap") {
+        Histogram histogram;
+        const int iterations = 1000000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            histogram.record(static_cast<uint64_t>(i & 0xffff));
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double nsPerRecord = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+        std::cout << "(" << nsPerRecord << " ns/record) ";
+        // Generous bound so unoptimised builds on busy machines still pass
+        ASSERT_TRUE(nsPerRecord < 1000.0);
+        ASSERT_EQUAL(static_cast<uint64_t>(iterations), histogram.count());
+        return true;
+    });
+    
+    TEST("MetricsRegistry::renderPrometheus - renders all metric types") {
+        MetricsRegistry registry;
+        registry.counter("requests_total", "Requests", {{"route", "/a"}}).inc(3);
+        registry.counter("requests_total", "Requests", {{"route", "/a"}}).inc(2);
+        registry.gauge("queue_depth", "Depth").set(7);
+        Histogram& latency = registry.histogram("latency_seconds", "Latency", {{"route", "/a"}});
+        latency.observe(std::chrono::milliseconds(3));
+        latency.observe(std::chrono::milliseconds(200));
+        uint64_t id = registry.addGaugeCallback("scheduled", "Scheduled", {}, [] { return 4.0; });
+        
+        std::string text = registry.renderPrometheus();
+        ASSERT_TRUE(text.find("# TYPE requests_total counter\n") != std::string::npos);
+        ASSERT_TRUE(text.find("requests_total{route=\"/a\"} 5\n") != std::string::npos);
+        ASSERT_TRUE(text.find("queue_depth 7\n") != std::string::npos);
+        ASSERT_TRUE(text.find("scheduled 4\n") != std::string::npos);
+        ASSERT_TRUE(text.find("# TYPE latency_seconds histogram\n") != std::string::npos);
+        ASSERT_TRUE(text.find("latency_seconds_bucket{route=\"/a\",le=\"0.001\"} 0\n") != std::string::npos);
+        ASSERT_TRUE(text.find("latency_seconds_bucket{route=\"/a\",le=\"0.005\"} 1\n") != std::string::npos);
+        ASSERT_TRUE(text.find("latency_seconds_bucket{route=\"/a\",le=\"+Inf\"} 2\n") != std::string::npos);
+        ASSERT_TRUE(text.find("latency_seconds_count{route=\"/a\"} 2\n") != std::string::npos);
+        
+        registry.removeGaugeCallback(id);
+        ASSERT_TRUE(registry.renderPrometheus().find("scheduled") == std::string::npos);
+        return true;
+    });
+}
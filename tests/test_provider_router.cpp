@@ -0,0 +1,128 @@
+#include "test_framework.h"
+#include "../src/providers/provider_router.h"
+#include "../src/providers/implementations/DefaultMessagingProvider.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace messaging_service;
+
+/**
+ * @brief Test cases for ProviderRouter class
+ */
+void runProviderRouterTests(TestFramework& framework) {
+    
+    TEST("ProviderRouter::selectProvider - empty and single candidate") {
+        ProviderRouter router(true);
+        std::vector<std::shared_ptr<MessagingProvider>> none;
+        ASSERT_TRUE(router.selectProvider(none) == nullptr);
+        
+        auto only = std::make_shared<DefaultMessagingProvider>("only", std::vector<std::string>{"sms"});
+        std::vector<std::shared_ptr<MessagingProvider>> one = {only};
+        ASSERT_TRUE(router.selectProvider(one) == only);
+        return true;
+    });
+    
+    TEST("ProviderRouter::selectProvider - prefers lower latency") {
+        ProviderRouter router(true);
+        auto fast = std::make_shared<DefaultMessagingProvider>("fast", std::vector<std::string>{"sms"});
+        auto slow = std::make_shared<DefaultMessagingProvider>("slow", std::vector<std::string>{"sms"});
+        for (int i = 0; i < 20; ++i) {
+            router.recordResult("fast", 10.0, true);
+            router.recordResult("slow", 400.0, true);
+        }
+        
+        std::vector<std::shared_ptr<MessagingProvider>> candidates = {fast, slow};
+        int fastPicks = 0;
+        for (int i = 0; i < 1000; ++i) {
+            if (router.selectProvider(candidates) == fast) {
+                fastPicks++;
+            }
+        }
+        // Only exploration should ever pick the slow provider
+        ASSERT_TRUE(fastPicks > 950);
+        return true;
+    });
+    
+    TEST("ProviderRouter::selectProvider - avoids failing provider") {
+        ProviderRouter router(true);
+        auto healthy = std::make_shared<DefaultMessagingProvider>("healthy", std::vector<std::string>{"sms"});
+        auto failing = std::make_shared<DefaultMessagingProvider>("failing", std::vector<std::string>{"sms"});
+        for (int i = 0; i < 20; ++i) {
+            router.recordResult("healthy", 50.0, true);
+            router.recordResult("failing", 50.0, false);
+        }
+        
+        std::vector<std::shared_ptr<MessagingProvider>> candidates = {healthy, failing};
+        int healthyPicks = 0;
+        for (int i = 0; i < 1000; ++i) {
+            if (router.selectProvider(candidates) == healthy) {
+                healthyPicks++;
+            }
+        }
+        ASSERT_TRUE(healthyPicks > 950);
+        return true;
+    });
+    
+    TEST("ProviderRouter::recordResult - EWMA moves toward new samples") {
+        ProviderRouter router(true, 0.5);
+        router.recordResult("p", 100.0, true);
+        router.recordResult("p", 200.0, false);
+        
+        auto stats = router.getStats();
+        ASSERT_EQUAL(1u, stats.size());
+        ASSERT_EQUAL("p", stats[0].name);
+        ASSERT_TRUE(stats[0].ewmaLatencyMs > 149.0 && stats[0].ewmaLatencyMs < 151.0);
+        ASSERT_TRUE(stats[0].successRate > 0.49 && stats[0].successRate < 0.51);
+        ASSERT_EQUAL(2u, stats[0].requests);
+        ASSERT_EQUAL(1u, stats[0].failures);
+        return true;
+    });
+    
+    TEST("ProviderRouter::dispatch - tracks requests and clears in-flight count") {
+        ProviderRouter router(true);
+        auto provider = std::make_shared<DefaultMessagingProvider>("dispatch_test", std::vector<std::string>{"sms"});
+        MessageRequest request("+15550001", "+15550002", "sms", "hello", "dispatch_test", "2024-11-01T14:00:00Z");
+        
+        MessageResponse response = router.dispatch(provider, request);
+        ASSERT_TRUE(response.success);
+        
+        auto stats = router.getStats();
+        ASSERT_EQUAL(1u, stats.size());
+        ASSERT_EQUAL(1u, stats[0].requests);
+        ASSERT_EQUAL(0u, stats[0].outstanding);
+        ASSERT_EQUAL(0u, stats[0].failures);
+        return true;
+    });
+    
+    TEST("ProviderRouter::selectProviderForType - weighted mode keeps to the type's configured providers") {
+        MessagingProviderFactory::registerProvider("configured_sms",
+            std::make_shared<DefaultMessagingProvider>("configured_sms", std::vector<std::string>{"sms"}));
+        ProviderRouter router(true);
+        
+        ASSERT_TRUE(MessagingProviderFactory::setProviderForType("sms", "configured_sms"));
+        for (int i = 0; i < 200; ++i) {
+            ASSERT_EQUAL("configured_sms", router.selectProviderForType("sms")->getProviderName());
+        }
+        
+        // A set of providers shares the type; registered ones outside it never do
+        ASSERT_TRUE(MessagingProviderFactory::setProvidersForType("sms", {"configured_sms", "twilio"}));
+        ASSERT_FALSE(MessagingProviderFactory::setProvidersForType("sms", {"default_email"}));
+        for (int i = 0; i < 200; ++i) {
+            std::string name = router.selectProviderForType("sms")->getProviderName();
+            ASSERT_TRUE(name == "configured_sms" || name == "twilio");
+        }
+        
+        ASSERT_TRUE(MessagingProviderFactory::setProvidersForType("sms", {"default_sms", "twilio"}));
+        ASSERT_EQUAL("default_sms", MessagingProviderFactory::getProviderForType("sms")->getProviderName());
+        return true;
+    });
+    
+    TEST("ProviderRouter::selectProviderForType - fixed mode uses type mapping") {
+        ProviderRouter router(false);
+        auto provider = router.selectProviderForType("sms");
+        ASSERT_TRUE(provider != nullptr);
+        ASSERT_EQUAL("default_sms", provider->getProviderName());
+        return true;
+    });
+}
@@ -0,0 +1,133 @@
+#include "test_framework.h"
+#include "../src/utils/rate_shaper.h"
+#include <chrono>
+#include <string>
+
+using namespace messaging_service;
+
+/**
+ * @brief Test cases for RateShaper and TokenBucketTable classes
+ */
+void runRateShaperTests(TestFramework& framework) {
+    
+    TEST("RateShaper::reserve - disabled shaper never delays") {
+        RateShaper shaper(RateShaperConfig{});
+        std::chrono::milliseconds delay(0);
+        for (int i = 0; i < 100; ++i) {
+            ASSERT_TRUE(shaper.reserve("+15550001", "+15550002", "twilio", delay));
+            ASSERT_EQUAL(0, delay.count());
+        }
+        ASSERT_FALSE(shaper.enabled());
+        ASSERT_EQUAL(0u, shaper.bucketCount());
+        return true;
+    });
+    
+    TEST("RateShaper::reserve - per sender rate spaces sends") {
+        RateShaperConfig config;
+        config.perSender.ratePerSecond = 1.0;
+        RateShaper shaper(config);
+        
+        std::chrono::milliseconds delay(0);
+        ASSERT_TRUE(shaper.reserve("+15550001", "+15550002", "twilio", delay));
+        ASSERT_EQUAL(0, delay.count());
+        ASSERT_TRUE(shaper.reserve("+15550001", "+15550003", "twilio", delay));
+        ASSERT_TRUE(delay.count() > 900 && delay.count() <= 1001);
+        ASSERT_TRUE(shaper.reserve("+15550001", "+15550004", "twilio", delay));
+        ASSERT_TRUE(delay.count() > 1900 && delay.count() <= 2001);
+        
+        // A different sender has its own bucket
+        ASSERT_TRUE(shaper.reserve("+15559999", "+15550002", "twilio", delay));
+        ASSERT_EQUAL(0, delay.count());
+        return true;
+    });
+    
+    TEST("RateShaper::reserve - burst allows immediate sends") {
+        RateShaperConfig config;
+        config.perSender.ratePerSecond = 1.0;
+        config.perSender.burst = 3.0;
+        RateShaper shaper(config);
+        
+        std::chrono::milliseconds delay(0);
+        for (int i = 0; i < 3; ++i) {
+            ASSERT_TRUE(shaper.reserve("sender", "to" + std::to_string(i), "p", delay));
+            ASSERT_EQUAL(0, delay.count());
+        }
+        ASSERT_TRUE(shaper.reserve("sender", "to3", "p", delay));
+        ASSERT_TRUE(delay.count() > 900);
+        return true;
+    });
+    
+    TEST("RateShaper::reserve - slowest level in hierarchy wins") {
+        RateShaperConfig config;
+        config.perSender.ratePerSecond = 100.0;
+        config.perProvider.ratePerSecond = 2.0;
+        RateShaper shaper(config);
+        
+        std::chrono::milliseconds delay(0);
+        ASSERT_TRUE(shaper.reserve("a", "x", "p", delay));
+        ASSERT_EQUAL(0, delay.count());
+        ASSERT_TRUE(shaper.reserve("b", "y", "p", delay));
+        ASSERT_TRUE(delay.count() > 450 && delay.count() <= 501);
+        return true;
+    });
+    
+    TEST("RateShaper::reserve - rejects beyond max delay without consuming") {
+        RateShaperConfig config;
+        config.perRecipient.ratePerSecond = 1.0;
+        config.maxDelay = std::chrono::seconds(2);
+        RateShaper shaper(config);
+        
+        std::chrono::milliseconds delay(0);
+        ASSERT_TRUE(shaper.reserve("a", "x", "p", delay));
+        ASSERT_TRUE(shaper.reserve("a", "x", "p", delay));
+        ASSERT_TRUE(shaper.reserve("a", "x", "p", delay));
+        ASSERT_FALSE(shaper.reserve("a", "x", "p", delay));
+        ASSERT_FALSE(shaper.reserve("a", "x", "p", delay));
+        return true;
+    });
+    
+    TEST("RateShaper::release - returns the tokens of an unused reservation") {
+        RateShaperConfig config;
+        config.perSender.ratePerSecond = 1.0;
+        config.perProvider.ratePerSecond = 1.0;
+        RateShaper shaper(config);
+        
+        std::chrono::milliseconds delay(0);
+        ASSERT_TRUE(shaper.reserve("sender", "to1", "p", delay));
+        ASSERT_EQUAL(0, delay.count());
+        ASSERT_TRUE(shaper.reserve("sender", "to2", "p", delay));
+        ASSERT_TRUE(delay.count() > 900);
+        
+        // Both sends fail before reaching the provider; the next one goes straight out
+        shaper.release("sender", "to2", "p");
+        shaper.release("sender", "to1", "p");
+        ASSERT_TRUE(shaper.reserve("sender", "to3", "p", delay));
+        ASSERT_EQUAL(0, delay.count());
+        
+        // Releasing a key that never reserved changes nothing
+        shaper.release("other", "to4", "q");
+        ASSERT_TRUE(shaper.reserve("sender", "to5", "p", delay));
+        ASSERT_TRUE(delay.count() > 900);
+        return true;
+    });
+    
+    TEST("TokenBucketTable::evictIdle - removes only full idle buckets") {
+        RateLimit limit;
+        limit.ratePerSecond = 1000.0;
+        TokenBucketTable table(limit, 4, std::chrono::seconds(0));
+        
+        auto now = TokenBucketTable::Clock::now();
+        for (int i = 0; i < 100; ++i) {
+            std::string key = "key" + std::to_string(i);
+            auto lock = table.lockShard(key);
+            table.consume(key, now);
+        }
+        ASSERT_TRUE(table.size() > 0);
+        
+        // Every bucket refills within a millisecond at 1000/s
+        size_t removed = table.evictIdle(now + std::chrono::seconds(1));
+        ASSERT_TRUE(removed > 0);
+        ASSERT_EQUAL(0u, table.size());
+        return true;
+    });
+}
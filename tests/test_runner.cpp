@@ -3,6 +3,28 @@
 
 // Forward declarations for test functions
 void runJsonParserTests(TestFramework& framework);
+void runProviderRouterTests(TestFramework& framework);
+void runIdGeneratorTests(TestFramework& framework);
+void runRateShaperTests(TestFramework& framework);
+void runOrderedDispatcherTests(TestFramework& framework);
+void runLoggerTests(TestFramework& framework);
+void runMetricsTests(TestFramework& framework);
+void runTracingTests(TestFramework& framework);
+void runServerConfigTests(TestFramework& framework);
+void runSupervisorTests(TestFramework& framework);
+void runAdmissionControllerTests(TestFramework& framework);
+void runWorkerPoolTests(TestFramework& framework);
+void runFairQueueTests(TestFramework& framework);
+void runMessagePageCacheTests(TestFramework& framework);
+void runConditionalGetTests(TestFramework& framework);
+void runCompressionTests(TestFramework& framework);
+void runEventStreamTests(TestFramework& framework);
+void runDuplicateFilterTests(TestFramework& framework);
+void runIdempotencyStoreTests(TestFramework& framework);
+void runSendQueueTests(TestFramework& framework);
+#ifdef HAVE_HTTPLIB
+void runHttpProviderTests(TestFramework& framework);
+#endif
 
 /**
  * @brief Main test runner
@@ -14,6 +36,28 @@ int main() {
     
     // Run all test suites
     runJsonParserTests(framework);
+    runProviderRouterTests(framework);
+    runIdGeneratorTests(framework);
+    runRateShaperTests(framework);
+    runOrderedDispatcherTests(framework);
+    runLoggerTests(framework);
+    runMetricsTests(framework);
+    runTracingTests(framework);
+    runServerConfigTests(framework);
+    runSupervisorTests(framework);
+    runAdmissionControllerTests(framework);
+    runWorkerPoolTests(framework);
+    runFairQueueTests(framework);
+    runMessagePageCacheTests(framework);
+    runConditionalGetTests(framework);
+    runCompressionTests(framework);
+    runEventStreamTests(framework);
+    runDuplicateFilterTests(framework);
+    runIdempotencyStoreTests(framework);
+    runSendQueueTests(framework);
+#ifdef HAVE_HTTPLIB
+    runHttpProviderTests(framework);
+#endif
     
     // Execute all tests
     bool allPassed = framework.runTests();
@@ -0,0 +1,99 @@
+#include "test_framework.h"
+#include "../src/utils/send_queue.h"
+#include "../src/utils/idempotency_store.h"
+#include "../src/utils/worker_pool.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using namespace messaging_service;
+
+namespace {
+
+// One request with an Idempotency-Key, decided the way the send handlers decide it
+IdempotencyStore::Outcome sendWithKey(IdempotencyStore& store, SendQueue& queue, std::atomic<int>& sends,
+                                      IdempotentResponse& response) {
+    auto outcome = store.begin("key", "fingerprint", std::chrono::milliseconds(0), response);
+    if (outcome != IdempotencyStore::Outcome::Acquired) {
+        return outcome;
+    }
+
+    MessageResponse sent;
+    auto result = queue.send("tenant", 1, [&sends] {
+        sends++;
+        return MessageResponse(true, "sent", "vendor-1");
+    }, sent);
+    bool dispatched = result == SendQueue::Outcome::Sent;
+    response.status = dispatched ? 200 : (result == SendQueue::Outcome::TenantQueueFull ? 429 : 503);
+    response.body = sent.provider_message_id;
+
+    if (IdempotencyStore::isFinal(response.status, dispatched)) {
+        store.complete("key", response);
+    } else {
+        store.abandon("key");
+    }
+    return outcome;
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for SendQueue
+ */
+void runSendQueueTests(TestFramework& framework) {
+
+    // Test that a send runs on the lanes and its response comes back to the caller
+    TEST("SendQueue::send - returns the provider's response") {
+        WorkerPool pool(2);
+        OrderedDispatcher dispatcher(&pool, 8);
+        FairQueue fairQueue;
+        SendQueue queue(&fairQueue, &dispatcher);
+
+        MessageResponse response;
+        auto outcome = queue.send("tenant", 7, [] { return MessageResponse(false, "rejected", "", 502); }, response);
+        ASSERT_TRUE(outcome == SendQueue::Outcome::Sent);
+        ASSERT_FALSE(response.success);
+        ASSERT_EQUAL(502, response.http_status_code);
+        ASSERT_EQUAL(0u, fairQueue.getInFlightCount());
+
+        // A send that throws still reached the provider, so it is reported as sent and failed
+        outcome = queue.send("tenant", 7, []() -> MessageResponse { throw std::runtime_error("boom"); }, response);
+        ASSERT_TRUE(outcome == SendQueue::Outcome::Sent);
+        ASSERT_EQUAL(500, response.http_status_code);
+        return true;
+    });
+
+    // Test that a stopped worker pool refuses the send, and a retry with the same key sends
+    TEST("SendQueue::send - a stopped pool leaves the key free for a retry that sends") {
+        IdempotencyStore store;
+        std::atomic<int> sends(0);
+        IdempotentResponse response;
+
+        auto stopped = std::make_unique<WorkerPool>(2);
+        OrderedDispatcher stoppedDispatcher(stopped.get(), 8);
+        FairQueue fairQueue;
+        SendQueue stoppedQueue(&fairQueue, &stoppedDispatcher);
+        stopped->stop();
+
+        ASSERT_TRUE(sendWithKey(store, stoppedQueue, sends, response) == IdempotencyStore::Outcome::Acquired);
+        ASSERT_EQUAL(503, response.status);
+        ASSERT_EQUAL(0, sends.load());
+        ASSERT_EQUAL(0u, fairQueue.getInFlightCount());
+
+        // The retry acquires the key again instead of replaying the refusal
+        WorkerPool pool(2);
+        OrderedDispatcher dispatcher(&pool, 8);
+        SendQueue queue(&fairQueue, &dispatcher);
+        ASSERT_TRUE(sendWithKey(store, queue, sends, response) == IdempotencyStore::Outcome::Acquired);
+        ASSERT_EQUAL(200, response.status);
+        ASSERT_EQUAL(1, sends.load());
+
+        // Once sent, the key replays
+        ASSERT_TRUE(sendWithKey(store, queue, sends, response) == IdempotencyStore::Outcome::Replayed);
+        ASSERT_EQUAL(std::string("vendor-1"), response.body);
+        ASSERT_EQUAL(1, sends.load());
+        return true;
+    });
+}
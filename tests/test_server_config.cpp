@@ -0,0 +1,140 @@
+#include "test_framework.h"
+#include "../src/server/server_config.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace messaging_service;
+
+namespace {
+
+std::string writeConfigFile(const std::string& contents) {
+    std::string path = "/tmp/messaging_service_server_config_" + std::to_string(getpid()) + ".conf";
+    std::ofstream file(path);
+    file << contents;
+    return path;
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for ServerConfig class
+ */
+void runServerConfigTests(TestFramework& framework) {
+
+    // Test that a bare first argument is still taken as the port
+    TEST("ServerConfig::applyArguments - positional port and flags") {
+        ServerConfig config;
+        std::string error;
+        char program[] = "messaging-service";
+        char port[] = "9090";
+        char threads[] = "--threads";
+        char threadCount[] = "24";
+        char timeout[] = "--keep-alive-timeout=15";
+        char* argv[] = {program, port, threads, threadCount, timeout};
+
+        ASSERT_TRUE(config.applyArguments(5, argv, error));
+        ASSERT_EQUAL(9090, config.port);
+        ASSERT_EQUAL(24u, config.threads);
+        ASSERT_EQUAL(15, config.keepAliveTimeoutSec);
+        return true;
+    });
+
+    // Test that invalid and unknown settings are rejected with a message
+    TEST("ServerConfig::set - rejects invalid values") {
+        ServerConfig config;
+        std::string error;
+        ASSERT_FALSE(config.set("port", "70000", error));
+        ASSERT_TRUE(error.find("port") != std::string::npos);
+        ASSERT_FALSE(config.set("threads", "eight", error));
+        ASSERT_FALSE(config.set("read_timeout", "5s", error));
+        ASSERT_FALSE(config.set("keep_alive_max_count", "0", error));
+        ASSERT_FALSE(config.set("drain_timeout", "-1", error));
+        ASSERT_TRUE(config.set("drain_delay", "0", error));
+        ASSERT_EQUAL(0, config.drainDelaySec);
+        ASSERT_TRUE(config.set("page_cache_mb", "0", error));
+        ASSERT_EQUAL(0u, config.pageCacheMb);
+        ASSERT_TRUE(config.set("events_port", "0", error));
+        ASSERT_EQUAL(0, config.eventsPort);
+        ASSERT_FALSE(config.set("events_max_streams", "0", error));
+        ASSERT_TRUE(config.set("message_retention_months", "24", error));
+        ASSERT_EQUAL(24, config.messageRetentionMonths);
+        ASSERT_FALSE(config.set("message_retention_months", "-1", error));
+        ASSERT_FALSE(config.set("workers_per_core", "2", error));
+        ASSERT_TRUE(error.find("Unknown setting") != std::string::npos);
+        ASSERT_EQUAL(8080, config.port);
+        return true;
+    });
+
+    // Test that the file is applied first, then the environment, then flags
+    TEST("ServerConfig::load - file, environment and flags in order") {
+        std::string path = writeConfigFile(
+            "# tuned for the load balancer\n"
+            "threads = 16\n"
+            "keep_alive_max_count = 500   # reuse connections longer\n"
+            "payload_max_bytes = 65536\n"
+            "listen_backlog = 4096\n");
+        setenv("SERVER_THREADS", "32", 1);
+        setenv("SERVER_READ_TIMEOUT", "10", 1);
+
+        std::string configFlag = "--config=" + path;
+        char program[] = "messaging-service";
+        char readTimeout[] = "--read-timeout";
+        char readTimeoutValue[] = "20";
+        char* argv[] = {program, &configFlag[0], readTimeout, readTimeoutValue};
+
+        ServerConfig config;
+        std::string error;
+        bool loaded = ServerConfig::load(4, argv, config, error);
+        unsetenv("SERVER_THREADS");
+        unsetenv("SERVER_READ_TIMEOUT");
+        std::remove(path.c_str());
+
+        ASSERT_TRUE(loaded);
+        ASSERT_EQUAL(32u, config.threads);
+        ASSERT_EQUAL(500u, config.keepAliveMaxCount);
+        ASSERT_EQUAL(65536u, config.payloadMaxBytes);
+        ASSERT_EQUAL(4096, config.listenBacklog);
+        ASSERT_EQUAL(20, config.readTimeoutSec);
+        ASSERT_EQUAL(5, config.writeTimeoutSec);
+        return true;
+    });
+
+    // Test that errors in the config file name the line
+    TEST("ServerConfig::applyFile - reports the failing line") {
+        std::string path = writeConfigFile("threads = 8\nport 8080\n");
+        ServerConfig config;
+        std::string error;
+        bool applied = config.applyFile(path, error);
+        std::remove(path.c_str());
+
+        ASSERT_FALSE(applied);
+        ASSERT_TRUE(error.find(":2:") != std::string::npos);
+        ASSERT_FALSE(config.applyFile("/nonexistent/messaging-service.conf", error));
+        return true;
+    });
+
+    // Test automatic thread sizing
+    TEST("ServerConfig::resolvedThreads - sized from cores, connections and workers") {
+        ServerConfig config;
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        ASSERT_TRUE(config.resolvedThreads() >= cores * 4);
+        ASSERT_TRUE(config.resolvedThreads() >= 8u);
+
+        config.expectedConnections = 5000;
+        ASSERT_TRUE(config.resolvedThreads() >= 5000u);
+
+        // Worker processes share the expected connections
+        config.workers = 4;
+        ASSERT_EQUAL(4u, config.resolvedWorkers());
+        ASSERT_EQUAL(1250u, config.resolvedThreads());
+
+        config.threads = 12;
+        ASSERT_EQUAL(12u, config.resolvedThreads());
+        return true;
+    });
+}
@@ -0,0 +1,103 @@
+#include "test_framework.h"
+#include "../src/server/supervisor.h"
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace messaging_service;
+
+namespace {
+
+// Reads bytes written by worker processes, giving up after a timeout
+size_t readStarts(int fd, size_t wanted, std::string& seen) {
+    while (seen.size() < wanted) {
+        pollfd readable{fd, POLLIN, 0};
+        if (poll(&readable, 1, 5000) <= 0) {
+            break;
+        }
+        char byte;
+        if (read(fd, &byte, 1) != 1) {
+            break;
+        }
+        seen += byte;
+    }
+    return seen.size();
+}
+
+SupervisorOptions fastOptions(size_t workers) {
+    SupervisorOptions options;
+    options.workers = workers;
+    options.shutdownTimeout = std::chrono::milliseconds(5000);
+    options.minRestartDelay = std::chrono::milliseconds(10);
+    options.maxRestartDelay = std::chrono::milliseconds(40);
+    return options;
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for Supervisor class
+ */
+void runSupervisorTests(TestFramework& framework) {
+
+    // Test that every worker starts with its own index and stops on shutdown
+    TEST("Supervisor::run - starts workers and stops them on shutdown") {
+        int pipeFds[2];
+        ASSERT_TRUE(pipe(pipeFds) == 0);
+
+        Supervisor supervisor(fastOptions(3), [&pipeFds](size_t index) {
+            char byte = static_cast<char>('0' + index);
+            if (write(pipeFds[1], &byte, 1) != 1) {
+                _exit(2);
+            }
+            pause();   // until SIGTERM from the supervisor
+            _exit(0);
+            return 0;
+        });
+
+        int result = -1;
+        std::thread runner([&supervisor, &result] { result = supervisor.run(); });
+        std::string seen;
+        size_t started = readStarts(pipeFds[0], 3, seen);
+        supervisor.requestStop();
+        runner.join();
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+
+        ASSERT_EQUAL(3u, started);
+        ASSERT_TRUE(seen.find('0') != std::string::npos);
+        ASSERT_TRUE(seen.find('1') != std::string::npos);
+        ASSERT_TRUE(seen.find('2') != std::string::npos);
+        ASSERT_EQUAL(0, result);
+        ASSERT_EQUAL(0u, supervisor.getRestartCount());
+        return true;
+    });
+
+    // Test that a worker that dies is started again
+    TEST("Supervisor::run - restarts workers that exit") {
+        int pipeFds[2];
+        ASSERT_TRUE(pipe(pipeFds) == 0);
+
+        Supervisor supervisor(fastOptions(1), [&pipeFds](size_t) {
+            char byte = 'x';
+            if (write(pipeFds[1], &byte, 1) != 1) {
+                _exit(2);
+            }
+            _exit(3);
+            return 3;
+        });
+
+        int result = -1;
+        std::thread runner([&supervisor, &result] { result = supervisor.run(); });
+        std::string seen;
+        size_t started = readStarts(pipeFds[0], 3, seen);
+        supervisor.requestStop();
+        runner.join();
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+
+        ASSERT_EQUAL(3u, started);
+        ASSERT_TRUE(supervisor.getRestartCount() >= 2u);
+        return true;
+    });
+}
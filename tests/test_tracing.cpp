@@ -0,0 +1,196 @@
+#include "test_framework.h"
+#include "../src/utils/tracing.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace messaging_service;
+
+namespace {
+
+std::string tempTracePath(const std::string& name) {
+    return "/tmp/messaging_service_" + name + "_" + std::to_string(getpid()) + ".json";
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+size_t countLines(const std::string& text) {
+    size_t lines = 0;
+    for (char c : text) {
+        if (c == '\n') {
+            lines++;
+        }
+    }
+    return lines;
+}
+
+// Span id of the active span, as it appears in exported JSON
+std::string currentSpanHex() {
+    return Tracer::currentContext().toTraceparent().substr(36, 16);
+}
+
+TracerConfig exportAll(const std::string& path) {
+    TracerConfig config;
+    config.sampleRate = 1.0;
+    config.exportFile = path;
+    return config;
+}
+
+} // namespace
+
+/**
+ * @brief Test cases for Tracer, RequestTrace and Span classes
+ */
+void runTracingTests(TestFramework& framework) {
+
+    // Test W3C traceparent round-trip and rejection of malformed values
+    TEST("TraceContext::fromTraceparent - round trip and malformed values") {
+        TraceContext context;
+        ASSERT_TRUE(TraceContext::fromTraceparent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01", context));
+        ASSERT_EQUAL("4bf92f3577b34da6a3ce929d0e0e4736", context.traceIdHex());
+        ASSERT_TRUE(context.sampled);
+        ASSERT_EQUAL("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01", context.toTraceparent());
+
+        TraceContext unchanged;
+        ASSERT_FALSE(TraceContext::fromTraceparent("", unchanged));
+        ASSERT_FALSE(TraceContext::fromTraceparent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7", unchanged));
+        ASSERT_FALSE(TraceContext::fromTraceparent("00-4bf92f3577b34da6a3ce929d0e0e473g-00f067aa0ba902b7-01", unchanged));
+        ASSERT_FALSE(TraceContext::fromTraceparent("00-00000000000000000000000000000000-00f067aa0ba902b7-01", unchanged));
+        ASSERT_FALSE(unchanged.valid());
+        return true;
+    });
+
+    // Test that nothing is recorded while tracing is disabled
+    TEST("Span - no-op when tracing is disabled") {
+        Tracer tracer{TracerConfig()};
+        ASSERT_FALSE(tracer.enabled());
+
+        RequestTrace trace("GET /health", "req-1", nullptr, tracer);
+        ASSERT_FALSE(trace.context().valid());
+        Span span("json.parse");
+        ASSERT_FALSE(span.active());
+        ASSERT_FALSE(Tracer::currentContext().valid());
+        return true;
+    });
+
+    // Test that child spans are parented to the span active when they start
+    TEST("Span - children parented to the active span") {
+        std::string path = tempTracePath("nest");
+        std::remove(path.c_str());
+        std::string rootId, parseId, dbId;
+        {
+            Tracer tracer(exportAll(path));
+            {
+                RequestTrace trace("POST /api/messages/sms", "req-nest", nullptr, tracer);
+                rootId = currentSpanHex();
+                {
+                    Span parse("json.parse");
+                    parseId = currentSpanHex();
+                }
+                {
+                    Span db("db.insert_message");
+                    db.setAttribute("rows", "1");
+                    dbId = currentSpanHex();
+                }
+                ASSERT_EQUAL(rootId, currentSpanHex());
+            }
+            ASSERT_FALSE(Tracer::currentContext().valid());
+            tracer.flush();
+        }
+
+        std::string exported = readFile(path);
+        std::remove(path.c_str());
+        ASSERT_EQUAL(1u, countLines(exported));
+        ASSERT_TRUE(parseId != dbId);
+        ASSERT_TRUE(exported.find("\"spanId\":\"" + parseId + "\",\"parentSpanId\":\"" + rootId + "\",\"name\":\"json.parse\"") != std::string::npos);
+        ASSERT_TRUE(exported.find("\"spanId\":\"" + dbId + "\",\"parentSpanId\":\"" + rootId + "\",\"name\":\"db.insert_message\"") != std::string::npos);
+        ASSERT_TRUE(exported.find("\"key\":\"request.id\",\"value\":{\"stringValue\":\"req-nest\"}") != std::string::npos);
+        return true;
+    });
+
+    // Test that a captured trace continues on another thread
+    TEST("TraceScope - continues a captured trace on another thread") {
+        std::string path = tempTracePath("propagate");
+        std::remove(path.c_str());
+        std::string traceId, rootId, workerParentId;
+        {
+            Tracer tracer(exportAll(path));
+            {
+                RequestTrace trace("POST /api/messages/email", "req-thread", nullptr, tracer);
+                traceId = trace.context().traceIdHex();
+                rootId = currentSpanHex();
+                CapturedTrace captured = CapturedTrace::current();
+                auto enqueued = std::chrono::system_clock::now();
+
+                std::thread worker([&captured, enqueued, &workerParentId] {
+                    recordSpan(captured, "worker_pool.wait", enqueued, std::chrono::system_clock::now());
+                    TraceScope scope(captured);
+                    workerParentId = currentSpanHex();
+                    Span send("provider.send");
+                });
+                worker.join();
+                ASSERT_EQUAL(rootId, currentSpanHex());
+            }
+            tracer.flush();
+        }
+
+        std::string exported = readFile(path);
+        std::remove(path.c_str());
+        ASSERT_EQUAL(rootId, workerParentId);
+        ASSERT_TRUE(exported.find("\"name\":\"worker_pool.wait\"") != std::string::npos);
+        ASSERT_TRUE(exported.find("\"parentSpanId\":\"" + rootId + "\",\"name\":\"provider.send\"") != std::string::npos);
+        ASSERT_TRUE(exported.find("\"traceId\":\"" + traceId + "\"") != std::string::npos);
+        return true;
+    });
+
+    // Test that a trace started from a parent context keeps its trace id and sampling decision
+    TEST("RequestTrace - keeps parent trace id and sampling decision") {
+        TracerConfig config;
+        config.slowThresholdMs = 60000;
+        Tracer tracer(config);
+
+        TraceContext parent;
+        ASSERT_TRUE(TraceContext::fromTraceparent("00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01", parent));
+        RequestTrace trace("scheduler.send", "req-parent", &parent, tracer);
+        TraceContext context = trace.context();
+        ASSERT_EQUAL(parent.traceIdHex(), context.traceIdHex());
+        ASSERT_TRUE(context.sampled);
+        ASSERT_TRUE(context.spanId != parent.spanId);
+        return true;
+    });
+
+    // Test OTLP JSON serialisation of a single span
+    TEST("Tracer::toOtlpJson - serialises span fields") {
+        TraceContext context;
+        context.traceIdHigh = 1;
+        context.traceIdLow = 2;
+        context.spanId = 3;
+
+        SpanData root;
+        root.name = "GET \"quoted\"";
+        root.spanId = 3;
+        root.startNs = 1000;
+        root.endNs = 2500;
+        root.error = true;
+        root.attributes.emplace_back("http.status_code", "503");
+
+        std::string json = Tracer::toOtlpJson(context, {root});
+        ASSERT_TRUE(json.find("\"resourceSpans\":[") != std::string::npos);
+        ASSERT_TRUE(json.find("\"traceId\":\"00000000000000010000000000000002\"") != std::string::npos);
+        ASSERT_TRUE(json.find("\"spanId\":\"0000000000000003\"") != std::string::npos);
+        ASSERT_TRUE(json.find("parentSpanId") == std::string::npos);
+        ASSERT_TRUE(json.find("\"name\":\"GET \\\"quoted\\\"\"") != std::string::npos);
+        ASSERT_TRUE(json.find("\"kind\":2") != std::string::npos);
+        ASSERT_TRUE(json.find("\"startTimeUnixNano\":\"1000\",\"endTimeUnixNano\":\"2500\"") != std::string::npos);
+        ASSERT_TRUE(json.find("\"status\":{\"code\":2}") != std::string::npos);
+        return true;
+    });
+}
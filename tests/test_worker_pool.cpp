@@ -0,0 +1,135 @@
+#include "test_framework.h"
+#include "../src/utils/ordered_dispatcher.h"
+#include "../src/utils/worker_pool.h"
+#include <algorithm>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace messaging_service;
+
+/**
+ * @brief Test cases for WorkerPool and PriorityScheduler classes
+ */
+void runWorkerPoolTests(TestFramework& framework) {
+
+    // Test that busy classes are served in proportion to their weights
+    TEST("PriorityScheduler::next - shares service by weight") {
+        PriorityScheduler scheduler;   // 8:2:1
+        std::array<bool, kTaskPriorityCount> allWaiting{true, true, true};
+        for (size_t i = 0; i < kTaskPriorityCount; ++i) {
+            scheduler.activate(static_cast<TaskPriority>(i));
+        }
+
+        std::array<int, kTaskPriorityCount> served{0, 0, 0};
+        for (int i = 0; i < 1100; ++i) {
+            served[static_cast<size_t>(scheduler.next(allWaiting))]++;
+        }
+        ASSERT_EQUAL(800, served[0]);
+        ASSERT_EQUAL(200, served[1]);
+        ASSERT_EQUAL(100, served[2]);
+        return true;
+    });
+
+    // Test that a class that sat idle does not bank credit and starve the others
+    TEST("PriorityScheduler::activate - idle class rejoins at the current clock") {
+        PriorityWeights weights;
+        weights.interactive = 1;
+        weights.scheduled = 1;
+        PriorityScheduler scheduler(weights);
+        scheduler.activate(TaskPriority::Scheduled);
+        for (int i = 0; i < 1000; ++i) {
+            scheduler.next({false, true, false});
+        }
+
+        scheduler.activate(TaskPriority::Interactive);
+        int scheduledServed = 0;
+        for (int i = 0; i < 10; ++i) {
+            if (scheduler.next({true, true, false}) == TaskPriority::Scheduled) {
+                scheduledServed++;
+            }
+        }
+        ASSERT_TRUE(scheduledServed >= 4 && scheduledServed <= 6);
+        return true;
+    });
+
+    // Test that interactive work overtakes a queued bulk backlog without starving it
+    TEST("WorkerPool::submit - interactive tasks overtake queued bulk") {
+        WorkerPool pool(1);
+        std::promise<void> release;
+        std::shared_future<void> gate = release.get_future().share();
+        std::promise<void> started;
+        pool.submit([gate, &started]() {
+            started.set_value();
+            gate.wait();
+        });
+        started.get_future().wait();
+
+        std::mutex orderMutex;
+        std::string order;
+        auto record = [&orderMutex, &order](char c) {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            order += c;
+        };
+        std::vector<std::future<void>> futures;
+        for (int i = 0; i < 20; ++i) {
+            futures.push_back(pool.submit(TaskPriority::Scheduled, [&record]() { record('s'); }));
+        }
+        for (int i = 0; i < 8; ++i) {
+            futures.push_back(pool.submit(TaskPriority::Interactive, [&record]() { record('i'); }));
+        }
+        ASSERT_EQUAL(20u, pool.getPendingTaskCount(TaskPriority::Scheduled));
+        ASSERT_EQUAL(8u, pool.getPendingTaskCount(TaskPriority::Interactive));
+
+        release.set_value();
+        for (auto& future : futures) {
+            future.get();
+        }
+
+        // All interactive tasks finish within the first ten, with bulk still getting its share
+        std::string first = order.substr(0, 10);
+        ASSERT_EQUAL(8, static_cast<int>(std::count(first.begin(), first.end(), 'i')));
+        ASSERT_TRUE(first.find('s') != std::string::npos);
+        ASSERT_EQUAL(0u, pool.getPendingTaskCount());
+        return true;
+    });
+
+    // Test that interactive work raises its lane ahead of other bulk without reordering the lane
+    TEST("OrderedDispatcher::submit - interactive tasks raise their lane's priority") {
+        WorkerPool pool(1);
+        OrderedDispatcher dispatcher(&pool, 2);   // keys 1 and 2 hash onto different lanes
+        std::promise<void> release;
+        std::shared_future<void> gate = release.get_future().share();
+        pool.submit(TaskPriority::Scheduled, [gate]() { gate.wait(); });
+
+        std::mutex orderMutex;
+        std::vector<int> order;
+        auto record = [&orderMutex, &order](int value) {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            order.push_back(value);
+        };
+        std::vector<std::future<void>> futures;
+        for (int i = 0; i < 40; ++i) {
+            futures.push_back(dispatcher.submit(2, [&record, i]() { record(100 + i); }, TaskPriority::Scheduled));
+        }
+        for (int i = 0; i < 5; ++i) {
+            futures.push_back(dispatcher.submit(1, [&record, i]() { record(i); }, TaskPriority::Scheduled));
+        }
+        futures.push_back(dispatcher.submit(1, [&record]() { record(-1); }, TaskPriority::Interactive));
+
+        release.set_value();
+        for (auto& future : futures) {
+            future.get();
+        }
+
+        // The raised lane runs first, in submission order, ahead of the bulk lane queued before it
+        ASSERT_EQUAL(46u, order.size());
+        std::vector<int> raised(order.begin(), order.begin() + 6);
+        ASSERT_TRUE(raised == std::vector<int>({0, 1, 2, 3, 4, -1}));
+        for (size_t i = 6; i < order.size(); ++i) {
+            ASSERT_EQUAL(static_cast<int>(100 + i - 6), order[i]);
+        }
+        return true;
+    });
+}